@@ -0,0 +1,75 @@
+/**
+ * @file srcml_parse_events.c
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+  Example program of the use of the C API for srcML.
+
+  Count the elements of each source-code file using parse events, and compare
+  the time with generating the srcML of the file.
+*/
+
+#include <srcml.h>
+#include <stdio.h>
+#include <time.h>
+
+static void count_element(void* context, const char* prefix, const char* localname, const char* uri,
+                          int num_attributes, const char** attributes,
+                          int start_line, int start_column, int end_line, int end_column) {
+
+    ++*(int*) context;
+}
+
+int main(int argc, char* argv[]) {
+
+    struct srcml_parse_handler handler = { count_element, 0, 0 };
+
+    /* create a new srcml archive structure */
+    struct srcml_archive* archive = srcml_archive_create();
+    srcml_archive_enable_option(archive, SRCML_OPTION_POSITION);
+
+    for (int i = 1; i < argc; ++i) {
+
+        struct srcml_unit* unit = srcml_unit_create(archive);
+
+        /* parse the file to srcML */
+        clock_t start = clock();
+        srcml_unit_parse_filename(unit, argv[i]);
+        srcml_unit_get_srcml(unit);
+        double srcml_time = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+        srcml_unit_free(unit);
+        unit = srcml_unit_create(archive);
+
+        /* parse the file to events */
+        int count = 0;
+        start = clock();
+        srcml_unit_parse_filename_events(unit, argv[i], &handler, &count);
+        double events_time = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+        printf("%s: %d elements, srcML %.3fs, events %.3fs\n", argv[i], count, srcml_time, events_time);
+
+        srcml_unit_free(unit);
+    }
+
+    /* free the srcML archive data */
+    srcml_archive_free(archive);
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file BodyQueue.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef BODY_QUEUE_HPP
+#define BODY_QUEUE_HPP
+
+#include <srcml.h>
+#include <srcml_utilities.hpp>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <string>
+#include <memory>
+
+// The inner srcML of the units of an input, streamed in order from the input to the output.
+// The input keeps each unit while it streams its body, and then hands the unit over with the
+// end of its body. The input only waits when the output is too far behind.
+class BodyQueue {
+public:
+
+    // append part of the body of the current unit
+    inline void write(const char* srcml, size_t size) {
+
+        std::unique_ptr<Part> part(new Part);
+        part->srcml.assign(srcml, size);
+        push(std::move(part));
+    }
+
+    // end the body of the current unit, handing over the unit and the status of the input
+    inline void end(std::unique_ptr<srcml_unit> unit, int status) {
+
+        std::unique_ptr<Part> part(new Part);
+        part->unit = std::move(unit);
+        part->status = status;
+        part->end = true;
+        push(std::move(part));
+    }
+
+    // next part of the body of the unit being output, waiting for it, and false at the end of
+    // the body, with the unit and the status of the input
+    inline bool read(std::string& srcml, std::unique_ptr<srcml_unit>& unit, int& status) {
+
+        std::unique_ptr<Part> part;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv_part.wait(lock, [this]{ return !parts.empty(); });
+
+            part = std::move(parts.front());
+            parts.pop_front();
+            queued -= part->srcml.size() + sizeof(Part);
+        }
+        cv_space.notify_one();
+
+        if (part->end) {
+            unit = std::move(part->unit);
+            status = part->status;
+            return false;
+        }
+
+        srcml.swap(part->srcml);
+        return true;
+    }
+
+private:
+
+    // part of a body, or the end of a body with its unit
+    struct Part {
+        std::string srcml;
+        std::unique_ptr<srcml_unit> unit;
+        int status = SRCML_STATUS_OK;
+        bool end = false;
+    };
+
+    inline void push(std::unique_ptr<Part> part) {
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv_space.wait(lock, [this]{ return queued < MAX_QUEUED; });
+
+            queued += part->srcml.size() + sizeof(Part);
+            parts.push_back(std::move(part));
+        }
+        cv_part.notify_one();
+    }
+
+    // size of the parts queued before the input waits for the output
+    static const size_t MAX_QUEUED = 4 * 1024 * 1024;
+
+    std::deque<std::unique_ptr<Part>> parts;
+    size_t queued = 0;
+    std::mutex mutex;
+    std::condition_variable cv_part;
+    std::condition_variable cv_space;
+};
+
+#endif
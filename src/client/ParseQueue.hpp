@@ -25,46 +25,66 @@
 
 #include <ParseRequest.hpp>
 #include <WriteQueue.hpp>
-#include <ctpl_stl.h>
+#include <srcml.h>
 #include <mutex>
 #include <srcml_consume.hpp>
 #include <memory>
 #include <srcml_utilities.hpp>
+#include <SRCMLStatus.hpp>
 
 class ParseQueue {
 public:
 
-    ParseQueue(int max_threads, WriteQueue* write_queue)
-        : pool(max_threads), wqueue(write_queue) {}
+    // requests are parsed on the threads of an executor, and written in order to the output archive
+    ParseQueue(int max_threads, srcml_archive* archive, WriteQueue* write_queue)
+        : executor(srcml_executor_create(max_threads, 0)), archive(archive), wqueue(write_queue) {}
+
+    ~ParseQueue() {
+
+        srcml_executor_free(executor);
+    }
 
     inline void schedule(std::shared_ptr<ParseRequest> pvalue) {
 
-        int next;
-        {
-            std::unique_lock<std::mutex> l(e);
+        std::unique_lock<std::mutex> l(e);
 
-            next = ++counter;
-        }
-        pvalue->position = next;
+        pvalue->position = ++counter;
+
+        // when enabled, inputs are parsed directly into the output archive when written
+        pvalue->parse_on_write = parse_on_write && pvalue->needsparsing;
 
         // error passthrough to output for proper output in trace
-        if (pvalue->status) {
+        if (pvalue->status)
             pvalue->unit = 0;
-            wqueue->schedule(pvalue);
+
+        // an error, or a streamed unit that is handed to the output with the end of its body, has nothing to parse
+        srcml_parse_callback parsed = pvalue->status || pvalue->body ? nullptr : srcml_consume;
+
+        // the output archive writes the requests in the order scheduled
+        std::unique_ptr<WriteRequest> request(new WriteRequest{ pvalue, wqueue });
+        if (srcml_archive_write_submit(archive, executor, nullptr, parsed, WriteQueue::write_submitted, request.get()) != SRCML_STATUS_OK) {
+            SRCMLstatus(ERROR_MSG, "srcml: Unable to schedule unit");
             return;
         }
-
-        pool.push(srcml_consume, pvalue, wqueue);
+        request.release();
     }
 
     inline void wait() {
 
-        pool.stop(true);
+        srcml_archive_write_submit_wait(archive);
+    }
+
+    // inputs are parsed when written, instead of by the parse threads
+    inline void enable_parse_on_write() {
+
+        parse_on_write = true;
     }
 
 private:
-    ctpl::thread_pool pool;
+    srcml_executor* executor;
+    srcml_archive* archive;
     WriteQueue* wqueue;
+    bool parse_on_write = false;
     int counter = 0;
     std::mutex e;
 };
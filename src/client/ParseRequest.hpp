@@ -28,6 +28,7 @@
 #include <vector>
 #include <srcml_utilities.hpp>
 #include <memory>
+#include <BodyQueue.hpp>
 #include <boost/optional.hpp>
 
 struct ParseRequest {
@@ -50,6 +51,8 @@ struct ParseRequest {
     boost::optional<std::string> time_stamp;
     boost::optional<std::string> errormsg;
     bool needsparsing = true;
+    bool parse_on_write = false;
+    std::shared_ptr<BodyQueue> body;
     srcml_transform_result* results = nullptr;
     std::shared_ptr<srcml_archive> input_archive;
 };
@@ -25,27 +25,28 @@
 
 #include <srcml.h>
 #include <ParseRequest.hpp>
-#include <mutex>
-#include <condition_variable>
-#include <queue>
-#include <deque>
-#include <thread>
+#include <memory>
 #include <TraceLog.hpp>
 #include <srcml_input_src.hpp>
 
+class WriteQueue;
+
+// a request submitted to the output archive, passed to the callbacks of its unit
+struct WriteRequest {
+    std::shared_ptr<ParseRequest> request;
+    WriteQueue* wqueue;
+};
+
 class WriteQueue {
 
 public:
-    WriteQueue(TraceLog& log, const srcml_output_dest& destination, bool ordered = true);
+    WriteQueue(TraceLog& log, const srcml_output_dest& destination);
 
     // writes out the current srcml
-    void schedule(std::shared_ptr<ParseRequest> pvalue);
-
-    // stop the write process, allowing it to finish up
-    void stop();
+    void write(std::shared_ptr<ParseRequest> pvalue);
 
-    // actual process
-    void process();
+    // write callback of the output archive, called one at a time in the order scheduled
+    static void write_submitted(srcml_unit* unit, int status, void* context);
 
     // number of units writtent
     int numWritten() const { return total; }
@@ -53,14 +54,7 @@ public:
 public:
     TraceLog& log;
     const srcml_output_dest& destination;
-    bool ordered;
-    std::thread write_thread;
-    int maxposition;
-    std::priority_queue<std::shared_ptr<ParseRequest>, std::deque<std::shared_ptr<ParseRequest>>, bool (*)(std::shared_ptr<ParseRequest>, std::shared_ptr<ParseRequest>)> q;
-    std::mutex qmutex;
-    std::condition_variable cv;
     int total = 0;
-    bool completed = false;
 };
 
 #endif
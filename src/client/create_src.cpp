@@ -32,7 +32,7 @@
 #include <libarchive_utilities.hpp>
 #include <srcml_utilities.hpp>
 
-static std::unique_ptr<srcml_archive> srcml_read_open_internal(const srcml_input_src& input_source, const boost::optional<size_t>& revision) {
+static std::unique_ptr<srcml_archive> srcml_read_open_internal(const srcml_request_t& srcml_request, const srcml_input_src& input_source, const boost::optional<size_t>& revision) {
 
     OpenFileLimiter::open();
     std::unique_ptr<srcml_archive> arch(srcml_archive_create());
@@ -41,6 +41,14 @@ static std::unique_ptr<srcml_archive> srcml_read_open_internal(const srcml_input
 
     int status = SRCML_STATUS_OK;
 
+    // with --read-ahead, parse units while the previous ones are written
+    if (srcml_request.read_ahead)
+        srcml_archive_set_read_ahead(arch.get(), SRCML_READ_AHEAD_UNITS, SRCML_READ_AHEAD_BYTES);
+
+    // with --parallel-read, parse large archive files on multiple threads
+    if (srcml_request.parallel_read)
+        srcml_archive_set_read_threads(arch.get(), srcml_request.max_threads);
+
     if (revision) {
         status = srcml_archive_set_srcdiff_revision(arch.get(), *revision);
         if (status != SRCML_STATUS_OK)
@@ -59,8 +67,15 @@ static std::unique_ptr<srcml_archive> srcml_read_open_internal(const srcml_input
         curinput.fd = *uninput.fd;
     }
 
+    // gzip files are read directly, so that the seek table of a seekable archive is used
+#ifdef WITH_ZLIB
+    bool read_gzip = curinput.protocol == "file" && !curinput.fd && curinput.compressions.size() == 1 && curinput.compressions.front() == ".gz";
+#else
+    bool read_gzip = false;
+#endif
+
     // compressed files
-    if (!curinput.compressions.empty() && curinput.archives.empty()) {
+    if (!curinput.compressions.empty() && curinput.archives.empty() && !read_gzip) {
         srcml_input_src uninput = curinput;
         input_file(uninput);
         curinput.fd = *uninput.fd;
@@ -96,10 +111,13 @@ void create_src(const srcml_request_t& srcml_request,
 
         TraceLog log;
 
+        // both revisions are extracted by switching the revision for each unit
+        auto revision = srcml_request.revisions ? boost::optional<size_t>(SRCDIFF_REVISION_ORIGINAL) : srcml_request.revision;
+
         for (const auto& input_source : input_sources) {
-            auto arch(srcml_read_open_internal(input_source, srcml_request.revision));
+            auto arch(srcml_read_open_internal(srcml_request, input_source, revision));
 
-            src_output_filesystem(arch.get(), destination, log);
+            src_output_filesystem(arch.get(), destination, log, srcml_request.revisions);
         }
 
     } else if (input_sources.size() == 1 && contains<int>(destination) &&
@@ -107,19 +125,18 @@ void create_src(const srcml_request_t& srcml_request,
 
         // srcml->src extract to stdout
 
-        auto arch(srcml_read_open_internal(input_sources[0], srcml_request.revision));
+        auto arch(srcml_read_open_internal(srcml_request, input_sources[0], srcml_request.revision));
 
         // move to the correct unit
-        for (int i = 1; i < srcml_request.unit; ++i) {
-            if (!srcml_archive_skip_unit(arch.get())) {
-                SRCMLstatus(ERROR_MSG, "Requested unit %s out of range.", srcml_request.unit);
-                exit(1);
-            }
+        if (srcml_request.unit > 1 && !srcml_archive_skip_units(arch.get(), (size_t) (srcml_request.unit - 1))) {
+            SRCMLstatus(ERROR_MSG, "Requested unit %s out of range.", srcml_request.unit);
+            exit(1);
         }
 
+        // the header of a unit is read, so that its source is streamed as the unit is parsed
         int count = 0;
         while (1) {
-            std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(arch.get()));
+            std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit_header(arch.get()));
             if (srcml_request.unit && !unit) {
                 SRCMLstatus(ERROR_MSG, "Requested unit %s out of range.", srcml_request.unit);
                 exit(1);
@@ -156,17 +173,15 @@ void create_src(const srcml_request_t& srcml_request,
 
     } else if (input_sources.size() == 1 && destination.compressions.empty() && destination.archives.empty()) {
 
-        auto arch(srcml_read_open_internal(input_sources[0], srcml_request.revision));
+        auto arch(srcml_read_open_internal(srcml_request, input_sources[0], srcml_request.revision));
 
         // move to the correct unit
-        for (int i = 1; i < srcml_request.unit; ++i) {
-            if (!srcml_archive_skip_unit(arch.get())) {
-                SRCMLstatus(ERROR_MSG, "Requested unit %s out of range.", srcml_request.unit);
-                exit(1);
-            }
+        if (srcml_request.unit > 1 && !srcml_archive_skip_units(arch.get(), (size_t) (srcml_request.unit - 1))) {
+            SRCMLstatus(ERROR_MSG, "Requested unit %s out of range.", srcml_request.unit);
+            exit(1);
         }
 
-        std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(arch.get()));
+        std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit_header(arch.get()));
         if (!unit) {
             SRCMLstatus(ERROR_MSG, "Requested unit %s out of range.", srcml_request.unit);
             exit(1);
@@ -219,7 +234,7 @@ void create_src(const srcml_request_t& srcml_request,
         // extract all the srcml archives to this libarchive
         for (const auto& input_source : input_sources) {
 
-            auto arch(srcml_read_open_internal(input_source, srcml_request.revision));
+            auto arch(srcml_read_open_internal(srcml_request, input_source, srcml_request.revision));
 
             // extract this srcml archive to the source archive
             src_output_libarchive(arch.get(), ar.get());
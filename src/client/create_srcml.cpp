@@ -41,7 +41,9 @@
 #include <SRCMLStatus.hpp>
 #include <ParserTest.hpp>
 #include <cstring>
+#include <algorithm>
 #include <libarchive_utilities.hpp>
+#include <src_input_shard.hpp>
 
 int srcml_handler_dispatch(ParseQueue& queue,
                           srcml_archive* srcml_arch,
@@ -111,8 +113,23 @@ void create_srcml(const srcml_request_t& srcml_request,
         exit(SRCML_STATUS_INVALID_ARGUMENT);
     }
 
-    // open the output
+    // gzip output is compressed in-process, on the same number of threads as parsing
     int nstatus = SRCML_STATUS_OK;
+    if (!option(SRCML_COMMAND_NOARCHIVE) && destination.compressions.size() == 1 && destination.compressions.front() == ".gz") {
+
+        nstatus = srcml_archive_set_gzip_threads(srcml_arch.get(), srcml_request.max_threads > 0 ? srcml_request.max_threads : 1);
+        if (nstatus == SRCML_STATUS_OK)
+            nstatus = srcml_archive_set_gzip_frame_units(srcml_arch.get(), srcml_request.gzip_frame_units);
+        if (nstatus != SRCML_STATUS_OK) {
+            SRCMLstatus(ERROR_MSG, "srcml: Unable to compress output with the libraries on this platform");
+            return;
+        }
+    }
+
+    if (srcml_request.unit_index)
+        srcml_archive_enable_index(srcml_arch.get());
+
+    // open the output
     if (!option(SRCML_COMMAND_NOARCHIVE)) {
         if (contains<int>(destination)) {
 
@@ -173,6 +190,8 @@ void create_srcml(const srcml_request_t& srcml_request,
             srcml_archive_disable_solitary_unit(srcml_arch.get());
         if (*srcml_request.markup_options & SRCML_OPTION_POSITION)
             srcml_archive_enable_option(srcml_arch.get(), SRCML_OPTION_POSITION);
+        if (*srcml_request.markup_options & SRCML_OPTION_POSITION_COMPACT)
+            srcml_archive_enable_option(srcml_arch.get(), SRCML_OPTION_POSITION_COMPACT);
         if (*srcml_request.markup_options & SRCML_OPTION_CPP)
             srcml_archive_enable_option(srcml_arch.get(), SRCML_OPTION_CPP);
         if (*srcml_request.markup_options & SRCML_OPTION_CPP_MARKUP_IF0)
@@ -202,8 +221,10 @@ void create_srcml(const srcml_request_t& srcml_request,
     //   only one input
     //   no cli request to make it an archive
     //   not a directory (if local file)
+    //   not a shard, which is always an archive so the shards can be merged
     if (input_sources.size() == 1 && input_sources[0].protocol != "filelist" &&
         !(srcml_request.markup_options && (*srcml_request.markup_options & SRCML_ARCHIVE)) &&
+        !srcml_request.shard_count &&
         !input_sources[0].isdirectory && input_sources[0].archives.empty()) {
 
         srcml_archive_enable_solitary_unit(srcml_arch.get());
@@ -259,6 +280,37 @@ void create_srcml(const srcml_request_t& srcml_request,
         }
     }
 
+    // merge srcML archives, with the units copied as is
+    if (srcml_request.merge) {
+
+        std::vector<const char*> filenames;
+        for (const auto& input : input_sources) {
+
+            if (input.state != SRCML || input.protocol != "file" || !input.archives.empty() ||
+                std::any_of(input.compressions.begin(), input.compressions.end(), [](const std::string& ext) { return ext != ".gz"; })) {
+                SRCMLstatus(ERROR_MSG, "srcml: --merge only merges srcML files, not %s", input.filename);
+                exit(1);
+            }
+
+            filenames.push_back(input.c_str());
+        }
+
+        if (!srcml_request.transformations.empty()) {
+            SRCMLstatus(ERROR_MSG, "srcml: --merge can not be used with transformations");
+            exit(1);
+        }
+
+        if (srcml_archive_write_merge_filenames(srcml_arch.get(), (int) filenames.size(), filenames.data()) != SRCML_STATUS_OK) {
+            SRCMLstatus(ERROR_MSG, "srcml: %s", srcml_archive_error_string(srcml_arch.get()));
+            srcml_archive_close(srcml_arch.get());
+            exit(1);
+        }
+
+        srcml_archive_close(srcml_arch.get());
+
+        return;
+    }
+
     // iterate through all transformations added during cli parsing
     int xpath_index = -1;
     for (const auto& trans : srcml_request.transformations) {
@@ -319,31 +371,78 @@ void create_srcml(const srcml_request_t& srcml_request,
     WriteQueue write_queue(log, destination);
 
     // parsing queue
-    ParseQueue parse_queue(srcml_request.max_threads, &write_queue);
+    ParseQueue parse_queue(srcml_request.max_threads, srcml_arch.get(), &write_queue);
+
+    // with --parse-on-write, inputs are parsed directly into the output archive, in order, so that
+    // their srcML is never held in memory. This trades throughput for memory, as each parse holds
+    // the output, so inputs are parsed one at a time. Not possible when the srcML of the unit is needed
+    if (srcml_request.parse_on_write && srcml_request.transformations.empty() &&
+        !option(SRCML_COMMAND_PARSER_TEST | SRCML_COMMAND_XML_RAW | SRCML_COMMAND_XML_FRAGMENT | SRCML_COMMAND_CAT_XML)) {
+        parse_queue.enable_parse_on_write();
+    }
 
     // convert input sources to srcml
     int status = 0;
     bool always_archive = option(SRCML_COMMAND_PARSER_TEST);
-    for (const auto& input : input_sources) {
+    if (srcml_request.shard_count) {
 
-        if (input.protocol == "filelist")
-            always_archive = true;
-
-        int numhandled = srcml_handler_dispatch(parse_queue, srcml_arch.get(), srcml_request, input, destination);
-        if (!numhandled)
-            status = 1;
-        if (numhandled == -1)
+        // with a shard, directories and filelists are expanded so that all the inputs are partitioned together
+        for (const auto& input : input_sources) {
+            if (input.protocol == "filelist")
+                always_archive = true;
+        }
+        std::vector<src_input_shard_input> shard_inputs;
+        if (src_input_shard_expand(srcml_request, input_sources, shard_inputs) == -1)
             status = -1;
-        if (status == -1)
-            break;
+
+        // a single source archive is partitioned by its entries as they are read
+        std::pair<size_t, size_t> shard_range(0, shard_inputs.size());
+        srcml_request_t shard_request = srcml_request;
+        if (!(shard_inputs.size() == 1 && !shard_inputs[0].directory_file && !shard_inputs[0].input.archives.empty())) {
+
+            std::vector<uint64_t> sizes;
+            for (const auto& shard_input : shard_inputs) {
+                sizes.push_back(shard_input.size);
+            }
+            shard_range = src_input_shard_range(srcml_request, sizes);
+            shard_request = src_input_shard_unpartitioned(srcml_request);
+        }
+
+        for (size_t i = shard_range.first; status != -1 && i < shard_range.second; ++i) {
+
+            const auto& shard_input = shard_inputs[i];
+            if (shard_input.directory_file) {
+                src_input_filesystem_file(parse_queue, srcml_arch.get(), shard_request, *shard_input.directory_file);
+                continue;
+            }
+
+            int numhandled = srcml_handler_dispatch(parse_queue, srcml_arch.get(), shard_request, shard_input.input, destination);
+            if (!numhandled)
+                status = 1;
+            if (numhandled == -1)
+                status = -1;
+        }
+
+    } else {
+
+        for (const auto& input : input_sources) {
+
+            if (input.protocol == "filelist")
+                always_archive = true;
+
+            int numhandled = srcml_handler_dispatch(parse_queue, srcml_arch.get(), srcml_request, input, destination);
+            if (!numhandled)
+                status = 1;
+            if (numhandled == -1)
+                status = -1;
+            if (status == -1)
+                break;
+        }
     }
 
-    // wait for the parsing queue to finish
+    // wait for the parsing and writing to finish
     parse_queue.wait();
 
-    // wait for the writing queue to finish
-    write_queue.stop();
-
     if (SRCMLStatus::errors())
         status = -1;
 
@@ -32,11 +32,7 @@
 #include <archive_entry.h>
 #include <SRCMLStatus.hpp>
 
-int src_input_filelist(ParseQueue& queue,
-                        srcml_archive* srcml_arch,
-                        const srcml_request_t& srcml_request,
-                        const std::string& input_file,
-                        const srcml_output_dest& destination) {
+int src_input_filelist_inputs(const std::string& input_file, std::vector<srcml_input_src>& inputs) {
 
     std::unique_ptr<archive> arch(libarchive_input_file(input_file));
     if (!arch)
@@ -106,8 +102,25 @@ int src_input_filelist(ParseQueue& queue,
         if (sline[0] == '#')
             continue;
 
-        // process this file
-        srcml_input_src input(sline);
+        inputs.push_back(srcml_input_src(sline));
+    }
+
+    return 1;
+}
+
+int src_input_filelist(ParseQueue& queue,
+                        srcml_archive* srcml_arch,
+                        const srcml_request_t& srcml_request,
+                        const std::string& input_file,
+                        const srcml_output_dest& destination) {
+
+    std::vector<srcml_input_src> inputs;
+    if (src_input_filelist_inputs(input_file, inputs) == -1)
+        return -1;
+
+    // process these files
+    for (const auto& input : inputs) {
+
         int status = srcml_handler_dispatch(queue, srcml_arch, srcml_request, input, destination);
         if (status == -1)
             return -1;
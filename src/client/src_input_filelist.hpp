@@ -29,6 +29,10 @@
 #include <string>
 #include <boost/optional.hpp>
 #include <srcml_input_src.hpp>
+#include <vector>
+
+// inputs listed in a filelist, in order, -1 on error
+int src_input_filelist_inputs(const std::string& input_filename, std::vector<srcml_input_src>& inputs);
 
 int src_input_filelist(ParseQueue& queue,
                         srcml_archive* srcml_arch,
@@ -42,10 +42,8 @@
     #include <unistd.h>
 #endif
 
-int src_input_filesystem(ParseQueue& queue,
-                          srcml_archive* srcml_arch,
-                          const srcml_request_t& srcml_request,
-                          const std::string& raw_input) {
+std::vector<std::pair<std::string, uint64_t>> src_input_filesystem_files(const srcml_request_t& srcml_request,
+                                                                        const std::string& raw_input) {
 
     // with immediate directory "." lookup the current working directory
     std::string input = raw_input;
@@ -55,8 +53,8 @@ int src_input_filesystem(ParseQueue& queue,
         free(cwd);
     }
 
-    // get a list of files (including directories) from the current directory
-    std::vector<std::string> files;
+    // get a list of files (including directories) from the current directory, with their sizes
+    std::vector<std::pair<std::string, uint64_t>> files;
 
     // start at the root of the tree
     auto darchive = archive_read_disk_new();
@@ -95,28 +93,43 @@ int src_input_filesystem(ParseQueue& queue,
                 continue;
         }
 
-        files.push_back(archive_entry_pathname(entry));
+        files.push_back(std::make_pair(filename, (uint64_t) archive_entry_size(entry)));
     }
     archive_entry_free(entry);
     archive_read_free(darchive);
 
     std::sort(files.begin(), files.end());
 
-    for (auto& filename : files) {
+    return files;
+}
 
-        srcml_input_src input_file(filename);
+void src_input_filesystem_file(ParseQueue& queue,
+                                srcml_archive* srcml_arch,
+                                const srcml_request_t& srcml_request,
+                                const std::string& filename) {
 
-        // If a directory contains archives skip them
-        if (!(srcml_request.command & SRCML_COMMAND_PARSER_TEST) && !(input_file.archives.empty())) {
-            input_file.skip = true;
-        }
+    srcml_input_src input_file(filename);
 
-        if (srcml_request.command & SRCML_COMMAND_PARSER_TEST) {
-            srcml_input_srcml(queue, srcml_arch, srcml_request, input_file, srcml_request.revision);
-        } else {
-            input_file.prefix = filename.substr(0, filename.find_last_of('/'));
-            src_input_libarchive(queue, srcml_arch, srcml_request, input_file);
-        }
+    // If a directory contains archives skip them
+    if (!(srcml_request.command & SRCML_COMMAND_PARSER_TEST) && !(input_file.archives.empty())) {
+        input_file.skip = true;
+    }
+
+    if (srcml_request.command & SRCML_COMMAND_PARSER_TEST) {
+        srcml_input_srcml(queue, srcml_arch, srcml_request, input_file, srcml_request.revision);
+    } else {
+        input_file.prefix = filename.substr(0, filename.find_last_of('/'));
+        src_input_libarchive(queue, srcml_arch, srcml_request, input_file);
+    }
+}
+
+int src_input_filesystem(ParseQueue& queue,
+                          srcml_archive* srcml_arch,
+                          const srcml_request_t& srcml_request,
+                          const std::string& input) {
+
+    for (const auto& file : src_input_filesystem_files(srcml_request, input)) {
+        src_input_filesystem_file(queue, srcml_arch, srcml_request, file.first);
     }
 
     return 1;
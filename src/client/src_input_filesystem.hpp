@@ -26,6 +26,20 @@
 #include <srcml.h>
 #include <srcml_cli.hpp>
 #include <ParseQueue.hpp>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// files of a directory, including its subdirectories, in order, with their sizes
+std::vector<std::pair<std::string, uint64_t>> src_input_filesystem_files(const srcml_request_t& srcml_request,
+                                                                        const std::string& input_filename);
+
+// parse a file found in a directory
+void src_input_filesystem_file(ParseQueue& queue,
+                                srcml_archive* srcml_arch,
+                                const srcml_request_t& srcml_request,
+                                const std::string& filename);
 
 int src_input_filesystem(ParseQueue& queue,
                           srcml_archive* srcml_arch,
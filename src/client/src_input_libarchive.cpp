@@ -36,6 +36,7 @@ typedef SSIZE_T ssize_t;
 #include <SRCMLStatus.hpp>
 #include <cstring>
 #include <libarchive_utilities.hpp>
+#include <src_input_shard.hpp>
 
 archive* libarchive_input_file(const srcml_input_src& input_file) {
 
@@ -198,6 +199,13 @@ int src_input_libarchive(ParseQueue& queue,
         if (srcml_request.att_filename && srcml_archive_is_solitary_unit(srcml_arch))
             filename = *srcml_request.att_filename;
 
+        // with a shard, the entries of a source archive are streamed, so are partitioned by filename
+        if (srcml_request.shard_count && archive_format(arch.get()) != ARCHIVE_FORMAT_RAW && archive_format(arch.get()) != ARCHIVE_FORMAT_EMPTY &&
+            src_input_shard_hash(filename, srcml_request.shard_count) + 1 != srcml_request.shard) {
+            ++count;
+            continue;
+        }
+
         // language may have been explicitly set
         std::string language;
 
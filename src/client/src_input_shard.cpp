@@ -0,0 +1,144 @@
+/**
+ * @file src_input_shard.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <src_input_shard.hpp>
+#include <src_input_filesystem.hpp>
+#include <src_input_filelist.hpp>
+#include <sys/stat.h>
+#include <cstdlib>
+
+bool src_input_shard_parse(const std::string& value, size_t& shard, size_t& shard_count) {
+
+    auto pos = value.find('/');
+    if (pos == 0 || pos == std::string::npos || pos + 1 == value.size())
+        return false;
+
+    std::string index = value.substr(0, pos);
+    std::string count = value.substr(pos + 1);
+    if (index.find_first_not_of("0123456789") != std::string::npos ||
+        count.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+
+    shard = std::strtoul(index.c_str(), nullptr, 10);
+    shard_count = std::strtoul(count.c_str(), nullptr, 10);
+
+    return shard >= 1 && shard <= shard_count;
+}
+
+size_t src_input_shard_hash(const std::string& filename, size_t shard_count) {
+
+    // FNV-1a, so that the shard is the same for every run and platform
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : filename) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    return (size_t) (hash % shard_count);
+}
+
+std::pair<size_t, size_t> src_input_shard_range(const srcml_request_t& srcml_request, const std::vector<uint64_t>& sizes) {
+
+    // each input counts at least one, so that empty inputs are still spread over the shards
+    double total = 0;
+    for (auto size : sizes)
+        total += (double) size + 1;
+
+    // an input is in the shard that contains its midpoint, so shards are contiguous and in order
+    std::pair<size_t, size_t> range(sizes.size(), sizes.size());
+    bool found = false;
+    double before = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+
+        double weight = (double) sizes[i] + 1;
+        size_t shard = (size_t) (((before + weight / 2) / total) * srcml_request.shard_count) + 1;
+        if (shard > srcml_request.shard_count)
+            shard = srcml_request.shard_count;
+
+        if (shard == srcml_request.shard && !found) {
+            range.first = i;
+            found = true;
+        } else if (shard > srcml_request.shard) {
+            if (!found)
+                range.first = i;
+            range.second = i;
+            break;
+        }
+
+        before += weight;
+    }
+
+    return range;
+}
+
+uint64_t src_input_shard_size(const std::string& filename) {
+
+    struct stat s;
+    if (stat(filename.c_str(), &s) != 0)
+        return 0;
+
+    return (uint64_t) s.st_size;
+}
+
+srcml_request_t src_input_shard_unpartitioned(const srcml_request_t& srcml_request) {
+
+    srcml_request_t unpartitioned = srcml_request;
+    unpartitioned.shard_count = 0;
+
+    return unpartitioned;
+}
+
+int src_input_shard_expand(const srcml_request_t& srcml_request, const std::vector<srcml_input_src>& inputs,
+                           std::vector<src_input_shard_input>& expanded) {
+
+    for (const auto& input : inputs) {
+
+        if (input.protocol == "filelist") {
+
+            std::vector<srcml_input_src> listed;
+            if (src_input_filelist_inputs(input, listed) == -1)
+                return -1;
+
+            if (src_input_shard_expand(srcml_request, listed, expanded) == -1)
+                return -1;
+
+        } else if (input.protocol == "file" && input.isdirectory) {
+
+            for (const auto& file : src_input_filesystem_files(srcml_request, input)) {
+
+                src_input_shard_input shard_input;
+                shard_input.directory_file = file.first;
+                shard_input.size = file.second;
+                expanded.push_back(shard_input);
+            }
+
+        } else {
+
+            src_input_shard_input shard_input;
+            shard_input.input = input;
+            shard_input.size = input.protocol == "file" ? src_input_shard_size(input.resource) : 0;
+            expanded.push_back(shard_input);
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file src_input_shard.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * This file is part of the srcml command-line client.
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcml command-line client; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+  Partition of the input units for --shard i/N
+
+  Directories are expanded into their files, and filelists into their
+  inputs, before partitioning, so all the inputs are known. Each shard is a
+  contiguous range of the expanded inputs in their order, balanced by size.
+  Merging the shard archives in shard order gives the units in the same
+  order as a single run.
+
+  The entries of a source archive are streamed, so when it is the only
+  input, each entry goes to the shard of a stable hash of its filename.
+  Otherwise a source archive is one input of a shard.
+*/
+
+#ifndef SRC_INPUT_SHARD_HPP
+#define SRC_INPUT_SHARD_HPP
+
+#include <srcml_cli.hpp>
+#include <srcml_input_src.hpp>
+#include <boost/optional.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// parse the --shard value i/N, with 1 <= i <= N
+bool src_input_shard_parse(const std::string& value, size_t& shard, size_t& shard_count);
+
+// shard of an input archive entry, by a stable hash of its filename
+size_t src_input_shard_hash(const std::string& filename, size_t shard_count);
+
+// range [first, last) of the inputs, in order, in the shard of the request
+std::pair<size_t, size_t> src_input_shard_range(const srcml_request_t& srcml_request, const std::vector<uint64_t>& sizes);
+
+// size of a local file, 0 when not a local file
+uint64_t src_input_shard_size(const std::string& filename);
+
+// request for the expansion of an input of a shard, with no further partitioning
+srcml_request_t src_input_shard_unpartitioned(const srcml_request_t& srcml_request);
+
+// input of a shard, once directories and filelists are expanded
+struct src_input_shard_input {
+
+    // input, when not a file of a directory
+    srcml_input_src input;
+
+    // file of a directory, parsed as a file found in a directory
+    boost::optional<std::string> directory_file;
+
+    // size for balancing the shards
+    uint64_t size = 0;
+};
+
+// expand the directories and filelists of the inputs, in the order the inputs are parsed, -1 on error
+int src_input_shard_expand(const srcml_request_t& srcml_request, const std::vector<srcml_input_src>& inputs,
+                           std::vector<src_input_shard_input>& expanded);
+
+#endif
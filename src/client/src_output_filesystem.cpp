@@ -25,8 +25,9 @@
 #include <iostream>
 #include <srcml_utilities.hpp>
 #include <mkDir.hpp>
+#include <srcmlns.hpp>
 
-void src_output_filesystem(srcml_archive* srcml_arch, const std::string& output_dir, TraceLog& log) {
+void src_output_filesystem(srcml_archive* srcml_arch, const std::string& output_dir, TraceLog& log, bool revisions) {
 
     // construct the relative directory
     std::string prefix;
@@ -38,30 +39,49 @@ void src_output_filesystem(srcml_archive* srcml_arch, const std::string& output_
 
     int count = 0;
     std::string last;
-    while (std::unique_ptr<srcml_unit> unit{srcml_archive_read_unit(srcml_arch)}) {
+    // a unit output once is read by its header, so that the source is streamed as the unit is parsed
+    while (std::unique_ptr<srcml_unit> unit{revisions ? srcml_archive_read_unit(srcml_arch) : srcml_archive_read_unit_header(srcml_arch)}) {
 
         const char* cfilename = srcml_unit_get_filename(unit.get());
         if (!cfilename)
             continue;
 
-        std::string filename = cfilename;
+        // with revisions, each revision is output from the same read of the unit, into its own directory
+        size_t last_revision = revisions ? SRCDIFF_REVISION_MODIFIED : SRCDIFF_REVISION_ORIGINAL;
+        for (size_t revision = SRCDIFF_REVISION_ORIGINAL; revision <= last_revision; ++revision) {
 
-        // separate pathname from filename
-        std::string path = prefix;
-        path += '/';
-        auto pos = filename.rfind('/');
-        path += pos != std::string::npos ? filename.substr(0, pos) : "";
+            std::string filename = cfilename;
+            std::string revision_prefix = prefix;
+            if (revisions) {
 
-        std::string fullfilename = prefix;
-        fullfilename += "/";
-        fullfilename += filename;
+                srcml_archive_set_srcdiff_revision(srcml_arch, revision);
 
-        // use libarchive to create the file path
-        dir.mkdir(path);
+                filename = attribute_revision(filename, (int) revision);
+                if (filename.empty())
+                    continue;
 
-        // unparse directory to filename
-        log << ++count << fullfilename;
+                if (!revision_prefix.empty())
+                    revision_prefix += '/';
+                revision_prefix += revision == SRCDIFF_REVISION_ORIGINAL ? "original" : "modified";
+            }
 
-        srcml_unit_unparse_filename(unit.get(), fullfilename.c_str());
+            // separate pathname from filename
+            std::string path = revision_prefix;
+            path += '/';
+            auto pos = filename.rfind('/');
+            path += pos != std::string::npos ? filename.substr(0, pos) : "";
+
+            std::string fullfilename = revision_prefix;
+            fullfilename += "/";
+            fullfilename += filename;
+
+            // use libarchive to create the file path
+            dir.mkdir(path);
+
+            // unparse directory to filename
+            log << ++count << fullfilename;
+
+            srcml_unit_unparse_filename(unit.get(), fullfilename.c_str());
+        }
     }
 }
@@ -36,6 +36,7 @@
 #include <csignal>
 #include <cmath>
 #include <TraceLog.hpp>
+#include <memory>
 
 #ifndef _MSC_BUILD
 #include <sys/uio.h>
@@ -47,6 +48,7 @@ namespace {
     bool request_create_srcml      (const srcml_request_t&);
     bool request_display_metadata  (const srcml_request_t&);
     bool request_output_compression(const srcml_request_t&);
+    bool request_output_gzip       (const srcml_request_t&);
     bool request_create_src        (const srcml_request_t&);
 }
 
@@ -142,7 +144,9 @@ See `srcml --help` for more information.
     }
 
     // step (srcml|src)->compressed
-    if (request_output_compression(srcml_request)) {
+    // gzip of srcML is performed in-process when srcML creation is the last step
+    bool create_srcml_gzip = pipeline.size() == 1 && request_create_srcml(srcml_request) && request_output_gzip(srcml_request);
+    if (request_output_compression(srcml_request) && !create_srcml_gzip) {
 #if ARCHIVE_VERSION_NUMBER >= 3002000
         pipeline.push_back(compress_srcml);
 #else
@@ -197,6 +201,9 @@ namespace {
         if (option(SRCML_COMMAND_CAT_XML))
             return true;
 
+        if (request.merge)
+            return true;
+
         return std::find_if(request.input_sources.begin(), request.input_sources.end(), [](const srcml_input_src& input) { return input.state == SRC; }) != request.input_sources.end() ||
         (request.output_filename.state == SRCML || option(SRCML_COMMAND_XML)) ||
         !request.transformations.empty();
@@ -220,6 +227,21 @@ namespace {
         return request.output_filename.compressions.size() >= 1;
     }
 
+    /*
+        Output is gzip compressed srcML
+        * Only compression of output is gzip, and libsrcml supports it
+    */
+    bool request_output_gzip(const srcml_request_t& request) {
+
+        if (request.output_filename.compressions.size() != 1 || request.output_filename.compressions.front() != ".gz" ||
+            !request.output_filename.archives.empty() || option(SRCML_COMMAND_NOARCHIVE))
+            return false;
+
+        std::unique_ptr<srcml_archive, decltype(&srcml_archive_free)> archive(srcml_archive_create(), srcml_archive_free);
+
+        return archive && srcml_archive_set_gzip_threads(archive.get(), 1) == SRCML_STATUS_OK;
+    }
+
     /*
         Creating source code
         * Specific option for source output
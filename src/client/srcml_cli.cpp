@@ -22,6 +22,7 @@
 
 #include <srcml_cli.hpp>
 #include <src_prefix.hpp>
+#include <src_input_shard.hpp>
 #include <stdlib.h>
 #include <SRCMLStatus.hpp>
 #include <algorithm>
@@ -195,6 +196,14 @@ srcml_request_t parseCLI11(int argc, char* argv[]) {
         ->type_name("NUM")
         ->group("GENERAL OPTIONS");
 
+    app.add_flag("--read-ahead", srcml_request.read_ahead,
+        "Parse the units of srcML archive files on a separate thread, ahead of their use")
+        ->group("GENERAL OPTIONS");
+
+    app.add_flag("--parallel-read", srcml_request.parallel_read,
+        "Parse large uncompressed srcML archive files on up to --jobs threads")
+        ->group("GENERAL OPTIONS");
+
     // src2srcml_options "CREATING SRCML"
     auto text =
     app.add_option("--text,-t",
@@ -250,6 +259,19 @@ srcml_request_t parseCLI11(int argc, char* argv[]) {
         "Create a srcML archive, default for multiple input files")
         ->group("CREATING SRCML");
 
+    app.add_option("--gzip-frame-units", srcml_request.gzip_frame_units,
+        "Compress .gz srcML archive output as independent gzip members of NUM units with a seek table")
+        ->type_name("NUM")
+        ->group("CREATING SRCML");
+
+    app.add_flag("--index", srcml_request.unit_index,
+        "Write an index of the units of the srcML archive output to FILE.idx, for direct access to a unit")
+        ->group("CREATING SRCML");
+
+    app.add_flag("--parse-on-write", srcml_request.parse_on_write,
+        "Parse each file directly into the srcML output, without holding its srcML in memory. Files are parsed one at a time, whatever --jobs is")
+        ->group("CREATING SRCML");
+
     auto output_xml =
     app.add_flag_callback("--output-srcml,-X",   [&]() { srcml_request.command |= SRCML_COMMAND_XML; },
         "Output in XML instead of text")
@@ -276,6 +298,13 @@ srcml_request_t parseCLI11(int argc, char* argv[]) {
         "Include start and end attributes with line/column of each element")
         ->group("MARKUP OPTIONS");
 
+    app.add_flag_callback("--position-compact",[&]() {
+        *srcml_request.markup_options |= SRCML_OPTION_POSITION;
+        *srcml_request.markup_options |= SRCML_OPTION_POSITION_COMPACT;
+    },
+        "Include a single compact span attribute with line/column of each element")
+        ->group("MARKUP OPTIONS");
+
     // default tabs
     srcml_request.tabs = 8;
     app.add_option("--tabs", srcml_request.tabs,
@@ -583,10 +612,33 @@ srcml_request_t parseCLI11(int argc, char* argv[]) {
         "Cat all the XML units into a single unit")
         ->group("");
 
+    auto revision =
     app.add_flag("--revision", srcml_request.revision,
         "Extract the given revision (0 = original, 1 = modified)")
         ->group("");
 
+    app.add_flag("--revisions", srcml_request.revisions,
+        "Extract both revisions in a single pass, with --to-dir, into the directories original and modified")
+        ->group("")
+        ->needs(todir)
+        ->excludes(revision);
+
+    app.add_flag("--merge", srcml_request.merge,
+        "Merge srcML archives into one, copying the units without parsing them")
+        ->group("");
+
+    app.add_option("--shard",
+        "Only parse shard i of N of the input units, for combining independent runs with --merge")
+        ->type_name("i/N")
+        ->group("")
+        ->expected(1)
+        ->each([&](std::string value) {
+            if (!src_input_shard_parse(value, srcml_request.shard, srcml_request.shard_count)) {
+                SRCMLstatus(ERROR_MSG, "srcml: --shard requires i/N with 1 <= i <= N, not \"%s\"", value);
+                exit(CLI_STATUS_ERROR);
+            }
+        });
+
     app.add_flag_callback("--update",       [&]() { srcml_request.command |= SRCML_COMMAND_UPDATE; },
         "Output and update existing srcml")
         ->group("");
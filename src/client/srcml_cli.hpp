@@ -158,10 +158,35 @@ struct srcml_request_t {
     int unit = 0;
     int max_threads;
 
+    // parse the units of srcML archive files ahead of their use
+    bool read_ahead = false;
+
+    // parse large srcML archive files on multiple threads
+    bool parallel_read = false;
+
+    // units per gzip member of seekable output
+    size_t gzip_frame_units = 0;
+
+    // write a sidecar index of the output units
+    bool unit_index = false;
+
+    // parse directly into the srcML archive output
+    bool parse_on_write = false;
+
     boost::optional<std::string> pretty_format;
 
     boost::optional<size_t> revision;
 
+    // extract both srcdiff revisions
+    bool revisions = false;
+
+    // merge srcML archives by copying their units
+    bool merge = false;
+
+    // shard of the input units for this run, from 1 to shard_count, no sharding when shard_count is 0
+    size_t shard = 0;
+    size_t shard_count = 0;
+
     // pre-input
     char buf[4] = { 0 };
     size_t bufsize = 0;
@@ -20,7 +20,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  *
  * Thread-designed function to parse and create a unit.
- * Output is scheduled for writing on the write queue
+ * Output is then written in order by the write queue
  */
 
 #include <srcml_consume.hpp>
@@ -33,15 +33,10 @@
 #include <SRCMLStatus.hpp>
 #include <Timer.hpp>
 
-// creates initial unit, parses, and then sends unit to write queue
-void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> request, WriteQueue* write_queue) {
+// creates initial unit and parses, before the output archive hands the unit to the write queue
+void srcml_consume(srcml_unit* /* unit */, int /* status */, void* context) {
 
-    // error passthrough to output for proper output in trace
-    if (request->status) {
-        request->unit.reset(0);
-        write_queue->schedule(request);
-        return;
-    }
+    std::shared_ptr<ParseRequest> request = static_cast<WriteRequest*>(context)->request;
 
     std::string original_filename;
 
@@ -53,7 +48,6 @@ void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> reque
         request->unit.reset(srcml_unit_create(request->srcml_arch));
         if (!request->unit) {
             request->status = SRCML_STATUS_ERROR;
-            write_queue->schedule(request);
             return;
         }
     }
@@ -62,7 +56,6 @@ void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> reque
     if (srcml_unit_get_language(request->unit.get()) == 0 || srcml_unit_get_language(request->unit.get())[0] == '\0')
         if ((request->status = srcml_unit_set_language(request->unit.get(), request->language.c_str())) != SRCML_STATUS_OK) {
             request->unit.reset();
-            write_queue->schedule(request);
             return;
         }
 
@@ -80,7 +73,6 @@ void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> reque
 
         if ((request->status = srcml_unit_set_filename(request->unit.get(), request->filename->c_str())) != SRCML_STATUS_OK) {
             request->unit.reset();
-            write_queue->schedule(request);
             return;
         }
     }
@@ -88,7 +80,6 @@ void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> reque
     // (optional) version attribute
     if (request->version && ((request->status = srcml_unit_set_version(request->unit.get(), request->version->c_str())) != SRCML_STATUS_OK)) {
         request->unit.reset();
-        write_queue->schedule(request);
         return;
     }
 
@@ -96,6 +87,11 @@ void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> reque
     if (request->time_stamp)
         srcml_unit_set_timestamp(request->unit.get(), request->time_stamp->c_str());
 
+    // parsed directly into the output archive when written, so the srcML is never in the unit
+    if (request->parse_on_write) {
+        return;
+    }
+
     // parse the buffer/file, timing as we go
     Timer parsetime;
 
@@ -111,13 +107,11 @@ void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> reque
         request->status = SRCML_STATUS_IO_ERROR;
         request->errormsg = "";
         request->unit.reset();
-        write_queue->schedule(request);
         exit(1);
     }
     if (request->status != SRCML_STATUS_OK) {
         request->errormsg = "srcml: Unable to open file " + original_filename;
         request->unit.reset();
-        write_queue->schedule(request);
         return;
     }
 
@@ -128,7 +122,4 @@ void srcml_consume(int /* thread_pool_id */, std::shared_ptr<ParseRequest> reque
     if (request->results && srcml_transform_get_type(request->results) == SRCML_RESULT_NONE) {
         request->unit.reset();
     }
-
-    // schedule unit for output
-    write_queue->schedule(request);
 }
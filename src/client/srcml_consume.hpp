@@ -23,11 +23,9 @@
 #ifndef SRCML_CONSUME_HPP
 #define SRCML_CONSUME_HPP
 
-#include <memory>
+#include <srcml.h>
 
-struct ParseRequest;
-class WriteQueue;
-
-void srcml_consume(int thread_pool_id, std::shared_ptr<ParseRequest>, WriteQueue*);
+// parsed callback of a request submitted to the output archive
+void srcml_consume(srcml_unit* unit, int status, void* context);
 
 #endif
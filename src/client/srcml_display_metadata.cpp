@@ -47,7 +47,7 @@ namespace {
         int numUnits = 0;
         long LOC = 0;
         while (true) {
-            std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(srcml_arch));
+            std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit_header(srcml_arch));
             if (!unit)
                 break;
 
@@ -87,7 +87,7 @@ namespace {
         if (xml_encoding)
             std::cout << "encoding=" << "\"" << xml_encoding << "\"\n";
 
-        std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(srcml_arch));
+        std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit_header(srcml_arch));
         int unit_count = 0;
 
         if (!isarchive && unit) {
@@ -125,7 +125,7 @@ namespace {
         int numUnits = 0;
         while (true) {
 
-            std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit(srcml_arch));
+            std::unique_ptr<srcml_unit> unit(srcml_archive_read_unit_header(srcml_arch));
             if (!unit)
                 break;
 
@@ -153,6 +153,9 @@ void srcml_display_metadata(const srcml_request_t& srcml_request, const srcml_in
         OpenFileLimiter::open();
         std::unique_ptr<srcml_archive> srcml_arch(srcml_archive_create());
 
+        // metadata is only from the unit headers, so the units are scanned instead of parsed
+        srcml_archive_set_header_scan(srcml_arch.get(), 1);
+
         int status = SRCML_STATUS_OK;
         if (contains<int>(input)) {
             status = srcml_archive_read_open_fd(srcml_arch.get(), input);
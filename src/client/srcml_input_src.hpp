@@ -128,6 +128,10 @@ inline std::ostream& operator<<(std::ostream& out, const srcml_input_src& input)
     return out;
 }
 
+// limits on the srcML units read ahead of the client
+const size_t SRCML_READ_AHEAD_UNITS = 64;
+const size_t SRCML_READ_AHEAD_BYTES = 16 * 1024 * 1024;
+
 int srcml_archive_read_open(srcml_archive* arch, const srcml_input_src& input_source);
 
 #endif
@@ -23,6 +23,7 @@
 #include <srcml_input_srcml.hpp>
 #include <srcml_utilities.hpp>
 #include <ParseQueue.hpp>
+#include <BodyQueue.hpp>
 #include <srcml_input_src.hpp>
 #include <srcml.h>
 #include <srcml_options.hpp>
@@ -49,6 +50,14 @@ int srcml_input_srcml(ParseQueue& queue,
     if (revision)
         open_status = srcml_archive_set_srcdiff_revision(srcml_input_archive.get(), *revision);
 
+    // with --read-ahead, parse units while the previous ones are processed
+    if (srcml_request.read_ahead)
+        srcml_archive_set_read_ahead(srcml_input_archive.get(), SRCML_READ_AHEAD_UNITS, SRCML_READ_AHEAD_BYTES);
+
+    // with --parallel-read, parse large archive files on as many threads as the processing
+    if (srcml_request.parallel_read)
+        srcml_archive_set_read_threads(srcml_input_archive.get(), srcml_request.max_threads);
+
     open_status = srcml_archive_read_open(srcml_input_archive.get(), srcml_input);
     if (open_status != SRCML_STATUS_OK) {
         if (srcml_input.protocol == "file" )
@@ -80,18 +89,24 @@ int srcml_input_srcml(ParseQueue& queue,
     }
 
     // move to the correct unit (if needed)
-    for (int i = 1; i < (option(SRCML_COMMAND_PARSER_TEST) ? srcml_request.unit : srcml_input.unit); ++i) {
-        if (!srcml_archive_skip_unit(srcml_input_archive.get())) {
-            SRCMLstatus(ERROR_MSG, "Requested unit %s out of range.", srcml_input.unit);
-            exit(1);
-        }
+    int unit_position = option(SRCML_COMMAND_PARSER_TEST) ? srcml_request.unit : srcml_input.unit;
+    if (unit_position > 1 && !srcml_archive_skip_units(srcml_input_archive.get(), (size_t) (unit_position - 1))) {
+        SRCMLstatus(ERROR_MSG, "Requested unit %s out of range.", srcml_input.unit);
+        exit(1);
     }
 
     // if we found a valid unit
     bool unitFound = false;
 
+    // without transformations, the inner srcML of a unit is streamed from the input to the output,
+    // so only its header is read, and the unit is handed to the output at the end of its body
+    std::shared_ptr<BodyQueue> body;
+    if (option(SRCML_COMMAND_XML_RAW) && srcml_request.transformations.empty())
+        body = std::make_shared<BodyQueue>();
+
     // process each entry in the input srcml archive
-    while (std::unique_ptr<srcml_unit> unit{ srcml_archive_read_unit(srcml_input_archive.get())}) {
+    while (std::unique_ptr<srcml_unit> unit{ body ? srcml_archive_read_unit_header(srcml_input_archive.get())
+                                                  : srcml_archive_read_unit(srcml_input_archive.get())}) {
 
         unitFound = true;
 
@@ -106,25 +121,36 @@ int srcml_input_srcml(ParseQueue& queue,
             }
         }
 
+        // if the archive has a language (set by the user) then use that
+        // this is a way of converting language
+        if (srcml_archive_get_language(srcml_output_archive))
+            srcml_unit_set_language(unit.get(), srcml_archive_get_language(srcml_output_archive));
+
         // form the parsing request
         std::shared_ptr<ParseRequest> prequest(new ParseRequest);
         prequest->srcml_arch = srcml_output_archive;
-        prequest->unit.swap(unit);
+        if (!body)
+            prequest->unit.swap(unit);
         prequest->needsparsing = false;
+        prequest->body = body;
         prequest->input_archive = srcml_input_archive;
         prequest->parsertest_filename = srcml_input.resource;
 
         if (srcml_archive_get_url(prequest->input_archive.get()))
             prequest->url = srcml_archive_get_url(prequest->input_archive.get());
 
-        // if the archive has a language (set by the user) then use that
-        // this is a way of converting language
-        if (srcml_archive_get_language(srcml_output_archive))
-            srcml_unit_set_language(prequest->unit.get(), srcml_archive_get_language(srcml_output_archive));
-
         // hand request off to the processing queue
         queue.schedule(prequest);
 
+        // stream the body while the previous units are written
+        if (body) {
+            int status = srcml_unit_get_srcml_inner_io(unit.get(), body.get(), [](void* context, const char* buffer, int len) {
+                ((BodyQueue*) context)->write(buffer, (size_t) len);
+                return len;
+            });
+            body->end(std::move(unit), status);
+        }
+
         // one-time through for individual unit
         if (option(SRCML_COMMAND_PARSER_TEST) ? srcml_request.unit : srcml_input.unit)
             break;
@@ -240,7 +240,7 @@ void display_template(srcml_archive* srcml_arch, pretty_template_t& output_templ
         }
     }
     else {
-        unit.reset(srcml_archive_read_unit(srcml_arch));
+        unit.reset(srcml_archive_read_unit_header(srcml_arch));
     }
 
     if (output_template.body) {
@@ -296,7 +296,7 @@ void display_template(srcml_archive* srcml_arch, pretty_template_t& output_templ
                 pretty_print(*output_template.body, body_params);
 
             body_params.clear();
-            unit.reset(srcml_archive_read_unit(srcml_arch));
+            unit.reset(srcml_archive_read_unit_header(srcml_arch));
 
             // When you want to print only the information from a specific unit
             if (unit_num > 0 && unit_num == unit_count && !(xml)) {
@@ -36,6 +36,22 @@
 #include <srcml_utilities.hpp>
 #include <mkDir.hpp>
 #include <cmath>
+#include <Timer.hpp>
+
+// output of the inner srcML of a unit, with the last character for the trailing newline
+struct raw_output {
+    srcml_archive* archive = nullptr;
+    char last = '\0';
+};
+
+static int raw_write(void* context, const char* buffer, int len) {
+
+    auto output = (raw_output*) context;
+    if (len > 0)
+        output->last = buffer[len - 1];
+
+    return srcml_archive_write_string(output->archive, buffer, len) == SRCML_STATUS_OK ? len : -1;
+}
 
 // Public consumption thread function
 void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, const srcml_output_dest& /* destination */) {
@@ -143,11 +159,32 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
         };
     }
 
+    // parse directly into the output archive, in order, instead of writing a parsed unit. This runs
+    // in the ordered write of the archive, so these parses are serial, whatever the number of threads
+    if (request->status == SRCML_STATUS_OK && request->parse_on_write) {
+
+        Timer parsetime;
+
+        if (request->disk_filename)
+            request->status = srcml_archive_write_parse_filename(output_archive, request->unit.get(), request->disk_filename->c_str());
+        else
+            request->status = srcml_archive_write_parse_memory(output_archive, request->unit.get(), request->buffer.data(), request->buffer.size());
+
+        request->runtime = parsetime.cpu_time_elapsed();
+
+        // report the actual failure, as the file was only opened here
+        std::string name = request->filename ? *request->filename : (request->disk_filename ? *request->disk_filename : std::string(""));
+        if (request->status == SRCML_STATUS_IO_ERROR)
+            request->errormsg = "srcml: Unable to open file " + name;
+        else if (request->status == SRCML_STATUS_UNSET_LANGUAGE)
+            request->errormsg = "srcml: Unable to determine the language of " + name;
+        else if (request->status != SRCML_STATUS_OK)
+            request->errormsg = "srcml: Unable to parse " + name + " into the archive, status " + std::to_string(request->status);
+    }
+
     // write the unit
     if (request->status == SRCML_STATUS_OK) {
 
-        log.totalLOC(srcml_unit_get_loc(request->unit.get()));
-
         // chance that a solo unit archive was the input, but transformation was
         // done, so output has to be a full archive
         if (request->results && srcml_transform_get_unit_size(request->results) > 1) {
@@ -161,7 +198,7 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
             }
         }
         // if no transformed units, write the main unit
-        if ((!request->results || srcml_transform_get_unit_size(request->results) == 0) && request->unit) {
+        if ((!request->results || srcml_transform_get_unit_size(request->results) == 0) && (request->unit || request->body)) {
             int status = SRCML_STATUS_OK;
             if (option(SRCML_COMMAND_XML_FRAGMENT)) {
                 const char* s = srcml_unit_get_srcml_outer(request->unit.get());
@@ -170,10 +207,24 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
                     srcml_archive_write_string(output_archive, "\n", 1);
                 }
             } else if (option(SRCML_COMMAND_XML_RAW)) {
-                const char* s = srcml_unit_get_srcml_inner(request->unit.get());
-                status = srcml_archive_write_string(output_archive, s, (int) strlen(s));
+                raw_output output;
+                output.archive = output_archive;
+                if (request->body) {
+
+                    // streamed from the input, which hands the unit over at the end of its body
+                    std::string srcml;
+                    int input_status = SRCML_STATUS_OK;
+                    while (request->body->read(srcml, request->unit, input_status)) {
+                        if (status == SRCML_STATUS_OK && raw_write(&output, srcml.data(), (int) srcml.size()) < 0)
+                            status = SRCML_STATUS_IO_ERROR;
+                    }
+                    if (status == SRCML_STATUS_OK)
+                        status = input_status;
+                } else {
+                    status = srcml_unit_get_srcml_inner_io(request->unit.get(), &output, raw_write);
+                }
                 // when non-blank and does not end in newline, add one in
-                if (s[0] != '\0' && s[strlen(s) - 1] != '\n') {
+                if (output.last != '\0' && output.last != '\n') {
                     srcml_archive_write_string(output_archive, "\n", 1);
                 }
             } else if (option(SRCML_COMMAND_CAT_XML)) {
@@ -200,7 +251,7 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
                 if (s[0] != '\0' && s[strlen(s) - 1] != '\n') {
                     srcml_archive_write_string(output_archive, "\n", 1);
                 }
-            } else {
+            } else if (!request->parse_on_write) {
                 status = srcml_archive_write_unit(output_archive, request->unit.get());
             }
             if (status != SRCML_STATUS_OK) {
@@ -208,6 +259,9 @@ void srcml_write_request(std::shared_ptr<ParseRequest> request, TraceLog& log, c
             }
         }
 
+        // lines of code of a streamed unit are only known once it is written
+        log.totalLOC(srcml_unit_get_loc(request->unit.get()));
+
         if (request->results)
             srcml_transform_free(request->results);
 
@@ -61,6 +61,13 @@ public :
      */
     virtual TransformationResult apply(xmlDocPtr doc, int position) const = 0;
 
+    /**
+     * modifies
+     *
+     * @returns if apply changes the doc it is applied to
+     */
+    virtual bool modifies() const { return false; }
+
     virtual ~Transformation() {}
 
       /** XSLT parameters */
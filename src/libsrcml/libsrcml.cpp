@@ -39,6 +39,7 @@
 #include <fstream>
 
 #include <memory>
+#include <mutex>
 
 #if defined(__GNUG__) && !defined(__MINGW32__) && !defined(NO_DLLOAD)
 #include <dlfcn.h>
@@ -86,6 +87,27 @@ static srcml_archive global_archive;
  */
 static srcml_unit global_unit;
 
+/**
+ * @var global_mutex
+ *
+ * guards global_archive and global_unit, so that the convenience functions
+ * can be called from multiple threads
+ */
+static std::mutex global_mutex;
+
+/**
+ * srcml_set_error_string
+ * @param error the error message
+ *
+ * Set the error message of the convenience functions.
+ */
+static void srcml_set_error_string(const std::string& error) {
+
+    std::lock_guard<std::mutex> lock(global_mutex);
+
+    global_archive.error_string = error;
+}
+
 /******************************************************************************
  *                                                                            *
  *                           Global Cleanup function                          *
@@ -152,26 +174,36 @@ int srcml(const char* input_filename, const char* output_filename) {
 
     if (!input_filename || !output_filename) {
 
-        global_archive.error_string = "No input file provided";
+        srcml_set_error_string("No input file provided");
         return SRCML_STATUS_INVALID_ARGUMENT;
     }
 
-    if (srcml_check_extension(input_filename)) {
+    // the settings of the convenience functions are copied, so they can change during the translation
+    std::unique_ptr<srcml_archive> archive;
+    boost::optional<std::string> unit_filename;
+    boost::optional<std::string> unit_timestamp;
+    {
+        std::lock_guard<std::mutex> lock(global_mutex);
 
-        // src->srcml
-        std::unique_ptr<srcml_archive> archive(srcml_archive_clone(&global_archive));
-        if (!archive) {
-            global_archive.error_string = "Unable to create srcML archive";
-            return SRCML_STATUS_ERROR;
-        }
+        archive.reset(srcml_archive_clone(&global_archive));
+        unit_filename = global_unit.filename;
+        unit_timestamp = global_unit.timestamp;
+    }
+    if (!archive) {
+        srcml_set_error_string("Unable to create srcML archive");
+        return SRCML_STATUS_ERROR;
+    }
+
+    if (srcml_archive_check_extension(archive.get(), input_filename)) {
 
+        // src->srcml
         int status = srcml_archive_write_open_filename(archive.get(), output_filename);
         if (status != SRCML_STATUS_OK)
             return status;
 
         std::unique_ptr<srcml_unit> unit(srcml_unit_create(archive.get()));
         if (!unit) {
-            global_archive.error_string = "Unable to create srcML unit";
+            srcml_set_error_string("Unable to create srcML unit");
             return SRCML_STATUS_ERROR;
         }
 
@@ -185,8 +217,8 @@ int srcml(const char* input_filename, const char* output_filename) {
             return status;
 
         // unit filename is based on convenience functions or the input filename
-        if (srcml_unit_get_filename(&global_unit) != 0)
-            status = srcml_unit_set_filename(unit.get(), srcml_unit_get_filename(&global_unit));
+        if (unit_filename)
+            status = srcml_unit_set_filename(unit.get(), unit_filename->c_str());
         else
             status = srcml_unit_set_filename(unit.get(), input_filename);
         if (status != SRCML_STATUS_OK)
@@ -197,7 +229,7 @@ int srcml(const char* input_filename, const char* output_filename) {
         if (status != SRCML_STATUS_OK)
             return status;
 
-        status = srcml_unit_set_timestamp(unit.get(), srcml_unit_get_timestamp(&global_unit));
+        status = srcml_unit_set_timestamp(unit.get(), unit_timestamp ? unit_timestamp->c_str() : 0);
         if (status != SRCML_STATUS_OK)
             return status;
 
@@ -218,24 +250,16 @@ int srcml(const char* input_filename, const char* output_filename) {
         if (!((len > 4 && tolower(input_filename[len - 1]) == 'l' && tolower(input_filename[len - 2]) == 'm'
             && ((tolower(input_filename[len - 3]) == 'x' && input_filename[len - 4] == '.')
              || (tolower(input_filename[len - 3]) == 'c' && tolower(input_filename[len - 4]) == 'r' && tolower(input_filename[len - 5]) == 's' && tolower(input_filename[len - 6]) == '.')))
-           || (global_archive.language && strcmp(global_archive.language->c_str(), "xml") == 0))) {
+           || (archive->language && strcmp(archive->language->c_str(), "xml") == 0))) {
 
-            if (global_archive.language) {
-                global_archive.error_string = "Language '";
-                global_archive.error_string += global_archive.language->c_str();
-                global_archive.error_string += "' is not supported.";
-            } else
-                global_archive.error_string = "No language provided.";
+            if (archive->language)
+                srcml_set_error_string("Language '" + *archive->language + "' is not supported.");
+            else
+                srcml_set_error_string("No language provided.");
 
             return SRCML_STATUS_INVALID_INPUT;
         }
 
-        std::unique_ptr<srcml_archive> archive(srcml_archive_clone(&global_archive));
-        if (!archive) {
-            global_archive.error_string = "Unable to create srcML archive";
-            return SRCML_STATUS_ERROR;
-        }
-
         int status = srcml_archive_read_open_filename(archive.get(), input_filename);
         if (status != SRCML_STATUS_OK)
             return status;
@@ -268,6 +292,8 @@ int srcml(const char* input_filename, const char* output_filename) {
  */
 int srcml_set_src_encoding(const char* encoding) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_set_src_encoding(&global_archive, encoding);
 }
 
@@ -281,6 +307,8 @@ int srcml_set_src_encoding(const char* encoding) {
  */
 int srcml_set_xml_encoding(const char* encoding) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_set_xml_encoding(&global_archive, encoding);
 }
 
@@ -294,6 +322,8 @@ int srcml_set_xml_encoding(const char* encoding) {
  */
 int srcml_set_language(const char* language) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_set_language(&global_archive, language);
 }
 
@@ -307,6 +337,8 @@ int srcml_set_language(const char* language) {
  */
 int srcml_set_filename(const char* filename) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_unit_set_filename(&global_unit, filename);
 }
 
@@ -320,6 +352,8 @@ int srcml_set_filename(const char* filename) {
  */
 int srcml_set_url(const char* url) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_set_url(&global_archive, url);
 }
 
@@ -333,6 +367,8 @@ int srcml_set_url(const char* url) {
  */
 int srcml_set_version(const char* version) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_set_version(&global_archive, version);
 }
 
@@ -346,6 +382,8 @@ int srcml_set_version(const char* version) {
  */
 int srcml_set_timestamp(const char* timestamp) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_unit_set_timestamp(&global_unit, timestamp);
 }
 
@@ -359,6 +397,8 @@ int srcml_set_timestamp(const char* timestamp) {
  */
 int srcml_set_options(size_t option) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_set_options(&global_archive, option);
 }
 
@@ -372,6 +412,8 @@ int srcml_set_options(size_t option) {
  */
 int srcml_enable_option(size_t option) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_enable_option(&global_archive, option);
 }
 
@@ -385,6 +427,8 @@ int srcml_enable_option(size_t option) {
  */
 int srcml_disable_option(size_t option) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_disable_option(&global_archive, option);
 }
 
@@ -398,6 +442,8 @@ int srcml_disable_option(size_t option) {
  */
 int srcml_set_tabstop(size_t tabstop) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_set_tabstop(&global_archive, tabstop);
 }
 
@@ -412,6 +458,8 @@ int srcml_set_tabstop(size_t tabstop) {
  */
 int srcml_register_file_extension(const char* extension, const char* language) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_register_file_extension(&global_archive, extension, language);
 }
 
@@ -426,6 +474,8 @@ int srcml_register_file_extension(const char* extension, const char* language) {
  */
 int srcml_register_namespace(const char* prefix, const char* ns) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_register_namespace(&global_archive, prefix, ns);
 }
 
@@ -440,6 +490,8 @@ int srcml_register_namespace(const char* prefix, const char* ns) {
  */
 int srcml_set_processing_instruction(const char* target, const char* data) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_set_processing_instruction(&global_archive, target, data);
 }
 
@@ -454,6 +506,8 @@ int srcml_set_processing_instruction(const char* target, const char* data) {
  */
 int srcml_set_eol(size_t eol) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_unit_set_eol(&global_unit, eol);
 }
 
@@ -479,6 +533,8 @@ size_t srcml_get_eol() {
  */
 int srcml_set_srcdiff_revision(size_t revision_number) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_set_srcdiff_revision(&global_archive, revision_number);
 }
 
@@ -769,6 +825,8 @@ const char * srcml_get_language_list(size_t pos) {
  */
 const char * srcml_check_extension(const char* filename) {
 
+    std::lock_guard<std::mutex> lock(global_mutex);
+
     return srcml_archive_check_extension(&global_archive, filename);
 }
 
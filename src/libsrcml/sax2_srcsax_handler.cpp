@@ -21,6 +21,7 @@
  */
 
 #include <sax2_srcsax_handler.hpp>
+#include <srcml_mmap_input.hpp>
 #include <srcmlns.hpp>
 #include <string>
 #include <algorithm>
@@ -48,12 +49,6 @@
     #define SRCSAX_DEBUG_END_CHARS(ch,len)
 #endif
 
-// libxml2 places elements into a dictionary
-// once initialized, can compare pointers instead of strings
-static const xmlChar* UNIT_ENTRY = nullptr;
-static const xmlChar* MACRO_LIST_ENTRY = nullptr;
-static const xmlChar* ESCAPE_ENTRY = nullptr;
-
 /**
  * factory
  *
@@ -103,6 +98,13 @@ static void update_ctx(void* ctx) {
     state->prevbase = ctxt->input->base;
 }
 
+// offset in the mapped input of a position in the libxml2 buffer. Without an encoder, the bytes
+// given to the parser after the position are the rest of its buffer
+static size_t mapped_offset(xmlParserCtxtPtr ctxt, const srcml_mapped_input* mapped, const xmlChar* pos) {
+
+    return mapped->parsed - (size_t) (ctxt->input->end - pos);
+}
+
 // unit and root delayed-start processing
 static int reparse_root(void* ctx) {
 
@@ -191,14 +193,16 @@ void start_document(void* ctx) {
     SRCSAX_DEBUG_START("");
 
     // save for dictionary lookup of common elements
-    UNIT_ENTRY       = xmlDictLookup(ctxt->dict, (const xmlChar*) "unit", (int) strlen("unit"));
-    MACRO_LIST_ENTRY = xmlDictLookup(ctxt->dict, (const xmlChar*) "macro-list", (int) strlen("macro-list"));
-    ESCAPE_ENTRY     = xmlDictLookup(ctxt->dict, (const xmlChar*) "escape", (int) strlen("escape"));
+    state->unit_entry       = xmlDictLookup(ctxt->dict, (const xmlChar*) "unit", (int) strlen("unit"));
+    state->macro_list_entry = xmlDictLookup(ctxt->dict, (const xmlChar*) "macro-list", (int) strlen("macro-list"));
+    state->escape_entry     = xmlDictLookup(ctxt->dict, (const xmlChar*) "escape", (int) strlen("escape"));
 
     // save the encoding from the input
     state->context->encoding = "UTF-8";
     if (ctxt->encoding && ctxt->encoding[0] != '\0')
         state->context->encoding = (const char *)ctxt->encoding;
+    else if (state->context->input && state->context->input->encoder)
+        state->context->encoding = state->context->input->encoder->name;
     else if (ctxt->input)
         state->context->encoding = (const char *)ctxt->input->encoding;
 
@@ -267,6 +271,10 @@ void start_root(void* ctx, const xmlChar* localname, const xmlChar* prefix, cons
 
     state->mode = ROOT;
 
+    // whitespace in the prolog is not reported, and the push parser starts the document before skipping it
+    while (state->base < ctxt->input->cur && state->base[0] != '<')
+        ++state->base;
+
     // save the root start tag because we are going to parse it again to generate proper start_root() and start_unit()
     // calls after we know whether this is an archive or not
     state->rootstarttag.reserve(ctxt->input->cur - state->base + 2);
@@ -373,7 +381,9 @@ void first_start_element(void* ctx, const xmlChar* localname, const xmlChar* pre
 
     // if macros are found, then must return, process first
     // but stay in first_start_element, since this can be between root unit and nested unit
-    if (localname == MACRO_LIST_ENTRY) {
+    if (localname == state->macro_list_entry) {
+
+        ++state->depth;
 
         state->context->handler->meta_tag(state->context, (const char*) localname, (const char*) prefix, (const char*) URI,
                                           nb_namespaces, namespaces, nb_attributes, attributes);
@@ -381,7 +391,7 @@ void first_start_element(void* ctx, const xmlChar* localname, const xmlChar* pre
     }
 
     // archive when the first element after the root is <unit>
-    state->context->is_archive = (localname == UNIT_ENTRY);
+    state->context->is_archive = (localname == state->unit_entry);
 
     // turn off first_start_element() handling
     ctxt->sax->startElementNs = &start_element;
@@ -438,6 +448,8 @@ void start_unit(void* ctx, const xmlChar* localname, const xmlChar* prefix, cons
     if (state == nullptr)
         return;
 
+    ++state->depth;
+
     // collect cpp prefix
     for (int i = 0; i < nb_namespaces; ++i) {
 
@@ -496,8 +508,8 @@ void start_unit(void* ctx, const xmlChar* localname, const xmlChar* prefix, cons
                                             nb_namespaces, namespaces,
                                             nb_attributes, attributes);
 
-    // assuming not collecting the unit body
-    ctxt->sax->startElementNs = 0;
+    // assuming not collecting the unit body, with elements only counted
+    ctxt->sax->startElementNs = &count_element;
     ctxt->sax->ignorableWhitespace = ctxt->sax->characters = 0;
     ctxt->sax->comment = 0;
     ctxt->sax->cdataBlock = 0;
@@ -516,6 +528,26 @@ void start_unit(void* ctx, const xmlChar* localname, const xmlChar* prefix, cons
     // start to collect source
     state->unitsrc.clear();
 
+    // the body of a unit of an archive in a mapped file, when libxml2 does not convert
+    // the encoding, is a single copy from the mapping. The start tag is checked against the
+    // mapping for the offset
+    state->mapped_unit = false;
+    const srcml_mapped_input* mapped = state->context->mapped;
+    if (mapped && state->context->is_archive && ctxt->input->buf && !ctxt->input->buf->encoder) {
+
+        const std::string& tag = state->unitsrcml;
+        size_t end = mapped_offset(ctxt, mapped, ctxt->input->cur) + 1;
+        size_t tag_size = tag.size() - (state->insert_end - state->insert_begin);
+        size_t tail_size = tag.size() - state->insert_end;
+        if (end <= mapped->size && tag_size <= end
+            && memcmp(mapped->data + end - tag_size, tag.data(), state->insert_begin) == 0
+            && memcmp(mapped->data + end - tail_size, tag.data() + state->insert_end, tail_size) == 0) {
+
+            state->mapped_unit = true;
+            state->mapped_begin = end;
+        }
+    }
+
     SRCSAX_DEBUG_END(localname);
 }
 
@@ -614,6 +646,8 @@ void start_element(void* ctx, const xmlChar* localname, const xmlChar* /* prefix
     if (state == nullptr)
         return;
 
+    ++state->depth;
+
     update_ctx(ctx);
 
     SRCSAX_DEBUG_START(localname);
@@ -622,7 +656,8 @@ void start_element(void* ctx, const xmlChar* localname, const xmlChar* /* prefix
 
         // end previous start element
         if (state->base[0] == '>') {
-            state->unitsrcml.append(1, '>');
+            if (!state->mapped_unit)
+                state->unitsrcml.append(1, '>');
             state->base += 1;
         }
 
@@ -633,13 +668,14 @@ void start_element(void* ctx, const xmlChar* localname, const xmlChar* /* prefix
 
         SRCML_DEBUG("BASE", (const char*) state->base, srcmllen);
 
-        state->unitsrcml.append((const char*) state->base, srcmllen);
+        if (!state->mapped_unit)
+            state->unitsrcml.append((const char*) state->base, srcmllen);
 
         SRCML_DEBUG("UNIT", state->unitsrcml.c_str(), state->unitsrcml.size());
 
         // Special element <escape char="0x0c"/> used to embed non-XML characters
         // extract the value of the char attribute and add to the src (text)
-        if (localname == ESCAPE_ENTRY) {
+        if (localname == state->escape_entry) {
 
             std::string svalue((const char *)attributes[0 * 5 + 3], attributes[0 * 5 + 4] - attributes[0 * 5 + 3]);
 
@@ -653,6 +689,35 @@ void start_element(void* ctx, const xmlChar* localname, const xmlChar* /* prefix
     SRCSAX_DEBUG_END(localname);
 }
 
+/**
+ * count_element
+ * @param ctx an xmlParserCtxtPtr
+ * @param localname the name of the element tag
+ * @param prefix the tag prefix
+ * @param URI the namespace of tag
+ * @param nb_namespaces number of namespaces definitions
+ * @param namespaces the defined namespaces
+ * @param nb_attributes the number of attributes on the tag
+ * @param nb_defaulted the number of defaulted attributes
+ * @param attributes list of attribute name value pairs (localname/prefix/URI/value/end)
+ *
+ * SAX handler function for start of an element that is not collected.
+ * Only counts the element.
+ */
+void count_element(void* ctx, const xmlChar* /* localname */, const xmlChar* /* prefix */, const xmlChar* /* URI */,
+                    int /* nb_namespaces */, const xmlChar** /* namespaces */,
+                    int /* nb_attributes */, int /* nb_defaulted */, const xmlChar** /* attributes */) {
+
+    auto ctxt = (xmlParserCtxtPtr) ctx;
+    if (ctxt == nullptr)
+        return;
+    auto state = (sax2_srcsax_handler*) ctxt->_private;
+    if (state == nullptr)
+        return;
+
+    ++state->depth;
+}
+
 /**
  * end_element
  * @param ctx an xmlParserCtxtPtr
@@ -673,6 +738,9 @@ void end_element(void* ctx, const xmlChar* localname, const xmlChar* prefix, con
     if (state == nullptr)
         return;
 
+    // the push parser ends an empty element before it counts it as open, so the depth is counted here
+    int depth = state->depth--;
+
     update_ctx(ctx);
 
     SRCSAX_DEBUG_START(localname);
@@ -686,8 +754,21 @@ void end_element(void* ctx, const xmlChar* localname, const xmlChar* prefix, con
             return;
         }
 
-        state->content_end = (int) state->unitsrcml.size() + 1;
-        state->unitsrcml.append((const char*) state->base, srcmllen);
+        if (!state->mapped_unit) {
+
+            state->content_end = (int) state->unitsrcml.size() + 1;
+            state->unitsrcml.append((const char*) state->base, srcmllen);
+
+        } else if (localname == state->unit_entry && depth == 2) {
+
+            // end of a unit whose body is in the mapped input
+            const srcml_mapped_input* mapped = state->context->mapped;
+            size_t end_tag = mapped_offset(ctxt, mapped, state->base);
+            state->unitsrcml.append(mapped->data + state->mapped_begin, end_tag - state->mapped_begin);
+            state->content_end = (int) state->unitsrcml.size() + 1;
+            state->unitsrcml.append(mapped->data + end_tag, srcmllen);
+            state->mapped_unit = false;
+        }
 
         SRCML_DEBUG("UNIT", state->unitsrcml.c_str(), state->unitsrcml.size());
     }
@@ -697,18 +778,18 @@ void end_element(void* ctx, const xmlChar* localname, const xmlChar* prefix, con
     SRCSAX_DEBUG_END(localname);
 
     // plain end element
-    if (localname != UNIT_ENTRY) {
+    if (localname != state->unit_entry) {
         return;
     }
 
     // At this point, we have the end of a unit
 
-    if (ctxt->nameNr == 2 || !state->context->is_archive) {
+    if (depth == 2 || !state->context->is_archive) {
 
         end_unit(ctx, localname, prefix, URI);
     }
 
-    if (ctxt->nameNr == 1) {
+    if (depth == 1) {
 
         state->mode = END_ROOT;
 
@@ -716,6 +797,70 @@ void end_element(void* ctx, const xmlChar* localname, const xmlChar* prefix, con
     }
 }
 
+/**
+ * stop_unit_body
+ * @param ctxt an xmlParserCtxtPtr
+ *
+ * Stop collecting the body of the unit being parsed, as if it
+ * was started without collecting the body.
+ */
+void stop_unit_body(xmlParserCtxtPtr ctxt) {
+
+    auto state = (sax2_srcsax_handler*) ctxt->_private;
+    if (state == nullptr || !state->collect_unit_body)
+        return;
+
+    state->collect_unit_body = false;
+    state->mapped_unit = false;
+    state->unitsrcml.clear();
+    state->unitsrc.clear();
+
+    ctxt->sax->startElementNs = &count_element;
+    ctxt->sax->ignorableWhitespace = ctxt->sax->characters = 0;
+    ctxt->sax->comment = 0;
+    ctxt->sax->cdataBlock = 0;
+    ctxt->sax->processingInstruction = 0;
+}
+
+/**
+ * unmap_unit_body
+ * @param ctxt an xmlParserCtxtPtr
+ *
+ * Collect the body of the unit being parsed as it is parsed, instead
+ * of copying it from the mapped input at the end of the unit.
+ */
+void unmap_unit_body(xmlParserCtxtPtr ctxt) {
+
+    auto state = (sax2_srcsax_handler*) ctxt->_private;
+    if (state == nullptr || !state->mapped_unit)
+        return;
+
+    // the body parsed so far is only in the mapped input
+    const srcml_mapped_input* mapped = state->context->mapped;
+    size_t end = mapped_offset(ctxt, mapped, state->base);
+    state->unitsrcml.append(mapped->data + state->mapped_begin, end - state->mapped_begin);
+    state->mapped_unit = false;
+}
+
+/**
+ * unit_body_size
+ * @param ctxt an xmlParserCtxtPtr
+ *
+ * @returns the size of the body of the unit being parsed so far,
+ * including the part still only in the mapped input.
+ */
+size_t unit_body_size(xmlParserCtxtPtr ctxt) {
+
+    auto state = (sax2_srcsax_handler*) ctxt->_private;
+    if (state == nullptr)
+        return 0;
+
+    if (!state->mapped_unit)
+        return state->unitsrcml.size();
+
+    return state->unitsrcml.size() + mapped_offset(ctxt, state->context->mapped, state->base) - state->mapped_begin;
+}
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 
@@ -784,7 +929,8 @@ void characters_unit(void* ctx, const xmlChar* ch, int len) {
 
     // end previous start element
     if (state->base[0] == '>') {
-        state->unitsrcml.append(1, '>');
+        if (!state->mapped_unit)
+            state->unitsrcml.append(1, '>');
         state->base += 1;
     }
 
@@ -793,7 +939,8 @@ void characters_unit(void* ctx, const xmlChar* ch, int len) {
     if (state->base == ctxt->input->cur) {
 
         // plain old strings
-        state->unitsrcml.append((const char*) ch, len);
+        if (!state->mapped_unit)
+            state->unitsrcml.append((const char*) ch, len);
 
         // libxml2 passes ctxt->input->cur as ch, so then must increment to len
         state->base = ctxt->input->cur + len;
@@ -801,7 +948,8 @@ void characters_unit(void* ctx, const xmlChar* ch, int len) {
     } else {
 
         // whitespace and escaped characters
-        state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
+        if (!state->mapped_unit)
+            state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
         state->base = ctxt->input->cur;
     }
 
@@ -833,7 +981,7 @@ void comment(void* ctx, const xmlChar* value) {
 
     SRCSAX_DEBUG_START("");
 
-    if (state->collect_unit_body) {
+    if (state->collect_unit_body && !state->mapped_unit) {
 
         // take the value but note it could be part of inter-unit
         state->unitsrcml.append("<!--");
@@ -872,7 +1020,8 @@ void cdata_block(void* ctx, const xmlChar* value, int len) {
     if (state->collect_unit_body) {
 
         // xml can get raw
-        state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
+        if (!state->mapped_unit)
+            state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
 
         // CDATA is character data
         state->unitsrc.append((const char*) value, len);
@@ -907,7 +1056,8 @@ void processing_instruction(void* ctx, const xmlChar* /* target */, const xmlCha
 
     if (state->collect_unit_body) {
 
-        state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
+        if (!state->mapped_unit)
+            state->unitsrcml.append((const char*) state->base, ctxt->input->cur - state->base);
 
         state->base = ctxt->input->cur;
     }
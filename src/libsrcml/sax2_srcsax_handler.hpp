@@ -65,6 +65,9 @@ struct sax2_srcsax_handler {
 
     int unit_count = 0;
 
+    /** number of open elements, counted by the start and end element handlers */
+    int depth = 0;
+
     /** the current parsing mode */
     srcMLMode mode = START;
 
@@ -93,9 +96,21 @@ struct sax2_srcsax_handler {
 
     int loc = 0;
 
+    /** the body of the unit is copied from the mapped input at the end of the unit, instead of as it is parsed */
+    bool mapped_unit = false;
+
+    /** offset in the mapped input of the start of the unit body */
+    size_t mapped_begin = 0;
+
     boost::optional<std::string> cpp_prefix;
 
     bool rootcalled = false;
+
+    /** dictionary entries of common elements, so that pointers are compared instead of strings.
+        Per parser, since each parser context has its own dictionary */
+    const xmlChar* unit_entry = nullptr;
+    const xmlChar* macro_list_entry = nullptr;
+    const xmlChar* escape_entry = nullptr;
 };
 
 /**
@@ -221,6 +236,25 @@ void start_element(void* ctx, const xmlChar* localname, const xmlChar* prefix, c
                     int nb_namespaces, const xmlChar** namespaces, int nb_attributes, int nb_defaulted,
                     const xmlChar** attributes);
 
+/**
+ * count_element
+ * @param ctx an xmlParserCtxtPtr
+ * @param localname the name of the element tag
+ * @param prefix the tag prefix
+ * @param URI the namespace of tag
+ * @param nb_namespaces number of namespaces definitions
+ * @param namespaces the defined namespaces
+ * @param nb_attributes the number of attributes on the tag
+ * @param nb_defaulted the number of defaulted attributes
+ * @param attributes list of attribute name value pairs (localname/prefix/URI/value/end)
+ *
+ * SAX handler function for start of an element that is not collected.
+ * Only counts the element.
+ */
+void count_element(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI,
+                    int nb_namespaces, const xmlChar** namespaces,
+                    int nb_attributes, int nb_defaulted, const xmlChar** attributes);
+
 /**
  * end_element_ns
  * @param ctx an xmlParserCtxtPtr
@@ -234,6 +268,33 @@ void start_element(void* ctx, const xmlChar* localname, const xmlChar* prefix, c
  */
 void end_element(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI);
 
+/**
+ * stop_unit_body
+ * @param ctxt an xmlParserCtxtPtr
+ *
+ * Stop collecting the body of the unit being parsed, as if it
+ * was started without collecting the body.
+ */
+void stop_unit_body(xmlParserCtxtPtr ctxt);
+
+/**
+ * unmap_unit_body
+ * @param ctxt an xmlParserCtxtPtr
+ *
+ * Collect the body of the unit being parsed as it is parsed, instead
+ * of copying it from the mapped input at the end of the unit.
+ */
+void unmap_unit_body(xmlParserCtxtPtr ctxt);
+
+/**
+ * unit_body_size
+ * @param ctxt an xmlParserCtxtPtr
+ *
+ * @returns the size of the body of the unit being parsed so far,
+ * including the part still only in the mapped input.
+ */
+size_t unit_body_size(xmlParserCtxtPtr ctxt);
+
 /**
  * characters_root
  * @param ctx an xmlParserCtxtPtr
@@ -69,23 +69,43 @@ srcsax_context * srcSAXController::getContext() {
  */
 void srcSAXController::parse(srcSAXHandler * handler) {
 
-    handler->set_controller(this);
+    while (parse_chunk(handler))
+        ;
+}
+
+/**
+ * parse_chunk
+ * @param handler srcMLHandler with hooks for sax parsing
+ * @param max_size maximum size of the chunk
+ *
+ * Parse the next chunk of the xml document with the supplied hooks.
+ * Parsing is in the calling thread, and all events for the chunk are
+ * delivered before returning.
+ *
+ * @returns true if there is more to parse, false if complete.
+ */
+bool srcSAXController::parse_chunk(srcSAXHandler * handler, size_t max_size) {
 
-    cppCallbackAdapter adapter(handler);
-    context->data = &adapter;
-    srcsax_handler sax_handler = cppCallbackAdapter::factory();
-    context->handler = &sax_handler;
+    if (!adapter) {
 
-    int status = srcsax_parse(context);
+        handler->set_controller(this);
 
-    context->data = 0;
+        adapter.reset(new cppCallbackAdapter(handler));
+        context->data = adapter.get();
+        sax_handler = cppCallbackAdapter::factory();
+        context->handler = &sax_handler;
+    }
 
-    if (status != 0) {
+    int status = srcsax_parse_chunk(context, max_size);
+
+    if (status < 0) {
 
         xmlErrorPtr ep = xmlCtxtGetLastError(context->libxml2_context);
-        SAXError error = { std::string(ep->message), ep->code };
+        SAXError error = { std::string(ep ? ep->message : ""), ep ? ep->code : XML_ERR_INTERNAL_ERROR };
 
         throw error;
     }
+
+    return status > 0;
 }
 
@@ -22,6 +22,7 @@
 #define INCLUDED_SRCSAX_CONTROLLER_HPP
 
 class srcSAXHandler;
+class cppCallbackAdapter;
 #include <srcsax.hpp>
 
 #include <libxml/parser.h>
@@ -56,6 +57,10 @@ private :
     // xmlParserCtxt
     srcsax_context* context = nullptr;
 
+    // forwarding of callbacks to the handler while parsing in chunks
+    std::unique_ptr<cppCallbackAdapter> adapter;
+    srcsax_handler sax_handler;
+
 public :
 
     /**
@@ -88,6 +93,17 @@ public :
      */
     void parse(srcSAXHandler * handler);
 
+    /**
+     * parse_chunk
+     * @param handler srcMLHandler with hooks for sax parsing
+     * @param max_size maximum size of the chunk
+     *
+     * Parse the next chunk of the xml document with the supplied hooks.
+     *
+     * @returns true if there is more to parse, false if complete.
+     */
+    bool parse_chunk(srcSAXHandler * handler, size_t max_size = SRCSAX_CHUNK_SIZE);
+
     /**
      * stop_parser
      *
@@ -85,6 +85,10 @@ typedef SSIZE_T ssize_t;
 #define SRCML_STATUS_UNSET_LANGUAGE       7
 /** Return status indicating their are no transformations */
 #define SRCML_STATUS_NO_TRANSFORMATION    8
+/** Return status indicating the executor queue is full */
+#define SRCML_STATUS_BUSY                 9
+/** Return status indicating the request was canceled */
+#define SRCML_STATUS_CANCELED             10
 /**@}*/
 
 /**@{ @anchor Language @name Core Language Set */
@@ -115,6 +119,8 @@ const unsigned int SRCML_OPTION_CPP_TEXT_ELSE     = 1<<4;
 const unsigned int SRCML_OPTION_CPP_MARKUP_IF0    = 1<<5;
 /** Encode the original source encoding as an attribute */
 const unsigned int SRCML_OPTION_STORE_ENCODING    = 1<<6;
+/** Encode position attributes as a single compact pos:span attribute (used with SRCML_OPTION_POSITION) */
+const unsigned int SRCML_OPTION_POSITION_COMPACT  = 1<<7;
 /**@}*/
 
 /**@{ @name Source Output EOL Options */
@@ -146,6 +152,45 @@ struct srcml_archive;
  */
 struct srcml_unit;
 
+/**
+ * @struct srcml_executor
+ *
+ * Pool of threads with a bounded queue for asynchronous parsing of units
+ */
+struct srcml_executor;
+
+/**
+ * @struct srcml_parse_request
+ *
+ * Handle to a pending asynchronous parse of a unit
+ */
+struct srcml_parse_request;
+
+/**
+ * Completion callback of an asynchronous parse, called with the unit, the status of the parse, and the user context.
+ * It is called on an executor thread, or on the thread that canceled the request or freed the executor.
+ * It must not free the executor, as srcml_executor_free() waits for the executor threads to finish.
+ */
+typedef void (*srcml_parse_callback)(struct srcml_unit* unit, int status, void* context);
+
+/**
+ * @struct srcml_parse_handler
+ *
+ * Callbacks for the parse events of a unit, delivered directly from the parser without generating srcML.
+ * The unit element is the first start and the last end, with the unit attributes and the start position only.
+ * Any callback may be NULL.
+ */
+struct srcml_parse_handler {
+    /** Start of an element, with attributes as name/value pairs, and the line/column of the start and end of the element */
+    void (*start_element)(void* context, const char* prefix, const char* localname, const char* uri,
+                          int num_attributes, const char** attributes,
+                          int start_line, int start_column, int end_line, int end_column);
+    /** End of an element */
+    void (*end_element)(void* context, const char* prefix, const char* localname, const char* uri);
+    /** Source-code text, not null terminated */
+    void (*characters)(void* context, const char* ch, int len);
+};
+
 /** @defgroup utility Utility functions
     @{
  */
@@ -272,6 +317,10 @@ LIBSRCML_DECL void srcml_memory_free(char * buffer);
   * Options can be queried with the global srcml_get_*() and
   srcml_check_*()
 
+  * The options are shared by the whole process. srcml() may be called from
+  multiple threads, and uses the options as they were when it started. Use
+  a srcml_archive for independent options
+
   @{
  */
 /**
@@ -593,11 +642,122 @@ LIBSRCML_DECL const char* srcml_archive_error_string(const struct srcml_archive*
  * @param archive A srcml_archive opened for writing
  * @param unit A srcml_unit to output
  * @note Can not mix with by element mode.
+ * @note May be called from multiple threads at once. Each call appends a complete unit.
  * @return SRCML_STATUS_OK on success
  * @return Status error code on failure
  */
 LIBSRCML_DECL int srcml_archive_write_unit(struct srcml_archive* archive, struct srcml_unit* unit);
 
+/**
+ * Append the srcml_unit unit to the srcml_archive archive after all units with a lower sequence number
+ * @param archive A srcml_archive opened for writing
+ * @param unit A srcml_unit to output
+ * @param sequence Position of the unit in the output. The first is 0, and each is used once, even when the write fails.
+ * @note Can not mix with by element mode.
+ * @note Intended to be called from multiple threads at once. A call waits until the unit before it in sequence is written.
+ * @return SRCML_STATUS_OK on success
+ * @return SRCML_STATUS_INVALID_ARGUMENT if the sequence number was already used, or is taken by a waiting write
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_archive_write_unit_sequence(struct srcml_archive* archive, struct srcml_unit* unit, size_t sequence);
+
+/**
+ * Parse the contents of the file with the name src_filename directly into the srcml_archive archive as a unit
+ * @param archive A srcml_archive opened for writing
+ * @param unit A srcml_unit with the unit metadata
+ * @param src_filename Name of a file to parse
+ * @note The srcML of the unit is not stored in the unit. The unit start tag is written before parsing,
+ * so it declares any namespace the language may use, and any hash is from a separate read of the file.
+ * @note The archive output is held for the whole parse, so parses into the same archive are serial.
+ * @note Can not mix with by element mode.
+ * @return SRCML_STATUS_OK on success
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_archive_write_parse_filename(struct srcml_archive* archive, struct srcml_unit* unit, const char* src_filename);
+
+/**
+ * Parse the contents of src_buffer directly into the srcml_archive archive as a unit
+ * @param archive A srcml_archive opened for writing
+ * @param unit A srcml_unit with the unit metadata
+ * @param src_buffer Buffer containing source code to parse
+ * @param buffer_size Size of the buffer to parse
+ * @note The srcML of the unit is not stored in the unit. The unit start tag is written before parsing,
+ * so it declares any namespace the language may use.
+ * @note The archive output is held for the whole parse, so parses into the same archive are serial.
+ * @note Can not mix with by element mode.
+ * @return SRCML_STATUS_OK on success
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_archive_write_parse_memory(struct srcml_archive* archive, struct srcml_unit* unit, const char* src_buffer, size_t buffer_size);
+
+/**
+ * Queue the parse of the file with the name src_filename into a unit on an executor, and write the unit
+ * to the srcml_archive archive after the units submitted before it
+ * @param archive A srcml_archive opened for writing, or any srcml_archive when there is a write callback
+ * @param executor A srcml_executor to parse on
+ * @param unit A srcml_unit with the unit metadata, created for this archive
+ * @param src_filename Name of a file to parse
+ * @param parsed Callback after the parse, on an executor thread in any order, e.g., to transform the unit. May be NULL.
+ * @param write Callback in place of the write of the unit, called with the status of the parse, in the order submitted
+ * and one at a time. May be NULL, and then a unit that fails to parse is not written.
+ * @param context User context passed to the callbacks
+ * @note The unit must not be used until it is written, or passed to the write callback, which may free it.
+ * Callbacks are called on executor threads, and must not wait on the archive.
+ * @note Can not mix with by element mode.
+ * @return SRCML_STATUS_OK on success
+ * @return SRCML_STATUS_BUSY if the queue of the executor is full
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_archive_write_submit_filename(struct srcml_archive* archive, struct srcml_executor* executor, struct srcml_unit* unit, const char* src_filename,
+                                                      srcml_parse_callback parsed, srcml_parse_callback write, void* context);
+
+/**
+ * Queue the parse of src_buffer into a unit on an executor, and write the unit to the srcml_archive archive
+ * after the units submitted before it
+ * @param archive A srcml_archive opened for writing, or any srcml_archive when there is a write callback
+ * @param executor A srcml_executor to parse on
+ * @param unit A srcml_unit with the unit metadata, created for this archive
+ * @param src_buffer Buffer containing source code to parse
+ * @param buffer_size Size of the buffer to parse
+ * @param parsed Callback after the parse, on an executor thread in any order. May be NULL.
+ * @param write Callback in place of the write of the unit, in the order submitted and one at a time. May be NULL.
+ * @param context User context passed to the callbacks
+ * @note The unit must not be used, and the buffer must not be changed, until the unit is written or passed to the write callback.
+ * @note Can not mix with by element mode.
+ * @return SRCML_STATUS_OK on success
+ * @return SRCML_STATUS_BUSY if the queue of the executor is full
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_archive_write_submit_memory(struct srcml_archive* archive, struct srcml_executor* executor, struct srcml_unit* unit,
+                                                    const char* src_buffer, size_t buffer_size,
+                                                    srcml_parse_callback parsed, srcml_parse_callback write, void* context);
+
+/**
+ * Submit a unit without a parse, and write it to the srcml_archive archive after the units submitted before it,
+ * e.g., a unit that is already parsed, or that the parsed callback parses
+ * @param archive A srcml_archive opened for writing, or any srcml_archive when there is a write callback
+ * @param executor A srcml_executor to call the parsed callback on
+ * @param unit A srcml_unit, or NULL when there is a write callback
+ * @param parsed Callback on an executor thread in any order, with SRCML_STATUS_OK. May be NULL.
+ * @param write Callback in place of the write of the unit, in the order submitted and one at a time. May be NULL.
+ * @param context User context passed to the callbacks
+ * @note Can not mix with by element mode.
+ * @return SRCML_STATUS_OK on success
+ * @return SRCML_STATUS_BUSY if the queue of the executor is full
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_archive_write_submit(struct srcml_archive* archive, struct srcml_executor* executor, struct srcml_unit* unit,
+                                             srcml_parse_callback parsed, srcml_parse_callback write, void* context);
+
+/**
+ * Wait until all units submitted to the srcml_archive archive are written
+ * @param archive A srcml_archive units were submitted to
+ * @note Must not be called from a callback of a submitted unit.
+ * @return SRCML_STATUS_OK on success
+ * @return Status error code of the first unit written without a write callback that failed to parse or write
+ */
+LIBSRCML_DECL int srcml_archive_write_submit_wait(struct srcml_archive* archive);
+
 /**
  * Append the string to the srcml_archive archive
  * @param archive A srcml_archive opened for writing
@@ -609,6 +769,23 @@ LIBSRCML_DECL int srcml_archive_write_unit(struct srcml_archive* archive, struct
  */
 LIBSRCML_DECL int srcml_archive_write_string(struct srcml_archive* archive, const char* s, int len);
 
+/**
+ * Append the units of srcML archives to the srcml_archive archive as is, after a root that merges their roots
+ * @param archive A srcml_archive opened for writing, with nothing written yet
+ * @param num_inputs Number of srcML inputs
+ * @param srcml_filenames Array of names of srcML files, archives or single units, possibly compressed
+ * @note Only the roots of the inputs are parsed. Units are found by their start and end tags, and their
+ * bytes are copied without parsing. The root of the output declares the namespaces of the roots of the inputs,
+ * has the url, version, and other attributes that all the roots have in common, and the macro lists of all the roots.
+ * @note The options and tabs of the inputs must be the same, and a prefix can not be for different namespaces.
+ * @note Units written by a merge are not in the index of the archive.
+ * @return SRCML_STATUS_OK on success
+ * @return SRCML_STATUS_INVALID_IO_OPERATION if the archive is not opened for writing, or something was already written
+ * @return SRCML_STATUS_IO_ERROR if an input can not be opened
+ * @return SRCML_STATUS_INVALID_INPUT if an input is not srcML, or can not be merged
+ */
+LIBSRCML_DECL int srcml_archive_write_merge_filenames(struct srcml_archive* archive, int num_inputs, const char* const srcml_filenames[]);
+
 /**
  * Close a srcml_archive opened using srcml_archive_read_open_*() or srcml_archive_write_open_*().
  * The archive can be reopened.
@@ -780,6 +957,56 @@ LIBSRCML_DECL int srcml_archive_enable_hash(struct srcml_archive* archive);
  */
 LIBSRCML_DECL int srcml_archive_disable_hash(struct srcml_archive* archive);
 
+/**
+ * Whether the archive has a unit index (in the case of a read), or would write one (in case of a write)
+ * @param archive A srcml archive opened for reading or writing
+ * @retval 1 Has a unit index
+ * @retval 0 Does not have a unit index
+ */
+LIBSRCML_DECL int srcml_archive_has_index(const struct srcml_archive* archive);
+
+/**
+ * Write a sidecar unit index file, named by adding ".idx" to the archive filename,
+ * with the byte offset, length, filename, language, hash and LOC of each unit.
+ * Reading the archive by filename then uses the index to go directly to a unit, as long as
+ * the size and modification time of the archive match the index. Opening a file for writing
+ * removes any index of it, with or without this option.
+ * Only applies to uncompressed output opened with srcml_archive_write_open_filename(),
+ * and not to units written by element. Must be set before the archive is opened for writing.
+ * @param archive A srcml_archive
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_enable_index(struct srcml_archive* archive);
+
+/**
+ * Do not write a unit index. This is the default.
+ * @param archive A srcml_archive
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_disable_index(struct srcml_archive* archive);
+
+/**
+ * Map an uncompressed archive file into memory for reading, instead of reading it into a buffer,
+ * so that its units are not copied as they are parsed. Must be set before srcml_archive_read_open_filename().
+ * The file must not be truncated or changed while the archive is open: reading past the new end
+ * of the file raises SIGBUS, which terminates the process, and changes may show up in the units.
+ * Files opened with an encoding, compressed files, and files read on multiple threads are not mapped.
+ * @param archive A srcml_archive
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_enable_mmap(struct srcml_archive* archive);
+
+/**
+ * Read an archive file into a buffer, instead of mapping it. This is the default.
+ * @param archive A srcml_archive
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_disable_mmap(struct srcml_archive* archive);
+
 /**
  * Set the XML encoding of the srcML archive
  * @param archive The srcml_archive to set the encoding
@@ -843,6 +1070,69 @@ LIBSRCML_DECL int srcml_archive_disable_option(struct srcml_archive* archive, si
  */
 LIBSRCML_DECL int srcml_archive_set_tabstop(struct srcml_archive* archive, size_t tabstop);
 
+/**
+ * Compress the srcML output of the archive with gzip, using multiple threads.
+ * Must be set before the archive is opened for writing.
+ * @param archive A srcml_archive
+ * @param num_threads Number of threads to compress with, 0 for no compression
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ * @retval SRCML_STATUS_ERROR if gzip compression is not supported
+ */
+LIBSRCML_DECL int srcml_archive_set_gzip_threads(struct srcml_archive* archive, int num_threads);
+
+/**
+ * Make the gzip srcML output of the archive seekable. Each group of num_units units
+ * is compressed as an independent gzip member, with a seek table at the end, so that
+ * reading by filename can decompress only the members it needs. The output is still
+ * an ordinary gzip file. Must be set before the archive is opened for writing.
+ * @param archive A srcml_archive
+ * @param num_units Number of units in each member, 0 for a single gzip stream
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ * @retval SRCML_STATUS_ERROR if gzip compression is not supported
+ */
+LIBSRCML_DECL int srcml_archive_set_gzip_frame_units(struct srcml_archive* archive, size_t num_units);
+
+/**
+ * Read units of the archive ahead of the caller on a separate thread, into a queue
+ * bounded by a number of units and by the size of their srcML. Either limit can be 0
+ * for no limit, and both 0 reads units in the caller's thread. A single unit larger than
+ * num_bytes is still read ahead. Must be set before the archive is opened for reading.
+ * @param archive A srcml_archive
+ * @param num_units Maximum number of units read ahead, 0 for no limit
+ * @param num_bytes Maximum size in bytes of the srcML of the units read ahead, 0 for no limit
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_set_read_ahead(struct srcml_archive* archive, size_t num_units, size_t num_bytes);
+
+/**
+ * Parse an archive opened with srcml_archive_read_open_filename() on multiple threads.
+ * The archive is split into partitions at unit boundaries, using the unit index if there is one,
+ * and the partitions are parsed in parallel. Units are still read in order. Only applies to
+ * large, uncompressed archives in an encoding where '<' is a single byte, e.g., UTF-8; others are
+ * read in a single thread. The number of threads is limited to the number of cores, so a single
+ * core always reads in a single thread. Must be set before the archive is opened for reading.
+ * @param archive A srcml_archive
+ * @param num_threads Number of threads to parse with, 0 or 1 for a single thread
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_set_read_threads(struct srcml_archive* archive, int num_threads);
+
+/**
+ * Only read the headers of units, i.e., their attributes and lines of code, for metadata.
+ * After the first unit, the input is scanned for unit start tags instead of parsed,
+ * and the unit bodies are not checked to be well-formed. Units are read with
+ * srcml_archive_read_unit_header(). Must be set before the archive is opened for reading.
+ * @param archive A srcml_archive
+ * @param header_scan Non-zero to only read unit headers
+ * @retval SRCML_STATUS_OK on success
+ * @retval SRCML_STATUS_INVALID_ARGUMENT
+ */
+LIBSRCML_DECL int srcml_archive_set_header_scan(struct srcml_archive* archive, int header_scan);
+
 /**
  * Set an extension to be associated with a given source-code language
  * @param archive A srcml_archive that associates the given extension with a language
@@ -946,6 +1236,42 @@ LIBSRCML_DECL int srcml_archive_get_options(const struct srcml_archive* archive)
  */
 LIBSRCML_DECL size_t srcml_archive_get_tabstop(const struct srcml_archive* archive);
 
+/**
+ * @param archive A srcml_archive
+ * @return The number of threads for gzip compression of the output, 0 for no compression
+ */
+LIBSRCML_DECL int srcml_archive_get_gzip_threads(const struct srcml_archive* archive);
+
+/**
+ * @param archive A srcml_archive
+ * @return The number of units in each gzip member of seekable output, 0 for a single gzip stream
+ */
+LIBSRCML_DECL size_t srcml_archive_get_gzip_frame_units(const struct srcml_archive* archive);
+
+/**
+ * @param archive A srcml_archive
+ * @return The maximum number of units read ahead, 0 for no limit
+ */
+LIBSRCML_DECL size_t srcml_archive_get_read_ahead_units(const struct srcml_archive* archive);
+
+/**
+ * @param archive A srcml_archive
+ * @return The maximum size in bytes of the srcML of the units read ahead, 0 for no limit
+ */
+LIBSRCML_DECL size_t srcml_archive_get_read_ahead_bytes(const struct srcml_archive* archive);
+
+/**
+ * @param archive A srcml_archive
+ * @return The number of threads to parse an archive opened by filename with, 0 or 1 for a single thread
+ */
+LIBSRCML_DECL int srcml_archive_get_read_threads(const struct srcml_archive* archive);
+
+/**
+ * @param archive A srcml_archive
+ * @return If only unit headers are read, with a scan of the input
+ */
+LIBSRCML_DECL int srcml_archive_get_header_scan(const struct srcml_archive* archive);
+
 /**
  * @param archive A srcml_archive
  * @return The number of currently defined namespaces or 0 if archive is NULL
@@ -1005,6 +1331,8 @@ LIBSRCML_DECL const char* srcml_archive_check_extension(const struct srcml_archi
 */
 /**
  * Read the next unit header from the archive
+ * The body of the unit can then be streamed, without collecting the whole unit,
+ * by srcml_unit_unparse_*() or srcml_unit_get_srcml_inner_io()
  * @param archive A srcml_archive open for reading
  * @return The read srcml_unit, with header information only, on success
  * @return NULL on failure
@@ -1026,6 +1354,29 @@ LIBSRCML_DECL struct srcml_unit* srcml_archive_read_unit(struct srcml_archive* a
  * @return NULL on failure
  */
 LIBSRCML_DECL int srcml_archive_skip_unit(struct srcml_archive* archive);
+
+/**
+ * Skip the next num_units units from the archive. For a seekable gzip archive opened
+ * by filename, whole gzip members are skipped without decompressing them. For an archive
+ * with a unit index opened by filename, the skipped units are not read at all.
+ * @param archive A srcml_archive open for reading
+ * @param num_units The number of units to skip
+ * @return 1 Succesfully skipped
+ * @return 0 on failure, including fewer than num_units units
+ */
+LIBSRCML_DECL int srcml_archive_skip_units(struct srcml_archive* archive, size_t num_units);
+
+/**
+ * Read the unit at a position in the archive, with reading continuing after it.
+ * With a unit index, or for a seekable gzip archive, the archive is read from the unit
+ * on, before or after the current position. Otherwise, the unit must not be before
+ * the current position, and the units before it are skipped.
+ * @param archive A srcml_archive open for reading
+ * @param position The position of the unit in the archive, starting at 0
+ * @return The read srcml_unit on success
+ * @return NULL on failure
+ */
+LIBSRCML_DECL struct srcml_unit* srcml_archive_read_unit_at(struct srcml_archive* archive, size_t position);
 /**@}*/
 
 /**@{ @name XPath query and XSLT transformations */
@@ -1437,6 +1788,19 @@ LIBSRCML_DECL const char* srcml_unit_get_srcml_outer(struct srcml_unit* unit);
  */
 LIBSRCML_DECL const char* srcml_unit_get_srcml_inner(struct srcml_unit* unit);
 
+/**
+ * Write the srcML without the enclosing unit tags using a write callback
+ * For a unit read with srcml_archive_read_unit_header(), the srcML is streamed in chunks
+ * as the rest of the unit is parsed, so the whole unit is never in memory. The body of the
+ * unit is then consumed, and no other srcML or source of the unit is available.
+ * @param unit A srcml unit opened for reading
+ * @param context User provided context for the callback
+ * @param write_callback A write callback function
+ * @return SRCML_STATUS_OK on success
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_unit_get_srcml_inner_io(struct srcml_unit* unit, void* context, int (*write_callback)(void* context, const char* buffer, int len));
+
 /**@}*/
 
 /**@{ @name Convert source code to srcML
@@ -1492,6 +1856,115 @@ LIBSRCML_DECL int srcml_unit_parse_fd(struct srcml_unit* unit, int src_fd);
 LIBSRCML_DECL int srcml_unit_parse_io(struct srcml_unit* unit, void * context, ssize_t (*read_callback)(void * context, void * buffer, size_t len), int (*close_callback)(void * context));
 /**@}*/
 
+/**@{ @name Convert source code to parse events
+      @brief Source code is parsed and the events are delivered to a srcml_parse_handler. No srcML is stored in the unit.
+      */
+/**
+ * Parse the contents of the file with the name src_filename and deliver the parse events to the handler
+ * @param unit A srcml_unit with the unit metadata
+ * @param src_filename Name of a file to parse
+ * @param handler Callbacks for the parse events
+ * @param context User context passed to each callback
+ * @return SRCML_STATUS_OK on success
+ * @return Status error code on failure.
+ */
+LIBSRCML_DECL int srcml_unit_parse_filename_events(struct srcml_unit* unit, const char* src_filename, const struct srcml_parse_handler* handler, void* context);
+
+/**
+ * Parse the contents of the src_buffer and deliver the parse events to the handler
+ * @param unit A srcml_unit with the unit metadata
+ * @param src_buffer Buffer containing source code to parse
+ * @param buffer_size Size of the buffer to parse
+ * @param handler Callbacks for the parse events
+ * @param context User context passed to each callback
+ * @return SRCML_STATUS_OK on success
+ * @return Status error code on failure.
+ */
+LIBSRCML_DECL int srcml_unit_parse_memory_events(struct srcml_unit* unit, const char* src_buffer, size_t buffer_size, const struct srcml_parse_handler* handler, void* context);
+/**@}*/
+
+/**@{ @name Convert source code to srcML asynchronously
+      @brief Parsing is queued on a srcml_executor, and completion is delivered to a callback and a pollable srcml_parse_request.
+      */
+/**
+ * Create a new executor for asynchronous parsing
+ * @param num_threads Number of threads to parse with, or 0 for the number of cores
+ * @param max_queued Maximum number of requests waiting for a thread, or 0 for no limit
+ * @return The created srcml_executor
+ * @return NULL on failure
+ */
+LIBSRCML_DECL struct srcml_executor* srcml_executor_create(int num_threads, int max_queued);
+
+/**
+ * Free an executor. Queued requests are canceled, and running requests are finished first.
+ * @note Must not be called from a completion callback.
+ * @param executor A srcml_executor
+ */
+LIBSRCML_DECL void srcml_executor_free(struct srcml_executor* executor);
+
+/**
+ * Queue the parse of the contents of the file with the name src_filename into a unit
+ * @param executor A srcml_executor to parse on
+ * @param unit A srcml_unit to parse the results to
+ * @param src_filename Name of a file to parse
+ * @param callback Completion callback, may be NULL
+ * @param context User context passed to the callback
+ * @param request Address to store a handle to the request, or NULL. The handle must be freed with srcml_parse_request_free().
+ * @note The unit must not be used until the request completes.
+ * @return SRCML_STATUS_OK on success
+ * @return SRCML_STATUS_BUSY if the queue of the executor is full
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_unit_parse_filename_async(struct srcml_executor* executor, struct srcml_unit* unit, const char* src_filename,
+                                                  srcml_parse_callback callback, void* context, struct srcml_parse_request** request);
+
+/**
+ * Queue the parse of the contents of src_buffer into a unit
+ * @param executor A srcml_executor to parse on
+ * @param unit A srcml_unit to parse the results to
+ * @param src_buffer Buffer containing source code to parse
+ * @param buffer_size Size of the buffer to parse
+ * @param callback Completion callback, may be NULL
+ * @param context User context passed to the callback
+ * @param request Address to store a handle to the request, or NULL. The handle must be freed with srcml_parse_request_free().
+ * @note The unit must not be used, and the buffer must not be changed, until the request completes.
+ * @return SRCML_STATUS_OK on success
+ * @return SRCML_STATUS_BUSY if the queue of the executor is full
+ * @return Status error code on failure
+ */
+LIBSRCML_DECL int srcml_unit_parse_memory_async(struct srcml_executor* executor, struct srcml_unit* unit, const char* src_buffer, size_t buffer_size,
+                                                srcml_parse_callback callback, void* context, struct srcml_parse_request** request);
+
+/**
+ * Check if a request is complete, i.e., parsed, failed, or canceled
+ * @param request A srcml_parse_request
+ * @return 1 if complete, 0 otherwise
+ */
+LIBSRCML_DECL int srcml_parse_request_is_done(struct srcml_parse_request* request);
+
+/**
+ * Wait for a request to complete
+ * @param request A srcml_parse_request
+ * @return Status of the parse on success, SRCML_STATUS_CANCELED if canceled
+ * @return SRCML_STATUS_INVALID_ARGUMENT on an invalid request
+ */
+LIBSRCML_DECL int srcml_parse_request_wait(struct srcml_parse_request* request);
+
+/**
+ * Cancel a request that has not started parsing. The callback is called with SRCML_STATUS_CANCELED.
+ * @param request A srcml_parse_request
+ * @return SRCML_STATUS_OK on success
+ * @return SRCML_STATUS_ERROR if the request already started parsing
+ */
+LIBSRCML_DECL int srcml_parse_request_cancel(struct srcml_parse_request* request);
+
+/**
+ * Free the handle to a request. A request that has not completed still completes.
+ * @param request A srcml_parse_request
+ */
+LIBSRCML_DECL void srcml_parse_request_free(struct srcml_parse_request* request);
+/**@}*/
+
 /**@{ @name Convert srcML to source code
       @brief srcML in a srcml unit is converted back to source code, and stored in a variety of output destinations
       */
@@ -23,7 +23,21 @@
 #include <srcmlns.hpp>
 #include <srcml_translator.hpp>
 #include <srcml_sax2_reader.hpp>
+#include <srcml_gzip_output.hpp>
+#include <srcml_gzip_input.hpp>
+#include <srcml_unit_index.hpp>
+#include <srcml_parallel_reader.hpp>
+#include <srcml_mmap_input.hpp>
+#include <srcml_merge_input.hpp>
+#include <srcml_executor.hpp>
+#include <unit_utilities.hpp>
 #include <libxml/encoding.h>
+#include <algorithm>
+#include <cstdio>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 /**
  * srcml_archive_check_extension
@@ -289,7 +303,7 @@ int srcml_archive_set_options(struct srcml_archive* archive, size_t options) {
         archive->options |= SRCML_OPTION_CPP_DECLARED;
     }
 
-    int modoption = options % (1<<7);
+    int modoption = options % (1<<8);
 
     archive->options = modoption;
 
@@ -311,6 +325,20 @@ int srcml_archive_has_hash(const struct srcml_archive* archive) {
     return (archive->options & SRCML_OPTION_HASH) != 0;
 }
 
+/**
+ * @param archive a srcml_archive
+ */
+int srcml_archive_has_index(const struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return 0;
+
+    if (archive->type == SRCML_ARCHIVE_READ || archive->type == SRCML_ARCHIVE_RW)
+        return archive->unit_index != nullptr;
+
+    return archive->write_index;
+}
+
 /**
  * @param archive a srcml_archive
  */
@@ -363,6 +391,80 @@ int srcml_archive_disable_hash(struct srcml_archive* archive) {
     return SRCML_STATUS_OK;
 }
 
+/**
+ * srcml_archive_enable_index
+ * @param archive a srcml_archive
+ *
+ * Write a sidecar index of the units of an archive written to a file.
+ * Applies to the next srcml_archive_write_open_filename.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on an invalid argument.
+ */
+int srcml_archive_enable_index(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->write_index = true;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_disable_index
+ * @param archive a srcml_archive
+ *
+ * Do not write a sidecar index of the units.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on an invalid argument.
+ */
+int srcml_archive_disable_index(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->write_index = false;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_enable_mmap
+ * @param archive a srcml_archive
+ *
+ * Map an archive file into memory for reading.
+ * Applies to the next srcml_archive_read_open_filename.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on an invalid argument.
+ */
+int srcml_archive_enable_mmap(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->read_mmap = true;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_disable_mmap
+ * @param archive a srcml_archive
+ *
+ * Read an archive file into a buffer, instead of mapping it.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on an invalid argument.
+ */
+int srcml_archive_disable_mmap(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->read_mmap = false;
+
+    return SRCML_STATUS_OK;
+}
+
 /**
  * srcml_archive_enable_option
  * @param archive a srcml_archive
@@ -383,7 +485,7 @@ int srcml_archive_enable_option(struct srcml_archive* archive, size_t option) {
         archive->options |= SRCML_OPTION_CPP_DECLARED;
     }
 
-    int modoption = option % (1<<7);
+    int modoption = option % (1<<8);
 
     archive->options |= modoption;
 
@@ -405,7 +507,7 @@ int srcml_archive_disable_option(struct srcml_archive* archive, size_t option) {
     if (archive == nullptr)
         return SRCML_STATUS_INVALID_ARGUMENT;
 
-    int modoption = option % (1<<7);
+    int modoption = option % (1<<8);
 
     archive->options &= ~modoption;
 
@@ -431,6 +533,122 @@ int srcml_archive_set_tabstop(struct srcml_archive* archive, size_t tabstop) {
     return SRCML_STATUS_OK;
 }
 
+/**
+ * srcml_archive_set_gzip_threads
+ * @param archive a srcml_archive
+ * @param num_threads number of threads to compress with, 0 for no compression
+ *
+ * Compress the srcML output with gzip using num_threads threads.
+ * Applies to the next srcml_archive_write_open_*.
+ *
+ * @returns SRCML_STATUS_OK on success, SRCML_STATUS_INVALID_ARGUMENT on an invalid argument,
+ * and SRCML_STATUS_ERROR if built without gzip support.
+ */
+int srcml_archive_set_gzip_threads(struct srcml_archive* archive, int num_threads) {
+
+    if (archive == nullptr || num_threads < 0)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+#ifndef WITH_ZLIB
+    if (num_threads)
+        return SRCML_STATUS_ERROR;
+#endif
+
+    archive->gzip_threads = num_threads;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_set_gzip_frame_units
+ * @param archive a srcml_archive
+ * @param num_units number of units in each gzip member, 0 for a single gzip stream
+ *
+ * Compress the srcML output with gzip as a seekable archive, with each group of
+ * num_units units in an independent gzip member. Applies to the next srcml_archive_write_open_*.
+ *
+ * @returns SRCML_STATUS_OK on success, SRCML_STATUS_INVALID_ARGUMENT on an invalid argument,
+ * and SRCML_STATUS_ERROR if built without gzip support.
+ */
+int srcml_archive_set_gzip_frame_units(struct srcml_archive* archive, size_t num_units) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+#ifndef WITH_ZLIB
+    if (num_units)
+        return SRCML_STATUS_ERROR;
+#endif
+
+    archive->gzip_frame_units = num_units;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_set_read_ahead
+ * @param archive a srcml_archive
+ * @param num_units maximum number of units to read ahead, 0 for no limit
+ * @param num_bytes maximum size of the srcML of the units read ahead, 0 for no limit
+ *
+ * Read units ahead of the caller on a thread, into a queue bounded by
+ * num_units and num_bytes. Both 0 reads in the caller's thread.
+ * Applies to the next srcml_archive_read_open_*.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on an invalid argument.
+ */
+int srcml_archive_set_read_ahead(struct srcml_archive* archive, size_t num_units, size_t num_bytes) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->read_ahead_units = num_units;
+    archive->read_ahead_bytes = num_bytes;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_set_read_threads
+ * @param archive a srcml_archive
+ * @param num_threads number of threads to parse with, 0 or 1 for a single thread
+ *
+ * Parse the partitions of an archive file on multiple threads.
+ * Applies to the next srcml_archive_read_open_filename.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on an invalid argument.
+ */
+int srcml_archive_set_read_threads(struct srcml_archive* archive, int num_threads) {
+
+    if (archive == nullptr || num_threads < 0)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->read_threads = num_threads;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_set_header_scan
+ * @param archive a srcml_archive
+ * @param header_scan non-zero to only read unit headers, with a scan of the input
+ *
+ * Read only the headers and lines of code of units. After the first unit,
+ * the input is scanned for unit start tags instead of parsed.
+ * Applies to the next srcml_archive_read_open_*.
+ *
+ * @returns SRCML_STATUS_OK on success and SRCML_STATUS_INVALID_ARGUMENT on an invalid argument.
+ */
+int srcml_archive_set_header_scan(struct srcml_archive* archive, int header_scan) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    archive->header_scan = header_scan != 0;
+
+    return SRCML_STATUS_OK;
+}
+
 /**
  * srcml_archive_register_file_extension
  * @param archive a srcml_archive
@@ -559,6 +777,8 @@ int srcml_archive_register_macro(struct srcml_archive* archive, const char* toke
  * @param revision_number
  *
  * Set what revision (0 = original, 1 = modified) in a srcDiff archive to operate with.
+ * The revision can be changed between reads of a unit, since both revisions
+ * of a unit are extracted at the same time.
  *
  * @returns SRCML_STATUS_OK on success and a status error code on failure.
  */
@@ -654,7 +874,7 @@ const char* srcml_archive_get_version(const struct srcml_archive* archive) {
  */
 int srcml_archive_get_options(const struct srcml_archive* archive) {
 
-    return archive ? (archive->options % (1<<7)) : 0;
+    return archive ? (archive->options % (1<<8)) : 0;
 }
 
 /**
@@ -668,6 +888,72 @@ size_t srcml_archive_get_tabstop(const struct srcml_archive* archive) {
     return archive ? archive->tabstop : 0;
 }
 
+/**
+ * srcml_archive_get_gzip_threads
+ * @param archive a srcml_archive
+ *
+ * @returns Retrieve the number of threads for gzip compression of the output, 0 for none.
+ */
+int srcml_archive_get_gzip_threads(const struct srcml_archive* archive) {
+
+    return archive ? archive->gzip_threads : 0;
+}
+
+/**
+ * srcml_archive_get_gzip_frame_units
+ * @param archive a srcml_archive
+ *
+ * @returns Retrieve the number of units in each gzip member of seekable output, 0 for a single gzip stream.
+ */
+size_t srcml_archive_get_gzip_frame_units(const struct srcml_archive* archive) {
+
+    return archive ? archive->gzip_frame_units : 0;
+}
+
+/**
+ * srcml_archive_get_read_ahead_units
+ * @param archive a srcml_archive
+ *
+ * @returns Retrieve the maximum number of units read ahead, 0 for no limit.
+ */
+size_t srcml_archive_get_read_ahead_units(const struct srcml_archive* archive) {
+
+    return archive ? archive->read_ahead_units : 0;
+}
+
+/**
+ * srcml_archive_get_read_ahead_bytes
+ * @param archive a srcml_archive
+ *
+ * @returns Retrieve the maximum size of the srcML of the units read ahead, 0 for no limit.
+ */
+size_t srcml_archive_get_read_ahead_bytes(const struct srcml_archive* archive) {
+
+    return archive ? archive->read_ahead_bytes : 0;
+}
+
+/**
+ * srcml_archive_get_read_threads
+ * @param archive a srcml_archive
+ *
+ * @returns Retrieve the number of threads to parse an archive file with, 0 or 1 for a single thread.
+ */
+int srcml_archive_get_read_threads(const struct srcml_archive* archive) {
+
+    return archive ? archive->read_threads : 0;
+}
+
+/**
+ * srcml_archive_get_header_scan
+ * @param archive a srcml_archive
+ *
+ * @returns Retrieve if only unit headers are read, with a scan of the input.
+ */
+int srcml_archive_get_header_scan(const struct srcml_archive* archive) {
+
+    return archive && archive->header_scan ? 1 : 0;
+}
+
 /**
  * srcml_archive_get_namespace_size
  * @param archive a srcml_archive
@@ -873,6 +1159,22 @@ size_t srcml_archive_get_srcdiff_revision(const struct srcml_archive* archive) {
  *                                                                            *
  ******************************************************************************/
 
+/**
+ * srcml_archive_write_gzip
+ * @param archive a srcml_archive
+ *
+ * @returns if the output is compressed with gzip.
+ */
+static bool srcml_archive_write_gzip(const struct srcml_archive* archive) {
+
+#ifdef WITH_ZLIB
+    return archive->gzip_threads || archive->gzip_frame_units;
+#else
+    (void) archive;
+    return false;
+#endif
+}
+
 static int srcml_archive_write_create_translator_xml_buffer(struct srcml_archive* archive) {
 
     try {
@@ -891,6 +1193,10 @@ static int srcml_archive_write_create_translator_xml_buffer(struct srcml_archive
                                                 optional_to_c_str(archive->version),
                                                 archive->attributes, 0, 0, 0);
         archive->translator->set_macro_list(archive->user_macro_list);
+        if (srcml_archive_write_gzip(archive))
+            archive->translator->set_frame_units(archive->gzip_frame_units);
+        if (archive->unit_index)
+            archive->translator->set_unit_index(archive->unit_index.get());
 
     } catch(...) {
 
@@ -902,6 +1208,44 @@ static int srcml_archive_write_create_translator_xml_buffer(struct srcml_archive
     return SRCML_STATUS_OK;
 }
 
+/**
+ * srcml_archive_write_output_encoder
+ * @param archive a srcml_archive
+ * @param encoder the encoding handler for the output
+ *
+ * With gzip compression the encoding is done before compression, so
+ * the underlying output buffer has no encoding handler.
+ *
+ * @returns the encoding handler for the underlying output buffer.
+ */
+static xmlCharEncodingHandlerPtr srcml_archive_write_output_encoder(const struct srcml_archive* archive, xmlCharEncodingHandlerPtr encoder) {
+
+    return srcml_archive_write_gzip(archive) ? nullptr : encoder;
+}
+
+/**
+ * srcml_archive_write_output
+ * @param archive a srcml_archive
+ * @param output the underlying output buffer
+ * @param encoder the encoding handler for the output
+ *
+ * Wrap the output buffer in gzip compression, if enabled.
+ *
+ * @returns the output buffer for the translator, or NULL on failure.
+ */
+static xmlOutputBufferPtr srcml_archive_write_output(const struct srcml_archive* archive, xmlOutputBufferPtr output, xmlCharEncodingHandlerPtr encoder) {
+
+#ifdef WITH_ZLIB
+    if (srcml_archive_write_gzip(archive))
+        return srcml_gzip_output_create(output, std::max(archive->gzip_threads, 1), encoder, archive->gzip_frame_units);
+#else
+    (void) archive;
+    (void) encoder;
+#endif
+
+    return output;
+}
+
 /**
  * srcml_archive_write_open_filename
  * @param archive a srcml_archive
@@ -918,7 +1262,22 @@ int srcml_archive_write_open_filename(struct srcml_archive* archive, const char*
         return SRCML_STATUS_INVALID_ARGUMENT;
 
     archive->type = SRCML_ARCHIVE_WRITE;
-    archive->output_buffer = xmlOutputBufferCreateFilename(srcml_filename, 0, 0);
+
+    // an index of an earlier archive in the file no longer matches it
+    remove(srcml_unit_index_filename(srcml_filename).c_str());
+
+    // an index of uncompressed output counts the bytes written to the file
+    archive->unit_index.reset();
+    if (archive->write_index && !srcml_archive_write_gzip(archive)) {
+
+        archive->unit_index = std::make_shared<srcml_unit_index>();
+        archive->seek_filename = srcml_filename;
+        archive->output_buffer = srcml_unit_index_output_create(srcml_filename, archive->unit_index);
+
+        return SRCML_STATUS_OK;
+    }
+
+    archive->output_buffer = srcml_archive_write_output(archive, xmlOutputBufferCreateFilename(srcml_filename, 0, 0), 0);
 
     return SRCML_STATUS_OK;
 }
@@ -946,7 +1305,7 @@ int srcml_archive_write_open_memory(struct srcml_archive* archive, char** buffer
     archive->size = size;
 
     archive->xbuffer = xmlBufferCreate();
-    archive->output_buffer = xmlOutputBufferCreateBuffer(archive->xbuffer, 0);
+    archive->output_buffer = srcml_archive_write_output(archive, xmlOutputBufferCreateBuffer(archive->xbuffer, 0), 0);
 
     return SRCML_STATUS_OK;
 }
@@ -968,7 +1327,8 @@ int srcml_archive_write_open_FILE(struct srcml_archive* archive, FILE* srcml_fil
 
     archive->type = SRCML_ARCHIVE_WRITE;
 
-    archive->output_buffer = xmlOutputBufferCreateFile(srcml_file, xmlFindCharEncodingHandler(archive->encoding ? archive->encoding->c_str() : 0));
+    xmlCharEncodingHandlerPtr encoder = xmlFindCharEncodingHandler(archive->encoding ? archive->encoding->c_str() : 0);
+    archive->output_buffer = srcml_archive_write_output(archive, xmlOutputBufferCreateFile(srcml_file, srcml_archive_write_output_encoder(archive, encoder)), encoder);
 
     return SRCML_STATUS_OK;
 }
@@ -990,7 +1350,8 @@ int srcml_archive_write_open_fd(struct srcml_archive* archive, int srcml_fd) {
 
     archive->type = SRCML_ARCHIVE_WRITE;
 
-    archive->output_buffer = xmlOutputBufferCreateFd(srcml_fd, xmlFindCharEncodingHandler(archive->encoding ? archive->encoding->c_str() : 0));
+    xmlCharEncodingHandlerPtr encoder = xmlFindCharEncodingHandler(archive->encoding ? archive->encoding->c_str() : 0);
+    archive->output_buffer = srcml_archive_write_output(archive, xmlOutputBufferCreateFd(srcml_fd, srcml_archive_write_output_encoder(archive, encoder)), encoder);
 
     return SRCML_STATUS_OK;
 }
@@ -1015,7 +1376,8 @@ int srcml_archive_write_open_io(struct srcml_archive* archive, void * context, i
 
     archive->type = SRCML_ARCHIVE_WRITE;
 
-    archive->output_buffer = xmlOutputBufferCreateIO(write_callback, close_callback, context, xmlFindCharEncodingHandler(archive->encoding ? archive->encoding->c_str() : 0));
+    xmlCharEncodingHandlerPtr encoder = xmlFindCharEncodingHandler(archive->encoding ? archive->encoding->c_str() : 0);
+    archive->output_buffer = srcml_archive_write_output(archive, xmlOutputBufferCreateIO(write_callback, close_callback, context, srcml_archive_write_output_encoder(archive, encoder)), encoder);
 
     return SRCML_STATUS_OK;
 }
@@ -1033,15 +1395,18 @@ int srcml_archive_write_open_io(struct srcml_archive* archive, void * context, i
  * Function used internally to the srcml_archive_read_open_* functions.
  * Reads and sets the open type as well as gathers the attributes
  * and sets the options from the opened srcML Archive.
+ * With a parallel reader, the input is the first partition of the archive.
  */
-static int srcml_archive_read_open_internal(struct srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input) {
+static int srcml_archive_read_open_internal(struct srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input,
+                                            std::unique_ptr<srcml_parallel_reader> parallel = nullptr) {
 
     if (!input)
         return SRCML_STATUS_IO_ERROR;
 
     try {
 
-        archive->reader = new srcml_sax2_reader(archive, std::move(input));
+        archive->reader = new srcml_sax2_reader(archive, std::move(input), archive->read_ahead_units, archive->read_ahead_bytes, std::move(parallel),
+                                                archive->header_scan);
 
     } catch(...) {
 
@@ -1049,6 +1414,7 @@ static int srcml_archive_read_open_internal(struct srcml_archive* archive, std::
     }
 
     archive->type = SRCML_ARCHIVE_READ;
+    archive->read_position = 0;
 
     return SRCML_STATUS_OK;
 }
@@ -1068,7 +1434,57 @@ int srcml_archive_read_open_filename(struct srcml_archive* archive, const char*
     if (archive == nullptr || srcml_filename == nullptr)
         return SRCML_STATUS_INVALID_ARGUMENT;
 
-    std::unique_ptr<xmlParserInputBuffer> input(xmlParserInputBufferCreateFilename(srcml_filename, archive->encoding ? xmlParseCharEncoding(archive->encoding->c_str()) : XML_CHAR_ENCODING_NONE));
+    xmlCharEncoding encoding = archive->encoding ? xmlParseCharEncoding(archive->encoding->c_str()) : XML_CHAR_ENCODING_NONE;
+
+    // seekable gzip archives are decompressed by frame
+    archive->seek_table.reset();
+#ifdef WITH_ZLIB
+    archive->seek_table = srcml_gzip_read_seek_table(srcml_filename);
+    if (archive->seek_table) {
+
+        archive->seek_filename = srcml_filename;
+
+        std::unique_ptr<xmlParserInputBuffer> input(srcml_gzip_input_create(srcml_filename, archive->seek_table, 1, archive->gzip_threads, encoding));
+
+        return srcml_archive_read_open_internal(archive, std::move(input));
+    }
+#endif
+
+    // an index from when the archive was written is used to go directly to a unit
+    archive->unit_index = srcml_unit_index_read(srcml_filename);
+    if (archive->unit_index)
+        archive->seek_filename = srcml_filename;
+
+    // large archives are parsed in partitions on multiple threads, up to one per core, unless only scanned for headers
+    int read_threads = std::min(archive->read_threads, (int) std::thread::hardware_concurrency());
+    std::shared_ptr<srcml_archive_partitions> partitions;
+    if (!archive->header_scan)
+        partitions = srcml_partition_archive(srcml_filename, archive->unit_index.get(), read_threads);
+    if (partitions) {
+
+        std::unique_ptr<xmlParserInputBuffer> input(srcml_partition_input_create(srcml_filename, *partitions, 0, encoding));
+        if (input) {
+
+            std::unique_ptr<srcml_parallel_reader> parallel;
+            try {
+
+                parallel.reset(new srcml_parallel_reader(archive, srcml_filename, partitions, read_threads, encoding));
+
+            } catch(...) {
+
+                return SRCML_STATUS_ERROR;
+            }
+
+            return srcml_archive_read_open_internal(archive, std::move(input), std::move(parallel));
+        }
+    }
+
+    // a regular file is mapped, instead of read, for the parser when enabled
+    std::unique_ptr<xmlParserInputBuffer> input;
+    if (archive->read_mmap)
+        input.reset(srcml_mmap_input_create(srcml_filename, encoding));
+    if (!input)
+        input.reset(xmlParserInputBufferCreateFilename(srcml_filename, encoding));
 
     return srcml_archive_read_open_internal(archive, std::move(input));
 }
@@ -1186,22 +1602,18 @@ int srcml_archive_read_open_io(struct srcml_archive* archive, void * context, in
  ******************************************************************************/
 
 /**
- * srcml_archive_write_unit
+ * srcml_archive_write_unit_ready
  * @param archive a srcml archive opened for writing
- * @param unit a srcml_unit to output
+ * @param unit a srcml_unit with a body to output
  *
- * Append the srcml_unit unit to the srcml_archive archive.
+ * Check that the unit can be appended to the archive, and create the translator
+ * of the archive if needed. The caller holds the write lock of the archive.
  * If copying from a read and only the attributes have been read
- * read in the xml and output.
- *
- * Can not mix with by element mode.
+ * read in the xml.
  *
  * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
  */
-int srcml_archive_write_unit(struct srcml_archive* archive, struct srcml_unit* unit) {
-
-    if (archive == nullptr || unit == nullptr)
-        return SRCML_STATUS_INVALID_ARGUMENT;
+static int srcml_archive_write_unit_ready(struct srcml_archive* archive, struct srcml_unit* unit) {
 
     if (!unit->read_body && !unit->read_header)
         return SRCML_STATUS_UNINITIALIZED_UNIT;
@@ -1223,43 +1635,698 @@ int srcml_archive_write_unit(struct srcml_archive* archive, struct srcml_unit* u
             return status;
     }
 
-    archive->translator->add_unit(unit);
-
     return SRCML_STATUS_OK;
 }
 
 /**
- * srcml_archive_write
+ * srcml_archive_write_unit_internal
  * @param archive a srcml archive opened for writing
- * @param unit a srcml_unit to output
+ * @param unit a srcml_unit with a body to output
  *
  * Append the srcml_unit unit to the srcml_archive archive.
+ * The caller holds the write lock of the archive.
  * If copying from a read and only the attributes have been read
  * read in the xml and output.
  *
- * Can not mix with by element mode.
- *
  * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
  */
-int srcml_archive_write_string(struct srcml_archive* archive, const char* s, int len) {
+static int srcml_archive_write_unit_internal(struct srcml_archive* archive, struct srcml_unit* unit) {
 
-    if (archive == nullptr || s == nullptr || len < 0)
-        return SRCML_STATUS_INVALID_ARGUMENT;
+    int status = srcml_archive_write_unit_ready(archive, unit);
+    if (status != SRCML_STATUS_OK)
+        return status;
 
-    if (archive->output_buffer)
-        xmlOutputBufferWrite(archive->output_buffer, len, s);
+    unit_srcml_from_tree(unit);
 
-    archive->rawwrites = true;
+    archive->translator->add_unit(unit);
 
     return SRCML_STATUS_OK;
 }
 
 /**
- * srcml_archive_read_unit
- * @param archive a srcml archive open for reading
+ * srcml_archive_write_unit
+ * @param archive a srcml archive opened for writing
+ * @param unit a srcml_unit to output
  *
- * Read the next unit from the archive.
- * unit contains read attribute.  xml is set to read only if needed
+ * Append the srcml_unit unit to the srcml_archive archive.
+ * If copying from a read and only the attributes have been read
+ * read in the xml and output.
+ *
+ * Can not mix with by element mode.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_archive_write_unit(struct srcml_archive* archive, struct srcml_unit* unit) {
+
+    if (archive == nullptr || unit == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    std::lock_guard<std::mutex> lock(archive->write_order.mutex);
+
+    return srcml_archive_write_unit_internal(archive, unit);
+}
+
+/**
+ * srcml_archive_write_unit_sequence
+ * @param archive a srcml archive opened for writing
+ * @param unit a srcml_unit to output
+ * @param sequence the position of the unit in the output, starting at 0
+ *
+ * Append the srcml_unit unit to the srcml_archive archive after the units
+ * with all lower sequence numbers are written. Sequence numbers are per archive,
+ * and each is used once, even when the write fails. A sequence number that is
+ * already written, or taken by another waiting write, is invalid.
+ *
+ * Can not mix with by element mode.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_archive_write_unit_sequence(struct srcml_archive* archive, struct srcml_unit* unit, size_t sequence) {
+
+    if (archive == nullptr || unit == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    std::unique_lock<std::mutex> lock(archive->write_order.mutex);
+
+    // a sequence number that is already written, or is taken by a waiting write, would never be next
+    if (sequence < archive->write_order.next_sequence || !archive->write_order.waiting.insert(sequence).second)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    int status = srcml_archive_write_unit_ready(archive, unit);
+
+    // a nested unit is rendered without the lock, while the units before it are written, and only appended
+    // under the lock. Rendering is in UTF-8, so any other encoding of the output is rendered under the lock
+    std::string srcml;
+    std::string language;
+    bool rendered = false;
+    if (status == SRCML_STATUS_OK && (archive->translator->get_options() & SRCML_OPTION_ARCHIVE)
+        && (!archive->encoding || xmlParseCharEncoding(archive->encoding->c_str()) == XML_CHAR_ENCODING_UTF8)) {
+
+        OPTION_TYPE options = archive->translator->get_options();
+        lock.unlock();
+
+        unit_srcml_from_tree(unit);
+        language = archive->translator->render_unit(unit, options, srcml);
+        rendered = true;
+
+        lock.lock();
+    }
+
+    archive->write_order.sequence_cv.wait(lock, [archive, sequence]{ return archive->write_order.next_sequence == sequence; });
+
+    if (rendered) {
+        archive->translator->add_rendered_unit(unit, language, srcml);
+    } else if (status == SRCML_STATUS_OK) {
+        unit_srcml_from_tree(unit);
+        archive->translator->add_unit(unit);
+    }
+
+    // the next unit in sequence can go, whether or not this one was written
+    archive->write_order.waiting.erase(sequence);
+    ++archive->write_order.next_sequence;
+    lock.unlock();
+    archive->write_order.sequence_cv.notify_all();
+
+    return status;
+}
+
+/**
+ * srcml_archive_write_parse_filename
+ * @param archive a srcml archive opened for writing
+ * @param unit a srcml_unit with the unit metadata
+ * @param src_filename name of a file to parse into srcML
+ *
+ * Parse the contents of src_filename directly into the srcml_archive archive as a unit.
+ * The srcML of the unit is never stored in the unit.
+ *
+ * Can not mix with by element mode.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_archive_write_parse_filename(struct srcml_archive* archive, struct srcml_unit* unit, const char* src_filename) {
+
+    if (archive == nullptr || unit == nullptr || src_filename == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    if (archive->type != SRCML_ARCHIVE_WRITE && archive->type != SRCML_ARCHIVE_RW)
+        return SRCML_STATUS_INVALID_IO_OPERATION;
+
+    // any hash is from a separate read of the source, which does not need the lock
+    int status = srcml_unit_hash_source(unit, src_filename, 0, 0);
+    if (status != SRCML_STATUS_OK)
+        return status;
+
+    // the unit is written to the output as it is parsed, so only the parse is under the lock
+    std::lock_guard<std::mutex> lock(archive->write_order.mutex);
+
+    // if we haven't opened the translator yet, do so now
+    if (archive->translator == nullptr) {
+        status = srcml_archive_write_create_translator_xml_buffer(archive);
+        if (status != SRCML_STATUS_OK)
+            return status;
+    }
+
+    return srcml_unit_parse_translator(unit, archive->translator, src_filename, 0, 0);
+}
+
+/**
+ * srcml_archive_write_parse_memory
+ * @param archive a srcml archive opened for writing
+ * @param unit a srcml_unit with the unit metadata
+ * @param src_buffer buffer containing source code to parse into srcML
+ * @param buffer_size size of the buffer to parse
+ *
+ * Parse the contents of src_buffer directly into the srcml_archive archive as a unit.
+ * The srcML of the unit is never stored in the unit.
+ *
+ * Can not mix with by element mode.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_archive_write_parse_memory(struct srcml_archive* archive, struct srcml_unit* unit, const char* src_buffer, size_t buffer_size) {
+
+    if (archive == nullptr || unit == nullptr || (buffer_size && src_buffer == nullptr))
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    if (archive->type != SRCML_ARCHIVE_WRITE && archive->type != SRCML_ARCHIVE_RW)
+        return SRCML_STATUS_INVALID_IO_OPERATION;
+
+    // any hash is from a separate read of the source, which does not need the lock
+    int status = srcml_unit_hash_source(unit, 0, src_buffer, buffer_size);
+    if (status != SRCML_STATUS_OK)
+        return status;
+
+    // the unit is written to the output as it is parsed, so only the parse is under the lock
+    std::lock_guard<std::mutex> lock(archive->write_order.mutex);
+
+    // if we haven't opened the translator yet, do so now
+    if (archive->translator == nullptr) {
+        status = srcml_archive_write_create_translator_xml_buffer(archive);
+        if (status != SRCML_STATUS_OK)
+            return status;
+    }
+
+    return srcml_unit_parse_translator(unit, archive->translator, 0, src_buffer, buffer_size);
+}
+
+/**
+ * srcml_archive_write_submitted
+ * @param submission a submitted unit that is parsed, which is taken over
+ *
+ * Add a parsed unit to the units waiting to be written. Unless another thread is
+ * writing, write the units that are next in the order submitted, including any
+ * parsed while writing. So units are written one at a time, in order, and no
+ * thread waits on another to write.
+ */
+static void srcml_archive_write_submitted(srcml_submission* submission) {
+
+    srcml_archive* archive = submission->archive;
+    srcml_submit_order& order = archive->submit_order;
+
+    std::unique_lock<std::mutex> lock(order.mutex);
+
+    order.parsed.emplace(submission->sequence, std::unique_ptr<srcml_submission>(submission));
+
+    if (order.writing)
+        return;
+    order.writing = true;
+
+    for (auto it = order.parsed.find(order.next_write); it != order.parsed.end(); it = order.parsed.find(order.next_write)) {
+
+        std::unique_ptr<srcml_submission> next = std::move(it->second);
+        order.parsed.erase(it);
+        lock.unlock();
+
+        int status = next->status;
+        if (next->write)
+            next->write(next->unit, status, next->context);
+        else if (status == SRCML_STATUS_OK)
+            status = srcml_archive_write_unit(archive, next->unit);
+
+        lock.lock();
+        if (!next->write && status != SRCML_STATUS_OK && order.status == SRCML_STATUS_OK)
+            order.status = status;
+        ++order.next_write;
+    }
+
+    // notified under the lock, since a waiter may free the archive as soon as it returns
+    order.writing = false;
+    if (order.next_write == order.next_submit)
+        order.written_cv.notify_all();
+}
+
+/**
+ * srcml_archive_write_submit_parsed
+ * @param unit the unit of the submission
+ * @param status the status of the parse
+ * @param context the submission
+ *
+ * Executor callback of a submitted unit. Call the parsed callback,
+ * unless canceled, then write the unit in order.
+ */
+static void srcml_archive_write_submit_parsed(srcml_unit* unit, int status, void* context) {
+
+    srcml_submission* submission = static_cast<srcml_submission*>(context);
+
+    if (submission->parsed && status != SRCML_STATUS_CANCELED)
+        submission->parsed(unit, status, submission->context);
+
+    submission->status = status;
+
+    srcml_archive_write_submitted(submission);
+}
+
+/**
+ * srcml_archive_write_submit_internal
+ * @param archive a srcml archive opened for writing, or any archive with a write callback
+ * @param executor a srcml_executor to parse on
+ * @param unit a srcml_unit created for this archive, or NULL when not parsed
+ * @param src_filename name of a file to parse, or NULL
+ * @param src_buffer buffer containing source code to parse when there is no filename, or NULL
+ * @param buffer_size size of the buffer to parse
+ * @param parse whether to parse the unit
+ * @param parsed callback after the parse, or NULL
+ * @param write callback in place of the write of the unit, or NULL
+ * @param context user context for the callbacks
+ *
+ * Queue a unit on the executor, and take its place in the order of the archive.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+static int srcml_archive_write_submit_internal(struct srcml_archive* archive, struct srcml_executor* executor, struct srcml_unit* unit,
+                                               const char* src_filename, const char* src_buffer, size_t buffer_size, bool parse,
+                                               srcml_parse_callback parsed, srcml_parse_callback write, void* context) {
+
+    // with a write callback, the archive only holds the order of the units
+    if (!write && archive->type != SRCML_ARCHIVE_WRITE && archive->type != SRCML_ARCHIVE_RW)
+        return SRCML_STATUS_INVALID_IO_OPERATION;
+
+    std::unique_ptr<srcml_submission> submission;
+    try {
+
+        submission.reset(new srcml_submission);
+
+    } catch(...) { return SRCML_STATUS_ERROR; }
+
+    submission->archive = archive;
+    submission->unit = unit;
+    submission->parsed = parsed;
+    submission->write = write;
+    submission->context = context;
+
+    // the lock is held while queueing, so that a unit that can not be queued does not take a place in the order
+    std::lock_guard<std::mutex> lock(archive->submit_order.mutex);
+
+    submission->sequence = archive->submit_order.next_submit;
+
+    int status;
+    if (!parse)
+        status = srcml_executor_submit_callback(executor, unit, srcml_archive_write_submit_parsed, submission.get());
+    else if (src_filename)
+        status = srcml_unit_parse_filename_async(executor, unit, src_filename, srcml_archive_write_submit_parsed, submission.get(), nullptr);
+    else
+        status = srcml_unit_parse_memory_async(executor, unit, src_buffer, buffer_size, srcml_archive_write_submit_parsed, submission.get(), nullptr);
+
+    if (status != SRCML_STATUS_OK)
+        return status;
+
+    submission.release();
+    ++archive->submit_order.next_submit;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_write_submit_filename
+ * @param archive a srcml archive opened for writing, or any archive with a write callback
+ * @param executor a srcml_executor to parse on
+ * @param unit a srcml_unit with the unit metadata, created for this archive
+ * @param src_filename name of a file to parse into srcML
+ * @param parsed callback on the executor thread after the parse, or NULL
+ * @param write callback in place of the write of the unit, or NULL
+ * @param context user context for the callbacks
+ *
+ * Queue the parse of the contents of src_filename into the unit on the executor. When
+ * parsed, and after the units submitted before it, the unit is written to the archive,
+ * or passed to the write callback. A unit that fails to parse is passed to the write
+ * callback with the status, and is not written.
+ *
+ * Can not mix with by element mode.
+ *
+ * @returns Return SRCML_STATUS_OK on success, SRCML_STATUS_BUSY if the queue of the
+ * executor is full, and a status error code on failure.
+ */
+int srcml_archive_write_submit_filename(struct srcml_archive* archive, struct srcml_executor* executor, struct srcml_unit* unit, const char* src_filename,
+                                        srcml_parse_callback parsed, srcml_parse_callback write, void* context) {
+
+    // units are parsed with the options of their archive, so they must be of this archive
+    if (archive == nullptr || executor == nullptr || unit == nullptr || unit->archive != archive || src_filename == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    return srcml_archive_write_submit_internal(archive, executor, unit, src_filename, nullptr, 0, true, parsed, write, context);
+}
+
+/**
+ * srcml_archive_write_submit_memory
+ * @param archive a srcml archive opened for writing, or any archive with a write callback
+ * @param executor a srcml_executor to parse on
+ * @param unit a srcml_unit with the unit metadata, created for this archive
+ * @param src_buffer buffer containing source code to parse into srcML
+ * @param buffer_size size of the buffer to parse
+ * @param parsed callback on the executor thread after the parse, or NULL
+ * @param write callback in place of the write of the unit, or NULL
+ * @param context user context for the callbacks
+ *
+ * Queue the parse of the contents of src_buffer into the unit on the executor. When
+ * parsed, and after the units submitted before it, the unit is written to the archive,
+ * or passed to the write callback. The buffer is not copied.
+ *
+ * Can not mix with by element mode.
+ *
+ * @returns Return SRCML_STATUS_OK on success, SRCML_STATUS_BUSY if the queue of the
+ * executor is full, and a status error code on failure.
+ */
+int srcml_archive_write_submit_memory(struct srcml_archive* archive, struct srcml_executor* executor, struct srcml_unit* unit, const char* src_buffer, size_t buffer_size,
+                                      srcml_parse_callback parsed, srcml_parse_callback write, void* context) {
+
+    // units are parsed with the options of their archive, so they must be of this archive
+    if (archive == nullptr || executor == nullptr || unit == nullptr || unit->archive != archive || (buffer_size && src_buffer == nullptr))
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    return srcml_archive_write_submit_internal(archive, executor, unit, nullptr, src_buffer ? src_buffer : "", buffer_size, true, parsed, write, context);
+}
+
+/**
+ * srcml_archive_write_submit
+ * @param archive a srcml archive opened for writing, or any archive with a write callback
+ * @param executor a srcml_executor to run the parsed callback on
+ * @param unit a srcml_unit, or NULL with a write callback
+ * @param parsed callback on the executor thread, or NULL
+ * @param write callback in place of the write of the unit, or NULL
+ * @param context user context for the callbacks
+ *
+ * Submit a unit without a parse, e.g., a unit that is already parsed, or is parsed
+ * by the parsed callback. The unit is written to the archive, or passed to the write
+ * callback, after the units submitted before it.
+ *
+ * Can not mix with by element mode.
+ *
+ * @returns Return SRCML_STATUS_OK on success, SRCML_STATUS_BUSY if the queue of the
+ * executor is full, and a status error code on failure.
+ */
+int srcml_archive_write_submit(struct srcml_archive* archive, struct srcml_executor* executor, struct srcml_unit* unit,
+                               srcml_parse_callback parsed, srcml_parse_callback write, void* context) {
+
+    if (archive == nullptr || executor == nullptr || (unit == nullptr && write == nullptr))
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    return srcml_archive_write_submit_internal(archive, executor, unit, nullptr, nullptr, 0, false, parsed, write, context);
+}
+
+/**
+ * srcml_archive_write_submit_wait
+ * @param archive a srcml archive units were submitted to
+ *
+ * Wait until all the units submitted to the archive are written.
+ * Must not be called from a callback of a submitted unit.
+ *
+ * @returns Return SRCML_STATUS_OK on success, and the status error code of the first
+ * unit written without a write callback that failed to parse or write.
+ */
+int srcml_archive_write_submit_wait(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    srcml_submit_order& order = archive->submit_order;
+
+    std::unique_lock<std::mutex> lock(order.mutex);
+    order.written_cv.wait(lock, [&order]{ return !order.writing && order.next_write == order.next_submit; });
+
+    int status = order.status;
+    order.status = SRCML_STATUS_OK;
+
+    return status;
+}
+
+/**
+ * srcml_archive_write
+ * @param archive a srcml archive opened for writing
+ * @param unit a srcml_unit to output
+ *
+ * Append the srcml_unit unit to the srcml_archive archive.
+ * If copying from a read and only the attributes have been read
+ * read in the xml and output.
+ *
+ * Can not mix with by element mode.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_archive_write_string(struct srcml_archive* archive, const char* s, int len) {
+
+    if (archive == nullptr || s == nullptr || len < 0)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    std::lock_guard<std::mutex> lock(archive->write_order.mutex);
+
+    if (archive->output_buffer)
+        xmlOutputBufferWrite(archive->output_buffer, len, s);
+
+    archive->rawwrites = true;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_write_merge_filenames
+ * @param archive a srcml archive opened for writing
+ * @param num_inputs number of srcML inputs
+ * @param srcml_filenames names of the srcML inputs
+ *
+ * Append the units of the srcML inputs as is, after a root that merges the roots
+ * of the inputs. Only the roots are parsed, and units are found by scanning for their
+ * start and end tags, so a merge is bound by reading and writing the bytes.
+ *
+ * The root declares the namespaces of the roots, which must agree on their prefixes.
+ * The options and tabs of the roots must be the same, and the url, version, and
+ * other attributes are kept when all the roots have the same value.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_archive_write_merge_filenames(struct srcml_archive* archive, int num_inputs, const char* const srcml_filenames[]) {
+
+    if (archive == nullptr || num_inputs < 0 || (num_inputs > 0 && srcml_filenames == nullptr))
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    for (int i = 0; i < num_inputs; ++i) {
+        if (srcml_filenames[i] == nullptr)
+            return SRCML_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (archive->type != SRCML_ARCHIVE_WRITE && archive->type != SRCML_ARCHIVE_RW)
+        return SRCML_STATUS_INVALID_IO_OPERATION;
+
+    std::lock_guard<std::mutex> lock(archive->write_order.mutex);
+
+    // the root is output from the roots of the inputs, so nothing can be written yet
+    if (archive->translator || archive->rawwrites)
+        return SRCML_STATUS_INVALID_IO_OPERATION;
+
+    std::vector<std::unique_ptr<srcml_merge_input>> inputs;
+    for (int i = 0; i < num_inputs; ++i) {
+
+        inputs.emplace_back(srcml_merge_input::open(srcml_filenames[i]));
+        if (!inputs.back()) {
+            archive->error_string = std::string("Unable to open srcML input ") + srcml_filenames[i];
+            return SRCML_STATUS_IO_ERROR;
+        }
+
+        if (!inputs.back()->read_root()) {
+            archive->error_string = std::string("Invalid srcML input ") + srcml_filenames[i];
+            return SRCML_STATUS_INVALID_INPUT;
+        }
+    }
+
+    // namespaces of the roots. A single unit keeps the namespaces that belong on units
+    std::vector<std::pair<std::string, std::string>> declared;
+    std::vector<std::pair<std::string, std::string>> root_namespaces;
+    std::vector<std::string> root_uris;
+    for (const auto& input : inputs) {
+        for (const auto& ns : input->namespaces) {
+
+            for (const auto& other : declared) {
+
+                if ((other.first == ns.first) != (other.second == ns.second)) {
+                    archive->error_string = "Conflicting namespaces " + other.first + "=" + other.second + " and " + ns.first + "=" + ns.second;
+                    return SRCML_STATUS_INVALID_INPUT;
+                }
+            }
+            if (std::find(declared.begin(), declared.end(), ns) == declared.end())
+                declared.push_back(ns);
+
+            if (!input->is_archive && (ns.second == SRCML_CPP_NS_URI || ns.second == SRCML_OPENMP_NS_URI))
+                continue;
+
+            if (std::find(root_uris.begin(), root_uris.end(), ns.second) == root_uris.end()) {
+                root_uris.push_back(ns.second);
+                root_namespaces.push_back(ns);
+            }
+        }
+    }
+
+    // attributes of each root as on a root, where a single unit has only those that belong on the root
+    auto root_attributes = [](const srcml_merge_input& input) {
+
+        std::vector<std::pair<std::string, std::string>> attributes;
+        for (const auto& attribute : input.attributes) {
+
+            std::string name = attribute.name.substr(attribute.name.find(':') + 1);
+            if (name == "url" || name == "version" || name == "tabs" || name == "options")
+                attributes.emplace_back(name, attribute.value);
+            else if (input.is_archive && name != "revision" && name != "language" && name != "filename" && name != "timestamp" && name != "hash")
+                attributes.emplace_back(attribute.name, attribute.value);
+        }
+
+        return attributes;
+    };
+
+    std::vector<std::vector<std::pair<std::string, std::string>>> roots;
+    for (const auto& input : inputs)
+        roots.push_back(root_attributes(*input));
+
+    // options and tabs affect the markup of the units, so must be the same
+    for (const auto& name : { "tabs", "options" }) {
+
+        auto value = [name](const std::vector<std::pair<std::string, std::string>>& attributes) {
+
+            auto it = std::find_if(attributes.begin(), attributes.end(), [name](const std::pair<std::string, std::string>& attribute) {
+                return attribute.first == name;
+            });
+
+            return it != attributes.end() ? it->second : std::string();
+        };
+
+        for (const auto& attributes : roots) {
+
+            if (value(attributes) != value(roots.front())) {
+                archive->error_string = std::string("Different ") + name + " of srcML inputs";
+                return SRCML_STATUS_INVALID_INPUT;
+            }
+        }
+    }
+
+    // the root of the output
+    archive->options |= SRCML_OPTION_ARCHIVE;
+
+    for (const auto& ns : root_namespaces) {
+
+        srcml_archive_register_namespace(archive, ns.first.c_str(), ns.second.c_str());
+
+        // on the root, even when the namespace usually belongs on units
+        auto& view = archive->namespaces.get<nstags::uri>();
+        view.find(ns.second)->flags |= NS_ROOT | NS_USED;
+    }
+
+    for (const auto& attribute : roots.empty() ? std::vector<std::pair<std::string, std::string>>() : roots.front()) {
+
+        bool common = std::all_of(roots.begin(), roots.end(), [&attribute](const std::vector<std::pair<std::string, std::string>>& attributes) {
+            return std::find(attributes.begin(), attributes.end(), attribute) != attributes.end();
+        });
+        if (!common)
+            continue;
+
+        if (attribute.first == "url") {
+            srcml_archive_set_url(archive, attribute.second.c_str());
+        } else if (attribute.first == "version") {
+            srcml_archive_set_version(archive, attribute.second.c_str());
+        } else if (attribute.first == "tabs") {
+            archive->tabstop = atoi(attribute.second.c_str());
+        } else if (attribute.first == "options") {
+
+            std::string options = attribute.second + ",";
+            for (size_t pos = 0, next = 0; (next = options.find(',', pos)) != std::string::npos; pos = next + 1) {
+
+                std::string option = options.substr(pos, next - pos);
+                if (option == "CPP_TEXT_ELSE")
+                    archive->options |= SRCML_OPTION_CPP_TEXT_ELSE;
+                else if (option == "CPP_MARKUP_IF0")
+                    archive->options |= SRCML_OPTION_CPP_MARKUP_IF0;
+                else if (option == "LINE")
+                    archive->options |= SRCML_OPTION_LINE;
+                else if (option == "POSITION_COMPACT")
+                    archive->options |= SRCML_OPTION_POSITION_COMPACT;
+            }
+
+        } else {
+
+            archive->attributes.push_back(attribute.first);
+            archive->attributes.push_back(attribute.second);
+        }
+    }
+
+    for (const auto& input : inputs) {
+        for (size_t i = 0; i + 1 < input->macro_list.size(); i += 2) {
+
+            bool found = false;
+            for (size_t j = 0; j + 1 < archive->user_macro_list.size(); j += 2)
+                found = found || (archive->user_macro_list[j] == input->macro_list[i] && archive->user_macro_list[j + 1] == input->macro_list[i + 1]);
+
+            if (!found) {
+                archive->user_macro_list.push_back(input->macro_list[i]);
+                archive->user_macro_list.push_back(input->macro_list[i + 1]);
+            }
+        }
+    }
+
+    int status = srcml_archive_write_create_translator_xml_buffer(archive);
+    if (status != SRCML_STATUS_OK)
+        return status;
+
+    // the units of each input, as is
+    for (int i = 0; i < num_inputs; ++i) {
+
+        if (!inputs[i]->write_units(*archive->translator, root_uris)) {
+            archive->error_string = std::string("Invalid srcML input ") + srcml_filenames[i];
+            return SRCML_STATUS_INVALID_INPUT;
+        }
+    }
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_read_unit_header
+ * @param archive a srcml archive open for reading
+ *
+ * Read the header of the next unit from the archive.
+ * The srcML of the unit is only available if it was already parsed.
+ *
+ * @returns Return the read srcml_unit on success.
+ * On failure returns NULL.
+ */
+struct srcml_unit* srcml_archive_read_unit_header(struct srcml_archive* archive) {
+
+    if (archive == nullptr)
+        return nullptr;
+
+    if (archive->type != SRCML_ARCHIVE_READ && archive->type != SRCML_ARCHIVE_RW)
+        return nullptr;
+
+    std::unique_ptr<srcml_unit> unit(srcml_unit_create(archive));
+    if (!archive->reader->read_header(unit.get()))
+        return nullptr;
+
+    ++archive->read_position;
+
+    return unit.release();
+}
+
+/**
+ * srcml_archive_read_unit
+ * @param archive a srcml archive open for reading
+ *
+ * Read the next unit from the archive.
+ * unit contains read attribute.  xml is set to read only if needed
  * in a subsequent call.
  *
  * @returns Return the read srcml_unit on success.
@@ -1274,11 +2341,9 @@ struct srcml_unit* srcml_archive_read_unit(struct srcml_archive* archive) {
         return nullptr;
 
     std::unique_ptr<srcml_unit> unit(srcml_unit_create(archive));
-    int not_done = 0;
-    if (!unit->read_header)
-        not_done = archive->reader->read_header(unit.get());
-
-    archive->reader->read_body(unit.get());
+    int not_done = archive->reader->read(unit.get());
+    if (not_done)
+        ++archive->read_position;
 
     if (!not_done || !unit->read_body) {
         return nullptr;
@@ -1312,9 +2377,181 @@ int srcml_archive_skip_unit(struct srcml_archive* archive) {
         return 0;
     }
 
+    ++archive->read_position;
+
+    return 1;
+}
+
+/**
+ * srcml_archive_read_reopen
+ * @param archive an archive open for reading
+ * @param input input of the start of the archive followed by the units from position
+ * @param position the position of the first unit of the input
+ *
+ * Reopen the reader on input, continuing from the unit at position.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+static int srcml_archive_read_reopen(struct srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input, size_t position) {
+
+    if (!input)
+        return SRCML_STATUS_IO_ERROR;
+
+    // the root is read again, so keep what was collected from it the first time
+    auto attributes = archive->attributes;
+    auto user_macro_list = archive->user_macro_list;
+
+    delete archive->reader;
+    archive->reader = nullptr;
+
+    int status = srcml_archive_read_open_internal(archive, std::move(input));
+
+    archive->attributes = attributes;
+    archive->user_macro_list = user_macro_list;
+
+    if (status != SRCML_STATUS_OK) {
+        archive->type = SRCML_ARCHIVE_INVALID;
+        return status;
+    }
+
+    archive->read_position = position;
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_archive_read_seek_frame
+ * @param archive a seekable gzip archive open for reading
+ * @param frame the frame to continue reading from
+ *
+ * Reopen the reader on the start of the archive followed by frame.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+static int srcml_archive_read_seek_frame(struct srcml_archive* archive, size_t frame) {
+
+#ifdef WITH_ZLIB
+    xmlCharEncoding encoding = archive->encoding ? xmlParseCharEncoding(archive->encoding->c_str()) : XML_CHAR_ENCODING_NONE;
+    std::unique_ptr<xmlParserInputBuffer> input(srcml_gzip_input_create(archive->seek_filename.c_str(), archive->seek_table, frame, archive->gzip_threads, encoding));
+
+    return srcml_archive_read_reopen(archive, std::move(input), (frame - 1) * archive->seek_table->units_per_frame);
+#else
+    (void) archive;
+    (void) frame;
+    return SRCML_STATUS_ERROR;
+#endif
+}
+
+/**
+ * srcml_archive_read_seek_index
+ * @param archive an archive with a unit index open for reading
+ * @param position the position of the unit to continue reading from
+ *
+ * Reopen the reader on the start of the archive followed by the unit at position.
+ *
+ * @returns Return SRCML_STATUS_OK on success and a status error code on failure.
+ */
+static int srcml_archive_read_seek_index(struct srcml_archive* archive, size_t position) {
+
+    // past the end, the last unit is read so that reading ends after it
+    position = std::min(position, archive->unit_index->units.size() - 1);
+
+    xmlCharEncoding encoding = archive->encoding ? xmlParseCharEncoding(archive->encoding->c_str()) : XML_CHAR_ENCODING_NONE;
+    std::unique_ptr<xmlParserInputBuffer> input(srcml_unit_index_input_create(archive->seek_filename.c_str(), *archive->unit_index, position, encoding));
+
+    return srcml_archive_read_reopen(archive, std::move(input), position);
+}
+
+/**
+ * srcml_archive_skip_units
+ * @param archive a srcml archive open for reading
+ * @param num_units the number of units to skip
+ *
+ * Skip the next num_units units from the archive. With a seek table, the
+ * frames before the frame of the target unit are not decompressed.
+ *
+ * @returns 1 on success
+ * @returns 0 on failure
+ */
+int srcml_archive_skip_units(struct srcml_archive* archive, size_t num_units) {
+
+    if (archive == nullptr)
+        return 0;
+
+    if (archive->type != SRCML_ARCHIVE_READ && archive->type != SRCML_ARCHIVE_RW)
+        return 0;
+
+    size_t target = archive->read_position + num_units;
+
+    // with an index, read directly from the target unit
+    if (archive->unit_index) {
+
+        if (target > archive->read_position && srcml_archive_read_seek_index(archive, target) != SRCML_STATUS_OK)
+            return 0;
+
+    // frame 0 is the start of the archive, and each frame after holds units_per_frame units
+    } else if (archive->seek_table && archive->seek_table->size() > 1) {
+
+        size_t units_per_frame = archive->seek_table->units_per_frame;
+        size_t current_frame = 1 + archive->read_position / units_per_frame;
+        size_t target_frame = std::min(1 + target / units_per_frame, archive->seek_table->size() - 1);
+
+        if (target_frame > current_frame && srcml_archive_read_seek_frame(archive, target_frame) != SRCML_STATUS_OK)
+            return 0;
+    }
+
+    while (archive->read_position < target) {
+        if (!srcml_archive_skip_unit(archive))
+            return 0;
+    }
+
     return 1;
 }
 
+/**
+ * srcml_archive_read_unit_at
+ * @param archive a srcml archive open for reading
+ * @param position the position of the unit, starting at 0
+ *
+ * Read the unit at position, with reading continuing after it. With a unit
+ * index or a seek table, the unit can be before the current position.
+ *
+ * @returns Return the read srcml_unit on success.
+ * On failure returns NULL.
+ */
+struct srcml_unit* srcml_archive_read_unit_at(struct srcml_archive* archive, size_t position) {
+
+    if (archive == nullptr)
+        return nullptr;
+
+    if (archive->type != SRCML_ARCHIVE_READ && archive->type != SRCML_ARCHIVE_RW)
+        return nullptr;
+
+    if (position != archive->read_position) {
+
+        if (archive->unit_index) {
+
+            if (position >= archive->unit_index->units.size() || srcml_archive_read_seek_index(archive, position) != SRCML_STATUS_OK)
+                return nullptr;
+
+        } else if (position < archive->read_position) {
+
+            // back to the start of the frame of the unit
+            if (!archive->seek_table || archive->seek_table->size() < 2)
+                return nullptr;
+
+            size_t frame = std::min(1 + position / archive->seek_table->units_per_frame, archive->seek_table->size() - 1);
+            if (srcml_archive_read_seek_frame(archive, frame) != SRCML_STATUS_OK)
+                return nullptr;
+        }
+
+        if (position > archive->read_position && !srcml_archive_skip_units(archive, position - archive->read_position))
+            return nullptr;
+    }
+
+    return srcml_archive_read_unit(archive);
+}
+
 /******************************************************************************
  *                                                                            *
  *                       Archive close function                               *
@@ -1343,6 +2580,14 @@ void srcml_archive_close(struct srcml_archive* archive) {
         archive->translator->close();
     }
 
+    // the index is complete once the output is
+    if (archive->type == SRCML_ARCHIVE_WRITE && archive->unit_index) {
+
+        archive->unit_index->srcml_size = archive->unit_index->written;
+        if (!archive->unit_index->complete || archive->rawwrites || !srcml_unit_index_write(archive->seek_filename, *archive->unit_index))
+            remove(srcml_unit_index_filename(archive->seek_filename).c_str());
+    }
+
     if (archive->rawwrites && archive->output_buffer) {
         xmlOutputBufferClose(archive->output_buffer);
         archive->output_buffer = nullptr;
@@ -1356,5 +2601,8 @@ void srcml_archive_close(struct srcml_archive* archive) {
         (*archive->buffer) = (char *) xmlBufferDetach(archive->xbuffer);
     }
 
+    archive->seek_table.reset();
+    archive->unit_index.reset();
+
     archive->type = SRCML_ARCHIVE_INVALID;
 }
@@ -0,0 +1,399 @@
+/**
+ * @file srcml_executor.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <srcml_executor.hpp>
+#include <algorithm>
+
+/**
+ * srcml_parse_task_complete
+ * @param task a task that is no longer queued
+ * @param status the status of the parse
+ *
+ * Call the completion callback, then mark the task as done so that
+ * any waiter returns after the callback.
+ */
+static void srcml_parse_task_complete(srcml_parse_task& task, int status) {
+
+    if (task.callback)
+        task.callback(task.unit, status, task.context);
+
+    {
+        std::lock_guard<std::mutex> lock(task.mutex);
+        task.status = status;
+        task.state = srcml_parse_task::DONE;
+    }
+    task.done_cv.notify_all();
+}
+
+/**
+ * srcml_executor_run
+ * @param queue the queue of the executor the thread runs for
+ *
+ * Worker thread. Run queued tasks until the executor is stopping.
+ */
+static void srcml_executor_run(std::shared_ptr<srcml_executor_queue> queue) {
+
+    while (true) {
+
+        std::shared_ptr<srcml_parse_task> task;
+        {
+            std::unique_lock<std::mutex> lock(queue->mutex);
+            queue->work_cv.wait(lock, [&queue]{ return queue->stopping || !queue->tasks.empty(); });
+
+            if (queue->tasks.empty())
+                return;
+
+            task = queue->tasks.front();
+            queue->tasks.pop_front();
+
+            std::lock_guard<std::mutex> task_lock(task->mutex);
+            task->state = srcml_parse_task::RUNNING;
+        }
+
+        int status = !task->parse ? SRCML_STATUS_OK
+                   : task->use_filename ? srcml_unit_parse_filename(task->unit, task->src_filename.c_str())
+                   : srcml_unit_parse_memory(task->unit, task->src_buffer, task->buffer_size);
+
+        srcml_parse_task_complete(*task, status);
+    }
+}
+
+/**
+ * srcml_executor_submit
+ * @param executor the executor to queue on
+ * @param task the task to queue
+ * @param request location to store a handle to the task, or NULL
+ *
+ * Queue a task on the executor, unless the queue is full.
+ *
+ * @returns SRCML_STATUS_OK on success, SRCML_STATUS_BUSY if the queue is full,
+ * and a status error code on failure.
+ */
+static int srcml_executor_submit(srcml_executor* executor, std::shared_ptr<srcml_parse_task> task, srcml_parse_request** request) {
+
+    std::unique_ptr<srcml_parse_request> handle;
+    if (request) {
+        try {
+
+            handle.reset(new srcml_parse_request);
+
+        } catch(...) { return SRCML_STATUS_ERROR; }
+
+        handle->task = task;
+    }
+
+    task->queue = executor->queue;
+    {
+        std::lock_guard<std::mutex> lock(executor->queue->mutex);
+
+        if (executor->queue->stopping)
+            return SRCML_STATUS_INVALID_IO_OPERATION;
+
+        if (executor->queue->max_queued && executor->queue->tasks.size() >= executor->queue->max_queued)
+            return SRCML_STATUS_BUSY;
+
+        executor->queue->tasks.push_back(task);
+    }
+    executor->queue->work_cv.notify_one();
+
+    if (request)
+        *request = handle.release();
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_executor_create
+ * @param num_threads number of threads to parse with, 0 for the number of cores
+ * @param max_queued maximum number of queued requests, 0 for no limit
+ *
+ * Create a new executor for asynchronous parsing.
+ * Client will have to free it using srcml_executor_free().
+ *
+ * @returns the created executor, or NULL on failure.
+ */
+srcml_executor* srcml_executor_create(int num_threads, int max_queued) {
+
+    if (num_threads < 0 || max_queued < 0)
+        return nullptr;
+
+    if (num_threads == 0)
+        num_threads = std::max(1, (int) std::thread::hardware_concurrency());
+
+    srcml_executor* executor = nullptr;
+    try {
+
+        executor = new srcml_executor;
+        executor->queue = std::make_shared<srcml_executor_queue>();
+
+    } catch(...) {
+
+        delete executor;
+        return nullptr;
+    }
+
+    executor->queue->max_queued = (size_t) max_queued;
+
+    try {
+
+        for (int i = 0; i < num_threads; ++i)
+            executor->workers.emplace_back(srcml_executor_run, executor->queue);
+
+    } catch(...) {
+
+        srcml_executor_free(executor);
+        return nullptr;
+    }
+
+    return executor;
+}
+
+/**
+ * srcml_executor_free
+ * @param executor a srcml_executor
+ *
+ * Free an executor. Queued requests are canceled, and running requests
+ * are finished before the threads are joined.
+ */
+void srcml_executor_free(srcml_executor* executor) {
+
+    if (executor == nullptr)
+        return;
+
+    std::deque<std::shared_ptr<srcml_parse_task>> canceled;
+    {
+        std::lock_guard<std::mutex> lock(executor->queue->mutex);
+        executor->queue->stopping = true;
+        canceled.swap(executor->queue->tasks);
+    }
+    executor->queue->work_cv.notify_all();
+
+    for (auto& task : canceled)
+        srcml_parse_task_complete(*task, SRCML_STATUS_CANCELED);
+
+    for (auto& worker : executor->workers)
+        worker.join();
+
+    delete executor;
+}
+
+/**
+ * srcml_executor_submit_callback
+ * @param executor a srcml_executor to run on
+ * @param unit a unit to pass to the callback, or NULL
+ * @param callback the callback
+ * @param context user context for the callback
+ *
+ * Queue a call of the callback on an executor thread, without a parse,
+ * in order with the parses queued on the executor.
+ *
+ * @returns SRCML_STATUS_OK on success, SRCML_STATUS_BUSY if the queue is full,
+ * and a status error code on failure.
+ */
+int srcml_executor_submit_callback(srcml_executor* executor, srcml_unit* unit, srcml_parse_callback callback, void* context) {
+
+    if (executor == nullptr || callback == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    std::shared_ptr<srcml_parse_task> task;
+    try {
+
+        task = std::make_shared<srcml_parse_task>();
+
+    } catch(...) { return SRCML_STATUS_ERROR; }
+
+    task->unit = unit;
+    task->parse = false;
+    task->use_filename = false;
+    task->src_buffer = nullptr;
+    task->buffer_size = 0;
+    task->callback = callback;
+    task->context = context;
+
+    return srcml_executor_submit(executor, task, nullptr);
+}
+
+/**
+ * srcml_unit_parse_filename_async
+ * @param executor a srcml_executor to parse on
+ * @param unit a unit to parse into
+ * @param src_filename name of a file to parse into srcML
+ * @param callback completion callback, or NULL
+ * @param context user context for the callback
+ * @param request location to store a handle to the request, or NULL
+ *
+ * Queue the parse of the contents of src_filename into the unit.
+ *
+ * @returns SRCML_STATUS_OK on success, SRCML_STATUS_BUSY if the queue is full,
+ * and a status error code on failure.
+ */
+int srcml_unit_parse_filename_async(srcml_executor* executor, srcml_unit* unit, const char* src_filename,
+                                    srcml_parse_callback callback, void* context, srcml_parse_request** request) {
+
+    if (executor == nullptr || unit == nullptr || src_filename == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    std::shared_ptr<srcml_parse_task> task;
+    try {
+
+        task = std::make_shared<srcml_parse_task>();
+        task->src_filename = src_filename;
+
+    } catch(...) { return SRCML_STATUS_ERROR; }
+
+    task->unit = unit;
+    task->use_filename = true;
+    task->src_buffer = nullptr;
+    task->buffer_size = 0;
+    task->callback = callback;
+    task->context = context;
+
+    return srcml_executor_submit(executor, task, request);
+}
+
+/**
+ * srcml_unit_parse_memory_async
+ * @param executor a srcml_executor to parse on
+ * @param unit a unit to parse into
+ * @param src_buffer buffer containing source code to parse into srcML
+ * @param buffer_size size of the buffer to parse
+ * @param callback completion callback, or NULL
+ * @param context user context for the callback
+ * @param request location to store a handle to the request, or NULL
+ *
+ * Queue the parse of the contents of src_buffer into the unit.
+ * The buffer is not copied.
+ *
+ * @returns SRCML_STATUS_OK on success, SRCML_STATUS_BUSY if the queue is full,
+ * and a status error code on failure.
+ */
+int srcml_unit_parse_memory_async(srcml_executor* executor, srcml_unit* unit, const char* src_buffer, size_t buffer_size,
+                                  srcml_parse_callback callback, void* context, srcml_parse_request** request) {
+
+    if (executor == nullptr || unit == nullptr || (buffer_size && src_buffer == nullptr))
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    std::shared_ptr<srcml_parse_task> task;
+    try {
+
+        task = std::make_shared<srcml_parse_task>();
+
+    } catch(...) { return SRCML_STATUS_ERROR; }
+
+    task->unit = unit;
+    task->use_filename = false;
+    task->src_buffer = src_buffer ? src_buffer : "";
+    task->buffer_size = buffer_size;
+    task->callback = callback;
+    task->context = context;
+
+    return srcml_executor_submit(executor, task, request);
+}
+
+/**
+ * srcml_parse_request_is_done
+ * @param request a srcml_parse_request
+ *
+ * @returns 1 if the request is complete, 0 otherwise.
+ */
+int srcml_parse_request_is_done(srcml_parse_request* request) {
+
+    if (request == nullptr)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(request->task->mutex);
+
+    return request->task->state == srcml_parse_task::DONE;
+}
+
+/**
+ * srcml_parse_request_wait
+ * @param request a srcml_parse_request
+ *
+ * Wait for the request to complete.
+ *
+ * @returns the status of the parse, SRCML_STATUS_CANCELED if canceled,
+ * and SRCML_STATUS_INVALID_ARGUMENT on an invalid request.
+ */
+int srcml_parse_request_wait(srcml_parse_request* request) {
+
+    if (request == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    srcml_parse_task& task = *request->task;
+
+    std::unique_lock<std::mutex> lock(task.mutex);
+    task.done_cv.wait(lock, [&task]{ return task.state == srcml_parse_task::DONE; });
+
+    return task.status;
+}
+
+/**
+ * srcml_parse_request_cancel
+ * @param request a srcml_parse_request
+ *
+ * Cancel a request that is still queued. The callback is called
+ * with SRCML_STATUS_CANCELED.
+ *
+ * @returns SRCML_STATUS_OK on success, and SRCML_STATUS_ERROR if
+ * the request already started.
+ */
+int srcml_parse_request_cancel(srcml_parse_request* request) {
+
+    if (request == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    std::shared_ptr<srcml_parse_task> task = request->task;
+
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        if (task->state != srcml_parse_task::QUEUED)
+            return SRCML_STATUS_ERROR;
+    }
+
+    // the task shares the queue, so the queue is valid even if the executor is freed meanwhile
+    std::shared_ptr<srcml_executor_queue> queue = task->queue;
+
+    // only the thread that removes the task from the queue completes it
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+
+        auto it = std::find(queue->tasks.begin(), queue->tasks.end(), task);
+        if (it == queue->tasks.end())
+            return SRCML_STATUS_ERROR;
+
+        queue->tasks.erase(it);
+    }
+
+    srcml_parse_task_complete(*task, SRCML_STATUS_CANCELED);
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_parse_request_free
+ * @param request a srcml_parse_request
+ *
+ * Free the handle to a request. The request itself still completes.
+ */
+void srcml_parse_request_free(srcml_parse_request* request) {
+
+    delete request;
+}
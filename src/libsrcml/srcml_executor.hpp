@@ -0,0 +1,119 @@
+/**
+ * @file srcml_executor.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SRCML_EXECUTOR_HPP
+#define SRCML_EXECUTOR_HPP
+
+#include <srcml.h>
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+struct srcml_parse_task;
+
+/**
+ * srcml_executor_queue
+ *
+ * Queue of parse tasks of an executor, shared with the workers and the
+ * queued tasks so that it outlives the executor while a task can reach it
+ */
+struct srcml_executor_queue {
+
+    /** maximum number of queued tasks, 0 for unlimited */
+    size_t max_queued = 0;
+
+    /** queued tasks, guarded by mutex */
+    std::deque<std::shared_ptr<srcml_parse_task>> tasks;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable work_cv;
+};
+
+/**
+ * srcml_parse_task
+ *
+ * A single asynchronous parse of a unit, shared between the executor
+ * queue, the worker that runs it, and the request handle.
+ */
+struct srcml_parse_task {
+
+    /** states of a task */
+    enum { QUEUED, RUNNING, DONE };
+
+    /** queue of the executor the task was submitted to */
+    std::shared_ptr<srcml_executor_queue> queue;
+
+    /** unit to parse into */
+    srcml_unit* unit;
+
+    /** parse the unit, or only call the callback */
+    bool parse = true;
+
+    /** source filename, or the buffer when there is none */
+    bool use_filename;
+    std::string src_filename;
+    const char* src_buffer;
+    size_t buffer_size;
+
+    /** completion callback and its user context */
+    srcml_parse_callback callback;
+    void* context;
+
+    /** state and resulting status, guarded by mutex */
+    int state = QUEUED;
+    int status = SRCML_STATUS_OK;
+    std::mutex mutex;
+    std::condition_variable done_cv;
+};
+
+/**
+ * srcml_executor
+ *
+ * Pool of threads with a bounded queue of parse tasks
+ */
+struct srcml_executor {
+
+    /** queue of tasks */
+    std::shared_ptr<srcml_executor_queue> queue;
+
+    /** worker threads */
+    std::vector<std::thread> workers;
+};
+
+/**
+ * srcml_parse_request
+ *
+ * Handle to a task for the user
+ */
+struct srcml_parse_request {
+
+    /** the task */
+    std::shared_ptr<srcml_parse_task> task;
+};
+
+// queue a call of the callback without a parse, in order with the parses queued
+int srcml_executor_submit_callback(srcml_executor* executor, srcml_unit* unit, srcml_parse_callback callback, void* context);
+
+#endif
@@ -0,0 +1,388 @@
+/**
+ * @file srcml_gzip_input.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef WITH_ZLIB
+
+#include <srcml_gzip_input.hpp>
+#include <srcml_gzip_output.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace {
+
+    uint64_t readLittleEndian(const unsigned char* data, int size) {
+
+        uint64_t value = 0;
+        for (int i = size - 1; i >= 0; --i)
+            value = (value << 8) | data[i];
+
+        return value;
+    }
+
+    /**
+     * readExtraMember
+     * @param data start of an empty gzip member with an extra field
+     * @param size size of the data
+     * @param id1 first subfield id
+     * @param id2 second subfield id
+     * @param subfield location of the subfield data
+     * @param subfield_size location of the size of the subfield data
+     *
+     * @returns the size of the member, or 0 if not an empty member with the subfield
+     */
+    size_t readExtraMember(const unsigned char* data, size_t size, char id1, char id2,
+                           const unsigned char** subfield, size_t* subfield_size) {
+
+        if (size < 16 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 0x08 || data[3] != 0x04)
+            return 0;
+
+        size_t xlen = (size_t) readLittleEndian(data + 10, 2);
+        if (xlen < 4 || (unsigned char) id1 != data[12] || (unsigned char) id2 != data[13])
+            return 0;
+
+        size_t len = (size_t) readLittleEndian(data + 14, 2);
+        size_t member_size = 12 + xlen + 10;
+        if (len + 4 != xlen || member_size > size)
+            return 0;
+
+        *subfield = data + 16;
+        *subfield_size = len;
+
+        return member_size;
+    }
+
+    /**
+     * GzipFrame
+     *
+     * A frame and its decompressed data
+     */
+    struct GzipFrame {
+
+        size_t frame = 0;
+        std::string data;
+        bool ok = false;
+        bool done = false;
+    };
+
+    /**
+     * ParallelGunzip
+     *
+     * Decompresses frames ahead on a pool of threads, and reads them in order.
+     */
+    class ParallelGunzip {
+    public:
+
+        ParallelGunzip(const char* filename, std::shared_ptr<const srcml_gzip_seek_table> table, size_t first_frame, int num_threads)
+            : filename(filename), table(table), window(2 * (size_t) num_threads) {
+
+            // the start of the archive, then the requested frames
+            frames.push_back(std::make_shared<GzipFrame>());
+            for (size_t i = std::max(first_frame, (size_t) 1); i < table->size(); ++i) {
+                frames.push_back(std::make_shared<GzipFrame>());
+                frames.back()->frame = i;
+            }
+
+            try {
+
+                for (int i = 0; i < num_threads; ++i)
+                    workers.emplace_back(&ParallelGunzip::run, this);
+
+            } catch(...) {
+
+                stop();
+                throw;
+            }
+        }
+
+        ~ParallelGunzip() {
+
+            stop();
+        }
+
+        // read the decompressed frames in order
+        int read(char* buffer, int len) {
+
+            while (position == current.size()) {
+
+                if (consumed == frames.size())
+                    return 0;
+
+                std::shared_ptr<GzipFrame> frame;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    frame = frames[consumed];
+                    done_cv.wait(lock, [&frame]{ return frame->done; });
+
+                    frames[consumed].reset();
+                    ++consumed;
+                }
+                job_cv.notify_all();
+
+                if (!frame->ok)
+                    return -1;
+
+                current.swap(frame->data);
+                position = 0;
+            }
+
+            size_t size = std::min((size_t) len, current.size() - position);
+            std::memcpy(buffer, current.data() + position, size);
+            position += size;
+
+            return (int) size;
+        }
+
+    private:
+
+        // worker thread, with its own stream on the file
+        void run() {
+
+            std::ifstream in(filename, std::ios::binary);
+
+            while (true) {
+
+                std::shared_ptr<GzipFrame> frame;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    job_cv.wait(lock, [this]{ return stopping || (next_job < frames.size() && next_job < consumed + window); });
+
+                    if (stopping)
+                        return;
+
+                    frame = frames[next_job];
+                    ++next_job;
+                }
+
+                frame->ok = in && decompress(in, *frame);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    frame->done = true;
+                }
+                done_cv.notify_all();
+            }
+        }
+
+        // decompress a single gzip member
+        bool decompress(std::ifstream& in, GzipFrame& frame) {
+
+            uint64_t offset = table->offsets[frame.frame];
+            std::string compressed((size_t) (table->offsets[frame.frame + 1] - offset), '\0');
+
+            in.clear();
+            in.seekg((std::streamoff) offset);
+            if (!in.read(&compressed[0], (std::streamsize) compressed.size()))
+                return false;
+
+            z_stream strm;
+            strm.zalloc = Z_NULL;
+            strm.zfree = Z_NULL;
+            strm.opaque = Z_NULL;
+            strm.next_in = Z_NULL;
+            strm.avail_in = 0;
+            if (inflateInit2(&strm, 16 + 15) != Z_OK)
+                return false;
+
+            strm.next_in = (Bytef*) compressed.data();
+            strm.avail_in = (uInt) compressed.size();
+
+            frame.data.resize(compressed.size() * 4 + 1024);
+            size_t used = 0;
+            int status;
+            while (true) {
+
+                strm.next_out = (Bytef*) &frame.data[used];
+                strm.avail_out = (uInt) (frame.data.size() - used);
+
+                status = inflate(&strm, Z_NO_FLUSH);
+                used = frame.data.size() - strm.avail_out;
+
+                if (status != Z_OK)
+                    break;
+
+                if (strm.avail_out == 0)
+                    frame.data.resize(frame.data.size() * 2);
+                else if (strm.avail_in == 0)
+                    break;
+            }
+            frame.data.resize(used);
+
+            inflateEnd(&strm);
+
+            return status == Z_STREAM_END;
+        }
+
+        // stop and join the workers
+        void stop() {
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            job_cv.notify_all();
+
+            for (auto& worker : workers)
+                if (worker.joinable())
+                    worker.join();
+        }
+
+        std::string filename;
+        std::shared_ptr<const srcml_gzip_seek_table> table;
+        size_t window;
+
+        // frames in read order, guarded by mutex
+        std::vector<std::shared_ptr<GzipFrame>> frames;
+        size_t next_job = 0;
+        size_t consumed = 0;
+        bool stopping = false;
+        std::mutex mutex;
+        std::condition_variable job_cv;
+        std::condition_variable done_cv;
+        std::vector<std::thread> workers;
+
+        // data of the frame being read
+        std::string current;
+        size_t position = 0;
+    };
+
+    int gunzip_read(void* context, char* buffer, int len) {
+
+        return static_cast<ParallelGunzip*>(context)->read(buffer, len);
+    }
+
+    int gunzip_close(void* context) {
+
+        delete static_cast<ParallelGunzip*>(context);
+
+        return 0;
+    }
+}
+
+/**
+ * srcml_gzip_read_seek_table
+ * @param filename name of a file
+ *
+ * Read the seek table of a seekable gzip srcML archive.
+ *
+ * @returns the seek table, or an empty pointer if the file is not a seekable archive.
+ */
+std::shared_ptr<srcml_gzip_seek_table> srcml_gzip_read_seek_table(const char* filename) {
+
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in)
+        return nullptr;
+
+    std::streamoff file_size = in.tellg();
+    if (file_size < (std::streamoff) SRCML_GZIP_FOOTER_SIZE)
+        return nullptr;
+
+    // footer
+    unsigned char footer[SRCML_GZIP_FOOTER_SIZE];
+    in.seekg(file_size - (std::streamoff) SRCML_GZIP_FOOTER_SIZE);
+    if (!in.read((char*) footer, sizeof(footer)))
+        return nullptr;
+
+    const unsigned char* data = nullptr;
+    size_t data_size = 0;
+    if (readExtraMember(footer, sizeof(footer), 'S', 'F', &data, &data_size) != sizeof(footer) || data_size != SRCML_GZIP_FOOTER_DATA_SIZE)
+        return nullptr;
+
+    uint64_t table_offset = readLittleEndian(data, 8);
+    uint64_t num_frames = readLittleEndian(data + 8, 8);
+    uint64_t units_per_frame = readLittleEndian(data + 16, 8);
+    uint64_t table_end = (uint64_t) file_size - SRCML_GZIP_FOOTER_SIZE;
+    if (table_offset > table_end || num_frames == 0 || units_per_frame == 0)
+        return nullptr;
+
+    // seek table members
+    std::string table_data((size_t) (table_end - table_offset), '\0');
+    in.seekg((std::streamoff) table_offset);
+    if (!in.read(&table_data[0], (std::streamsize) table_data.size()))
+        return nullptr;
+
+    auto table = std::make_shared<srcml_gzip_seek_table>();
+    table->units_per_frame = (size_t) units_per_frame;
+
+    const unsigned char* pos = (const unsigned char*) table_data.data();
+    const unsigned char* end = pos + table_data.size();
+    while (pos < end) {
+
+        size_t member_size = readExtraMember(pos, (size_t) (end - pos), 'S', 'T', &data, &data_size);
+        if (!member_size || data_size % SRCML_GZIP_SEEK_ENTRY_SIZE)
+            return nullptr;
+
+        for (size_t i = 0; i < data_size; i += SRCML_GZIP_SEEK_ENTRY_SIZE)
+            table->offsets.push_back(readLittleEndian(data + i, 8));
+
+        pos += member_size;
+    }
+    table->offsets.push_back(table_offset);
+
+    // offsets must be in order within the file
+    if (table->size() != num_frames || !std::is_sorted(table->offsets.begin(), table->offsets.end()))
+        return nullptr;
+
+    return table;
+}
+
+/**
+ * srcml_gzip_input_create
+ * @param filename name of a seekable gzip srcML archive
+ * @param table seek table of the archive
+ * @param frame first frame to read after frame 0
+ * @param num_threads number of threads to decompress frames with
+ * @param encoding the encoding of the archive
+ *
+ * Create an input buffer of frame 0 followed by the frames from frame onwards.
+ *
+ * @returns the input buffer, or NULL on failure.
+ */
+xmlParserInputBufferPtr srcml_gzip_input_create(const char* filename, std::shared_ptr<const srcml_gzip_seek_table> table,
+                                                size_t frame, int num_threads, xmlCharEncoding encoding) {
+
+    if (filename == nullptr || !table || table->size() == 0)
+        return nullptr;
+
+    ParallelGunzip* gunzip;
+    try {
+
+        gunzip = new ParallelGunzip(filename, table, frame, num_threads > 0 ? num_threads : 1);
+
+    } catch(...) {
+
+        return nullptr;
+    }
+
+    xmlParserInputBufferPtr input = xmlParserInputBufferCreateIO(gunzip_read, gunzip_close, gunzip, encoding);
+    if (input == nullptr)
+        delete gunzip;
+
+    return input;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file srcml_gzip_input.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SRCML_GZIP_INPUT_HPP
+#define SRCML_GZIP_INPUT_HPP
+
+#include <libxml/xmlIO.h>
+#include <libxml/encoding.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * srcml_gzip_seek_table
+ *
+ * Seek table of a seekable gzip srcML archive.
+ */
+struct srcml_gzip_seek_table {
+
+    /** compressed offset of each frame, followed by the offset of the end of the last frame */
+    std::vector<uint64_t> offsets;
+
+    /** number of units in each frame after frame 0 */
+    size_t units_per_frame = 0;
+
+    /** @returns the number of frames */
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+};
+
+/**
+ * srcml_gzip_read_seek_table
+ * @param filename name of a file
+ *
+ * Read the seek table of a seekable gzip srcML archive.
+ *
+ * @returns the seek table, or an empty pointer if the file is not a seekable archive.
+ */
+std::shared_ptr<srcml_gzip_seek_table> srcml_gzip_read_seek_table(const char* filename);
+
+/**
+ * srcml_gzip_input_create
+ * @param filename name of a seekable gzip srcML archive
+ * @param table seek table of the archive
+ * @param frame first frame to read after frame 0
+ * @param num_threads number of threads to decompress frames with
+ * @param encoding the encoding of the archive
+ *
+ * Create an input buffer of frame 0, the start of the archive, followed by the frames
+ * from frame onwards. Frames are decompressed ahead in parallel.
+ *
+ * @returns the input buffer, or NULL on failure.
+ */
+xmlParserInputBufferPtr srcml_gzip_input_create(const char* filename, std::shared_ptr<const srcml_gzip_seek_table> table,
+                                                size_t frame, int num_threads, xmlCharEncoding encoding);
+
+#endif
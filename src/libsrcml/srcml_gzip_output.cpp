@@ -0,0 +1,469 @@
+/**
+ * @file srcml_gzip_output.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef WITH_ZLIB
+
+#include <srcml_gzip_output.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <string>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+namespace {
+
+    // size of the uncompressed blocks that are compressed in parallel
+    const size_t BLOCK_SIZE = 128 * 1024;
+
+    // size of the deflate window, and of the dictionary from the previous block
+    const size_t DICTIONARY_SIZE = 32 * 1024;
+
+    /**
+     * GzipBlock
+     *
+     * A block of uncompressed data and its raw deflate compression
+     */
+    struct GzipBlock {
+
+        std::string input;
+        std::string dictionary;
+
+        // first and last block of a gzip member
+        bool first = false;
+        bool last = false;
+
+        std::string output;
+        uLong crc = 0;
+        bool ok = false;
+        bool done = false;
+    };
+
+    /**
+     * ParallelGzip
+     *
+     * Compresses blocks on a pool of threads, and writes them in order as gzip members.
+     */
+    class ParallelGzip {
+    public:
+
+        ParallelGzip(xmlOutputBufferPtr output, int num_threads, size_t frame_units)
+            : output(output), max_pending(2 * (size_t) num_threads), frame_units(frame_units) {
+
+            try {
+
+                for (int i = 0; i < num_threads; ++i)
+                    workers.emplace_back(&ParallelGzip::run, this);
+
+            } catch(...) {
+
+                stop();
+                throw;
+            }
+        }
+
+        ~ParallelGzip() {
+
+            stop();
+        }
+
+        // collect data into blocks
+        int write(const char* buffer, int len) {
+
+            const char* end = buffer + len;
+            while (buffer < end) {
+
+                size_t size = std::min((size_t) (end - buffer), BLOCK_SIZE - current.size());
+                current.append(buffer, size);
+                buffer += size;
+
+                if (current.size() == BLOCK_SIZE && !submit(false))
+                    return -1;
+            }
+
+            return len;
+        }
+
+        // end the current member, so that the following data starts a new one
+        void frame() {
+
+            if (!member_open && current.empty())
+                return;
+
+            if (!submit(true))
+                failed = true;
+        }
+
+        // compress the remaining data, finish the last member, and write the seek table
+        int close() {
+
+            bool ok = true;
+            if (member_open || !current.empty() || !started)
+                ok = submit(true);
+            while (ok && !pending.empty())
+                ok = writeNext();
+
+            if (ok && frame_units)
+                writeSeekTable();
+
+            stop();
+
+            return xmlOutputBufferClose(output) < 0 || !ok || failed ? -1 : 0;
+        }
+
+    private:
+
+        // queue the current block for compression, and write out any compressed blocks
+        bool submit(bool last) {
+
+            auto block = std::make_shared<GzipBlock>();
+            block->input.swap(current);
+            block->first = !member_open;
+            block->last = last;
+            started = true;
+            if (!block->first)
+                block->dictionary = dictionary;
+
+            // the end of this block is the dictionary of the next in the same member
+            member_open = !last;
+            if (member_open) {
+                dictionary.append(block->input);
+                if (dictionary.size() > DICTIONARY_SIZE)
+                    dictionary.erase(0, dictionary.size() - DICTIONARY_SIZE);
+            } else {
+                dictionary.clear();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(block);
+            }
+            job_cv.notify_one();
+            pending.push_back(block);
+
+            // write completed blocks in order, and limit the number of blocks in memory
+            while (!pending.empty()) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!pending.front()->done && pending.size() <= max_pending)
+                        break;
+                }
+
+                if (!writeNext())
+                    return false;
+            }
+
+            return true;
+        }
+
+        // wait for the next block in order to be compressed, and write it
+        bool writeNext() {
+
+            std::shared_ptr<GzipBlock> block = pending.front();
+            pending.pop_front();
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                done_cv.wait(lock, [&block]{ return block->done; });
+            }
+
+            if (!block->ok)
+                return false;
+
+            // gzip header: magic, deflate, no flags, no time, no extra flags, unknown OS
+            if (block->first) {
+                static const char header[] = { '\x1f', '\x8b', '\x08', 0, 0, 0, 0, 0, 0, '\xff' };
+
+                frames.push_back({ compressed_size, uncompressed_size });
+                member_crc = crc32(0L, Z_NULL, 0);
+                member_size = 0;
+                writeOutput(header, sizeof(header));
+            }
+
+            writeOutput(block->output.c_str(), block->output.size());
+
+            member_crc = crc32_combine(member_crc, block->crc, (z_off_t) block->input.size());
+            member_size += (uLong) block->input.size();
+            uncompressed_size += block->input.size();
+
+            // gzip trailer: crc and size of the member data
+            if (block->last) {
+                unsigned char trailer[8];
+                for (int i = 0; i < 4; ++i) {
+                    trailer[i]     = (unsigned char) (member_crc >> (8 * i));
+                    trailer[i + 4] = (unsigned char) (member_size >> (8 * i));
+                }
+                writeOutput((const char*) trailer, sizeof(trailer));
+            }
+
+            return !failed;
+        }
+
+        // write to the underlying output, tracking the compressed offset. Any failed write fails the close
+        bool writeOutput(const char* data, size_t size) {
+
+            if (xmlOutputBufferWrite(output, (int) size, data) < 0)
+                failed = true;
+            compressed_size += size;
+
+            return !failed;
+        }
+
+        // write an empty gzip member with an extra field subfield
+        void writeExtraMember(char id1, char id2, const std::string& data) {
+
+            std::string member = { '\x1f', '\x8b', '\x08', '\x04', 0, 0, 0, 0, 0, '\xff' };
+            appendLittleEndian(member, data.size() + 4, 2);
+            member += id1;
+            member += id2;
+            appendLittleEndian(member, data.size(), 2);
+            member += data;
+
+            // raw deflate of no data, and the trailer of no data
+            member += { '\x03', 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+            writeOutput(member.c_str(), member.size());
+        }
+
+        // seek table members, and the footer that locates them
+        void writeSeekTable() {
+
+            uint64_t table_offset = compressed_size;
+
+            for (size_t start = 0; start < frames.size(); start += SRCML_GZIP_SEEK_ENTRIES_PER_MEMBER) {
+
+                std::string entries;
+                for (size_t i = start; i < frames.size() && i < start + SRCML_GZIP_SEEK_ENTRIES_PER_MEMBER; ++i) {
+                    appendLittleEndian(entries, frames[i].first, 8);
+                    appendLittleEndian(entries, frames[i].second, 8);
+                }
+
+                writeExtraMember('S', 'T', entries);
+            }
+
+            std::string footer;
+            appendLittleEndian(footer, table_offset, 8);
+            appendLittleEndian(footer, frames.size(), 8);
+            appendLittleEndian(footer, frame_units, 8);
+
+            writeExtraMember('S', 'F', footer);
+        }
+
+        static void appendLittleEndian(std::string& s, uint64_t value, int size) {
+
+            for (int i = 0; i < size; ++i)
+                s += (char) (unsigned char) (value >> (8 * i));
+        }
+
+        // worker thread
+        void run() {
+
+            while (true) {
+
+                std::shared_ptr<GzipBlock> block;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    job_cv.wait(lock, [this]{ return stopping || !jobs.empty(); });
+
+                    if (jobs.empty())
+                        return;
+
+                    block = jobs.front();
+                    jobs.pop_front();
+                }
+
+                compress(*block);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    block->done = true;
+                }
+                done_cv.notify_all();
+            }
+        }
+
+        // raw deflate of a block, ending on a byte boundary so that blocks concatenate
+        static void compress(GzipBlock& block) {
+
+            block.crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef*) block.input.data(), (uInt) block.input.size());
+
+            z_stream strm;
+            strm.zalloc = Z_NULL;
+            strm.zfree = Z_NULL;
+            strm.opaque = Z_NULL;
+            if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                return;
+
+            if (!block.dictionary.empty())
+                deflateSetDictionary(&strm, (const Bytef*) block.dictionary.data(), (uInt) block.dictionary.size());
+
+            strm.next_in = (Bytef*) block.input.data();
+            strm.avail_in = (uInt) block.input.size();
+
+            int flush = block.last ? Z_FINISH : Z_SYNC_FLUSH;
+            block.output.resize(deflateBound(&strm, (uLong) block.input.size()) + 16);
+            size_t used = 0;
+            int status;
+            while (true) {
+
+                strm.next_out = (Bytef*) &block.output[used];
+                strm.avail_out = (uInt) (block.output.size() - used);
+
+                status = deflate(&strm, flush);
+                used = block.output.size() - strm.avail_out;
+
+                if (status == Z_STREAM_ERROR || (status == Z_BUF_ERROR && strm.avail_out != 0))
+                    break;
+
+                // complete when all input is consumed and the flush fit in the output
+                if (block.last ? status == Z_STREAM_END : (strm.avail_in == 0 && strm.avail_out != 0))
+                    break;
+
+                block.output.resize(block.output.size() * 2);
+            }
+            block.output.resize(used);
+
+            block.ok = block.last ? status == Z_STREAM_END : status == Z_OK || status == Z_BUF_ERROR;
+
+            deflateEnd(&strm);
+        }
+
+        // stop and join the workers
+        void stop() {
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            job_cv.notify_all();
+
+            for (auto& worker : workers)
+                if (worker.joinable())
+                    worker.join();
+        }
+
+        xmlOutputBufferPtr output;
+        size_t max_pending;
+
+        // units per frame of a seekable archive, 0 for a single member
+        size_t frame_units;
+
+        // uncompressed data not yet in a block, and the end of the previous block
+        std::string current;
+        std::string dictionary;
+        bool member_open = false;
+        bool started = false;
+
+        // blocks in output order, written by the calling thread
+        std::deque<std::shared_ptr<GzipBlock>> pending;
+
+        // blocks waiting for a worker, guarded by mutex
+        std::deque<std::shared_ptr<GzipBlock>> jobs;
+        bool stopping = false;
+        std::mutex mutex;
+        std::condition_variable job_cv;
+        std::condition_variable done_cv;
+        std::vector<std::thread> workers;
+
+        // gzip trailer of the current member
+        uLong member_crc = 0;
+        uLong member_size = 0;
+
+        // compressed and uncompressed offsets of each member, for the seek table
+        std::vector<std::pair<uint64_t, uint64_t>> frames;
+        uint64_t compressed_size = 0;
+        uint64_t uncompressed_size = 0;
+
+        // a write to the underlying output, or a frame, failed
+        bool failed = false;
+    };
+
+    int gzip_write(void* context, const char* buffer, int len) {
+
+        return static_cast<ParallelGzip*>(context)->write(buffer, len);
+    }
+
+    int gzip_close(void* context) {
+
+        ParallelGzip* gzip = static_cast<ParallelGzip*>(context);
+        int status = gzip->close();
+        delete gzip;
+
+        return status;
+    }
+}
+
+/**
+ * srcml_gzip_output_create
+ * @param output the output buffer for the compressed data
+ * @param num_threads number of threads to compress with
+ * @param encoder the character encoding handler of the uncompressed data, or NULL
+ * @param frame_units number of units per frame for a seekable archive, or 0 for a single stream
+ *
+ * Create an output buffer that compresses into gzip on output.
+ *
+ * @returns the output buffer, or NULL on failure. On failure output is closed.
+ */
+xmlOutputBufferPtr srcml_gzip_output_create(xmlOutputBufferPtr output, int num_threads, xmlCharEncodingHandlerPtr encoder, size_t frame_units) {
+
+    if (output == nullptr)
+        return nullptr;
+
+    ParallelGzip* gzip;
+    try {
+
+        gzip = new ParallelGzip(output, num_threads > 0 ? num_threads : 1, frame_units);
+
+    } catch(...) {
+
+        xmlOutputBufferClose(output);
+        return nullptr;
+    }
+
+    xmlOutputBufferPtr gzip_output = xmlOutputBufferCreateIO(gzip_write, gzip_close, gzip, encoder);
+    if (gzip_output == nullptr)
+        gzip_close(gzip);
+
+    return gzip_output;
+}
+
+/**
+ * srcml_gzip_output_frame
+ * @param output an output buffer created by srcml_gzip_output_create
+ *
+ * End the current frame of a seekable archive, so that the data written
+ * after it starts a new independent frame.
+ */
+void srcml_gzip_output_frame(xmlOutputBufferPtr output) {
+
+    if (output == nullptr || output->writecallback != gzip_write)
+        return;
+
+    xmlOutputBufferFlush(output);
+
+    static_cast<ParallelGzip*>(output->context)->frame();
+}
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @file srcml_gzip_output.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SRCML_GZIP_OUTPUT_HPP
+#define SRCML_GZIP_OUTPUT_HPP
+
+#include <libxml/xmlIO.h>
+#include <libxml/encoding.h>
+
+#include <cstddef>
+
+/*
+  A seekable gzip srcML archive is a sequence of independent gzip members (frames),
+  followed by empty gzip members that hold the seek table in their extra field.
+  Frame 0 is the start of the archive up to the first unit, and each frame after
+  that holds a fixed number of units. Since the table is only in the extra fields
+  of empty members, the file is still an ordinary gzip file.
+
+  Seek table members have the subfield 'S' 'T' with a list of entries, each the
+  compressed offset and the uncompressed offset of a frame, as 8-byte little-endian
+  integers. The file ends with a footer member of fixed size with the subfield
+  'S' 'F' with the compressed offset of the seek table, the number of frames, and
+  the number of units per frame.
+*/
+
+/** size of the footer member of a seekable gzip archive */
+const size_t SRCML_GZIP_FOOTER_SIZE = 50;
+
+/** size of the seek table data in the footer */
+const size_t SRCML_GZIP_FOOTER_DATA_SIZE = 24;
+
+/** size of a seek table entry */
+const size_t SRCML_GZIP_SEEK_ENTRY_SIZE = 16;
+
+/** maximum number of seek table entries in a single member */
+const size_t SRCML_GZIP_SEEK_ENTRIES_PER_MEMBER = 4000;
+
+/**
+ * srcml_gzip_output_create
+ * @param output the output buffer for the compressed data
+ * @param num_threads number of threads to compress with
+ * @param encoder the character encoding handler of the uncompressed data, or NULL
+ * @param frame_units number of units per frame for a seekable archive, or 0 for a single stream
+ *
+ * Create an output buffer that compresses everything written to it into gzip
+ * on output. Blocks of the data are compressed in parallel, each primed
+ * with the end of the previous block in the same frame, in the way of pigz. Closing
+ * the returned buffer finishes the stream and closes output.
+ *
+ * @returns the output buffer, or NULL on failure. On failure output is closed.
+ */
+xmlOutputBufferPtr srcml_gzip_output_create(xmlOutputBufferPtr output, int num_threads, xmlCharEncodingHandlerPtr encoder, size_t frame_units = 0);
+
+/**
+ * srcml_gzip_output_frame
+ * @param output an output buffer created by srcml_gzip_output_create
+ *
+ * End the current frame of a seekable archive, so that the data written
+ * after it starts a new independent frame.
+ */
+void srcml_gzip_output_frame(xmlOutputBufferPtr output);
+
+#endif
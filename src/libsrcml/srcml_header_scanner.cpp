@@ -0,0 +1,612 @@
+/**
+ * @file srcml_header_scanner.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <srcml_header_scanner.hpp>
+#include <srcml_types.hpp>
+#include <unit_utilities.hpp>
+
+#include <libxml/tree.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+    /** size of each read of the input */
+    const int SCAN_READ_SIZE = 64 * 1024;
+
+    /** input already scanned that is kept before it is discarded */
+    const size_t SCAN_KEEP_SIZE = 256 * 1024;
+
+    bool isSpace(char c) {
+
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    // local name of a qualified name
+    std::string localName(const std::string& name) {
+
+        size_t colon = name.find(':');
+
+        return colon == std::string::npos ? name : name.substr(colon + 1);
+    }
+
+    // append a character as UTF-8
+    void appendUTF8(std::string& value, unsigned long c) {
+
+        if (c < 0x80) {
+            value += (char) c;
+        } else if (c < 0x800) {
+            value += (char) (0xC0 | (c >> 6));
+            value += (char) (0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            value += (char) (0xE0 | (c >> 12));
+            value += (char) (0x80 | ((c >> 6) & 0x3F));
+            value += (char) (0x80 | (c & 0x3F));
+        } else {
+            value += (char) (0xF0 | (c >> 18));
+            value += (char) (0x80 | ((c >> 12) & 0x3F));
+            value += (char) (0x80 | ((c >> 6) & 0x3F));
+            value += (char) (0x80 | (c & 0x3F));
+        }
+    }
+
+    /**
+     * attributeValue
+     * @param raw the attribute value as in the start tag
+     *
+     * Normalize whitespace and replace entity and character references,
+     * as libxml2 does for the attribute values given to SAX2 handlers.
+     * Without entity substitution, libxml2 keeps &amp; as &#38;.
+     *
+     * @returns the value of the attribute.
+     */
+    std::string attributeValue(const std::string& raw) {
+
+        std::string value;
+        for (size_t i = 0; i < raw.size(); ++i) {
+
+            if (raw[i] != '&') {
+                value += isSpace(raw[i]) ? ' ' : raw[i];
+                continue;
+            }
+
+            size_t semicolon = raw.find(';', i);
+            if (semicolon == std::string::npos) {
+                value += raw.substr(i);
+                break;
+            }
+
+            std::string entity = raw.substr(i + 1, semicolon - i - 1);
+            if (entity == "lt")
+                value += '<';
+            else if (entity == "gt")
+                value += '>';
+            else if (entity == "amp")
+                value += "&#38;";
+            else if (entity == "quot")
+                value += '"';
+            else if (entity == "apos")
+                value += '\'';
+            else if (entity.size() > 2 && entity[0] == '#' && entity[1] == 'x')
+                appendUTF8(value, strtoul(entity.c_str() + 2, nullptr, 16));
+            else if (entity.size() > 1 && entity[0] == '#')
+                appendUTF8(value, strtoul(entity.c_str() + 1, nullptr, 10));
+            else
+                value += raw.substr(i, semicolon - i + 1);
+
+            i = semicolon;
+        }
+
+        return value;
+    }
+}
+
+/**
+ * srcml_header_scanner
+ * @param input the decoded input, at the start of the archive
+ *
+ * Construct a scanner on the input of a srcML archive.
+ */
+srcml_header_scanner::srcml_header_scanner(xmlParserInputBufferPtr input)
+    : input(input) {
+
+    refresh();
+}
+
+/**
+ * ~srcml_header_scanner
+ *
+ * Destructor.
+ */
+srcml_header_scanner::~srcml_header_scanner() {
+
+    if (encoder)
+        xmlCharEncCloseFunc(encoder);
+}
+
+/**
+ * set_encoding
+ * @param encoding the encoding of the input
+ *
+ * Set the encoding of an input that is not decoded, for the values of
+ * attributes. The scanner only reads encodings where markup is ASCII.
+ *
+ * @returns if the scanner can read the encoding.
+ */
+bool srcml_header_scanner::set_encoding(const char* encoding) {
+
+    encoder = xmlFindCharEncodingHandler(encoding);
+    if (!encoder)
+        return false;
+
+    return convert("<unit>") == "<unit>";
+}
+
+/**
+ * convert
+ * @param value text in the encoding of the input
+ *
+ * @returns the text in UTF-8.
+ */
+std::string srcml_header_scanner::convert(const std::string& value) {
+
+    if (!encoder)
+        return value;
+
+    std::unique_ptr<xmlBuffer, decltype(&xmlBufferFree)> in(xmlBufferCreate(), &xmlBufferFree);
+    std::unique_ptr<xmlBuffer, decltype(&xmlBufferFree)> out(xmlBufferCreate(), &xmlBufferFree);
+    xmlBufferAdd(in.get(), (const xmlChar*) value.data(), (int) value.size());
+    if (xmlCharEncInFunc(encoder, out.get(), in.get()) < 0)
+        return value;
+
+    return std::string((const char*) xmlBufferContent(out.get()), (size_t) xmlBufferLength(out.get()));
+}
+
+/**
+ * prefix_size
+ *
+ * Find the start tag of the first element in the root, which is the
+ * first unit of an archive, skipping any macro-list elements. For a
+ * single unit, the root itself is the unit, and the text before the
+ * element is part of it. The input is not consumed, so that it can be
+ * given to libxml2.
+ *
+ * @returns the size of the input through the start tag, or 0 if not found.
+ */
+size_t srcml_header_scanner::prefix_size() {
+
+    // XML declaration, comments, and processing instructions before the root
+    size_t offset = 0;
+    while (true) {
+
+        offset = find(offset, '<');
+        if (offset == std::string::npos || !fill(offset, 2) || data()[offset + 1] == '\0')
+            return 0;
+
+        if (data()[offset + 1] != '?' && data()[offset + 1] != '!')
+            break;
+
+        offset = find_tag_end(offset);
+        if (offset == std::string::npos)
+            return 0;
+        ++offset;
+    }
+
+    std::string root = tag_name(offset);
+    size_t root_end = find_tag_end(offset);
+    if (root.empty() || root_end == std::string::npos)
+        return 0;
+
+    // a root with nothing in it
+    if (data()[root_end - 1] == '/') {
+
+        done = true;
+        return root_end + 1;
+    }
+
+    // the text and elements in the root, up to the first element that is not a macro-list
+    TextLOC text;
+    offset = root_end + 1;
+    while (true) {
+
+        size_t lt = find(offset, '<');
+        if (lt == std::string::npos || !fill(lt, 2))
+            return 0;
+
+        if (lt > offset) {
+            text.newlines += (int) std::count(data() + offset, data() + lt, '\n');
+            text.text = true;
+            text.last_newline = data()[lt - 1] == '\n';
+        }
+
+        size_t end = find_tag_end(lt);
+        if (end == std::string::npos)
+            return 0;
+        offset = end + 1;
+
+        // end of the root without elements in it, a single unit of text
+        if (data()[lt + 1] == '/') {
+
+            prefix_text = text;
+            done = true;
+            return offset;
+        }
+
+        if (data()[lt + 1] == '!' || data()[lt + 1] == '?')
+            continue;
+
+        std::string name = tag_name(lt);
+        std::string local = localName(name);
+        if (local == "macro-list")
+            continue;
+
+        is_archive = local == "unit";
+        if (is_archive) {
+
+            // first unit of an archive
+            unit_end_tag = "</" + name;
+            prefix_unit = data()[end - 1] != '/';
+
+        } else {
+
+            // an element of a single unit
+            unit_end_tag = "</" + root;
+            prefix_unit = true;
+            prefix_text = text;
+            if (local == "escape") {
+                prefix_text.text = true;
+                prefix_text.last_newline = false;
+            }
+        }
+
+        return offset;
+    }
+}
+
+/**
+ * skip_body
+ *
+ * Skip the rest of the body of the unit started in the prefix.
+ *
+ * @returns the lines of code of the unit.
+ */
+int srcml_header_scanner::skip_body() {
+
+    // the prefix was consumed by the parser
+    refresh();
+
+    TextLOC text = prefix_text;
+    prefix_text = TextLOC();
+
+    if (!prefix_unit)
+        return text.loc();
+    prefix_unit = false;
+
+    size_t offset = 0;
+    if (!count_body(offset, text))
+        done = true;
+    else
+        consume(offset);
+
+    // the unit of a single unit is the root
+    if (!is_archive)
+        done = true;
+
+    return text.loc();
+}
+
+/**
+ * next_unit
+ * @param unit location to store the unit
+ *
+ * Read the attributes of the next unit of the archive from its start tag,
+ * then skip its body, counting its lines of code.
+ *
+ * @returns if there was a unit, false at the end of the root or of the input.
+ */
+bool srcml_header_scanner::next_unit(srcml_unit* unit) {
+
+    if (prefix_unit)
+        skip_body();
+
+    // the prefix was consumed by the parser
+    refresh();
+
+    size_t offset = 0;
+    while (!done) {
+
+        size_t lt = find(offset, '<');
+        if (lt == std::string::npos || !fill(lt, 2))
+            break;
+
+        // end of the root
+        if (data()[lt + 1] == '/')
+            break;
+
+        size_t end = find_tag_end(lt);
+        if (end == std::string::npos)
+            break;
+        offset = end + 1;
+
+        if (data()[lt + 1] == '!' || data()[lt + 1] == '?')
+            continue;
+
+        std::string name = tag_name(lt);
+        if (localName(name) != "unit")
+            continue;
+
+        // attributes of the start tag, without namespace declarations
+        size_t pos = lt + 1 + name.size();
+        size_t tag_end = data()[end - 1] == '/' ? end - 1 : end;
+        while (true) {
+
+            while (pos < tag_end && isSpace(data()[pos]))
+                ++pos;
+            if (pos >= tag_end)
+                break;
+
+            size_t name_start = pos;
+            while (pos < tag_end && data()[pos] != '=' && !isSpace(data()[pos]))
+                ++pos;
+            std::string attribute(data() + name_start, pos - name_start);
+
+            while (pos < tag_end && (isSpace(data()[pos]) || data()[pos] == '='))
+                ++pos;
+            if (pos >= tag_end)
+                break;
+
+            char quote = data()[pos];
+            size_t value_end = std::string(data() + pos + 1, tag_end - pos - 1).find(quote);
+            if (value_end == std::string::npos)
+                break;
+            std::string value(data() + pos + 1, value_end);
+            pos += value_end + 2;
+
+            if (attribute == "xmlns" || attribute.compare(0, 6, "xmlns:") == 0)
+                continue;
+
+            unit_update_attribute(unit, localName(attribute), attributeValue(convert(value)));
+        }
+        unit->read_header = true;
+
+        // body, for the lines of code
+        TextLOC text;
+        if (tag_end == end) {
+
+            unit_end_tag = "</" + name;
+            if (!count_body(offset, text)) {
+                done = true;
+                return false;
+            }
+        }
+        unit->loc = text.loc();
+
+        consume(offset);
+
+        return true;
+    }
+
+    done = true;
+
+    return false;
+}
+
+/**
+ * count_body
+ * @param offset start of the body, updated to after the end tag of the unit
+ * @param text text of the body so far
+ *
+ * Count the newlines and find the last character of the text of a unit
+ * body, up to the end tag of the unit. An escape element is a character.
+ *
+ * @returns if the end tag of the unit was found.
+ */
+bool srcml_header_scanner::count_body(size_t& offset, TextLOC& text) {
+
+    while (true) {
+
+        // keep the input bounded
+        if (offset > SCAN_KEEP_SIZE) {
+            consume(offset);
+            offset = 0;
+        }
+
+        size_t lt = find(offset, '<');
+        if (lt == std::string::npos || !fill(lt, unit_end_tag.size() + 1))
+            return false;
+
+        if (lt > offset) {
+            text.newlines += (int) std::count(data() + offset, data() + lt, '\n');
+            text.text = true;
+            text.last_newline = data()[lt - 1] == '\n';
+        }
+
+        size_t end = find_tag_end(lt);
+        if (end == std::string::npos)
+            return false;
+        offset = end + 1;
+
+        const char* tag = data() + lt;
+        if (tag[1] == '/') {
+
+            if (memcmp(tag, unit_end_tag.data(), unit_end_tag.size()) == 0
+                && (tag[unit_end_tag.size()] == '>' || isSpace(tag[unit_end_tag.size()])))
+                return true;
+
+            continue;
+        }
+
+        // escape elements are only in units, so a check of the name end is enough
+        size_t name_end = 1;
+        while (lt + name_end < end && !isSpace(tag[name_end]) && tag[name_end] != '/' && tag[name_end] != '>')
+            ++name_end;
+        if (name_end >= 7 && memcmp(tag + name_end - 6, "escape", 6) == 0 && (name_end == 7 || tag[name_end - 7] == ':')) {
+            text.text = true;
+            text.last_newline = false;
+        }
+    }
+}
+
+/**
+ * fill
+ * @param offset offset in the input
+ * @param size number of bytes needed
+ *
+ * @returns if size bytes are available from offset.
+ */
+bool srcml_header_scanner::fill(size_t offset, size_t size) {
+
+    while (this->size() < offset + size) {
+
+        if (!grow())
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * find
+ * @param offset offset to search from
+ * @param c character to find
+ *
+ * @returns the offset of the character, or std::string::npos if not found.
+ */
+size_t srcml_header_scanner::find(size_t offset, char c) {
+
+    while (true) {
+
+        if (offset < size()) {
+
+            const void* found = memchr(data() + offset, c, size() - offset);
+            if (found)
+                return (size_t) ((const char*) found - data());
+
+            offset = size();
+        }
+
+        if (!grow())
+            return std::string::npos;
+    }
+}
+
+/**
+ * find_tag_end
+ * @param offset start of the tag
+ *
+ * Comments end with "-->", and values of attributes can have a '>'.
+ *
+ * @returns the offset of the '>' that ends the tag, or std::string::npos if not found.
+ */
+size_t srcml_header_scanner::find_tag_end(size_t offset) {
+
+    if (!fill(offset, 4))
+        return std::string::npos;
+
+    if (memcmp(data() + offset, "<!--", 4) == 0) {
+
+        for (size_t end = offset + 4; (end = find(end, '>')) != std::string::npos; ++end)
+            if (data()[end - 1] == '-' && data()[end - 2] == '-')
+                return end;
+
+        return std::string::npos;
+    }
+
+    // most tags have no quotes before the first '>'
+    size_t end = find(offset + 1, '>');
+    if (end == std::string::npos)
+        return std::string::npos;
+
+    const char* tag = data() + offset;
+    if (!memchr(tag, '"', end - offset) && !memchr(tag, '\'', end - offset))
+        return end;
+
+    char quote = 0;
+    for (size_t pos = offset + 1; pos < size() || fill(pos, 1); ++pos) {
+
+        char c = data()[pos];
+        if (quote) {
+            if (c == quote)
+                quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '>') {
+            return pos;
+        }
+    }
+
+    return std::string::npos;
+}
+
+/**
+ * tag_name
+ * @param offset start of the tag
+ *
+ * @returns the qualified name of the tag.
+ */
+std::string srcml_header_scanner::tag_name(size_t offset) {
+
+    size_t end = offset + 1;
+    while (fill(end, 1) && !isSpace(data()[end]) && data()[end] != '/' && data()[end] != '>')
+        ++end;
+
+    return std::string(data() + offset + 1, end - offset - 1);
+}
+
+/**
+ * grow
+ *
+ * Read more of the input into the buffer.
+ *
+ * @returns if there was more input.
+ */
+bool srcml_header_scanner::grow() {
+
+    int status = xmlParserInputBufferGrow(input, SCAN_READ_SIZE);
+    refresh();
+
+    return status > 0;
+}
+
+/**
+ * consume
+ * @param offset end of the input no longer needed
+ *
+ * Discard the input before offset.
+ */
+void srcml_header_scanner::consume(size_t offset) {
+
+    xmlBufShrink(input->buffer, offset);
+    refresh();
+}
+
+/**
+ * refresh
+ *
+ * Update the content after a change to the input buffer.
+ */
+void srcml_header_scanner::refresh() {
+
+    content = (const char*) xmlBufContent(input->buffer);
+    content_size = xmlBufUse(input->buffer);
+}
@@ -0,0 +1,135 @@
+/**
+ * @file srcml_header_scanner.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SRCML_HEADER_SCANNER_HPP
+#define SRCML_HEADER_SCANNER_HPP
+
+#include <libxml/xmlIO.h>
+#include <libxml/encoding.h>
+
+#include <string>
+
+struct srcml_unit;
+
+/**
+ * srcml_header_scanner
+ *
+ * Reads the unit headers of a srcML archive from the decoded
+ * input by scanning the bytes for tags, instead of parsing.
+ * Unit bodies are skipped, only counting their lines of code,
+ * and are not checked to be well-formed.
+ *
+ * The root and the start tag of the first unit are parsed by
+ * libxml2, up to the size given by prefix_size(), and the scanner
+ * continues with the rest of the input.
+ */
+class srcml_header_scanner {
+
+public :
+
+    // constructors
+    srcml_header_scanner(xmlParserInputBufferPtr input);
+
+    // destructors
+    ~srcml_header_scanner();
+
+    // encoding of an input that is not decoded
+    bool set_encoding(const char* encoding);
+
+    // size of the input through the start tag of the first element in the root
+    size_t prefix_size();
+
+    // skip the rest of the unit started in the prefix, or the next unit
+    int skip_body();
+    bool next_unit(srcml_unit* unit);
+
+private :
+
+    /** lines of code of the text of a unit body */
+    struct TextLOC {
+
+        int newlines = 0;
+        bool text = false;
+        bool last_newline = false;
+
+        /** @returns the lines of code, the last line counted even without a newline */
+        int loc() const { return newlines + (text && !last_newline ? 1 : 0); }
+    };
+
+    // convert text of the input to UTF-8
+    std::string convert(const std::string& value);
+
+    // make at least size bytes available from offset, reading more of the input
+    bool fill(size_t offset, size_t size);
+
+    // find a character from offset, reading more of the input, npos if not found
+    size_t find(size_t offset, char c);
+
+    // find the end of the tag that starts at offset, npos if not found
+    size_t find_tag_end(size_t offset);
+
+    // qualified name of the tag at offset
+    std::string tag_name(size_t offset);
+
+    // count the text in the body of a unit up to its end tag
+    bool count_body(size_t& offset, TextLOC& text);
+
+    // read more of the input
+    bool grow();
+
+    // update the content after a change to the input buffer
+    void refresh();
+
+    // discard the input before offset
+    void consume(size_t offset);
+
+    /** @returns the current content of the input */
+    const char* data() const { return content; }
+
+    /** @returns the size of the current content of the input */
+    size_t size() const { return content_size; }
+
+    /** decoded input */
+    xmlParserInputBufferPtr input;
+
+    /** content of the input buffer, updated as it grows and is consumed */
+    const char* content = nullptr;
+    size_t content_size = 0;
+
+    /** converter of attribute values to UTF-8, when the input is not decoded */
+    xmlCharEncodingHandlerPtr encoder = nullptr;
+
+    /** end tag of the unit being scanned */
+    std::string unit_end_tag;
+
+    /** text of the unit in the prefix */
+    TextLOC prefix_text;
+
+    /** unit started in the prefix whose body is not yet skipped */
+    bool prefix_unit = false;
+
+    /** archive with units in the root, instead of a single unit */
+    bool is_archive = false;
+
+    /** end of the input or the root */
+    bool done = false;
+};
+
+#endif
@@ -0,0 +1,602 @@
+/**
+ * @file srcml_merge_input.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <srcml_merge_input.hpp>
+#include <srcml_translator.hpp>
+#include <srcmlns.hpp>
+
+#include <libxml/encoding.h>
+#include <libxml/tree.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+    /** size of each read of the input */
+    const int MERGE_READ_SIZE = 256 * 1024;
+
+    /** input already written that is kept before it is discarded */
+    const size_t MERGE_KEEP_SIZE = 1024 * 1024;
+
+    /** part of a unit scanned before it is written to the output */
+    const size_t MERGE_WRITE_SIZE = 1024 * 1024;
+
+    bool isSpace(char c) {
+
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    // local name of a qualified name
+    std::string localName(const std::string& name) {
+
+        size_t colon = name.find(':');
+
+        return colon == std::string::npos ? name : name.substr(colon + 1);
+    }
+
+    // append a character as UTF-8
+    void appendUTF8(std::string& value, unsigned long c) {
+
+        if (c < 0x80) {
+            value += (char) c;
+        } else if (c < 0x800) {
+            value += (char) (0xC0 | (c >> 6));
+            value += (char) (0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            value += (char) (0xE0 | (c >> 12));
+            value += (char) (0x80 | ((c >> 6) & 0x3F));
+            value += (char) (0x80 | (c & 0x3F));
+        } else {
+            value += (char) (0xF0 | (c >> 18));
+            value += (char) (0x80 | ((c >> 12) & 0x3F));
+            value += (char) (0x80 | ((c >> 6) & 0x3F));
+            value += (char) (0x80 | (c & 0x3F));
+        }
+    }
+
+    /**
+     * unescape
+     * @param raw the attribute value as in the start tag, without quotes
+     *
+     * @returns the value of the attribute with entity and character references replaced.
+     */
+    std::string unescape(const std::string& raw) {
+
+        std::string value;
+        for (size_t i = 0; i < raw.size(); ++i) {
+
+            if (raw[i] != '&') {
+                value += raw[i];
+                continue;
+            }
+
+            size_t semicolon = raw.find(';', i);
+            if (semicolon == std::string::npos) {
+                value += raw.substr(i);
+                break;
+            }
+
+            std::string entity = raw.substr(i + 1, semicolon - i - 1);
+            if (entity == "lt")
+                value += '<';
+            else if (entity == "gt")
+                value += '>';
+            else if (entity == "amp")
+                value += '&';
+            else if (entity == "quot")
+                value += '"';
+            else if (entity == "apos")
+                value += '\'';
+            else if (entity.size() > 2 && entity[0] == '#' && entity[1] == 'x')
+                appendUTF8(value, strtoul(entity.c_str() + 2, nullptr, 16));
+            else if (entity.size() > 1 && entity[0] == '#')
+                appendUTF8(value, strtoul(entity.c_str() + 1, nullptr, 10));
+            else
+                value += raw.substr(i, semicolon - i + 1);
+
+            i = semicolon;
+        }
+
+        return value;
+    }
+
+    /**
+     * parseAttributes
+     * @param tag the start tag
+     * @param size the size of the start tag
+     *
+     * @returns the attributes of the start tag, including namespace declarations.
+     */
+    std::vector<srcml_merge_input::Attribute> parseAttributes(const char* tag, size_t size) {
+
+        size_t tag_end = size >= 2 && tag[size - 2] == '/' ? size - 2 : size - 1;
+
+        // skip the name of the tag
+        size_t pos = 1;
+        while (pos < tag_end && !isSpace(tag[pos]))
+            ++pos;
+
+        std::vector<srcml_merge_input::Attribute> attributes;
+        while (true) {
+
+            while (pos < tag_end && isSpace(tag[pos]))
+                ++pos;
+            if (pos >= tag_end)
+                break;
+
+            size_t name_start = pos;
+            while (pos < tag_end && tag[pos] != '=' && !isSpace(tag[pos]))
+                ++pos;
+            std::string name(tag + name_start, pos - name_start);
+
+            while (pos < tag_end && (isSpace(tag[pos]) || tag[pos] == '='))
+                ++pos;
+            if (pos >= tag_end)
+                break;
+
+            const char* value_end = (const char*) memchr(tag + pos + 1, tag[pos], tag_end - pos - 1);
+            if (!value_end)
+                break;
+            size_t end = (size_t) (value_end - tag) + 1;
+
+            std::string raw(tag + pos, end - pos);
+            attributes.push_back({ name, raw, unescape(raw.substr(1, raw.size() - 2)) });
+            pos = end;
+        }
+
+        return attributes;
+    }
+}
+
+/**
+ * open
+ * @param filename name of a srcML file, possibly compressed
+ *
+ * Open the input. An input in an encoding other than UTF-8 is opened
+ * again, decoded to UTF-8 as it is read.
+ *
+ * @returns the input, or NULL if it can not be opened or its encoding is not supported.
+ */
+srcml_merge_input* srcml_merge_input::open(const char* filename) {
+
+    xmlParserInputBufferPtr input = xmlParserInputBufferCreateFilename(filename, XML_CHAR_ENCODING_NONE);
+    if (!input)
+        return nullptr;
+
+    std::unique_ptr<srcml_merge_input> merge_input(new srcml_merge_input(input));
+
+    // encoding from a byte order mark, or from the XML declaration
+    xmlCharEncoding encoding = XML_CHAR_ENCODING_NONE;
+    if (merge_input->fill(0, 4))
+        encoding = xmlDetectCharEncoding((const xmlChar*) merge_input->data(), 4);
+
+    if ((encoding == XML_CHAR_ENCODING_NONE || encoding == XML_CHAR_ENCODING_UTF8) && merge_input->fill(0, 5)
+        && memcmp(merge_input->data(), "<?xml", 5) == 0) {
+
+        size_t end = merge_input->find_tag_end(0);
+        if (end == std::string::npos)
+            return nullptr;
+
+        for (const auto& attribute : parseAttributes(merge_input->data(), end + 1)) {
+
+            if (attribute.name == "encoding")
+                encoding = xmlParseCharEncoding(attribute.value.c_str());
+        }
+    }
+
+    if (encoding == XML_CHAR_ENCODING_ERROR)
+        return nullptr;
+
+    if (encoding != XML_CHAR_ENCODING_NONE && encoding != XML_CHAR_ENCODING_UTF8 && encoding != XML_CHAR_ENCODING_ASCII) {
+
+        merge_input.reset();
+
+        input = xmlParserInputBufferCreateFilename(filename, encoding);
+        if (!input)
+            return nullptr;
+
+        merge_input.reset(new srcml_merge_input(input));
+    }
+
+    // byte order mark of UTF-8
+    if (merge_input->fill(0, 3) && memcmp(merge_input->data(), "\xEF\xBB\xBF", 3) == 0)
+        merge_input->consume(3);
+
+    return merge_input.release();
+}
+
+/**
+ * srcml_merge_input
+ * @param input the input, which the merge input takes ownership of
+ *
+ * Construct a merge input.
+ */
+srcml_merge_input::srcml_merge_input(xmlParserInputBufferPtr input)
+    : input(input) {
+
+    refresh();
+}
+
+/**
+ * ~srcml_merge_input
+ *
+ * Destructor.
+ */
+srcml_merge_input::~srcml_merge_input() {
+
+    xmlFreeParserInputBuffer(input);
+}
+
+/**
+ * read_root
+ *
+ * Read the namespaces and attributes of the root start tag. A root
+ * with a language attribute is a single unit, otherwise it is an
+ * archive, and the macro-list elements before its first unit are read.
+ *
+ * @returns if the root start tag was read.
+ */
+bool srcml_merge_input::read_root() {
+
+    // XML declaration, comments, and processing instructions before the root
+    size_t offset = 0;
+    while (true) {
+
+        offset = find(offset, '<');
+        if (offset == std::string::npos || !fill(offset, 2))
+            return false;
+
+        if (data()[offset + 1] != '?' && data()[offset + 1] != '!')
+            break;
+
+        offset = find_tag_end(offset);
+        if (offset == std::string::npos)
+            return false;
+        ++offset;
+    }
+
+    root_name = tag_name(offset);
+    size_t end = find_tag_end(offset);
+    if (localName(root_name) != "unit" || end == std::string::npos)
+        return false;
+    empty_root = data()[end - 1] == '/';
+
+    is_archive = true;
+    for (auto& attribute : parseAttributes(data() + offset, end + 1 - offset)) {
+
+        if (attribute.name == "xmlns" || attribute.name.compare(0, 6, "xmlns:") == 0) {
+
+            namespaces.emplace_back(attribute.name.size() > 6 ? attribute.name.substr(6) : "", attribute.value);
+            srcml_uri_normalize(namespaces.back().second);
+            continue;
+        }
+
+        if (localName(attribute.name) == "language")
+            is_archive = false;
+
+        attributes.push_back(attribute);
+    }
+    offset = end + 1;
+
+    // macro-list elements of an archive, before its first unit
+    while (is_archive && !empty_root) {
+
+        size_t lt = find(offset, '<');
+        if (lt == std::string::npos || !fill(lt, 2))
+            return false;
+
+        if (data()[lt + 1] == '/' || data()[lt + 1] == '!' || data()[lt + 1] == '?' || localName(tag_name(lt)) != "macro-list")
+            break;
+
+        end = find_tag_end(lt);
+        if (end == std::string::npos)
+            return false;
+
+        std::string token;
+        std::string type;
+        for (const auto& attribute : parseAttributes(data() + lt, end + 1 - lt)) {
+
+            if (attribute.name == "token")
+                token = attribute.value;
+            else if (attribute.name == "type")
+                type = attribute.value;
+        }
+
+        if (!token.empty() && !type.empty()) {
+
+            macro_list.push_back(token);
+            macro_list.push_back(type);
+        }
+
+        offset = end + 1;
+    }
+
+    consume(offset);
+
+    return true;
+}
+
+/**
+ * write_units
+ * @param translator the translator of the output archive
+ * @param root_uris URIs of the namespaces declared on the root of the output
+ *
+ * Write each unit of an archive as is. The start tag of a single unit
+ * is written without the namespace declarations of the output root,
+ * and without the url and options attributes, which only belong on
+ * the root. Only whitespace, comments, and processing instructions are
+ * allowed between the units of an archive.
+ *
+ * @returns if the units through the end of the root were written.
+ */
+bool srcml_merge_input::write_units(srcml_translator& translator, const std::vector<std::string>& root_uris) {
+
+    if (!is_archive) {
+
+        std::string start_tag = "<" + root_name;
+        for (const auto& ns : namespaces) {
+
+            if (std::find(root_uris.begin(), root_uris.end(), ns.second) == root_uris.end())
+                start_tag += " xmlns" + (ns.first.empty() ? "" : ":" + ns.first) + "=\"" + ns.second + "\"";
+        }
+        for (const auto& attribute : attributes) {
+
+            if (attribute.name != "url" && attribute.name != "options")
+                start_tag += " " + attribute.name + "=" + attribute.raw;
+        }
+        start_tag += empty_root ? "/>" : ">";
+
+        if (!translator.add_raw_unit() || !translator.add_raw(start_tag.c_str(), start_tag.size()))
+            return false;
+
+        size_t offset = 0;
+
+        return empty_root || write_unit(translator, 0, offset, "</" + root_name);
+    }
+
+    if (empty_root)
+        return true;
+
+    size_t offset = 0;
+    while (true) {
+
+        // keep the input bounded
+        if (offset > MERGE_KEEP_SIZE) {
+            consume(offset);
+            offset = 0;
+        }
+
+        size_t lt = find(offset, '<');
+        if (lt == std::string::npos || !fill(lt, 2))
+            return false;
+
+        if (std::find_if(data() + offset, data() + lt, [](char c) { return !isSpace(c); }) != data() + lt)
+            return false;
+
+        size_t end = find_tag_end(lt);
+        if (end == std::string::npos)
+            return false;
+
+        // end of the root
+        if (data()[lt + 1] == '/')
+            return tag_name(lt) == "/" + root_name;
+
+        offset = end + 1;
+        if (data()[lt + 1] == '!' || data()[lt + 1] == '?')
+            continue;
+
+        if (localName(tag_name(lt)) != "unit" || !translator.add_raw_unit())
+            return false;
+
+        if (data()[end - 1] == '/') {
+
+            if (!translator.add_raw(data() + lt, offset - lt))
+                return false;
+
+        } else if (!write_unit(translator, lt, offset, "</" + tag_name(lt))) {
+
+            return false;
+        }
+    }
+}
+
+/**
+ * write_unit
+ * @param translator the translator of the output archive
+ * @param start start of the unit in the input
+ * @param offset start of the body of the unit, updated to after the end tag
+ * @param end_tag the start of the end tag of the unit
+ *
+ * Write the unit through its end tag, in parts for a large unit.
+ * Units are not nested, so the first end tag of a unit ends it.
+ *
+ * @returns if the end tag was found and the unit written.
+ */
+bool srcml_merge_input::write_unit(srcml_translator& translator, size_t start, size_t& offset, const std::string& end_tag) {
+
+    while (true) {
+
+        // keep the input bounded
+        if (offset - start > MERGE_WRITE_SIZE) {
+
+            if (!translator.add_raw(data() + start, offset - start))
+                return false;
+            consume(offset);
+            start = offset = 0;
+        }
+
+        size_t lt = find(offset, '<');
+        if (lt == std::string::npos || !fill(lt, end_tag.size() + 1))
+            return false;
+        offset = lt + 1;
+
+        const char* tag = data() + lt;
+        if (memcmp(tag, end_tag.data(), end_tag.size()) != 0
+            || (tag[end_tag.size()] != '>' && !isSpace(tag[end_tag.size()])))
+            continue;
+
+        offset = find(lt, '>');
+        if (offset == std::string::npos)
+            return false;
+        ++offset;
+
+        return translator.add_raw(data() + start, offset - start);
+    }
+}
+
+/**
+ * fill
+ * @param offset offset in the input
+ * @param size number of bytes needed
+ *
+ * @returns if size bytes are available from offset.
+ */
+bool srcml_merge_input::fill(size_t offset, size_t size) {
+
+    while (this->size() < offset + size) {
+
+        if (!grow())
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * find
+ * @param offset offset to search from
+ * @param c character to find
+ *
+ * @returns the offset of the character, or std::string::npos if not found.
+ */
+size_t srcml_merge_input::find(size_t offset, char c) {
+
+    while (true) {
+
+        if (offset < size()) {
+
+            const void* found = memchr(data() + offset, c, size() - offset);
+            if (found)
+                return (size_t) ((const char*) found - data());
+
+            offset = size();
+        }
+
+        if (!grow())
+            return std::string::npos;
+    }
+}
+
+/**
+ * find_tag_end
+ * @param offset start of the tag
+ *
+ * Comments end with "-->", and values of attributes can have a '>'.
+ *
+ * @returns the offset of the '>' that ends the tag, or std::string::npos if not found.
+ */
+size_t srcml_merge_input::find_tag_end(size_t offset) {
+
+    if (!fill(offset, 2))
+        return std::string::npos;
+
+    if (fill(offset, 4) && memcmp(data() + offset, "<!--", 4) == 0) {
+
+        for (size_t end = offset + 4; (end = find(end, '>')) != std::string::npos; ++end)
+            if (data()[end - 1] == '-' && data()[end - 2] == '-')
+                return end;
+
+        return std::string::npos;
+    }
+
+    // skip the values of attributes before each '>'
+    size_t pos = offset + 1;
+    while (true) {
+
+        size_t end = find(pos, '>');
+        if (end == std::string::npos)
+            return std::string::npos;
+
+        const char* quote = std::find_if(data() + pos, data() + end, [](char c) { return c == '"' || c == '\''; });
+        if (quote == data() + end)
+            return end;
+
+        pos = find((size_t) (quote - data()) + 1, *quote);
+        if (pos == std::string::npos)
+            return std::string::npos;
+        ++pos;
+    }
+}
+
+/**
+ * tag_name
+ * @param offset start of the tag
+ *
+ * @returns the qualified name of the tag.
+ */
+std::string srcml_merge_input::tag_name(size_t offset) {
+
+    size_t end = offset + 1;
+    while (fill(end, 1) && !isSpace(data()[end]) && (data()[end] != '/' || end == offset + 1) && data()[end] != '>')
+        ++end;
+
+    return std::string(data() + offset + 1, end - offset - 1);
+}
+
+/**
+ * grow
+ *
+ * Read more of the input into the buffer.
+ *
+ * @returns if there was more input.
+ */
+bool srcml_merge_input::grow() {
+
+    int status = xmlParserInputBufferGrow(input, MERGE_READ_SIZE);
+    refresh();
+
+    return status > 0;
+}
+
+/**
+ * consume
+ * @param offset end of the input no longer needed
+ *
+ * Discard the input before offset.
+ */
+void srcml_merge_input::consume(size_t offset) {
+
+    xmlBufShrink(input->buffer, offset);
+    refresh();
+}
+
+/**
+ * refresh
+ *
+ * Update the content after a change to the input buffer.
+ */
+void srcml_merge_input::refresh() {
+
+    content = (const char*) xmlBufContent(input->buffer);
+    content_size = xmlBufUse(input->buffer);
+}
@@ -0,0 +1,130 @@
+/**
+ * @file srcml_merge_input.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SRCML_MERGE_INPUT_HPP
+#define SRCML_MERGE_INPUT_HPP
+
+#include <libxml/xmlIO.h>
+
+#include <string>
+#include <vector>
+#include <utility>
+
+class srcml_translator;
+
+/**
+ * srcml_merge_input
+ *
+ * An input srcML archive, or single unit, of a merge. Only the root
+ * start tag is parsed. The units are found by scanning for their
+ * start and end tags, and their bytes are written to the output
+ * unchanged. Unit bodies are not checked to be well-formed.
+ */
+class srcml_merge_input {
+
+public :
+
+    /** an attribute of the root start tag */
+    struct Attribute {
+
+        /** qualified name */
+        std::string name;
+
+        /** value as in the start tag */
+        std::string raw;
+
+        /** value with references replaced */
+        std::string value;
+    };
+
+    // open an input, decoded to UTF-8 when needed
+    static srcml_merge_input* open(const char* filename);
+
+    // destructors
+    ~srcml_merge_input();
+
+    // read through the root start tag, and any macro-list elements of an archive
+    bool read_root();
+
+    // write the units to the translator, through the end of the root
+    bool write_units(srcml_translator& translator, const std::vector<std::string>& root_uris);
+
+    /** qualified name of the root */
+    std::string root_name;
+
+    /** namespace declarations of the root as prefix and URI, with the URI normalized */
+    std::vector<std::pair<std::string, std::string>> namespaces;
+
+    /** attributes of the root */
+    std::vector<Attribute> attributes;
+
+    /** token and type of each macro-list element */
+    std::vector<std::string> macro_list;
+
+    /** archive with units in the root, instead of a single unit */
+    bool is_archive = false;
+
+private :
+
+    // constructors
+    srcml_merge_input(xmlParserInputBufferPtr input);
+
+    // stream the unit from its start tag through its end tag
+    bool write_unit(srcml_translator& translator, size_t start, size_t& offset, const std::string& end_tag);
+
+    // make at least size bytes available from offset, reading more of the input
+    bool fill(size_t offset, size_t size);
+
+    // find a character from offset, reading more of the input, npos if not found
+    size_t find(size_t offset, char c);
+
+    // find the end of the tag that starts at offset, npos if not found
+    size_t find_tag_end(size_t offset);
+
+    // qualified name of the tag at offset
+    std::string tag_name(size_t offset);
+
+    // read more of the input
+    bool grow();
+
+    // update the content after a change to the input buffer
+    void refresh();
+
+    // discard the input before offset
+    void consume(size_t offset);
+
+    /** @returns the current content of the input */
+    const char* data() const { return content; }
+
+    /** @returns the size of the current content of the input */
+    size_t size() const { return content_size; }
+
+    /** decoded input */
+    xmlParserInputBufferPtr input;
+
+    /** content of the input buffer, updated as it grows and is consumed */
+    const char* content = nullptr;
+    size_t content_size = 0;
+
+    /** root with nothing in it */
+    bool empty_root = false;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * @file srcml_mmap_input.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <srcml_mmap_input.hpp>
+
+#if !defined(_MSC_BUILD) && !defined(__MINGW32__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SRCML_MMAP_INPUT
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+#ifdef SRCML_MMAP_INPUT
+
+    // read callback for the input buffer, for any part of the mapping not given directly to the parser
+    int mmapInputRead(void* context, char* buffer, int len) {
+
+        auto mapped = (srcml_mapped_input*) context;
+
+        size_t size = std::min(mapped->size - mapped->position, (size_t) len);
+        memcpy(buffer, mapped->data + mapped->position, size);
+        mapped->position += size;
+
+        return (int) size;
+    }
+
+    // close callback for the input buffer
+    int mmapInputClose(void* context) {
+
+        auto mapped = (srcml_mapped_input*) context;
+
+        munmap((void*) mapped->data, mapped->size);
+        delete mapped;
+
+        return 0;
+    }
+
+#endif
+}
+
+/**
+ * srcml_mmap_input_create
+ * @param filename name of a srcML file
+ * @param encoding the encoding of the input, given by the caller
+ *
+ * Create an input buffer of a regular, uncompressed file mapped into memory.
+ * An input that is decoded by the buffer, with an encoding given by the caller,
+ * is not mapped, since libxml2 does not parse the mapped bytes.
+ *
+ * @returns the input buffer, or NULL if the file is not mapped.
+ */
+xmlParserInputBufferPtr srcml_mmap_input_create(const char* filename, xmlCharEncoding encoding) {
+
+#ifdef SRCML_MMAP_INPUT
+
+    if (filename == nullptr || encoding != XML_CHAR_ENCODING_NONE)
+        return nullptr;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void* data = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    // compressed files are left to libxml2, so only an XML document, with an optional BOM, is mapped
+    const char* start = (const char*) data;
+    size_t bom = st.st_size >= 3 && memcmp(start, "\xEF\xBB\xBF", 3) == 0 ? 3 : 0;
+    if ((size_t) st.st_size == bom || !strchr("< \t\r\n", start[bom])) {
+        munmap(data, (size_t) st.st_size);
+        return nullptr;
+    }
+
+    madvise(data, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+    auto mapped = new srcml_mapped_input;
+    mapped->data = start;
+    mapped->size = (size_t) st.st_size;
+
+    xmlParserInputBufferPtr input = xmlParserInputBufferCreateIO(mmapInputRead, mmapInputClose, mapped, XML_CHAR_ENCODING_NONE);
+    if (input == nullptr)
+        mmapInputClose(mapped);
+
+    return input;
+
+#else
+
+    (void) filename;
+    (void) encoding;
+
+    return nullptr;
+
+#endif
+}
+
+/**
+ * srcml_mmap_input_mapping
+ * @param input a parser input buffer
+ *
+ * @returns the mapping of an input buffer created by srcml_mmap_input_create, or NULL for any other input.
+ */
+srcml_mapped_input* srcml_mmap_input_mapping(xmlParserInputBufferPtr input) {
+
+#ifdef SRCML_MMAP_INPUT
+
+    if (input && input->closecallback == mmapInputClose)
+        return (srcml_mapped_input*) input->context;
+
+#else
+
+    (void) input;
+
+#endif
+
+    return nullptr;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file srcml_mmap_input.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SRCML_MMAP_INPUT_HPP
+#define SRCML_MMAP_INPUT_HPP
+
+#include <libxml/xmlIO.h>
+#include <libxml/encoding.h>
+
+#include <cstddef>
+
+/**
+ * srcml_mapped_input
+ *
+ * A file mapped into memory, the position of the next
+ * byte of it to read, and the number of bytes of it given
+ * to the parser, for the offsets of the units.
+ */
+struct srcml_mapped_input {
+
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t position = 0;
+    size_t parsed = 0;
+};
+
+/**
+ * srcml_mmap_input_create
+ * @param filename name of a srcML file
+ * @param encoding the encoding of the input, given by the caller
+ *
+ * Create an input buffer of a regular, uncompressed file mapped into memory.
+ * The srcSAX parser gives the mapping directly to libxml2, instead of reading
+ * it into the buffer.
+ *
+ * @returns the input buffer, or NULL if the file cannot be mapped, e.g., it is not a regular
+ * file or is compressed, or if an encoding is given.
+ */
+xmlParserInputBufferPtr srcml_mmap_input_create(const char* filename, xmlCharEncoding encoding);
+
+/**
+ * srcml_mmap_input_mapping
+ * @param input a parser input buffer
+ *
+ * @returns the mapping of an input buffer created by srcml_mmap_input_create, or NULL for any other input.
+ */
+srcml_mapped_input* srcml_mmap_input_mapping(xmlParserInputBufferPtr input);
+
+#endif
@@ -0,0 +1,560 @@
+/**
+ * @file srcml_parallel_reader.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <srcml_parallel_reader.hpp>
+#include <srcml_sax2_reader.hpp>
+#include <srcml_unit_index.hpp>
+#include <srcml_types.hpp>
+#include <libxml2_utilities.hpp>
+#include <srcml.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <new>
+
+namespace {
+
+    /** smallest partition, so that small archives are parsed in a single thread */
+    const uint64_t MIN_PARTITION_SIZE = 256 * 1024;
+
+    /** largest partition, to bound the memory of the units of a partition, which is
+        many times the size of their srcML for small units */
+    const uint64_t MAX_PARTITION_SIZE = 512 * 1024;
+
+    /** largest size of the srcML of the partitions parsed ahead of the one read */
+    const uint64_t MAX_AHEAD_SIZE = 2 * 1024 * 1024;
+
+    /** size of the blocks the archive is scanned in */
+    const size_t SCAN_BLOCK_SIZE = 64 * 1024;
+
+    /**
+     * findStartTag
+     * @param in stream of the archive
+     * @param from offset to scan from
+     * @param tag the start of the start tag, e.g., "<unit"
+     *
+     * Find the next start tag with the name. A '<' is always escaped in the
+     * text and attributes of srcML, so a match is a start tag, except inside
+     * comments, processing instructions, or CDATA. A partition that ends in
+     * one of these does not parse, and is read again sequentially.
+     *
+     * @returns the offset of the start tag, or 0 if there is none.
+     */
+    uint64_t findStartTag(std::ifstream& in, uint64_t from, const std::string& tag) {
+
+        in.clear();
+        in.seekg((std::streamoff) from);
+
+        // blocks overlap by the tag and the character after it
+        std::string block(SCAN_BLOCK_SIZE + tag.size() + 1, '\0');
+        size_t carry = 0;
+        uint64_t block_offset = from;
+        while (true) {
+
+            in.read(&block[carry], (std::streamsize) (block.size() - carry));
+            size_t size = carry + (size_t) in.gcount();
+            if (size <= tag.size())
+                return 0;
+
+            for (size_t pos = 0; (pos = block.find(tag, pos)) != std::string::npos && pos + tag.size() < size; ++pos) {
+
+                char next = block[pos + tag.size()];
+                if (next == ' ' || next == '>' || next == '/' || next == '\n' || next == '\t' || next == '\r')
+                    return block_offset + pos;
+            }
+
+            if (!in)
+                return 0;
+
+            carry = tag.size();
+            std::memmove(&block[0], &block[size - carry], carry);
+            block_offset += size - carry;
+        }
+    }
+
+    /**
+     * PartitionInput
+     *
+     * Input of the start of an archive, a range of the archive, and the root end tag.
+     */
+    struct PartitionInput {
+
+        std::ifstream in;
+        std::string prefix;
+        size_t prefix_position = 0;
+        uint64_t remaining = 0;
+        std::string suffix;
+        size_t suffix_position = 0;
+    };
+
+    int partition_input_read(void* context, char* buffer, int len) {
+
+        auto input = static_cast<PartitionInput*>(context);
+
+        if (input->prefix_position < input->prefix.size()) {
+
+            size_t size = std::min((size_t) len, input->prefix.size() - input->prefix_position);
+            memcpy(buffer, input->prefix.data() + input->prefix_position, size);
+            input->prefix_position += size;
+
+            return (int) size;
+        }
+
+        if (input->remaining) {
+
+            input->in.read(buffer, (std::streamsize) std::min((uint64_t) len, input->remaining));
+            if (input->in.bad() || input->in.gcount() == 0)
+                return -1;
+
+            input->remaining -= (uint64_t) input->in.gcount();
+
+            return (int) input->in.gcount();
+        }
+
+        size_t size = std::min((size_t) len, input->suffix.size() - input->suffix_position);
+        memcpy(buffer, input->suffix.data() + input->suffix_position, size);
+        input->suffix_position += size;
+
+        return (int) size;
+    }
+
+    int partition_input_close(void* context) {
+
+        delete static_cast<PartitionInput*>(context);
+
+        return 0;
+    }
+}
+
+/**
+ * srcml_partition_archive
+ * @param filename name of an uncompressed srcML archive
+ * @param index unit index of the archive, or NULL to scan for units
+ * @param num_threads number of threads the partitions are parsed with
+ *
+ * Partition an archive at unit start tags for parsing in parallel. There are a few
+ * partitions per thread, so that the threads stay busy, with a minimum and maximum size.
+ * The partition boundaries are from the index if there is one, otherwise the archive is
+ * scanned for the next unit start tag after each boundary.
+ *
+ * Only archives in an encoding where '<' is a single byte can be partitioned.
+ *
+ * @returns the partitions, or an empty pointer if the archive is too small or cannot be partitioned.
+ */
+std::shared_ptr<srcml_archive_partitions> srcml_partition_archive(const char* filename, const srcml_unit_index* index, int num_threads) {
+
+    if (filename == nullptr || num_threads < 2)
+        return nullptr;
+
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in)
+        return nullptr;
+    uint64_t size = (uint64_t) in.tellg();
+    if (size < 2 * MIN_PARTITION_SIZE)
+        return nullptr;
+
+    // the root start tag, after any XML declaration, comments, and processing instructions
+    std::string head(SCAN_BLOCK_SIZE, '\0');
+    in.seekg(0);
+    in.read(&head[0], (std::streamsize) head.size());
+    head.resize((size_t) in.gcount());
+
+    size_t pos = head.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+    while (true) {
+
+        pos = head.find_first_not_of(" \t\r\n", pos);
+        if (pos == std::string::npos || head[pos] != '<' || pos + 1 == head.size())
+            return nullptr;
+
+        if (head[pos + 1] != '?' && head[pos + 1] != '!')
+            break;
+
+        bool comment = head.compare(pos, 4, "<!--") == 0;
+        pos = comment ? head.find("-->", pos) : head.find('>', pos);
+        if (pos == std::string::npos)
+            return nullptr;
+        pos += comment ? 3 : 1;
+    }
+
+    size_t name_end = head.find_first_of(" \t\r\n/>", pos);
+    if (name_end == std::string::npos)
+        return nullptr;
+    std::string root_name = head.substr(pos + 1, name_end - pos - 1);
+    if (root_name != "unit" && (root_name.size() < 5 || root_name.compare(root_name.size() - 5, 5, ":unit") != 0))
+        return nullptr;
+
+    auto partitions = std::make_shared<srcml_archive_partitions>();
+    partitions->root_end_tag = "</" + root_name + ">\n";
+
+    // the first unit, which is the end of the start of the archive
+    std::string tag = "<" + root_name;
+    partitions->prefix_size = findStartTag(in, name_end, tag);
+    if (!partitions->prefix_size)
+        return nullptr;
+    partitions->offsets.push_back(partitions->prefix_size);
+
+    uint64_t num_partitions = std::max((uint64_t) num_threads * 4, size / MAX_PARTITION_SIZE);
+    num_partitions = std::min(num_partitions, size / MIN_PARTITION_SIZE);
+
+    for (uint64_t i = 1; i < num_partitions; ++i) {
+
+        uint64_t boundary = size / num_partitions * i;
+        if (boundary <= partitions->offsets.back())
+            continue;
+
+        uint64_t offset = 0;
+        if (index) {
+
+            // first indexed unit at or after the boundary
+            auto unit = std::lower_bound(index->units.begin(), index->units.end(), boundary,
+                [](const srcml_unit_index_entry& entry, uint64_t offset) { return entry.offset < offset; });
+            if (unit != index->units.end())
+                offset = unit->offset;
+
+        } else {
+
+            offset = findStartTag(in, boundary, tag);
+        }
+
+        if (!offset)
+            break;
+
+        partitions->offsets.push_back(offset);
+    }
+
+    if (partitions->size() < 2)
+        return nullptr;
+
+    return partitions;
+}
+
+/**
+ * srcml_partition_input_create
+ * @param filename name of a partitioned srcML archive
+ * @param partitions partitions of the archive
+ * @param partition the partition to read
+ * @param encoding the encoding of the archive
+ *
+ * Create an input buffer of a partition as a complete archive: the start of the
+ * archive, the partition, and the root end tag if not the last partition. The input
+ * of partition 0 is the archive from its start up to partition 1.
+ *
+ * @returns the input buffer, or NULL on failure.
+ */
+xmlParserInputBufferPtr srcml_partition_input_create(const char* filename, const srcml_archive_partitions& partitions,
+                                                     size_t partition, xmlCharEncoding encoding) {
+
+    if (filename == nullptr || partition >= partitions.size())
+        return nullptr;
+
+    std::unique_ptr<PartitionInput> input(new PartitionInput);
+    input->in.open(filename, std::ios::binary | std::ios::ate);
+    if (!input->in)
+        return nullptr;
+    uint64_t size = (uint64_t) input->in.tellg();
+    input->in.seekg(0);
+
+    uint64_t begin = partition == 0 ? 0 : partitions.offsets[partition];
+    uint64_t end = partition + 1 < partitions.size() ? partitions.offsets[partition + 1] : size;
+    if (begin > end || end > size)
+        return nullptr;
+
+    if (partition > 0) {
+
+        // the start of the archive, with the root start tag
+        input->prefix.resize((size_t) partitions.prefix_size);
+        if (!input->in.read(&input->prefix[0], (std::streamsize) input->prefix.size()))
+            return nullptr;
+
+        input->in.seekg((std::streamoff) begin);
+    }
+
+    input->remaining = end - begin;
+    if (partition + 1 < partitions.size())
+        input->suffix = partitions.root_end_tag;
+
+    xmlParserInputBufferPtr buffer_input = xmlParserInputBufferCreateIO(partition_input_read, partition_input_close, input.get(), encoding);
+    if (buffer_input != nullptr)
+        input.release();
+
+    return buffer_input;
+}
+
+/**
+ * srcml_parallel_reader
+ * @param archive the archive units are read for
+ * @param filename name of the partitioned archive
+ * @param partitions partitions of the archive
+ * @param num_threads number of threads to parse partitions with
+ * @param encoding the encoding of the archive
+ *
+ * Start parsing the partitions after the first, up to a window of
+ * partitions ahead of the one being read. The window is a partition
+ * per thread, within a limit on the size of the partitions ahead, and
+ * there is a worker per partition of the window.
+ */
+srcml_parallel_reader::srcml_parallel_reader(srcml_archive* archive, const char* filename, std::shared_ptr<const srcml_archive_partitions> partitions,
+                                             int num_threads, xmlCharEncoding encoding)
+    : archive(archive), settings(srcml_archive_clone(archive), srcml_archive_free), filename(filename),
+      partitions(partitions), encoding(encoding), sequential_archive(nullptr, srcml_archive_free) {
+
+    if (!settings)
+        throw std::bad_alloc();
+
+    uint64_t partition_size = std::max((uint64_t) 1, partitions->offsets.back() / partitions->size());
+    window = (size_t) std::max((uint64_t) 1, std::min((uint64_t) num_threads, MAX_AHEAD_SIZE / partition_size));
+
+    for (size_t i = 1; i < partitions->size(); ++i) {
+        jobs.push_back(std::make_shared<Partition>());
+        jobs.back()->partition = i;
+    }
+
+    try {
+
+        // more workers than the window would only wait
+        for (size_t i = 0; i < window; ++i)
+            workers.emplace_back(&srcml_parallel_reader::run, this);
+
+    } catch(...) {
+
+        stop();
+        throw;
+    }
+}
+
+/**
+ * ~srcml_parallel_reader
+ *
+ * Stops and joins the workers.
+ */
+srcml_parallel_reader::~srcml_parallel_reader() {
+
+    stop();
+}
+
+/**
+ * read
+ * @param unit location to store the unit
+ *
+ * Read the next unit of the partitions, in order. A partition with a parse
+ * error, e.g., from a boundary inside a comment, and the rest of the archive
+ * after it, are read sequentially instead.
+ *
+ * @returns 1 on success and 0 at the end of the input or on an error.
+ */
+int srcml_parallel_reader::read(srcml_unit* unit) {
+
+    if (sequential)
+        return read_sequential(unit);
+
+    while (!current || position == current->units.size()) {
+
+        if (consumed == jobs.size())
+            return 0;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            current = jobs[consumed];
+            done_cv.wait(lock, [this]{ return current->done; });
+
+            jobs[consumed].reset();
+            ++consumed;
+        }
+        job_cv.notify_all();
+
+        position = 0;
+
+        if (!current->ok) {
+
+            size_t partition = current->partition;
+            current.reset();
+
+            return read_sequential(partition, 0) ? read_sequential(unit) : 0;
+        }
+    }
+
+    *unit = std::move(*current->units[position]);
+    current->units[position].reset();
+    ++position;
+
+    return 1;
+}
+
+/**
+ * read_sequential
+ * @param partition the partition to start from
+ * @param num_skip number of units of the partition to skip
+ *
+ * Stop parsing in parallel, and read the archive from the partition on
+ * sequentially, after the units of it already read.
+ *
+ * @returns if the archive can be read from the partition.
+ */
+bool srcml_parallel_reader::read_sequential(size_t partition, size_t num_skip) {
+
+    stop();
+    jobs.clear();
+
+    sequential_archive.reset(srcml_archive_clone(settings.get()));
+    if (!sequential_archive)
+        return false;
+
+    // the partition is the last one, so its input continues to the end of the archive
+    srcml_archive_partitions rest = *partitions;
+    rest.offsets.resize(partition + 1);
+
+    std::unique_ptr<xmlParserInputBuffer> input(srcml_partition_input_create(filename.c_str(), rest, partition, encoding));
+    if (!input)
+        return false;
+
+    try {
+
+        sequential.reset(new srcml_sax2_reader(sequential_archive.get(), std::move(input)));
+
+        for (size_t i = 0; i < num_skip; ++i) {
+
+            srcml_unit skipped;
+            skipped.archive = sequential_archive.get();
+            if (!sequential->read_header(&skipped))
+                break;
+        }
+
+    } catch(...) {
+
+        sequential.reset();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * read_sequential
+ * @param unit location to store the unit
+ *
+ * Read the next unit sequentially.
+ *
+ * @returns 1 on success and 0 at the end of the input or on an error.
+ */
+int srcml_parallel_reader::read_sequential(srcml_unit* unit) {
+
+    unit->archive = sequential_archive.get();
+    int not_done = sequential->read(unit);
+    unit->archive = archive;
+
+    return not_done;
+}
+
+/**
+ * failed
+ *
+ * @returns if reading stopped on a parse error.
+ */
+bool srcml_parallel_reader::failed() const {
+
+    return sequential && sequential->failed();
+}
+
+/**
+ * run
+ *
+ * Worker thread, parsing the next partition within the window.
+ */
+void srcml_parallel_reader::run() {
+
+    while (true) {
+
+        std::shared_ptr<Partition> partition;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_cv.wait(lock, [this]{ return stopping || next_job == jobs.size() || next_job < consumed + window; });
+
+            if (stopping || next_job == jobs.size())
+                return;
+
+            partition = jobs[next_job];
+            ++next_job;
+        }
+
+        parse(*partition);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            partition->done = true;
+        }
+        done_cv.notify_all();
+    }
+}
+
+/**
+ * parse
+ * @param partition the partition to parse
+ *
+ * Parse the units of a partition, with its own archive for the root
+ * attributes and namespaces. The units are for the archive being read.
+ */
+void srcml_parallel_reader::parse(Partition& partition) {
+
+    std::unique_ptr<srcml_archive, void(*)(srcml_archive*)> partition_archive(srcml_archive_clone(settings.get()), srcml_archive_free);
+    if (!partition_archive)
+        return;
+
+    std::unique_ptr<xmlParserInputBuffer> input(srcml_partition_input_create(filename.c_str(), *partitions, partition.partition, encoding));
+    if (!input)
+        return;
+
+    try {
+
+        srcml_sax2_reader reader(partition_archive.get(), std::move(input));
+
+        while (true) {
+
+            std::unique_ptr<srcml_unit> unit(new srcml_unit);
+            unit->archive = partition_archive.get();
+            if (!reader.read(unit.get()))
+                break;
+
+            unit->archive = archive;
+            partition.units.push_back(std::move(unit));
+        }
+
+        partition.ok = !reader.failed();
+
+    } catch(...) {}
+}
+
+/**
+ * stop
+ *
+ * Stop and join the workers.
+ */
+void srcml_parallel_reader::stop() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_cv.notify_all();
+
+    for (auto& worker : workers)
+        if (worker.joinable())
+            worker.join();
+}
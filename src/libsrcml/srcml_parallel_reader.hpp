@@ -0,0 +1,171 @@
+/**
+ * @file srcml_parallel_reader.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SRCML_PARALLEL_READER_HPP
+#define SRCML_PARALLEL_READER_HPP
+
+#include <libxml/xmlIO.h>
+#include <libxml/encoding.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+struct srcml_archive;
+struct srcml_unit;
+struct srcml_unit_index;
+class srcml_sax2_reader;
+
+/**
+ * srcml_archive_partitions
+ *
+ * Partitions of a srcML archive file, each starting at the start tag of a unit.
+ * A partition is a complete archive once the start of the archive, up to the
+ * first unit, is put in front of it, and the root end tag after it.
+ */
+struct srcml_archive_partitions {
+
+    /** offset of the first unit, i.e., the size of the start of the archive */
+    uint64_t prefix_size = 0;
+
+    /** offset of the start of each partition, the last ends at the end of the file */
+    std::vector<uint64_t> offsets;
+
+    /** end tag of the root */
+    std::string root_end_tag;
+
+    /** @returns the number of partitions */
+    size_t size() const { return offsets.size(); }
+};
+
+/**
+ * srcml_partition_archive
+ * @param filename name of an uncompressed srcML archive
+ * @param index unit index of the archive, or NULL to scan for units
+ * @param num_threads number of threads the partitions are parsed with
+ *
+ * Partition an archive at unit start tags for parsing in parallel.
+ *
+ * @returns the partitions, or an empty pointer if the archive is too small or cannot be partitioned.
+ */
+std::shared_ptr<srcml_archive_partitions> srcml_partition_archive(const char* filename, const srcml_unit_index* index, int num_threads);
+
+/**
+ * srcml_partition_input_create
+ * @param filename name of a partitioned srcML archive
+ * @param partitions partitions of the archive
+ * @param partition the partition to read
+ * @param encoding the encoding of the archive
+ *
+ * Create an input buffer of a partition as a complete archive.
+ *
+ * @returns the input buffer, or NULL on failure.
+ */
+xmlParserInputBufferPtr srcml_partition_input_create(const char* filename, const srcml_archive_partitions& partitions,
+                                                     size_t partition, xmlCharEncoding encoding);
+
+/**
+ * srcml_parallel_reader
+ *
+ * Parses the partitions of an archive after the first one on a pool
+ * of threads, each with its own SAX parser, and reads their units in order.
+ * Partition 0, with the root, is parsed by the srcml_sax2_reader.
+ */
+class srcml_parallel_reader {
+
+public :
+
+    // constructors
+    srcml_parallel_reader(srcml_archive* archive, const char* filename, std::shared_ptr<const srcml_archive_partitions> partitions,
+                          int num_threads, xmlCharEncoding encoding);
+
+    // destructors
+    ~srcml_parallel_reader();
+
+    // reads the next unit of the partitions after the first
+    int read(srcml_unit* unit);
+
+    // reads the archive sequentially from a partition on, after the units of it already read
+    bool read_sequential(size_t partition, size_t num_skip);
+
+    // reports if reading stopped on a parse error
+    bool failed() const;
+
+private :
+
+    /** a partition and its units */
+    struct Partition {
+
+        size_t partition = 0;
+        std::vector<std::unique_ptr<srcml_unit>> units;
+        bool ok = false;
+        bool done = false;
+    };
+
+    // worker thread, parsing partitions in order
+    void run();
+
+    // parse all the units of a partition
+    void parse(Partition& partition);
+
+    // stop and join the workers
+    void stop();
+
+    // read the next unit sequentially
+    int read_sequential(srcml_unit* unit);
+
+    /** the archive units are read for */
+    srcml_archive* archive;
+
+    /** clone of the archive, with its settings, for the archives the partitions are parsed with */
+    std::unique_ptr<srcml_archive, void(*)(srcml_archive*)> settings;
+
+    std::string filename;
+    std::shared_ptr<const srcml_archive_partitions> partitions;
+    xmlCharEncoding encoding;
+
+    /** number of partitions parsed ahead of the one read */
+    size_t window = 1;
+
+    /** partitions in read order, guarded by mutex */
+    std::vector<std::shared_ptr<Partition>> jobs;
+    size_t next_job = 0;
+    size_t consumed = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable job_cv;
+    std::condition_variable done_cv;
+
+    std::vector<std::thread> workers;
+
+    /** the partition being read, and the position of its next unit */
+    std::shared_ptr<Partition> current;
+    size_t position = 0;
+
+    /** reader of the rest of the archive, once a partition did not parse */
+    std::unique_ptr<srcml_archive, void(*)(srcml_archive*)> sequential_archive;
+    std::unique_ptr<srcml_sax2_reader> sequential;
+};
+
+#endif
@@ -37,11 +37,12 @@
 #include <string>
 #include <vector>
 #include <stack>
+#include <deque>
+#include <memory>
+#include <functional>
 
 #include <cstring>
 
-#include <mutex>
-#include <condition_variable>
 #include <boost/optional.hpp>
 
 #define ATTR_LOCALNAME(pos) (pos * 5)
@@ -74,43 +75,35 @@ struct attribute_t {
  * srcml_reader_handler
  *
  * Inherits from srcMLHandler to provide hooks into
- * SAX2 parsing. Provides starting and stoping using
- * threads.  Collects attributes, namespaces and srcML
- * from units.
+ * SAX2 parsing. Collects attributes, namespaces and srcML
+ * from units. Parsing is in chunks in the reader's thread, so
+ * units parsed past the one asked for are queued until read.
  */
 class srcml_reader_handler : public srcSAXHandler {
 
 private :
 
-    /** mutex to halt both threads on */
-    std::mutex mutex;
-
-    /** sax stop/start condition */
-    std::condition_variable cond;
-
     /** collected root language */
     srcml_archive* archive = nullptr;
 
-    /** collected unit language */
-    srcml_unit* unit = nullptr;
+    /** unit currently being parsed */
+    std::unique_ptr<srcml_unit> current;
+
+    /** header of the current unit has already been read */
+    bool current_read = false;
+
+    /** parsed units not yet read, in order */
+    std::deque<std::unique_ptr<srcml_unit>> units;
 
     /** has reached end of parsing*/
     bool is_done = false;
     /** has passed root*/
     bool read_root = false;
-    /** stop after collecting unit attribute*/
-    bool collect_unit_header = false;
-    /** collect srcML as parse*/
-    bool collect_unit_body = false;
-
-    /** terminate */
-    bool terminate = false;
+    /** collect srcML of the next unit to start */
+    bool collect_unit_body = true;
 
-    /** indicate if we need to wait on the root */
-    bool wait_root = true;
-
-    /** skip internal unit elements */
-    bool skip = false;
+    /** output of the rest of the body of the current unit, streamed after its header was read, at the end of the unit */
+    std::function<void()> end_stream;
 
 public :
 
@@ -120,7 +113,7 @@ public :
     /**
      * srcml_reader_handler
      *
-     * Constructor.  Sets up mutex, conditions and state.
+     * Constructor.
      */
     srcml_reader_handler() {
     }
@@ -128,93 +121,39 @@ public :
     /**
      * ~srcml_reader_handler
      *
-     * Destructor, deletes mutex and conditions.
+     * Destructor.
      */
     ~srcml_reader_handler() {
      }
 
     /**
-     * stop_parser
+     * has_unit
      *
-     * Stop the parser for threading
+     * @returns if there is a unit whose header can be read without parsing further.
      */
-    void stop_parser() {
+    bool has_unit() const {
 
-        is_done = true;
-        srcSAXHandler::stop_parser();
+        return !units.empty() || (current && !current_read);
     }
 
     /**
-     * wait
+     * take_unit
+     * @param unit location to move the next unit to
      *
-     * Allows calling thread to wait until reached
-     * end of unit.
+     * Move the next unit to the caller. A unit still being parsed
+     * only has its header, and the rest of it is not collected.
      */
-    void wait() {
-
-        std::unique_lock<std::mutex> lock(mutex);
-
-        if (is_done)
-            return;
-
-        if (wait_root)
-            cond.wait(lock);
-    }
-
-    /**
-     * resume
-     *
-     * Resume SAX2 execution.
-     */
-    void resume() {
-
-        std::unique_lock<std::mutex> lock(mutex);
+    void take_unit(srcml_unit* unit) {
 
-        cond.notify_one();
-    }
-
-    /**
-     * resume_and_wait
-     *
-     * Atomic resume SAX2 execution then wait.
-     */
-    void resume_and_wait() {
+        if (!units.empty()) {
 
-        std::unique_lock<std::mutex> lock(mutex);
-        cond.notify_one();
-        if (is_done)
+            *unit = std::move(*units.front());
+            units.pop_front();
             return;
-
-        cond.wait(lock);
-    }
-
-    /**
-     * done
-     *
-     * Mark is done
-     */
-    void done() {
-
-        is_done = true;
-
-        cond.notify_one();
-    }
-
-    /**
-     * stop
-     *
-     * Stops SAX2 parsing Completely.  Parsing
-     * Can not be restarted.
-     */
-    void stop() {
-
-        {
-            std::unique_lock<std::mutex> lock(mutex);
-
-            terminate = true;
         }
 
-        resume();
+        *unit = std::move(*current);
+        current_read = true;
     }
 
 #pragma GCC diagnostic push
@@ -297,6 +236,8 @@ public :
                         archive->options |= SRCML_OPTION_CPP_MARKUP_IF0;
                     else if (option == "LINE")
                         archive->options |= SRCML_OPTION_LINE;
+                    else if (option == "POSITION_COMPACT")
+                        archive->options |= SRCML_OPTION_POSITION_COMPACT;
                 }
 
             } else if (attribute == "hash")
@@ -334,8 +275,7 @@ public :
      * @param num_attributes the number of attributes on the tag
      * @param attributes list of attributes
      *
-     * Overidden startUnit to handle collection of Unit attributes and tag. Stop before continue
-     * if collecting attributes.
+     * Overidden startUnit to handle collection of Unit attributes and tag into a new current unit.
      */
     virtual void startUnit(const char* localname, const char* prefix, const char* URI,
                            int num_namespaces, const xmlChar** namespaces, int num_attributes,
@@ -345,52 +285,25 @@ public :
         fprintf(stderr, "HERE: %s %s %d '%s'\n", __FILE__, __FUNCTION__, __LINE__, (const char *)localname);
 #endif
 
-        // pause
-        if (!read_root) {
+        read_root = true;
 
-            {
-                std::unique_lock<std::mutex> lock(mutex);
-
-                if (terminate)
-                    stop_parser();
-                wait_root = false;
-                cond.notify_one();
-                cond.wait(lock);
-                read_root = true;
-            }
-
-            if (terminate) {
-
-                stop_parser();
-                return;
-            }
-        }
+        current.reset(new srcml_unit);
+        current->archive = archive;
+        current->read_header = true;
+        current_read = false;
 
         // collect attributes
-        unit_update_attributes(unit, num_attributes, attributes);
+        unit_update_attributes(current.get(), num_attributes, attributes);
 
         auto ctxt = (xmlParserCtxtPtr) get_controller().getContext()->libxml2_context;
         auto state = (sax2_srcsax_handler*) ctxt->_private;
 
-        state->collect_unit_body = collect_unit_body;
-
-        if (collect_unit_header) {
-
-            // pause
-            std::unique_lock<std::mutex> lock(mutex);
-            if (terminate)
-                stop_parser();
-
-            cond.notify_one();
-            cond.wait(lock);
-        }
-
         state->loc = 0;
 
+        // only a unit asked for by its header alone is not collected, since any other unit
+        // started in the same chunk could be read in full
         state->collect_unit_body = collect_unit_body;
-
-        if (terminate)
-            stop_parser();
+        collect_unit_body = true;
 
 #ifdef SRCSAX_DEBUG
         fprintf(stderr, "HERE: %s %s %d '%s'\n", __FILE__, __FUNCTION__, __LINE__, (const char *)localname);
@@ -403,8 +316,7 @@ public :
      * @param prefix prefix for the tag
      * @param URI uri for tag
      *
-     * Overidden endRoot to indicate done with parsing and
-        free any waiting process.
+     * Overidden endRoot to indicate done with parsing.
      */
     virtual void endRoot(const char* localname, const char* prefix, const char* URI) {
 
@@ -412,16 +324,7 @@ public :
         fprintf(stderr, "HERE: %s %s %d '%s'\n", __FILE__, __FUNCTION__, __LINE__, (const char *)localname);
 #endif
 
-        {
-            std::unique_lock<std::mutex> lock(mutex);
-            if (terminate)
-                stop_parser();
-            is_done = true;
-            cond.notify_one();
-        }
-
-        if (terminate)
-            stop_parser();
+        is_done = true;
 
 #ifdef SRCSAX_DEBUG
         fprintf(stderr, "HERE: %s %s %d '%s'\n", __FILE__, __FUNCTION__, __LINE__, (const char *)localname);
@@ -434,7 +337,7 @@ public :
      * @param prefix prefix for the tag
      * @param URI uri for tag
      *
-     * Overidden endUnit to collect srcml and stop parsing.  Clear collect srcML after pause.
+     * Overidden endUnit to collect srcml and queue the unit to be read.
      */
     virtual void endUnit(const char* localname, const char* prefix, const char* URI) {
 
@@ -445,7 +348,24 @@ public :
         auto ctxt = (xmlParserCtxtPtr) get_controller().getContext()->libxml2_context;
         auto state = (sax2_srcsax_handler*) ctxt->_private;
 
-        if (collect_unit_body) {
+        if (!current)
+            return;
+
+        // header was already read, and the rest is not needed, unless streamed
+        if (current_read) {
+
+            if (end_stream) {
+                end_stream();
+                end_stream = nullptr;
+            }
+
+            current.reset();
+            return;
+        }
+
+        auto unit = current.get();
+
+        if (state->collect_unit_body) {
 
             if (!state->unitsrc.empty() && state->unitsrc.back() != '\n')
                 ++state->loc;
@@ -458,33 +378,36 @@ public :
             unit->src = std::move(state->unitsrc);
             unit->loc = state->loc;
 
+            // expand compact positions so readers see the standard position attributes
+            if (isoption(archive->options, SRCML_OPTION_POSITION_COMPACT)) {
+
+                const char* pos_prefix = srcml_archive_get_prefix_from_uri(archive, SRCML_POSITION_NS_URI);
+                auto oldsize = unit->srcml.size();
+                unit->srcml = expand_position(unit->srcml, pos_prefix ? pos_prefix : "pos");
+                unit->content_end += (int) (unit->srcml.size() - oldsize);
+            }
+
             // update provisional cpp prefix
             if (state->cpp_prefix) {
 
                 // namespaces probably aren't create yet
-                if (!unit->namespaces) {
-                    unit->namespaces = default_namespaces;
-                }
+                auto namespaces = std::make_shared<Namespaces>(unit->namespaces ? *unit->namespaces : default_namespaces);
 
                 // set the found prefix, plus mark it as used
-                auto&& view = unit->namespaces->get<nstags::uri>();
+                auto&& view = namespaces->get<nstags::uri>();
                 auto it = view.find(SRCML_CPP_NS_URI);
                 if (it != view.end()) {
                     view.modify(it, [](Namespace& thisns){ thisns.flags |= NS_USED; });
                 } else {
-                    unit->namespaces->push_back({ state->cpp_prefix->c_str(), SRCML_CPP_NS_URI, NS_USED | NS_STANDARD });
+                    namespaces->push_back({ state->cpp_prefix->c_str(), SRCML_CPP_NS_URI, NS_USED | NS_STANDARD });
                 }
+                unit->namespaces = namespaces;
             }
 
-            // pause
-            std::unique_lock<std::mutex> lock(mutex);
-            if (terminate) stop_parser();
-            cond.notify_one();
-            cond.wait(lock);
+            unit->read_body = true;
         }
 
-        if (terminate)
-            stop_parser();
+        units.push_back(std::move(current));
 
 #ifdef SRCSAX_DEBUG
         fprintf(stderr, "HERE: %s %s %d '%s'\n", __FILE__, __FUNCTION__, __LINE__, (const char *)localname);
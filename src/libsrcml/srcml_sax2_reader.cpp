@@ -27,166 +27,532 @@
 #include <cstring>
 
 #include <iostream>
+#include <atomic>
+
+// streams are numbered across readers, so that a unit of another reader, or of an earlier one, never matches
+static std::atomic<size_t> body_streams(0);
 
 /**
- * start_routine
- * @param arguments thread_args structure with control and handler
+ * srcml_sax2_reader
+ * @param archive the archive being read
+ * @param input parser input buffer
+ * @param ahead_units maximum number of units to read ahead, 0 for no limit
+ * @param ahead_bytes maximum size of the srcML of the units read ahead, 0 for no limit
+ * @param parallel reader of the rest of the archive, when the input is its first partition
+ * @param header_scan only read unit headers, scanning for them after the first unit
  *
- * Starts the parsing of the document.
+ * Construct a srcml_sax2_reader using a parser input buffer.
+ * Parses up to the first unit so that the root is read. If either
+ * limit is set, the rest of the input is read ahead on a thread,
+ * unless the partitions are already parsed ahead in parallel.
+ * With a header scan, only the input up to the start tag of the first
+ * unit is parsed, and there is no read-ahead.
  */
-static void* start_routine(thread_args* args) {
+srcml_sax2_reader::srcml_sax2_reader(srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input,
+                                     size_t ahead_units, size_t ahead_bytes,
+                                     std::unique_ptr<srcml_parallel_reader> parallel, bool header_scan)
+    : control(std::move(input)), handler(), ahead_units(ahead_units), ahead_bytes(ahead_bytes), parallel(std::move(parallel)) {
 
-    try {
+    handler.archive = archive;
 
-        args->control->parse(args->handler);
+    if (header_scan) {
 
-    } catch(SAXError error) {
+        scanner.reset(new srcml_header_scanner(control.getContext()->input.get()));
 
-        if (!(error.error_code == XML_ERR_EXTRA_CONTENT || error.error_code == XML_ERR_DOCUMENT_END)) {
-
-            fprintf(stderr, "Error Parsing: %s\n", error.message.c_str());
+        // the parser is given exactly the prefix, so the scanner starts right after it
+        size_t prefix = scanner->prefix_size();
+        if (prefix) {
 
-            args->handler->done();
+            handler.collect_unit_body = false;
+            parse_chunk(prefix);
+            handler.collect_unit_body = true;
         }
 
-        // might have to release a lock here or set is_done
+        // an input that is not decoded is scanned in its own encoding
+        bool encoding_ok = control.getContext()->input->encoder || !archive->encoding
+                           || *archive->encoding == "UTF-8" || scanner->set_encoding(archive->encoding->c_str());
+
+        // otherwise, not an archive the scanner can read, so parse it all
+        if (!prefix || !handler.read_root || parse_error || !encoding_ok)
+            scanner.reset();
+        else
+            return;
     }
 
-    return 0;
+    while (!handler.read_root && !handler.is_done)
+        parse_chunk();
+
+    // the root is read, so the thread only changes the handler and the units
+    if ((ahead_units || ahead_bytes) && !this->parallel)
+        ahead_thread = std::thread(&srcml_sax2_reader::run_ahead, this);
 }
 
 /**
- * srcml_sax2_reader
- * @param input parser input buffer
+ * ~srcml_sax2_reader
  *
- * Construct a srcml_sax2_reader using a parser input buffer
+ * Destructor a srcml_sax2_reader.
+ * Stops and joins any thread reading ahead.
  */
-srcml_sax2_reader::srcml_sax2_reader(srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input)
-    : control(std::move(input)), handler() {
+srcml_sax2_reader::~srcml_sax2_reader() {
 
-    handler.archive = archive;
+    if (!ahead_thread.joinable())
+        return;
 
-    // Setup thread here after things are created and settled
-    // Do not put in member initialization list as it can cause random crashes
-    thread = std::thread(start_routine, &args);
+    {
+        std::lock_guard<std::mutex> lock(ahead_mutex);
+        ahead_stopping = true;
+    }
+    space_cv.notify_all();
 
-    handler.wait();
+    ahead_thread.join();
 }
 
 /**
- * ~srcml_sax2_reader
+ * parse_chunk
+ * @param max_size maximum size of the chunk
  *
- * Destructor a srcml_sax2_reader
+ * Parse the next chunk of the input, with the handler
+ * collecting any units in it. Marks the handler done at
+ * the end of the input or on an error.
  */
-srcml_sax2_reader::~srcml_sax2_reader() {
+void srcml_sax2_reader::parse_chunk(size_t max_size) {
+
+    try {
 
-    handler.stop();
+        if (!control.parse_chunk(&handler, max_size))
+            handler.is_done = true;
 
-    if (thread.joinable()) {
+    } catch(SAXError error) {
+
+        if (!(error.error_code == XML_ERR_EXTRA_CONTENT || error.error_code == XML_ERR_DOCUMENT_END)) {
+            fprintf(stderr, "Error Parsing: %s\n", error.message.c_str());
+            parse_error = true;
+        }
+
+        handler.is_done = true;
+    }
+}
+
+/**
+ * run_ahead
+ *
+ * Read units into the queue while it is under both limits. A unit
+ * larger than the byte limit is queued with only its header, and the
+ * rest of the input is left to the caller. An error ends the queue, and
+ * is reported to the caller after the units already read.
+ */
+void srcml_sax2_reader::run_ahead() {
+
+    while (true) {
+
+        {
+            std::unique_lock<std::mutex> lock(ahead_mutex);
+            space_cv.wait(lock, [this]{
+                return ahead_stopping || ((!ahead_units || ahead.size() < ahead_units) && (!ahead_bytes || ahead_size < ahead_bytes));
+            });
+
+            if (ahead_stopping)
+                return;
+        }
+
+        std::unique_ptr<srcml_unit> unit;
+        int not_done = 0;
+        bool handoff = false;
+        bool error = false;
         try {
-            thread.join();
-        } catch(const std::system_error& e) {
-            std::cerr << "srcml: Internal error " << e.code() << " meaning " << e.what() << '\n';
+
+            unit.reset(new srcml_unit);
+            unit->archive = handler.archive;
+            not_done = parse_unit(unit.get(), ahead_bytes);
+            handoff = body_stream != 0;
+
+        } catch(...) {
+
+            // the parser state is unknown, so reading stops, and the caller reports the error
+            handler.is_done = true;
+            not_done = 0;
+            error = true;
         }
+
+        {
+            std::lock_guard<std::mutex> lock(ahead_mutex);
+            if (error)
+                ahead_error = true;
+            if (not_done) {
+                ahead_size += unit->srcml.size();
+                ahead.push_back(std::move(unit));
+            }
+            if (!not_done || handoff)
+                ahead_done = true;
+            ahead_handoff = handoff;
+        }
+        unit_cv.notify_one();
+
+        if (!not_done || handoff)
+            return;
     }
 }
 
+/**
+ * take_ahead
+ * @param unit location to store the unit
+ * @param header only the header of the unit is needed
+ *
+ * Wait for the next unit read ahead and move it to unit. After a unit
+ * that was queued with only its header, the thread is done, and the
+ * rest of the input is parsed in the current thread.
+ *
+ * @returns 1 on success and 0 at the end of the input.
+ */
+int srcml_sax2_reader::take_ahead(srcml_unit* unit, bool header) {
+
+    std::unique_ptr<srcml_unit> next;
+    bool resume;
+    bool handoff;
+    {
+        std::unique_lock<std::mutex> lock(ahead_mutex);
+        unit_cv.wait(lock, [this]{ return ahead_done || !ahead.empty(); });
+
+        if (ahead.empty()) {
+            if (ahead_error)
+                parse_error = true;
+            return 0;
+        }
+
+        next = std::move(ahead.front());
+        ahead.pop_front();
+        ahead_size -= next->srcml.size();
+        handoff = ahead.empty() && ahead_handoff;
+
+        // resume reading ahead only once the queue is half empty, so that
+        // the threads do not switch on every unit
+        resume = (!ahead_units || ahead.size() <= ahead_units / 2) && (!ahead_bytes || ahead_size <= ahead_bytes / 2);
+    }
+    if (resume)
+        space_cv.notify_one();
+
+    *unit = std::move(*next);
+
+    if (!handoff)
+        return 1;
+
+    ahead_thread.join();
+    if (header)
+        return 1;
+
+    // the whole unit is needed, so it is parsed to its end as if its header was not read
+    take_body(unit);
+    *handler.current = std::move(*unit);
+    handler.current_read = false;
+
+    return parse_unit(unit);
+}
+
 /**
  * read_header
- * @param language a location to store the language attribute
- * @param filename a location to store the filename attribute
- * @param url a location to store the url attribute
- * @param version a location to store the version attribute
+ * @param unit location to store the unit attributes
  *
- * Read attributes from next unit.
+ * Read attributes from next unit. The rest of the unit is
+ * not collected, unless it was already parsed or read ahead.
  *
  * @returns 1 on success and 0 on failure.
  */
 int srcml_sax2_reader::read_header(srcml_unit* unit) {
 
-    handler.unit = unit;
+    if (scanner)
+        return scan_header(unit);
 
-    if (handler.is_done)
-        return 0;
+    if (ahead_thread.joinable())
+        return take_ahead(unit, true);
 
-    handler.skip = true;
-    handler.collect_unit_header = true;
-    handler.collect_unit_body = false;
-    handler.resume_and_wait();
-    handler.collect_unit_body = false;
-    handler.collect_unit_header = false;
-    handler.skip = false;
+    return parse_header(unit);
+}
 
-    if (handler.is_done)
-        return 0;
+/**
+ * read
+ * @param unit location to store the unit
+ *
+ * Read attributes and srcML from next unit.
+ *
+ * @returns 1 on success and 0 on failure.
+ */
+int srcml_sax2_reader::read(srcml_unit* unit) {
+
+    if (scanner)
+        return scan_header(unit);
+
+    if (ahead_thread.joinable())
+        return take_ahead(unit, false);
+
+    return parse_unit(unit);
+}
+
+/**
+ * parse_header
+ * @param unit location to store the unit attributes
+ *
+ * Parse up to the attributes of the next unit.
+ *
+ * @returns 1 on success and 0 on failure.
+ */
+int srcml_sax2_reader::parse_header(srcml_unit* unit) {
+
+    stop_body();
+
+    // the body of the unit is collected up to the end of the chunk, so that it can be streamed
+    while (!handler.has_unit() && !handler.is_done)
+        parse_chunk();
+
+    if (!handler.has_unit())
+        return read_parallel(unit);
+
+    bool parsing = handler.units.empty();
 
-    handler.unit = 0;
+    handler.take_unit(unit);
+    ++num_units;
 
-    unit->read_header = true;
+    // the rest of the unit is only collected if its body is streamed
+    auto ctxt = (xmlParserCtxtPtr) control.getContext()->libxml2_context;
+    auto state = (sax2_srcsax_handler*) ctxt->_private;
+    if (parsing && state->collect_unit_body)
+        start_body(unit);
 
     return 1;
 }
 
 /**
- * read
- * @param language a location to store the language attribute
- * @param filename a location to store the filename attribute
- * @param url a location to store the url attribute
- * @param version a location to store the version attribute
+ * parse_unit
+ * @param unit location to store the unit
+ * @param handoff_size size of the body of a unit at which only its header is read, 0 for no limit
  *
- * Read attributes from next unit.
+ * Parse to the end of the next unit. A unit whose body is larger than the
+ * handoff size is stopped at the end of the chunk, with only its header read,
+ * so that the rest of its body can be streamed.
  *
  * @returns 1 on success and 0 on failure.
  */
-int srcml_sax2_reader::read(srcml_unit* unit) {
+int srcml_sax2_reader::parse_unit(srcml_unit* unit, size_t handoff_size) {
 
-    handler.unit = unit;
+    stop_body();
 
-    if (handler.is_done)
-        return 0;
+    auto ctxt = (xmlParserCtxtPtr) control.getContext()->libxml2_context;
+    while (handler.units.empty() && !handler.is_done) {
 
-    handler.skip = true;
-    handler.collect_unit_header = true;
-    handler.collect_unit_body = true;
-    handler.resume_and_wait();
-    handler.collect_unit_body = false;
-    handler.collect_unit_header = false;
-    handler.skip = false;
+        parse_chunk();
 
-    if (handler.is_done)
-        return 0;
+        if (handoff_size && handler.units.empty() && handler.has_unit() && unit_body_size(ctxt) > handoff_size) {
 
-    handler.unit = 0;
+            handler.take_unit(unit);
+            ++num_units;
+            start_body(unit);
+            return 1;
+        }
+    }
 
-    unit->read_header = true;
-    unit->read_body = true;
+    if (handler.units.empty())
+        return read_parallel(unit);
+
+    handler.take_unit(unit);
+    ++num_units;
 
     return 1;
 }
 
+/**
+ * read_parallel
+ * @param unit location to store the unit
+ *
+ * Read the next unit from the parallel reader, after the units of the input.
+ * If the input, the first partition, did not parse, e.g., from a boundary
+ * inside a comment, the parallel reader instead reads the whole archive
+ * sequentially after the units already read.
+ *
+ * @returns 1 on success and 0 at the end of the input or on an error.
+ */
+int srcml_sax2_reader::read_parallel(srcml_unit* unit) {
+
+    if (!parallel)
+        return 0;
+
+    if (parse_error) {
+
+        parse_error = false;
+        if (!parallel->read_sequential(0, num_units)) {
+            parallel.reset();
+            parse_error = true;
+            return 0;
+        }
+    }
+
+    return parallel->read(unit);
+}
+
+/**
+ * scan_header
+ * @param unit location to store the unit attributes
+ *
+ * The first unit was parsed up to its start tag, and the rest of it
+ * is skipped by the scanner. The following units are all scanned.
+ * Only the header and lines of code of a unit are read.
+ *
+ * @returns 1 on success and 0 on failure.
+ */
+int srcml_sax2_reader::scan_header(srcml_unit* unit) {
+
+    if (handler.has_unit()) {
+
+        handler.take_unit(unit);
+        unit->loc = scanner->skip_body();
+
+        return 1;
+    }
+
+    return scanner->next_unit(unit) ? 1 : 0;
+}
+
 /**
  * read_body
- * @param output_buffer output buffer to write text
+ * @param unit a unit read by read_header()
  *
- * Read the next unit from a srcML Archive
- * and return in the passed string parameter.
+ * The srcML of a unit is collected with its header, so it is only available
+ * if it was parsed before the header was read, or if the unit is still being
+ * parsed and its body was not streamed.
  *
- * @returns 1 on success and 0 if done
+ * @returns 1 if the srcML of the unit is available and 0 otherwise.
  */
 int srcml_sax2_reader::read_body(srcml_unit* unit) {
 
-    if (handler.is_done)
+    if (unit->read_body)
+        return 1;
+
+    if (ahead_thread.joinable() || !take_body(unit))
         return 0;
 
-    handler.unit = unit;
-    handler.collect_unit_body = true;
-    handler.resume_and_wait();
-    handler.collect_unit_body = false;
+    // the rest of the unit is parsed as if its header was not read
+    *handler.current = std::move(*unit);
+    handler.current_read = false;
 
-    if (handler.is_done)
-        return 0;
+    return parse_unit(unit);
+}
+
+/**
+ * start_body
+ * @param unit a unit whose header was read while it was parsed
+ *
+ * The rest of the input is the body of the unit. The unit is given a new stream,
+ * so the unit can be moved, and is matched by its stream, not its address.
+ */
+void srcml_sax2_reader::start_body(srcml_unit* unit) {
 
-    unit->read_body = true;
+    body_stream = ++body_streams;
+    unit->body_stream = body_stream;
+}
 
-    return 1;
+/**
+ * take_body
+ * @param unit a unit read by read_header()
+ *
+ * Take the stream of the body from the unit, so that its body is read once.
+ *
+ * @returns if the rest of the input is the body of the unit.
+ */
+bool srcml_sax2_reader::take_body(srcml_unit* unit) {
+
+    if (!body_stream || unit->body_stream != body_stream)
+        return false;
+
+    body_stream = 0;
+    unit->body_stream = 0;
+
+    return true;
+}
+
+/**
+ * stop_body
+ *
+ * Stop collecting the body of the unit whose header was read,
+ * since it is not streamed.
+ */
+void srcml_sax2_reader::stop_body() {
+
+    if (!body_stream)
+        return;
+
+    body_stream = 0;
+
+    stop_unit_body((xmlParserCtxtPtr) control.getContext()->libxml2_context);
+}
+
+/**
+ * stream_body
+ * @param unit a unit read by read_header()
+ * @param src stream the source instead of the srcML inside of the unit tags
+ * @param write output of each chunk of the body
+ *
+ * The rest of the unit is parsed, and the body is written after each chunk of the input,
+ * so only a chunk of the body is collected at a time. The body can only be streamed once,
+ * and only for a unit whose header was read while it was parsed.
+ *
+ * @returns SRCML_STATUS_OK on success, SRCML_STATUS_UNINITIALIZED_UNIT if the body cannot
+ * be streamed, and SRCML_STATUS_IO_ERROR if the output or the input fails.
+ */
+int srcml_sax2_reader::stream_body(srcml_unit* unit, bool src, const std::function<bool(const char*, size_t)>& write) {
+
+    if (!unit || ahead_thread.joinable() || !take_body(unit))
+        return SRCML_STATUS_UNINITIALIZED_UNIT;
+
+    auto ctxt = (xmlParserCtxtPtr) control.getContext()->libxml2_context;
+    auto state = (sax2_srcsax_handler*) ctxt->_private;
+
+    unmap_unit_body(ctxt);
+
+    // the start tag is not part of the body
+    state->unitsrcml.erase(0, state->content_begin);
+
+    // write what is collected so far, and the srcML up to the size
+    bool write_ok = true;
+    char last = '\0';
+    auto flush = [&](size_t srcml_size) {
+
+        const std::string& body = src ? state->unitsrc : state->unitsrcml;
+        size_t size = src ? body.size() : srcml_size;
+        if (write_ok && size)
+            write_ok = write(body.data(), size);
+
+        if (!state->unitsrc.empty())
+            last = state->unitsrc.back();
+
+        state->unitsrc.clear();
+        state->unitsrcml.clear();
+    };
+
+    // the end tag of the unit is the last part collected
+    bool ended = false;
+    handler.end_stream = [&]() {
+
+        flush(state->content_end > 0 ? state->content_end - 1 : 0);
+        ended = true;
+
+        // lines of code are counted as for a collected unit
+        unit->loc = state->loc + (last != '\0' && last != '\n' ? 1 : 0);
+    };
+
+    while (!ended && !handler.is_done) {
+
+        flush(state->unitsrcml.size());
+        parse_chunk();
+    }
+    handler.end_stream = nullptr;
+
+    return ended && write_ok ? SRCML_STATUS_OK : SRCML_STATUS_IO_ERROR;
+}
+
+/**
+ * failed
+ *
+ * @returns if parsing stopped on an error.
+ */
+bool srcml_sax2_reader::failed() const {
+
+    return parse_error || (parallel && parallel->failed());
 }
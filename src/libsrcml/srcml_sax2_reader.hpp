@@ -22,6 +22,8 @@
 #define INCLUDED_SRCML_SAX2_READER_HPP
 
 #include <srcml_reader_handler.hpp>
+#include <srcml_parallel_reader.hpp>
+#include <srcml_header_scanner.hpp>
 
 #include <srcSAXController.hpp>
 
@@ -34,30 +36,27 @@
 
 #include <string>
 #include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include <thread>
+#include <functional>
 #include <boost/optional.hpp>
 
-/**
- * thread_args
- *
- * Structure to hold information to pass
- * to thread function.
- */
-struct thread_args {
-
-    /** control for sax processing */
-    srcSAXController* control;
-
-    /** handler with hooks for sax processing */
-    srcml_reader_handler* handler;
-};
-
 /**
  * srcml_sax2_reader
  *
  * Extend XML Text Reader interface to
  * progressively read a srcML Archive collecting
- * units and reading unit attributes.
+ * units and reading unit attributes. The SAX
+ * parser is pulled in chunks in the caller's thread,
+ * or, with read-ahead, run ahead on its own thread
+ * into a bounded queue of units. With a parallel reader,
+ * the input is the first partition of the archive, and
+ * the units of the rest come from the parallel reader.
+ * With a header scan, the SAX parser only parses up to
+ * the first unit, and the scanner reads the rest.
  */
 class srcml_sax2_reader {
 
@@ -71,27 +70,96 @@ public :
 
 private :
 
-    /** thread running execution */
-    std::thread thread;
-    thread_args args = { &control, &handler };
+    /** maximum number of units read ahead, 0 for no limit */
+    size_t ahead_units = 0;
+
+    /** maximum size of the srcML of the units read ahead, 0 for no limit */
+    size_t ahead_bytes = 0;
+
+    /** units read ahead, guarded by ahead_mutex */
+    std::deque<std::unique_ptr<srcml_unit>> ahead;
+    size_t ahead_size = 0;
+    bool ahead_done = false;
+    bool ahead_handoff = false;
+    bool ahead_stopping = false;
+    bool ahead_error = false;
+    std::mutex ahead_mutex;
+    std::condition_variable space_cv;
+    std::condition_variable unit_cv;
+
+    /** thread reading ahead */
+    std::thread ahead_thread;
+
+    /** reader of the partitions after the input, if partitioned */
+    std::unique_ptr<srcml_parallel_reader> parallel;
+
+    /** scanner of the unit headers after the first unit, with a header scan */
+    std::unique_ptr<srcml_header_scanner> scanner;
+
+    /** if parsing stopped on an error */
+    bool parse_error = false;
+
+    /** number of units read from the input, before any from the parallel reader */
+    size_t num_units = 0;
+
+    /** stream of the body of the unit whose header was read while it was parsed, 0 if none.
+        The unit is owned by the caller, so it is handed the stream instead of the reader keeping it */
+    size_t body_stream = 0;
+
+    // hand the stream of the rest of the input to the unit whose header was read
+    void start_body(srcml_unit* unit);
+
+    // if the rest of the input is the body of the unit, taking the stream from it
+    bool take_body(srcml_unit* unit);
+
+    // stop collecting the body of the unit whose header was read
+    void stop_body();
+
+    // parse the next chunk of the input
+    void parse_chunk(size_t max_size = SRCSAX_CHUNK_SIZE);
+
+    // read the next unit header with the scanner
+    int scan_header(srcml_unit* unit);
+
+    // read the next unit by parsing in the current thread
+    int parse_header(srcml_unit* unit);
+    int parse_unit(srcml_unit* unit, size_t handoff_size = 0);
+
+    // read the next unit from the parallel reader
+    int read_parallel(srcml_unit* unit);
+
+    // read ahead into the queue until the input is done or stopped
+    void run_ahead();
+
+    // move the next unit read ahead to unit
+    int take_ahead(srcml_unit* unit, bool header);
 
 public :
 
     // constructors
-    srcml_sax2_reader(srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input);
+    srcml_sax2_reader(srcml_archive* archive, std::unique_ptr<xmlParserInputBuffer> input,
+                      size_t ahead_units = 0, size_t ahead_bytes = 0,
+                      std::unique_ptr<srcml_parallel_reader> parallel = nullptr, bool header_scan = false);
 
     // destructors
     ~srcml_sax2_reader();
 
-    /* finds next unit tag if not current unit and sets attributes.  Consumes unit.
-       Unit is still avaible for readsrcML or read.  But not readUnitAttributes.
+    /* finds next unit tag and sets attributes.  Consumes unit.
+       The srcML of the unit is only available if it was already parsed.
     */
     int read_header(srcml_unit* unit);
 
+    // reads the attributes and the srcML of the next unit
     int read(srcml_unit* unit);
 
-    // reads the next unit and returns it in parameter as srcML
+    // collects the srcML of a unit read by read_header(), if it is still being parsed
     int read_body(srcml_unit* unit);
+
+    // streams the rest of the srcML inside the unit tags, or of the source, of a unit read by read_header()
+    int stream_body(srcml_unit* unit, bool src, const std::function<bool(const char*, size_t)>& write);
+
+    // reports if parsing stopped on an error
+    bool failed() const;
 };
 
 #endif
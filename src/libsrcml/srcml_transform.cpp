@@ -521,8 +521,30 @@ int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit
         result->boolValue = false;
     }
 
-    // create a DOM of the unit
-    std::shared_ptr<xmlDoc> doc(xmlReadMemory(unit->srcml.c_str(), (int) unit->srcml.size(), 0, 0, 0), [](xmlDoc* doc) { xmlFreeDoc(doc); });
+    // a unit parsed into a tree is transformed without parsing its srcML. When the transformations
+    // change the tree, the srcML of the unit is generated first, as the unit may still be output
+    std::shared_ptr<xmlDoc> doc = unit->doc;
+    if (doc) {
+
+        if (archive->transformations.size() > 1 || archive->transformations.front()->modifies())
+            unit_srcml_from_tree(unit);
+
+    } else {
+
+        unit_update_start_tag(unit);
+
+        // transformations see the standard position attributes, not the compact form
+        std::string expanded;
+        const std::string* srcml = &unit->srcml;
+        if (isoption(archive->options, SRCML_OPTION_POSITION_COMPACT)) {
+            const char* pos_prefix = srcml_archive_get_prefix_from_uri(archive, SRCML_POSITION_NS_URI);
+            expanded = expand_position(unit->srcml, pos_prefix ? pos_prefix : "pos");
+            srcml = &expanded;
+        }
+
+        // create a DOM of the unit
+        doc.reset(xmlReadMemory(srcml->c_str(), (int) srcml->size(), 0, 0, 0), [](xmlDoc* doc) { xmlFreeDoc(doc); });
+    }
     if (doc == nullptr)
         return SRCML_STATUS_ERROR;
 
@@ -615,6 +637,36 @@ int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit
     // create units out of the transformation results
     result->type = lastresult.nodeType;
 
+    // namespaces of the results, shared by all results with the same use of the cpp and openmp namespaces
+    std::shared_ptr<const Namespaces> result_namespaces[2][2];
+    auto resultNamespaces = [&](bool usescpp, bool usesomp) {
+
+        auto& shared = result_namespaces[usescpp][usesomp];
+        if (shared)
+            return shared;
+
+        // when no namespace, use the starting namespaces
+        auto namespaces = std::make_shared<Namespaces>(unit->namespaces ? *unit->namespaces : starting_namespaces);
+
+        // mark cpp and omp as used based on the query result
+        auto& view = namespaces->get<nstags::uri>();
+        auto itcpp = view.find(SRCML_CPP_NS_URI);
+        if (itcpp != view.end()) {
+            view.modify(itcpp, [usescpp](Namespace& thisns){ if (usescpp) thisns.flags |= NS_USED; else thisns.flags &= ~NS_USED; });
+        } else if (usescpp) {
+            namespaces->push_back({ SRCML_CPP_NS_DEFAULT_PREFIX, SRCML_CPP_NS_URI, NS_USED | NS_STANDARD });
+        }
+        auto itomp = view.find(SRCML_OPENMP_NS_URI);
+        if (itomp != view.end()) {
+            view.modify(itomp, [usesomp](Namespace& thisns){ if (usesomp) thisns.flags |= NS_USED; else thisns.flags &= ~NS_USED; });
+        } else if (usesomp) {
+            namespaces->push_back({ SRCML_OPENMP_NS_DEFAULT_PREFIX, SRCML_OPENMP_NS_URI, NS_USED | NS_STANDARD });
+        }
+
+        shared = namespaces;
+        return shared;
+    };
+
     for (int i = 0; i < fullresults->nodeNr; ++i) {
 
         // create a new unit to store the results in
@@ -626,20 +678,9 @@ int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit
             nunit->hash = boost::none;
         }
 
-        // when no namespace, use the starting namespaces
-        if (!nunit->namespaces)
-            nunit->namespaces = starting_namespaces;
-
-        // mark unused cpp and omp until we examine the query result
-        auto& view = nunit->namespaces->get<nstags::uri>();
-        auto itcpp = view.find(SRCML_CPP_NS_URI);
-        if (itcpp != view.end()) {
-            view.modify(itcpp, [](Namespace& thisns){ thisns.flags &= ~NS_USED; });
-        }
-        auto itomp = view.find(SRCML_OPENMP_NS_URI);
-        if (itomp != view.end()) {
-            view.modify(itomp, [](Namespace& thisns){ thisns.flags &= ~NS_USED; });
-        }
+        // cpp and omp are unused until we examine the query result
+        bool usescpp = false;
+        bool usesomp = false;
 
         // special cases where the nodes are not written to the tree
         switch (fullresults->nodeTab[i]->type) {
@@ -679,29 +720,15 @@ int srcml_unit_apply_transforms(struct srcml_archive* archive, struct srcml_unit
             // also performs a free of resources
             xmlOutputBufferClose(output);
 
-            // update the cpp namespace if actually used
-            if (usesURI(fullresults->nodeTab[i], SRCML_CPP_NS_URI)) {
-
-                if (itcpp != view.end()) {
-                    view.modify(itcpp, [](Namespace& thisns){ thisns.flags |= NS_USED; });
-                } else {
-                    nunit->namespaces->push_back({ SRCML_CPP_NS_DEFAULT_PREFIX, SRCML_CPP_NS_URI, NS_USED | NS_STANDARD });
-                }
-            }
-
-            // update the openmp namespace if actually used
-            if (usesURI(fullresults->nodeTab[i], SRCML_OPENMP_NS_URI)) {
-
-                if (itomp != view.end()) {
-                    view.modify(itomp, [](Namespace& thisns){ thisns.flags |= NS_USED; });
-                } else {
-                    nunit->namespaces->push_back({ SRCML_OPENMP_NS_DEFAULT_PREFIX, SRCML_OPENMP_NS_URI, NS_USED | NS_STANDARD });
-                }
-            }
+            // update the cpp and openmp namespaces if actually used
+            usescpp = usesURI(fullresults->nodeTab[i], SRCML_CPP_NS_URI);
+            usesomp = usesURI(fullresults->nodeTab[i], SRCML_OPENMP_NS_URI);
 
             break;
         }
 
+        nunit->namespaces = resultNamespaces(usescpp, usesomp);
+
         // mark inside the units
         nunit->content_begin = lastresult.unitWrapped ? (int) nunit->srcml.find_first_of('>') + 1 : 0;
         nunit->content_end =   lastresult.unitWrapped ? (int) nunit->srcml.find_last_of('<') + 1  : (int) nunit->srcml.size() + 1;
@@ -32,6 +32,9 @@
 #include "srcmlns.hpp"
 #include <srcml_types.hpp>
 #include <unit_utilities.hpp>
+#include <libxml2_utilities.hpp>
+#include <srcml_gzip_output.hpp>
+#include <srcml_unit_index.hpp>
 
 /**
  * srcml_translator
@@ -88,6 +91,98 @@ void srcml_translator::set_macro_list(std::vector<std::string>& list) {
     out.setMacroList(list);
 }
 
+/**
+ * set_parse_handler
+ * @param handler parse event callbacks
+ * @param context user context passed to the callbacks
+ *
+ * Deliver parse events to the handler instead of generating srcML.
+ */
+void srcml_translator::set_parse_handler(const srcml_parse_handler* handler, void* context) {
+
+    out.parse_handler = handler;
+    out.parse_context = context;
+}
+
+/**
+ * set_frame_units
+ * @param units number of units per frame, 0 for no frames
+ *
+ * Start a new frame of seekable gzip output every units units.
+ */
+void srcml_translator::set_frame_units(size_t units) {
+
+    frame_units = units;
+}
+
+/**
+ * startFrame
+ *
+ * Start a new frame of seekable gzip output before the first unit of each frame,
+ * so that each frame starts with a unit start tag.
+ */
+void srcml_translator::startFrame() {
+
+    if (!frame_units || (frame_unit_count++ % frame_units) != 0)
+        return;
+
+#ifdef WITH_ZLIB
+    xmlTextWriterFlush(out.getWriter());
+    srcml_gzip_output_frame(out.output_buffer);
+#endif
+}
+
+/**
+ * set_unit_index
+ * @param index the index to record units in, or NULL for none
+ *
+ * Record the location and metadata of each unit output in index.
+ */
+void srcml_translator::set_unit_index(srcml_unit_index* index) {
+
+    unit_index = index;
+}
+
+/**
+ * startIndexUnit
+ *
+ * Record the offset of a unit about to be output in the index.
+ */
+void srcml_translator::startIndexUnit() {
+
+    if (!unit_index)
+        return;
+
+    xmlTextWriterFlush(out.getWriter());
+
+    unit_index->units.emplace_back();
+    unit_index->units.back().offset = unit_index->written;
+}
+
+/**
+ * endIndexUnit
+ * @param language the unit language
+ * @param hash the unit hash
+ * @param filename the unit filename
+ * @param loc the lines of code of the unit
+ *
+ * Record the length and metadata of the unit just output in the index.
+ */
+void srcml_translator::endIndexUnit(const char* language, const char* hash, const char* filename, int loc) {
+
+    if (!unit_index)
+        return;
+
+    xmlTextWriterFlush(out.getWriter());
+
+    auto& entry = unit_index->units.back();
+    entry.length = unit_index->written - entry.offset;
+    entry.loc = loc;
+    entry.language = language ? language : "";
+    entry.hash = hash ? hash : "";
+    entry.filename = filename ? filename : "";
+}
+
 /**
  * close
  *
@@ -120,13 +215,91 @@ void srcml_translator::translate(UTF8CharBuffer* parser_input) {
       lang & Language::LANGUAGE_OBJECTIVE_C)
         options |= SRCML_OPTION_CPP;
 
+    parse(parser_input, lang);
+}
+
+/**
+ * translate_tree
+ * @param unit srcML unit with the attributes of the unit
+ * @param parser_input the source input, which the lexer takes ownership of
+ * @param start_tag the start tag of the unit, without the closing '>'
+ * @param loc the lines of code of the input
+ *
+ * Translate a single unit into a tree, the same as parsing the srcML of the
+ * unit, without generating the srcML. The root element is created from the
+ * start tag once the namespaces used by the unit are known.
+ *
+ * @returns the tree of the unit, NULL on failure
+ */
+xmlDocPtr srcml_translator::translate_tree(const srcml_unit* unit, UTF8CharBuffer* parser_input, std::string& start_tag, int& loc) {
+
+    first = false;
+
+    const int lang = getLanguage();
+    if (lang == Language::LANGUAGE_C || lang == Language::LANGUAGE_CXX || lang == Language::LANGUAGE_CSHARP ||
+      lang & Language::LANGUAGE_OBJECTIVE_C)
+        options |= SRCML_OPTION_CPP;
+
+    // names are shared in a dictionary, as for a parsed document
+    std::unique_ptr<xmlDoc> doc(xmlNewDoc(BAD_CAST "1.0"));
+    if (!doc)
+        return nullptr;
+    doc->dict = xmlDictCreate();
+
+    // elements are built in a placeholder until the start tag of the unit is known
+    xmlNodePtr contents = xmlNewDocNode(doc.get(), 0, BAD_CAST "unit", 0);
+    xmlDocSetRootElement(doc.get(), contents);
+
+    out.startTree(contents);
+
+    loc = parse(parser_input, lang);
+
+    start_tag = start_unit_tag(unit);
+
+    // root element parsed from the start tag, so it is the same as from the srcML
+    std::string empty_unit = start_tag + "/>";
+    std::unique_ptr<xmlDoc> tag_doc(xmlReadMemory(empty_unit.c_str(), (int) empty_unit.size(), 0, 0, 0));
+    xmlNodePtr root = tag_doc ? xmlDocCopyNode(xmlDocGetRootElement(tag_doc.get()), doc.get(), 2) : nullptr;
+    if (!root) {
+        out.endTree(contents);
+        return nullptr;
+    }
+
+    // move the contents into the root
+    root->children = contents->children;
+    root->last = contents->last;
+    for (xmlNodePtr child = root->children; child; child = child->next)
+        child->parent = root;
+    contents->children = contents->last = nullptr;
+
+    xmlDocSetRootElement(doc.get(), root);
+    xmlFreeNode(contents);
+
+    out.endTree(root);
+
+    return doc.release();
+}
+
+/**
+ * parse
+ * @param parser_input the source input, which the lexer takes ownership of
+ * @param language the language to parse in
+ *
+ * Parse the input and output the contents of the unit.
+ *
+ * @returns the lines of code of the input
+ */
+int srcml_translator::parse(UTF8CharBuffer* parser_input, int language) {
+
+    int loc = 0;
+
     try {
 
         // master lexer with multiple streams
         antlr::TokenStreamSelector selector;
 
         // srcML lexical analyzer from standard input
-        KeywordLexer lexer(parser_input, getLanguage(), options, user_macro_list);
+        KeywordLexer lexer(parser_input, language, options, user_macro_list);
         lexer.setSelector(&selector);
         lexer.setTabsize((int)tabsize);
 
@@ -140,13 +313,15 @@ void srcml_translator::translate(UTF8CharBuffer* parser_input) {
         selector.select(&lexer);
 
         // base stream parser srcML connected to lexical analyzer
-        StreamMLParser parser(selector, getLanguage(), options);
+        StreamMLParser parser(selector, language, options);
 
         // connect local parser to attribute for output
         out.setTokenStream(parser);
 
         // parse and form srcML output with unit attributes
-        out.consume(getLanguageString(), revision, url, filename, version, timestamp, hash, encoding);
+        out.consume(Language(language).getLanguageString(), revision, url, filename, version, timestamp, hash, encoding);
+
+        loc = parser_input->getLOC();
 
     } catch (const std::exception& e) {
         fprintf(stderr, "SRCML Exception: %s\n", e.what());
@@ -157,6 +332,8 @@ void srcml_translator::translate(UTF8CharBuffer* parser_input) {
     catch (...) {
         fprintf(stderr, "srcML translator error\n");
     }
+
+    return loc;
 }
 
 void srcml_translator::prepareOutput() {
@@ -179,6 +356,176 @@ void srcml_translator::prepareOutput() {
     }
 }
 
+/**
+ * copyUnit
+ * @param output the output to copy to
+ * @param unit srcML unit to copy
+ *
+ * Copy the srcML of a unit directly to the archive, without the root namespaces
+ * inserted into its start tag, when that start tag is byte for byte the one add_unit()
+ * would output. This avoids merging the namespaces and writing the start tag for each
+ * unit copied between archives. Nothing is output when the unit can not be copied.
+ *
+ * @returns if the unit was copied.
+ */
+bool srcml_translator::copyUnit(srcMLOutput& output, const srcml_unit* unit) {
+
+    const OPTION_TYPE& options = output.options;
+
+    // only nested units with the attributes of the unit, and no srcDiff revision
+    if (!(options & SRCML_OPTION_ARCHIVE) || !unit->language || unit->url || unit->archive->revision_number)
+        return false;
+
+    // the unit start tag would have the position tabs or the source encoding
+    if (options & (SRCML_OPTION_POSITION | SRCML_OPTION_STORE_ENCODING))
+        return false;
+
+    // the unit start tag would not declare any namespaces
+    if (!(options & SRCML_OPTION_NAMESPACE_DECL))
+        return false;
+
+    // the start tag regenerated after parsing may be kept apart from the rest of the srcML
+    const std::string& srcml = unit->srcml;
+    if (unit->content_begin <= 0 || (size_t) unit->content_begin > srcml.size())
+        return false;
+
+    const char* tag = unit->start_tag ? unit->start_tag->c_str() : srcml.c_str();
+    const size_t tag_size = unit->start_tag ? unit->start_tag->size() : (size_t) unit->content_begin - 1;
+    const char* rest = srcml.c_str() + unit->content_begin - 1;
+    const size_t rest_size = srcml.size() - (unit->content_begin - 1);
+    if (unit->insert_begin != 6 || unit->insert_end < unit->insert_begin || tag_size < (size_t) unit->insert_end
+        || memcmp(tag, "<unit ", 6) != 0)
+        return false;
+
+    // match the next attribute of the start tag, when writing it would not escape anything
+    const char* p = tag + unit->insert_end;
+    const char* tag_end = tag + tag_size;
+    bool first_attribute = true;
+    auto match = [&](const char* prefix, const char* name, const char* value) {
+
+        if (!first_attribute && (p == tag_end || *p++ != ' '))
+            return false;
+        first_attribute = false;
+
+        for (const char* c = value; *c; ++c) {
+            if (*c < ' ' || *c > '~' || *c == '<' || *c == '>' || *c == '&' || *c == '"')
+                return false;
+        }
+
+        if (prefix) {
+
+            size_t prefix_size = strlen(prefix);
+            if ((size_t) (tag_end - p) < prefix_size + 1 || memcmp(p, prefix, prefix_size) != 0 || p[prefix_size] != ':')
+                return false;
+
+            p += prefix_size + 1;
+        }
+
+        size_t name_size = strlen(name);
+        size_t value_size = strlen(value);
+        if ((size_t) (tag_end - p) < name_size + value_size + 3
+            || memcmp(p, name, name_size) != 0 || p[name_size] != '=' || p[name_size + 1] != '"'
+            || memcmp(p + name_size + 2, value, value_size) != 0 || p[name_size + 2 + value_size] != '"')
+            return false;
+
+        p += name_size + value_size + 3;
+
+        return true;
+    };
+
+    // namespace declarations of a nested unit, which add_unit() would output from the flags of the
+    // default namespaces merged with those of the archive and the unit. The namespaces are few, so
+    // a linear pass is cheaper than the lookups of a merge
+    const size_t default_size = default_namespaces.size();
+    int flags[8] = { 0 };
+    bool other_prefix[8] = { false };
+    if (default_size > 8)
+        return false;
+
+    if (options & SRCML_OPTION_CPP_DECLARED)
+        flags[CPP] |= NS_USED;
+
+    const Namespaces* const merged[] = { &default_namespaces, &unit->archive->namespaces, unit->namespaces.get() };
+    for (const Namespaces* namespaces : merged) {
+
+        if (!namespaces)
+            continue;
+
+        for (const auto& ns : *namespaces) {
+
+            size_t pos = 0;
+            while (pos < default_size && ns.uri != default_namespaces[pos].uri)
+                ++pos;
+
+            // only standard namespaces are declared on nested units
+            if (pos == default_size) {
+                if (ns.flags & NS_STANDARD)
+                    return false;
+                continue;
+            }
+
+            flags[pos] |= ns.flags;
+            if (ns.prefix != default_namespaces[pos].prefix)
+                other_prefix[pos] = true;
+        }
+    }
+
+    // a unit tag with a prefix
+    if (other_prefix[SRC])
+        return false;
+
+    for (size_t pos = 0; pos < default_size; ++pos) {
+
+        if (!(flags[pos] & NS_STANDARD) || (flags[pos] & NS_ROOT) || (flags[pos] & NS_REQUIRED) || !(flags[pos] & NS_USED))
+            continue;
+
+        const Namespace& ns = default_namespaces[pos];
+        if (other_prefix[pos] || !(ns.prefix.empty() ? match(nullptr, "xmlns", ns.uri.c_str()) : match("xmlns", ns.prefix.c_str(), ns.uri.c_str())))
+            return false;
+    }
+
+    // attributes in the order add_unit() outputs them
+    const char* const attrs[][2] = {
+        { UNIT_ATTRIBUTE_REVISION,  unit->revision ? unit->revision->c_str() : revision },
+        { UNIT_ATTRIBUTE_LANGUAGE,  unit->language->c_str() },
+        { UNIT_ATTRIBUTE_FILENAME,  optional_to_c_str(unit->filename) },
+        { UNIT_ATTRIBUTE_VERSION,   optional_to_c_str(unit->version) },
+        { UNIT_ATTRIBUTE_TIMESTAMP, optional_to_c_str(unit->timestamp) },
+        { UNIT_ATTRIBUTE_HASH,      optional_to_c_str(unit->hash) },
+    };
+
+    for (const auto& attr : attrs) {
+        if (attr[1] && !match(nullptr, attr[0], attr[1]))
+            return false;
+    }
+
+    for (std::vector<std::string>::size_type pos = 0; pos + 1 < unit->attributes.size(); pos += 2) {
+        if (!match(nullptr, unit->attributes[pos].c_str(), unit->attributes[pos + 1].c_str()))
+            return false;
+    }
+
+    // an empty unit is output as an empty element, and the end tag is the one output
+    if (p != tag_end)
+        return false;
+
+    int size = unit->content_end - unit->content_begin - 1;
+    if (size > 0) {
+
+        if (*rest != '>' || (size_t) unit->content_end + 6 != srcml.size()
+            || srcml.compare(unit->content_end - 1, 7, "</unit>") != 0)
+            return false;
+
+    } else if (rest_size != 2 || rest[0] != '/' || rest[1] != '>') {
+        return false;
+    }
+
+    xmlTextWriterWriteRawLen(output.getWriter(), BAD_CAST tag, unit->insert_begin);
+    xmlTextWriterWriteRawLen(output.getWriter(), BAD_CAST (tag + unit->insert_end), (int) (tag_size - unit->insert_end));
+    xmlTextWriterWriteRawLen(output.getWriter(), BAD_CAST rest, (int) rest_size);
+
+    return true;
+}
+
 /**
  * add_unit
  * @param unit srcML to add to archive/non-archive with configuration options
@@ -201,7 +548,94 @@ bool srcml_translator::add_unit(const srcml_unit* unit) {
     // space between the previous unit and this one
     if ((options & SRCML_OPTION_ARCHIVE) > 0) {
         out.outputUnitSeparator();
+        startFrame();
     }
+    startIndexUnit();
+
+    std::string language = outputUnit(out, unit);
+
+    endIndexUnit(language.c_str(), optional_to_c_str(unit->hash), optional_to_c_str(unit->filename), unit->loc);
+
+    return true;
+}
+
+/**
+ * render_unit
+ * @param unit srcML unit to render
+ * @param options the translator options to render with
+ * @param srcml the rendered unit
+ *
+ * Render a nested unit of an archive as add_unit() would output it, but apart from the
+ * translator output. Only what is set when the translator is created is read, so a unit
+ * can be rendered while other units are output. Since output can change the translator
+ * options, the caller copies them while it holds the write lock.
+ *
+ * @returns the language of the unit.
+ */
+std::string srcml_translator::render_unit(const srcml_unit* unit, OPTION_TYPE options, std::string& srcml) {
+
+    std::unique_ptr<xmlBuffer> buffer(xmlBufferCreate());
+    xmlOutputBufferPtr obuffer = xmlOutputBufferCreateBuffer(buffer.get(), xmlFindCharEncodingHandler("UTF-8"));
+
+    // a nested unit of the archive
+    srcMLOutput output(0, obuffer, 0, out.xml_encoding, options, attributes, boost::none, tabsize);
+    output.depth = 1;
+
+    std::string language = outputUnit(output, unit);
+
+    output.close(false);
+
+    srcml.assign((const char*) xmlBufferContent(buffer.get()), (std::size_t) xmlBufferLength(buffer.get()));
+
+    return language;
+}
+
+/**
+ * add_rendered_unit
+ * @param unit srcML unit that was rendered
+ * @param language the language of the unit
+ * @param srcml the unit from render_unit()
+ *
+ * Add a unit rendered by render_unit() to the archive.
+ * Can not be in by element mode.
+ *
+ * @returns if succesfully added.
+ */
+bool srcml_translator::add_rendered_unit(const srcml_unit* unit, const std::string& language, const std::string& srcml) {
+
+    if (is_outputting_unit)
+        return false;
+
+    prepareOutput();
+
+    // space between the previous unit and this one
+    out.outputUnitSeparator();
+    startFrame();
+    startIndexUnit();
+
+    xmlTextWriterWriteRawLen(out.getWriter(), BAD_CAST srcml.c_str(), (int) srcml.size());
+
+    endIndexUnit(language.c_str(), optional_to_c_str(unit->hash), optional_to_c_str(unit->filename), unit->loc);
+
+    return true;
+}
+
+/**
+ * outputUnit
+ * @param output the output to write to
+ * @param unit srcML unit to output
+ *
+ * Output the start tag, contents, and end tag of a unit.
+ *
+ * @returns the language of the unit.
+ */
+std::string srcml_translator::outputUnit(srcMLOutput& output, const srcml_unit* unit) {
+
+    const OPTION_TYPE& options = output.options;
+
+    // a unit read from an archive is copied as is when its start tag is the one that would be output
+    if (copyUnit(output, unit))
+        return *unit->language;
 
     // if the unit has namespaces, then use those
     Namespaces mergedns = unit->archive->namespaces;
@@ -222,9 +656,9 @@ bool srcml_translator::add_unit(const srcml_unit* unit) {
     std::string language = unit->language ? *unit->language : Language(unit->derived_language).getLanguageString();
 
     // create a new unit start tag with all new info (hash value, namespaces actually used, etc.)
-    out.initNamespaces(mergedns);
+    output.initNamespaces(mergedns);
     auto nrevision = unit->archive->revision_number;
-    out.startUnit(language.c_str(),
+    output.startUnit(language.c_str(),
             (options & SRCML_OPTION_ARCHIVE) && unit->revision ? unit->revision->c_str() : revision,
             (options & SRCML_OPTION_ARCHIVE) || !unit->url       ? 0 : (nrevision ? attribute_revision(*unit->url, (int) *nrevision).c_str() : unit->url->c_str()),
             !unit->filename  ? 0 : (nrevision ? attribute_revision(*unit->filename, (int) *nrevision).c_str() : unit->filename->c_str()),
@@ -238,20 +672,98 @@ bool srcml_translator::add_unit(const srcml_unit* unit) {
     // write out the contents, excluding the start and end unit tags
     int size = unit->content_end - unit->content_begin - 1;
 
-    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces)) {
+    if (size > 0 && nrevision && issrcdiff(unit->archive->namespaces)) {
 
-        std::string s = extract_revision(unit->srcml.c_str() + unit->content_begin, size, (int) *unit->archive->revision_number);
+        // revisions of the unit are cached, so writing both revisions only extracts them once
+        const char* s = unit_revision(unit->srcml_raw_revision, unit->srcml.c_str() + unit->content_begin, size, *nrevision);
 
-        xmlTextWriterWriteRawLen(out.getWriter(), BAD_CAST s.c_str(), (int) s.size());
+        xmlTextWriterWriteRawLen(output.getWriter(), BAD_CAST s, (int) strlen(s));
 
     } else if (size > 0) {
-        xmlTextWriterWriteRawLen(out.getWriter(), BAD_CAST (unit->srcml.c_str() + unit->content_begin), size);
+        xmlTextWriterWriteRawLen(output.getWriter(), BAD_CAST (unit->srcml.c_str() + unit->content_begin), size);
     }
 
     // end the unit
-    xmlTextWriterEndElement(out.getWriter());
+    xmlTextWriterEndElement(output.getWriter());
 
-    return true;
+    return language;
+}
+
+/**
+ * add_parsed_unit
+ * @param unit srcML unit with the attributes of the unit
+ * @param language the language to parse in
+ * @param parser_input the source input, which the translator takes ownership of
+ * @param loc the lines of code of the input
+ *
+ * Parse the input directly into the output as a complete unit. Since the unit start tag
+ * is output before parsing, it declares any namespace the language may use.
+ *
+ * Can not use add_parsed_unit while outputting by element.
+ *
+ * @returns if succesfully added.
+ */
+bool srcml_translator::add_parsed_unit(const srcml_unit* unit, int language, UTF8CharBuffer* parser_input, int& loc) {
+
+    if (is_outputting_unit) {
+        delete parser_input;
+        return false;
+    }
+
+    prepareOutput();
+
+    // space between the previous unit and this one
+    if ((options & SRCML_OPTION_ARCHIVE) > 0) {
+        out.outputUnitSeparator();
+        startFrame();
+    }
+    startIndexUnit();
+
+    // if the unit has namespaces, then use those
+    Namespaces mergedns = unit->archive->namespaces;
+
+    if (unit->namespaces) {
+        mergedns += *unit->namespaces;
+    }
+
+    out.initNamespaces(mergedns);
+
+    // preprocessor and openmp elements may appear in any C family language
+    auto save_options = options;
+    if (language & Language::LANGUAGE_C_FAMILY) {
+
+        options |= SRCML_OPTION_CPP;
+
+        auto& view = out.namespaces.get<nstags::uri>();
+        for (const char* uri : { SRCML_CPP_NS_URI, SRCML_OPENMP_NS_URI }) {
+            auto it = view.find(uri);
+            if (it != view.end()) {
+                view.modify(it, [](Namespace& thisns){ thisns.flags |= NS_USED; });
+            }
+        }
+    }
+
+    out.startUnit(Language(language).getLanguageString(),
+            (options & SRCML_OPTION_ARCHIVE) && unit->revision ? unit->revision->c_str() : revision,
+            (options & SRCML_OPTION_ARCHIVE) ? 0 : optional_to_c_str(unit->url),
+            optional_to_c_str(unit->filename),
+            optional_to_c_str(unit->version),
+            optional_to_c_str(unit->timestamp),
+            optional_to_c_str(unit->hash),
+            optional_to_c_str(unit->encoding),
+            unit->attributes,
+            false);
+
+    loc = parse(parser_input, language);
+
+    options = save_options;
+
+    // end the unit
+    bool status = xmlTextWriterEndElement(out.getWriter()) != -1;
+
+    endIndexUnit(Language(language).getLanguageString(), optional_to_c_str(unit->hash), optional_to_c_str(unit->filename), loc);
+
+    return status;
 }
 
 /**
@@ -272,6 +784,10 @@ bool srcml_translator::add_start_unit(const srcml_unit * unit){
 
     first = false;
 
+    // units written by element are not indexed
+    if (unit_index)
+        unit_index->complete = false;
+
     out.startUnit(optional_to_c_str(unit->language, optional_to_c_str(unit->archive->language)),
                   revision,
                   optional_to_c_str(unit->url),
@@ -286,6 +802,55 @@ bool srcml_translator::add_start_unit(const srcml_unit * unit){
     return true;
 }
 
+/**
+ * start_unit_tag
+ * @param unit srcML unit whose start tag to generate
+ *
+ * Generate the start tag of a unit, without the closing '>', using the namespaces
+ * used so far in the translation. The translator output is unchanged, so this can
+ * regenerate the start tag of a unit after its contents are translated.
+ *
+ * @returns the unit start tag
+ */
+std::string srcml_translator::start_unit_tag(const srcml_unit* unit) {
+
+    std::unique_ptr<xmlBuffer> buffer(xmlBufferCreate());
+    xmlOutputBufferPtr obuffer = xmlOutputBufferCreateBuffer(buffer.get(), xmlFindCharEncodingHandler("UTF-8"));
+    xmlTextWriterPtr writer = xmlNewTextWriter(obuffer);
+
+    // temporarily redirect the output, as an unstarted unit
+    auto save_xout = out.xout;
+    auto save_output_buffer = out.output_buffer;
+    auto save_depth = out.depth;
+    auto save_openelementcount = out.openelementcount;
+    out.xout = writer;
+    out.output_buffer = obuffer;
+    out.depth = 0;
+
+    out.startUnit(optional_to_c_str(unit->language, optional_to_c_str(unit->archive->language)),
+                  revision,
+                  optional_to_c_str(unit->url),
+                  optional_to_c_str(unit->filename),
+                  optional_to_c_str(unit->version),
+                  optional_to_c_str(unit->timestamp),
+                  optional_to_c_str(unit->hash),
+                  optional_to_c_str(unit->encoding),
+                  unit->attributes,
+                  false);
+
+    xmlTextWriterFlush(writer);
+    std::string start_tag((const char*) xmlBufferContent(buffer.get()), (std::size_t) xmlBufferLength(buffer.get()));
+
+    xmlFreeTextWriter(writer);
+
+    out.xout = save_xout;
+    out.output_buffer = save_output_buffer;
+    out.depth = save_depth;
+    out.openelementcount = save_openelementcount;
+
+    return start_tag;
+}
+
 /**
  * add_end_unit
  *
@@ -435,6 +1000,49 @@ bool srcml_translator::add_string(const char *content) {
     return xmlTextWriterWriteString(out.getWriter(), BAD_CAST text) != -1;
 }
 
+/**
+ * add_raw_unit
+ *
+ * Start a unit whose srcML is written as is with add_raw(). The root start
+ * tag and the space between units are output first. Units written this way
+ * are not recorded in the index of the units.
+ * Can not be in by element mode.
+ *
+ * @returns if the unit can be written.
+ */
+bool srcml_translator::add_raw_unit() {
+
+    if (is_outputting_unit)
+        return false;
+
+    prepareOutput();
+
+    // space between the previous unit and this one
+    if ((options & SRCML_OPTION_ARCHIVE) > 0) {
+        out.outputUnitSeparator();
+        startFrame();
+    }
+
+    if (unit_index)
+        unit_index->complete = false;
+
+    return true;
+}
+
+/**
+ * add_raw
+ * @param s srcML to write
+ * @param size the size of s
+ *
+ * Write srcML of a unit started with add_raw_unit() as is.
+ *
+ * @returns if succesfully added.
+ */
+bool srcml_translator::add_raw(const char* s, size_t size) {
+
+    return xmlTextWriterWriteRawLen(out.getWriter(), BAD_CAST s, (int) size) != -1;
+}
+
 /**
  * ~srcml_translator
  *
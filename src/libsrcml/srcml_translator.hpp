@@ -45,6 +45,8 @@ class FileError {};
 /** Forward declaration of input buffer type */
 class UTF8CharBuffer;
 
+struct srcml_unit_index;
+
 /**
 * srcml_translator
 *
@@ -74,23 +76,38 @@ public:
 
     void set_macro_list(std::vector<std::string> & list);
 
+    void set_parse_handler(const srcml_parse_handler* handler, void* context);
+
+    void set_frame_units(size_t units);
+
+    void set_unit_index(srcml_unit_index* index);
+
     void close();
 
     void translate(UTF8CharBuffer* parser_input);
+    xmlDocPtr translate_tree(const srcml_unit* unit, UTF8CharBuffer* parser_input, std::string& start_tag, int& loc);
 
     bool add_unit(const srcml_unit* unit);
+    std::string render_unit(const srcml_unit* unit, OPTION_TYPE options, std::string& srcml);
+    bool add_rendered_unit(const srcml_unit* unit, const std::string& language, const std::string& srcml);
+    bool add_parsed_unit(const srcml_unit* unit, int language, UTF8CharBuffer* parser_input, int& loc);
     bool add_start_unit(const srcml_unit* unit);
     bool add_end_unit();
+    std::string start_unit_tag(const srcml_unit* unit);
     bool add_start_element(const char* prefix, const char* name, const char* uri);
     bool add_end_element();
     bool add_namespace(const char* prefix, const char* uri);
     bool add_attribute(const char* prefix, const char* name, const char* uri, const char* content);
     bool add_string(const char* content);
+    bool add_raw_unit();
+    bool add_raw(const char* s, size_t size);
 
     xmlOutputBufferPtr output_buffer() { return out.output_buffer; }
 
     xmlTextWriterPtr output_textwriter() { return out.xout; }
 
+    const OPTION_TYPE& get_options() const { return options; }
+
     // destructor
     ~srcml_translator();
 
@@ -136,6 +153,16 @@ private:
 
     void prepareOutput();
 
+    void startFrame();
+
+    void startIndexUnit();
+    void endIndexUnit(const char* language, const char* hash, const char* filename, int loc);
+
+    bool copyUnit(srcMLOutput& output, const srcml_unit* unit);
+    std::string outputUnit(srcMLOutput& output, const srcml_unit* unit);
+
+    int parse(UTF8CharBuffer* parser_input, int language);
+
     /** size of tabstop */
     size_t tabsize;
 
@@ -145,6 +172,15 @@ private:
     /** mark if have outputted starting unit tag for by element writing */
     bool is_outputting_unit = false;
 
+    /** number of units per frame of seekable gzip output, 0 for no frames */
+    size_t frame_units = 0;
+
+    /** number of units output in frames */
+    size_t frame_unit_count = 0;
+
+    /** index of the units output, if any */
+    srcml_unit_index* unit_index = nullptr;
+
 public:
     /** track depth for by element writing */
     int output_unit_depth = 0;
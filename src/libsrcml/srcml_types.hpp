@@ -33,6 +33,10 @@
 #include <Transformation.hpp>
 
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+#include <map>
 
 /** Private options */
 
@@ -92,6 +96,8 @@ typedef unsigned __int64 OPTION_TYPE;
 
 class srcml_sax2_reader;
 class srcml_translator;
+struct srcml_gzip_seek_table;
+struct srcml_unit_index;
 
 /**
  * SRCML_ARCHIVE_TYPE
@@ -100,6 +106,90 @@ class srcml_translator;
  */
 enum SRCML_ARCHIVE_TYPE { SRCML_ARCHIVE_INVALID, SRCML_ARCHIVE_RW, SRCML_ARCHIVE_READ, SRCML_ARCHIVE_WRITE };
 
+/**
+ * srcml_write_order
+ *
+ * Serializes writes to an archive from multiple threads, and orders
+ * writes with a sequence number. Copies start unlocked at sequence 0.
+ */
+struct srcml_write_order {
+
+    srcml_write_order() = default;
+    srcml_write_order(const srcml_write_order&) {}
+    srcml_write_order& operator=(const srcml_write_order&) { return *this; }
+
+    /** guards the translator and output of the archive */
+    std::mutex mutex;
+
+    /** signaled when next_sequence changes */
+    std::condition_variable sequence_cv;
+
+    /** sequence number of the next unit to write in order */
+    size_t next_sequence = 0;
+
+    /** sequence numbers of the writes waiting for their turn */
+    std::set<size_t> waiting;
+};
+
+/**
+ * srcml_submission
+ *
+ * A unit submitted to an archive, with its callbacks, until it is written
+ */
+struct srcml_submission {
+
+    /** the archive the unit is written to */
+    srcml_archive* archive = nullptr;
+
+    /** position of the unit in the order submitted */
+    size_t sequence = 0;
+
+    /** the unit, or NULL */
+    srcml_unit* unit = nullptr;
+
+    /** callbacks after the parse and in place of the write, and their user context */
+    srcml_parse_callback parsed = nullptr;
+    srcml_parse_callback write = nullptr;
+    void* context = nullptr;
+
+    /** status of the parse */
+    int status = SRCML_STATUS_OK;
+};
+
+/**
+ * srcml_submit_order
+ *
+ * Writes the units submitted to an archive in the order submitted, one at
+ * a time, as each is parsed. Copies start with nothing submitted.
+ */
+struct srcml_submit_order {
+
+    srcml_submit_order() = default;
+    srcml_submit_order(const srcml_submit_order&) {}
+    srcml_submit_order& operator=(const srcml_submit_order&) { return *this; }
+
+    /** guards the submit order */
+    std::mutex mutex;
+
+    /** signaled when all submitted units are written */
+    std::condition_variable written_cv;
+
+    /** sequence number of the next unit submitted */
+    size_t next_submit = 0;
+
+    /** sequence number of the next unit to write */
+    size_t next_write = 0;
+
+    /** parsed units waiting for the units before them, by sequence number */
+    std::map<size_t, std::unique_ptr<srcml_submission>> parsed;
+
+    /** a thread is writing units, and writes any that are parsed in the meantime */
+    bool writing = false;
+
+    /** status of the first unit that failed, of those written without a write callback */
+    int status = SRCML_STATUS_OK;
+};
+
 /**
  * srcml_archive
  *
@@ -131,6 +221,27 @@ struct srcml_archive {
     /** size of tabstop */
     size_t tabstop = 8;
 
+    /** number of threads for gzip compression of the output, 0 for none */
+    int gzip_threads = 0;
+
+    /** number of units per gzip member of seekable output, 0 for a single gzip stream */
+    size_t gzip_frame_units = 0;
+
+    /** maximum number of units read ahead of the caller, 0 for no limit */
+    size_t read_ahead_units = 0;
+
+    /** maximum size of the srcML of the units read ahead of the caller, 0 for no limit */
+    size_t read_ahead_bytes = 0;
+
+    /** number of threads to parse the partitions of an archive file with, 0 or 1 for a single thread */
+    int read_threads = 0;
+
+    /** map an archive file into memory for reading, instead of reading it into a buffer */
+    bool read_mmap = false;
+
+    /** only read unit headers, scanning the input for them instead of parsing it */
+    bool header_scan = false;
+
     /**  new namespace structure */
     Namespaces namespaces = starting_namespaces;
 
@@ -149,6 +260,19 @@ struct srcml_archive {
     /** a srcMLReader for reading */
     srcml_sax2_reader* reader = nullptr;
 
+    /** number of units read or skipped */
+    size_t read_position = 0;
+
+    /** seek table and filename of a seekable gzip archive opened for reading */
+    std::shared_ptr<srcml_gzip_seek_table> seek_table;
+    std::string seek_filename;
+
+    /** write a sidecar index of the units when writing to a file */
+    bool write_index = false;
+
+    /** unit index of the archive being written, or of an indexed archive opened for reading */
+    std::shared_ptr<srcml_unit_index> unit_index;
+
     std::vector<std::shared_ptr<Transformation>> transformations;
 
     /** srcDiff revision number */
@@ -165,6 +289,12 @@ struct srcml_archive {
     /** raw writes were made */
     bool rawwrites = false;
 
+    /** concurrent writes */
+    srcml_write_order write_order;
+
+    /** ordered writes of submitted units */
+    srcml_submit_order submit_order;
+
     /** error reporting */
     std::string error_string;
     int error_number = 0;
@@ -204,13 +334,11 @@ struct srcml_unit {
     /** language decided for the unit */
     int derived_language = SRCML_LANGUAGE_NONE;
 
-    /** output buffer to hold streaming creation of unit */
-    xmlBuffer* output_buffer = nullptr;
-
     /** a unit srcMLTranslator for writing and parsing as a stream */
     srcml_translator* unit_translator = nullptr;
 
-    boost::optional<Namespaces> namespaces;
+    /** namespaces, shared with clones and transformation results, so replaced instead of modified */
+    std::shared_ptr<const Namespaces> namespaces;
 
     // if header attributes have been read
     bool read_header = false;
@@ -220,16 +348,24 @@ struct srcml_unit {
 
     /** srcml from read and after parsing */
     std::string srcml;
-    boost::optional<std::string> srcml_revision;
-    int currevision = -1;
     boost::optional<std::string> srcml_fragment;
-    boost::optional<std::string> srcml_fragment_revision;
     boost::optional<std::string> srcml_raw;
-    boost::optional<std::string> srcml_raw_revision;
+
+    /** start tag regenerated after parsing, when its size differs from the start tag in srcml. It replaces
+        that start tag only when the whole srcML is needed, as replacing it moves the contents */
+    boost::optional<std::string> start_tag;
+
+    /** srcdiff revisions of the srcml, indexed by revision number, extracted together when first needed */
+    mutable std::vector<std::string> srcml_revision;
+    mutable std::vector<std::string> srcml_fragment_revision;
+    mutable std::vector<std::string> srcml_raw_revision;
 
     /** src from read */
     boost::optional<std::string> src;
 
+    /** tree of a unit parsed for transformation, with only the start tag in srcml until its srcML is generated */
+    std::shared_ptr<xmlDoc> doc;
+
     /** record the begin and end of the actual content */
     // int instead of size_t since used with libxml2
     int content_begin = 0;
@@ -239,6 +375,9 @@ struct srcml_unit {
 
     int loc = -1;
 
+    /** stream of the reader whose rest is the body of this unit, 0 if not streamed. Not cloned */
+    size_t body_stream = 0;
+
     /** error reporting */
     std::string error_string;
     int error_number = 0;
@@ -253,6 +392,31 @@ struct srcml_unit {
  */
 int srcml_unit_set_hash (struct srcml_unit* unit, const char* hash);
 
+/** Parse source directly into the output of a translator, without creating the srcML of the unit.
+ * Any hash of the unit is from srcml_unit_hash_source(), as the start tag is output before parsing
+ * Note: Not publicly available, so declared here instead of srcml.h
+ * @param unit A srcml_unit with the attributes of the unit
+ * @param translator The translator to output to, e.g., of an archive
+ * @param src_filename Name of a file to parse, or NULL to parse the buffer
+ * @param src_buffer Buffer of source code to parse
+ * @param buffer_size Size of the buffer
+ * @retval SRCML_STATUS_OK on success
+ * @retval Status error code on failure
+ */
+int srcml_unit_parse_translator(struct srcml_unit* unit, srcml_translator* translator,
+                                const char* src_filename, const char* src_buffer, size_t buffer_size);
+
+/** Hash the source for a unit that is parsed directly into a translator, when the archive has hashes
+ * Note: Not publicly available, so declared here instead of srcml.h
+ * @param unit A srcml_unit with the attributes of the unit
+ * @param src_filename Name of a file to hash, or NULL to hash the buffer
+ * @param src_buffer Buffer of source code to hash
+ * @param buffer_size Size of the buffer
+ * @retval SRCML_STATUS_OK on success
+ * @retval Status error code on failure
+ */
+int srcml_unit_hash_source(struct srcml_unit* unit, const char* src_filename, const char* src_buffer, size_t buffer_size);
+
 // helper conversions for boost::optional<std::string>
 inline const char* optional_to_c_str(const boost::optional<std::string>& s) {
     return s ? s->c_str() : 0;
@@ -25,6 +25,7 @@
 #include <UTF8CharBuffer.hpp>
 #include <memory>
 #include <libxml2_utilities.hpp>
+#include <unit_utilities.hpp>
 #include <cstring>
 #include <fcntl.h>
 #include <srcml_macros.hpp>
@@ -346,11 +347,12 @@ const char* srcml_unit_get_srcml(struct srcml_unit* unit) {
     if (!unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW))
         unit->archive->reader->read_body(unit);
 
-    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces)) {
-        if (!unit->srcml_revision || unit->currevision != (int) *unit->archive->revision_number)
-            unit->srcml_revision = extract_revision(unit->srcml.c_str(), (int) unit->srcml.size(), (int) *unit->archive->revision_number);
-        return unit->srcml_revision->c_str();
-    }
+    // the srcML of a unit parsed into a tree is generated when first needed
+    unit_srcml_from_tree(unit);
+    unit_update_start_tag(unit);
+
+    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces))
+        return unit_revision(unit->srcml_revision, unit->srcml.c_str(), (int) unit->srcml.size(), *unit->archive->revision_number);
 
     return unit->srcml.c_str();
 }
@@ -375,6 +377,9 @@ const char* srcml_unit_get_srcml_outer(struct srcml_unit* unit) {
     if (!unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW))
         unit->archive->reader->read_body(unit);
 
+    unit_srcml_from_tree(unit);
+    unit_update_start_tag(unit);
+
     // size of resulting raw version (no unit tag)
     auto rawsize = unit->srcml.size() - (unit->insert_end - unit->insert_begin);
 
@@ -413,11 +418,8 @@ const char* srcml_unit_get_srcml_outer(struct srcml_unit* unit) {
     }
 
     // if srcdiff versioned, then use that
-    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces)) {
-        if (!unit->srcml_fragment_revision || unit->currevision != (int) *unit->archive->revision_number)
-            unit->srcml_fragment_revision = extract_revision(unit->srcml_fragment->c_str(), (int) unit->srcml_fragment->size(), (int) *unit->archive->revision_number);
-        return unit->srcml_fragment_revision->c_str();
-    }
+    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces))
+        return unit_revision(unit->srcml_fragment_revision, unit->srcml_fragment->c_str(), (int) unit->srcml_fragment->size(), *unit->archive->revision_number);
 
     return unit->srcml_fragment->c_str();
 }
@@ -442,6 +444,8 @@ const char* srcml_unit_get_srcml_inner(struct srcml_unit* unit) {
     if (!unit->read_body && (unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW))
         unit->archive->reader->read_body(unit);
 
+    unit_srcml_from_tree(unit);
+
     auto start = unit->content_begin;
 
     // size of resulting raw version (no unit tag)
@@ -450,11 +454,8 @@ const char* srcml_unit_get_srcml_inner(struct srcml_unit* unit) {
         return "";
 
     // if srcdiff versioned, then use that
-    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces)) {
-        if (!unit->srcml_raw_revision || unit->currevision != (int) *unit->archive->revision_number)
-            unit->srcml_raw_revision = extract_revision(unit->srcml.c_str() + start, rawsize, (int) *unit->archive->revision_number);
-        return unit->srcml_raw_revision->c_str();
-    }
+    if (unit->archive->revision_number && issrcdiff(unit->archive->namespaces))
+        return unit_revision(unit->srcml_raw_revision, unit->srcml.c_str() + start, rawsize, *unit->archive->revision_number);
 
     // raw version is cached
     if (unit->srcml_raw)
@@ -465,18 +466,216 @@ const char* srcml_unit_get_srcml_inner(struct srcml_unit* unit) {
     return unit->srcml_raw->c_str();
 }
 
+/**
+ * srcml_unit_get_srcml_inner_io
+ * @param unit a srcml unit
+ * @param context user provided context for the callback
+ * @param write_callback a write callback function
+ *
+ * Write the srcml without the enclosing unit tags using the write callback.
+ * For a unit read with srcml_archive_read_unit_header(), the srcml is streamed
+ * in chunks as the rest of the unit is parsed, without collecting the whole unit.
+ *
+ * @returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_unit_get_srcml_inner_io(struct srcml_unit* unit, void* context, int (*write_callback)(void* context, const char* buffer, int len)) {
+
+    if (unit == nullptr || write_callback == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    if (!unit->read_body && !unit->read_header)
+        return SRCML_STATUS_UNINITIALIZED_UNIT;
+
+    // compact positions are only expanded for a whole unit
+    bool reading = unit->archive->type == SRCML_ARCHIVE_READ || unit->archive->type == SRCML_ARCHIVE_RW;
+    bool revision = unit->archive->revision_number && issrcdiff(unit->archive->namespaces);
+    bool compact = isoption(unit->archive->options, SRCML_OPTION_POSITION_COMPACT);
+    if (!unit->read_body && reading && !revision && !compact) {
+
+        int status = unit->archive->reader->stream_body(unit, false, [&](const char* srcml, size_t size) {
+
+            return write_callback(context, srcml, (int) size) >= 0;
+        });
+
+        if (status != SRCML_STATUS_UNINITIALIZED_UNIT)
+            return status;
+    }
+
+    const char* srcml = srcml_unit_get_srcml_inner(unit);
+    if (srcml == nullptr)
+        return SRCML_STATUS_UNINITIALIZED_UNIT;
+
+    int size = (int) strlen(srcml);
+    if (size && write_callback(context, srcml, size) < 0)
+        return SRCML_STATUS_IO_ERROR;
+
+    return SRCML_STATUS_OK;
+}
+
 /******************************************************************************
  *                                                                            *
  *                           Unit parsing functions                           *
  *                                                                            *
  ******************************************************************************/
 
+/**
+ * srcml_unit_parse_events_internal
+ * @param unit a srcml unit
+ * @param input the source input to the translator
+ * @param handler the parse event callbacks
+ * @param context user context for the callbacks
+ *
+ * Function for internal use for parsing to events. Translates the input
+ * with the events delivered to the handler. No srcML is generated.
+ *
+ * @returns Returns SRCML_STATUS_OK on success and SRCML_STATUS_IO_ERROR on failure.
+ */
+static int srcml_unit_parse_events_internal(struct srcml_unit* unit, UTF8CharBuffer* input, const srcml_parse_handler* handler, void* context) {
+
+    // translator requires an output buffer, even though nothing is written to it
+    std::unique_ptr<xmlBuffer> output_buffer(xmlBufferCreate());
+    if (!output_buffer)
+        return SRCML_STATUS_IO_ERROR;
+
+    xmlOutputBufferPtr obuffer = xmlOutputBufferCreateBuffer(output_buffer.get(), xmlFindCharEncodingHandler("UTF-8"));
+    if (!obuffer)
+        return SRCML_STATUS_IO_ERROR;
+
+    // positions are always part of the events
+    auto options = unit->archive->options | SRCML_OPTION_POSITION;
+    options &= ~(unsigned long long)(SRCML_OPTION_ARCHIVE);
+
+    try {
+
+        srcml_translator translator(
+            obuffer,
+            "UTF-8",
+            options,
+            unit->namespaces ? *(unit->namespaces) : unit->archive->namespaces,
+            boost::none,
+            unit->archive->tabstop,
+            unit->derived_language,
+            optional_to_c_str(unit->revision),
+            optional_to_c_str(unit->url),
+            optional_to_c_str(unit->filename),
+            optional_to_c_str(unit->version),
+            unit->attributes,
+            optional_to_c_str(unit->timestamp),
+            0,
+            optional_to_c_str(unit->encoding));
+
+        translator.set_macro_list(unit->archive->user_macro_list);
+        translator.set_parse_handler(handler, context);
+
+        translator.translate(input);
+
+    } catch(...) {
+
+        return SRCML_STATUS_IO_ERROR;
+    }
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_unit_parse_tree_internal
+ * @param unit a srcml unit
+ * @param input the source input to the translator
+ *
+ * Function for internal use for parsing a unit that is to be transformed.
+ * Translates the input into a tree of the unit, which the transformations
+ * use without parsing the srcML. The srcML is only generated from the tree
+ * when needed, e.g., to output the unit.
+ *
+ * @returns Returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+static int srcml_unit_parse_tree_internal(struct srcml_unit* unit, UTF8CharBuffer* input) {
+
+    if (unit->unit_translator) {
+        unit->unit_translator->close();
+        delete unit->unit_translator;
+        unit->unit_translator = nullptr;
+    }
+
+    // translator requires an output buffer, even though only the start tag is written to it
+    std::unique_ptr<xmlBuffer> output_buffer(xmlBufferCreate());
+    if (!output_buffer)
+        return SRCML_STATUS_IO_ERROR;
+
+    xmlOutputBufferPtr obuffer = xmlOutputBufferCreateBuffer(output_buffer.get(), xmlFindCharEncodingHandler("UTF-8"));
+    if (!obuffer)
+        return SRCML_STATUS_IO_ERROR;
+
+    // turn off option for archive so the start tag has full namespaces
+    auto options = unit->archive->options;
+    options &= ~(unsigned long long)(SRCML_OPTION_ARCHIVE);
+
+    if (!(unit->namespaces))
+        unit->namespaces = std::make_shared<const Namespaces>(unit->archive->namespaces);
+
+    try {
+
+        srcml_translator translator(
+            obuffer,
+            optional_to_c_str(unit->archive->encoding, "UTF-8"),
+            options,
+            *(unit->namespaces),
+            boost::none,
+            unit->archive->tabstop,
+            unit->derived_language,
+            optional_to_c_str(unit->revision),
+            optional_to_c_str(unit->url),
+            optional_to_c_str(unit->filename),
+            optional_to_c_str(unit->version),
+            unit->attributes,
+            optional_to_c_str(unit->timestamp),
+            optional_to_c_str(unit->hash, (unit->archive->options & SRCML_OPTION_HASH ? "" : 0)),
+            optional_to_c_str(unit->encoding));
+
+        translator.set_macro_list(unit->archive->user_macro_list);
+
+        std::string start_tag;
+        int loc = 0;
+        std::shared_ptr<xmlDoc> doc(translator.translate_tree(unit, input, start_tag, loc), [](xmlDoc* doc) { xmlFreeDoc(doc); });
+        if (!doc)
+            return SRCML_STATUS_INVALID_INPUT;
+
+        // namespaces were updated during translation, may now include
+        // namespaces that were optional
+        unit->namespaces = std::make_shared<const Namespaces>(translator.out.getNamespaces());
+
+        // the srcML is the start tag until generated from the tree
+        unit->srcml = start_tag;
+        unit->start_tag = boost::none;
+        unit->insert_begin = translator.out.namespace_begin;
+        unit->insert_end = translator.out.namespace_end;
+        unit->content_begin = unit->content_end = 0;
+        unit->doc = doc;
+        unit->loc = loc;
+
+        // transformations see the text as parsed from the srcML, with line endings normalized
+        if (translator.out.tree_carriage_return)
+            unit_srcml_from_tree(unit);
+
+    } catch(...) {
+
+        return SRCML_STATUS_IO_ERROR;
+    }
+
+    unit->read_body = true;
+
+    return SRCML_STATUS_OK;
+}
+
 /**
  * srcml_unit_parse_internal
  * @param unit a srcml unit
  * @param lang an interger representation of a language
  * @param input the source input to the translator
  * @param translation_options the options for translation
+ * @param handler optional parse event callbacks, used instead of srcML
+ * @param context user context for the parse event callbacks
+ * @param translator optional translator to parse directly into, used instead of the unit srcML
  *
  * Function for internal use for parsing functions. Creates
  * output buffer, translates a current input and places the
@@ -485,7 +684,9 @@ const char* srcml_unit_get_srcml_inner(struct srcml_unit* unit) {
  * @returns Returns SRCML_STATUS_OK on success and SRCML_STATUS_IO_ERROR on failure.
  */
 static int srcml_unit_parse_internal(struct srcml_unit* unit, const char* filename,
-    std::function<UTF8CharBuffer*(const char* src_encoding, bool output_hash, boost::optional<std::string>& hash)> createUTF8CharBuffer) {
+    std::function<UTF8CharBuffer*(const char* src_encoding, bool output_hash, boost::optional<std::string>& hash)> createUTF8CharBuffer,
+    const srcml_parse_handler* handler = nullptr, void* context = nullptr,
+    srcml_translator* translator = nullptr) {
 
     // figure out the language based on unit, archive, registered languages
     int lang = unit->language ? srcml_check_language(unit->language->c_str())
@@ -527,6 +728,27 @@ static int srcml_unit_parse_internal(struct srcml_unit* unit, const char* filena
     // unit url is just that of the archive
     unit->url = unit->archive->url;
 
+    // events are delivered directly from the parser
+    if (handler)
+        return srcml_unit_parse_events_internal(unit, input, handler, context);
+
+    // parse directly into the output of the translator
+    if (translator) {
+        int loc = 0;
+        if (!translator->add_parsed_unit(unit, lang, input, loc))
+            return SRCML_STATUS_INVALID_INPUT;
+
+        unit->loc = loc;
+
+        return SRCML_STATUS_OK;
+    }
+
+    // a unit that is to be transformed is parsed into a tree, unless the transformations
+    // need the compact positions expanded, or the start tag does not declare the namespaces
+    if (!unit->archive->transformations.empty() && !isoption(unit->archive->options, SRCML_OPTION_POSITION_COMPACT)
+        && isoption(unit->archive->options, SRCML_OPTION_NAMESPACE_DECL))
+        return srcml_unit_parse_tree_internal(unit, input);
+
     // create the unit start tag (start_unit and end_unit must be called together)
     int status = srcml_write_start_unit(unit);
     if (status != SRCML_STATUS_OK)
@@ -537,7 +759,7 @@ static int srcml_unit_parse_internal(struct srcml_unit* unit, const char* filena
 
     // namespaces were updated during translation, may now include
     // namespaces that were optional
-    unit->namespaces = unit->unit_translator->out.getNamespaces();
+    unit->namespaces = std::make_shared<const Namespaces>(unit->unit_translator->out.getNamespaces());
 
     // create the unit end tag
     return srcml_write_end_unit(unit);
@@ -658,6 +880,126 @@ int srcml_unit_parse_io(struct srcml_unit* unit, void * context, ssize_t (*read_
     });
 }
 
+/**
+ * srcml_unit_parse_filename_events
+ * @param unit a unit with the metadata for parsing
+ * @param src_filename name of a file to parse
+ * @param handler parse event callbacks
+ * @param context user context passed to the callbacks
+ *
+ * Parse the contents of src_filename and deliver the
+ * parse events to the handler.
+ *
+ * @returns Returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_unit_parse_filename_events(struct srcml_unit* unit, const char* src_filename, const struct srcml_parse_handler* handler, void* context) {
+
+    if (unit == nullptr || src_filename == nullptr || handler == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    // open the file and use the file descriptor version
+    int src_fd = OPEN(src_filename, O_RDONLY, 0);
+    if (src_fd == -1) {
+        return SRCML_STATUS_IO_ERROR;
+    }
+
+    return srcml_unit_parse_internal(unit, src_filename, [src_fd](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
+
+        return new UTF8CharBuffer(src_fd, encoding, output_hash, hash);
+    }, handler, context);
+}
+
+/**
+ * srcml_unit_parse_memory_events
+ * @param unit a unit with the metadata for parsing
+ * @param src_buffer buffer containing source code to parse
+ * @param buffer_size size of the buffer to parse
+ * @param handler parse event callbacks
+ * @param context user context passed to the callbacks
+ *
+ * Parse the contents of buffer up to size buffer_size and deliver the
+ * parse events to the handler.
+ *
+ * @returns Returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_unit_parse_memory_events(struct srcml_unit* unit, const char* src_buffer, size_t buffer_size, const struct srcml_parse_handler* handler, void* context) {
+
+    if (unit == nullptr || (buffer_size && src_buffer == nullptr) || handler == nullptr)
+        return SRCML_STATUS_INVALID_ARGUMENT;
+
+    return srcml_unit_parse_internal(unit, 0, [src_buffer, buffer_size](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
+
+        return new UTF8CharBuffer(src_buffer ? src_buffer : "", buffer_size, encoding, output_hash, hash);
+    }, handler, context);
+}
+
+/**
+ * srcml_unit_hash_source
+ * @param unit a unit with the attributes of the unit
+ * @param src_filename name of a file to hash, or NULL to hash the buffer
+ * @param src_buffer buffer containing source code to hash
+ * @param buffer_size size of the buffer to hash
+ *
+ * Hash the source of a unit that is parsed directly into a translator, when
+ * the archive has hashes. The unit start tag is output before parsing, so the
+ * hash needs a separate read of the source.
+ *
+ * @returns Returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_unit_hash_source(struct srcml_unit* unit, const char* src_filename, const char* src_buffer, size_t buffer_size) {
+
+    if (unit->hash || !(unit->archive->options & SRCML_OPTION_HASH))
+        return SRCML_STATUS_OK;
+
+    const char* src_encoding = optional_to_c_str(unit->encoding, optional_to_c_str(unit->archive->src_encoding));
+    try {
+
+        std::unique_ptr<UTF8CharBuffer> input(src_filename ? new UTF8CharBuffer(src_filename, src_encoding, true, unit->hash)
+                                                           : new UTF8CharBuffer(src_buffer ? src_buffer : "", buffer_size, src_encoding, true, unit->hash));
+        while (input->getChar() != -1)
+            ;
+
+    } catch(...) { return SRCML_STATUS_IO_ERROR; }
+
+    return SRCML_STATUS_OK;
+}
+
+/**
+ * srcml_unit_parse_translator
+ * @param unit a unit with the attributes of the unit
+ * @param translator the translator to output to, e.g., of an archive
+ * @param src_filename name of a file to parse, or NULL to parse the buffer
+ * @param src_buffer buffer containing source code to parse
+ * @param buffer_size size of the buffer to parse
+ *
+ * Parse the source directly into the output of the translator.
+ * The srcML of the unit is never created, so the unit has no contents afterwards.
+ * Any hash is from srcml_unit_hash_source().
+ *
+ * @returns Returns SRCML_STATUS_OK on success and a status error code on failure.
+ */
+int srcml_unit_parse_translator(struct srcml_unit* unit, srcml_translator* translator,
+                                const char* src_filename, const char* src_buffer, size_t buffer_size) {
+
+    if (src_filename) {
+
+        int src_fd = OPEN(src_filename, O_RDONLY, 0);
+        if (src_fd == -1) {
+            return SRCML_STATUS_IO_ERROR;
+        }
+
+        return srcml_unit_parse_internal(unit, src_filename, [src_fd](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
+
+            return new UTF8CharBuffer(src_fd, encoding, output_hash, hash);
+        }, nullptr, nullptr, translator);
+    }
+
+    return srcml_unit_parse_internal(unit, 0, [src_buffer, buffer_size](const char* encoding, bool output_hash, boost::optional<std::string>& hash)-> UTF8CharBuffer* {
+
+        return new UTF8CharBuffer(src_buffer ? src_buffer : "", buffer_size, encoding, output_hash, hash);
+    }, nullptr, nullptr, translator);
+}
+
 /******************************************************************************
  *                                                                            *
  *                           Unit unparsing functions                         *
@@ -682,18 +1024,61 @@ static int srcml_unit_unparse_internal(struct srcml_unit* unit, std::function<xm
         return SRCML_STATUS_IO_ERROR;
     }
 
+    // the source of a unit read by its header alone is streamed from the input,
+    // converted to the given eol, without collecting the whole unit
+    bool revision = unit->archive->revision_number && issrcdiff(unit->archive->namespaces);
+    if (!unit->read_body && !revision) {
+
+        std::string neol;
+        int status = unit->archive->reader->stream_body(unit, true, [&](const char* src, size_t size) {
+
+            if (unit->eol != SOURCE_OUTPUT_EOL_AUTO) {
+                neol.clear();
+                append_eol(neol, src, size, unit->eol);
+                src = neol.c_str();
+                size = neol.size();
+            }
+
+            return xmlOutputBufferWrite(output_handler.get(), (int) size, src) >= 0;
+        });
+
+        if (status != SRCML_STATUS_UNINITIALIZED_UNIT)
+            return status;
+    }
+
     try {
 
         if (!unit->read_body)
             unit->archive->reader->read_body(unit);
 
+        unit_srcml_from_tree(unit);
+
     } catch(...) {
 
         return SRCML_STATUS_IO_ERROR;
     }
 
+    // the src of a srcdiff revision is generated from the srcml of that revision
+    if (revision) {
+
+        auto revision = *unit->archive->revision_number;
+        unit_update_start_tag(unit);
+        unit_revision(unit->srcml_revision, unit->srcml.c_str(), (int) unit->srcml.size(), revision);
+
+        std::string src = extract_src(unit->srcml_revision[revision], unit->eol);
+        xmlOutputBufferWrite(output_handler.get(), (int) src.size(), src.c_str());
+        return SRCML_STATUS_OK;
+    }
+
     // if this unit was parsed from source, then the src does not exist
-    // generate this source from the srcml
+    // generate this source from the srcml, converting to the given eol in the same pass
+    if (!unit->src && unit->eol != SOURCE_OUTPUT_EOL_AUTO) {
+
+        std::string src = extract_src(unit->srcml, unit->eol);
+        xmlOutputBufferWrite(output_handler.get(), (int) src.size(), src.c_str());
+        return SRCML_STATUS_OK;
+    }
+
     if (!unit->src) {
         unit->src = extract_src(unit->srcml);
     }
@@ -704,26 +1089,9 @@ static int srcml_unit_unparse_internal(struct srcml_unit* unit, std::function<xm
     } else {
 
         // convert to the given eol
-        std::string neol(0, ' ');
-        neol.reserve(unit->src->size());
-
-        const std::string& src = *unit->src;
-        for (size_t i = 0; i < src.size(); ++i) {
-            if (src[i] != '\n') {
-                neol += src[i];
-            }
-            else if (unit->eol == SOURCE_OUTPUT_EOL_LF) {
-                neol += '\n';
-            }
-            else if (unit->eol == SOURCE_OUTPUT_EOL_CR) {
-                neol += '\r';
-            }
-            else if (unit->eol == SOURCE_OUTPUT_EOL_CRLF) {
-                neol += "\r\n";
-            } else {
-                neol += src[i];
-            }
-        }
+        std::string neol;
+        neol.reserve(unit->src->size() + unit->src->size() / 16);
+        append_eol(neol, unit->src->c_str(), unit->src->size(), unit->eol);
 
         xmlOutputBufferWrite(output_handler.get(), (int) neol.size(), neol.c_str());
     }
@@ -875,12 +1243,23 @@ int srcml_write_start_unit(struct srcml_unit* unit) {
     if (unit == nullptr)
         return SRCML_STATUS_INVALID_ARGUMENT;
 
-    // setup the output buffer where the srcML will be created
-    std::unique_ptr<xmlBuffer> output_buffer(xmlBufferCreate());
-    if (!output_buffer)
-        return SRCML_STATUS_IO_ERROR;
+    if (unit->unit_translator) {
+        unit->unit_translator->close();
+        delete unit->unit_translator;
+        unit->unit_translator = nullptr;
+    }
 
-    xmlOutputBufferPtr obuffer = xmlOutputBufferCreateBuffer(output_buffer.get(), xmlFindCharEncodingHandler("UTF-8"));
+    // the srcML is created directly in the unit, with no intermediate buffer
+    unit->doc.reset();
+    unit->srcml.clear();
+    unit->start_tag = boost::none;
+    xmlOutputBufferPtr obuffer = xmlOutputBufferCreateIO([](void* context, const char* buffer, int len) {
+
+        ((std::string*) context)->append(buffer, len);
+
+        return len;
+
+    }, 0, &(unit->srcml), 0);
     if (!obuffer)
         return SRCML_STATUS_IO_ERROR;
 
@@ -891,15 +1270,8 @@ int srcml_write_start_unit(struct srcml_unit* unit) {
         options &= ~(unsigned long long)(SRCML_OPTION_ARCHIVE);
 
         if (!(unit->namespaces))
-            unit->namespaces = unit->archive->namespaces;
-
-        if (unit->unit_translator) {
-            unit->unit_translator->close();
-            delete unit->unit_translator;
-            unit->unit_translator = nullptr;
-            xmlBufferFree(unit->output_buffer);
-            unit->output_buffer = nullptr;
-        }
+            unit->namespaces = std::make_shared<const Namespaces>(unit->archive->namespaces);
+
         unit->unit_translator = new srcml_translator(
             obuffer,
             optional_to_c_str(unit->archive->encoding, "UTF-8"),
@@ -928,20 +1300,13 @@ int srcml_write_start_unit(struct srcml_unit* unit) {
     if (!unit->unit_translator->add_start_unit(unit))
         return SRCML_STATUS_INVALID_INPUT;
 
-    // now that everything is ok, transfer the buffer to the unit
-    unit->output_buffer = output_buffer.release();
-
     // record start of content (after the unit start tag)
     xmlTextWriterFlush(unit->unit_translator->output_textwriter());
     unit->content_begin = unit->unit_translator->output_buffer()->written + 1;
 
-    // record end of content (after xmlns for srcML)
-    const char* s = (const char*) xmlBufferContent(unit->output_buffer);
-    auto pos = strstr(s, "xmlns") - s;
-    unit->insert_begin = (int) pos;
-    auto firstquote = strchr(s + pos + 1, '\"') - s;
-    auto secondquote = strchr(s + firstquote + 1, '\"') - s;
-    unit->insert_end = (int) secondquote + 2;
+    // record the first namespace declaration (xmlns for srcML) as recorded by the output
+    unit->insert_begin = unit->unit_translator->out.namespace_begin;
+    unit->insert_end = unit->unit_translator->out.namespace_end;
 
     return SRCML_STATUS_OK;
 }
@@ -975,36 +1340,31 @@ int srcml_write_end_unit(struct srcml_unit* unit) {
     if (!unit->unit_translator->add_end_unit())
         return SRCML_STATUS_INVALID_INPUT;
 
-    // flush before detaching
+    // flush so that all of the srcML is in the unit
     xmlTextWriterFlush(unit->unit_translator->output_textwriter());
 
-    // store the generated srcml in a char buffer
-    char* srcml = (char*) xmlBufferDetach(unit->output_buffer);
-
-    // record the current content_begin (which may change)
+    // record the current content_begin
     int content_begin = unit->content_begin;
-    int content_end = unit->content_end;
 
     // redo the start element with the namespaces found in the document
-    srcml_write_start_unit(unit);
-    char* start_tag = (char*) xmlBufferDetach(unit->output_buffer);
-
-    // recreate the unit with the newly generated start tag, which
-    // contains all the used namespaces
-    unit->srcml.assign(start_tag);
-
-    if (content_begin != content_end) {
-        unit->srcml.append(">");
-        unit->srcml.append(srcml + content_begin);
-    } else {
-        unit->srcml.append("/>");
-    }
-
-    // content end is changed since the start unit tag was rewritten
-    unit->content_end += (unit->content_begin - content_begin);
+    // using the same translator, instead of constructing another one
+    std::string start_tag = unit->unit_translator->start_unit_tag(unit);
+    unit->insert_begin = unit->unit_translator->out.namespace_begin;
+    unit->insert_end = unit->unit_translator->out.namespace_end;
+
+    // finished with any parsing. The output is closed without ending the document,
+    // which would add a newline after the unit
+    unit->unit_translator->out.close(false);
+    delete unit->unit_translator;
+    unit->unit_translator = nullptr;
 
-    free(start_tag);
-    free(srcml);
+    // the newly generated start tag contains all the used namespaces. When it is the same size
+    // as the original start tag, it replaces it in place. Otherwise, it is kept apart until the
+    // whole srcML is needed, so the contents are not moved for output of only the contents
+    if ((int) start_tag.size() == content_begin - 1)
+        unit->srcml.replace(0, start_tag.size(), start_tag);
+    else
+        unit->start_tag = std::move(start_tag);
 
     // record the loc
     if (!unit->src) {
@@ -1015,12 +1375,6 @@ int srcml_write_end_unit(struct srcml_unit* unit) {
     if (!unit->src->empty() && unit->src->back() != '\n')
         ++unit->loc;
 
-    // finished with any parsing
-    delete unit->unit_translator;
-    unit->unit_translator = 0;
-
-    xmlBufferFree(unit->output_buffer);
-
     unit->read_body = true;
 
     return SRCML_STATUS_OK;
@@ -0,0 +1,340 @@
+/**
+ * @file srcml_unit_index.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <srcml_unit_index.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace {
+
+    /** first line of an index file, followed by the size and modification time of the archive and the number of units */
+    const char* const INDEX_HEADER = "srcml-index 2";
+
+    // modification time of a file, or -1 if it cannot be found
+    int64_t fileModificationTime(const char* filename) {
+
+        struct stat file_stat;
+        if (stat(filename, &file_stat) != 0)
+            return -1;
+
+        return (int64_t) file_stat.st_mtime;
+    }
+
+    // escape the field separators, so that a field is on one line without tabs
+    std::string escapeField(const std::string& field) {
+
+        std::string escaped;
+        for (char c : field) {
+            switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '\t': escaped += "\\t"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            default:   escaped += c;
+            }
+        }
+
+        return escaped;
+    }
+
+    std::string unescapeField(const std::string& field) {
+
+        std::string unescaped;
+        for (size_t i = 0; i < field.size(); ++i) {
+
+            if (field[i] != '\\' || i + 1 == field.size()) {
+                unescaped += field[i];
+                continue;
+            }
+
+            switch (field[++i]) {
+            case 't': unescaped += '\t'; break;
+            case 'n': unescaped += '\n'; break;
+            case 'r': unescaped += '\r'; break;
+            default:  unescaped += field[i];
+            }
+        }
+
+        return unescaped;
+    }
+
+    /**
+     * IndexOutput
+     *
+     * Output to a file, counting the bytes written in the index.
+     */
+    struct IndexOutput {
+
+        FILE* file;
+        std::shared_ptr<srcml_unit_index> index;
+    };
+
+    int index_output_write(void* context, const char* buffer, int len) {
+
+        auto output = static_cast<IndexOutput*>(context);
+
+        if (fwrite(buffer, 1, (size_t) len, output->file) != (size_t) len)
+            return -1;
+
+        output->index->written += (uint64_t) len;
+
+        return len;
+    }
+
+    int index_output_close(void* context) {
+
+        auto output = static_cast<IndexOutput*>(context);
+
+        int status = fclose(output->file);
+        delete output;
+
+        return status == 0 ? 0 : -1;
+    }
+
+    /**
+     * IndexInput
+     *
+     * Input of the start of an archive, followed by the archive from a unit on.
+     */
+    struct IndexInput {
+
+        std::ifstream in;
+        std::string prefix;
+        size_t prefix_position = 0;
+    };
+
+    int index_input_read(void* context, char* buffer, int len) {
+
+        auto input = static_cast<IndexInput*>(context);
+
+        if (input->prefix_position < input->prefix.size()) {
+
+            size_t size = std::min((size_t) len, input->prefix.size() - input->prefix_position);
+            memcpy(buffer, input->prefix.data() + input->prefix_position, size);
+            input->prefix_position += size;
+
+            return (int) size;
+        }
+
+        input->in.read(buffer, len);
+        if (input->in.bad())
+            return -1;
+
+        return (int) input->in.gcount();
+    }
+
+    int index_input_close(void* context) {
+
+        delete static_cast<IndexInput*>(context);
+
+        return 0;
+    }
+}
+
+/**
+ * srcml_unit_index_filename
+ * @param srcml_filename name of a srcML archive
+ *
+ * @returns the name of the sidecar index file of the archive.
+ */
+std::string srcml_unit_index_filename(const std::string& srcml_filename) {
+
+    return srcml_filename + ".idx";
+}
+
+/**
+ * srcml_unit_index_output_create
+ * @param filename name of the srcML archive to write
+ * @param index the index to count the bytes written in
+ *
+ * Create an output buffer to the file that counts the bytes written.
+ *
+ * @returns the output buffer, or NULL on failure.
+ */
+xmlOutputBufferPtr srcml_unit_index_output_create(const char* filename, std::shared_ptr<srcml_unit_index> index) {
+
+    if (filename == nullptr || !index)
+        return nullptr;
+
+    FILE* file = fopen(filename, "wb");
+    if (file == nullptr)
+        return nullptr;
+
+    auto output = new IndexOutput{ file, index };
+
+    xmlOutputBufferPtr output_buffer = xmlOutputBufferCreateIO(index_output_write, index_output_close, output, nullptr);
+    if (output_buffer == nullptr)
+        index_output_close(output);
+
+    return output_buffer;
+}
+
+/**
+ * srcml_unit_index_write
+ * @param srcml_filename name of the srcML archive the index is for
+ * @param index the index of the archive
+ *
+ * Write the sidecar index file of a closed archive. The index records the
+ * size and the modification time of the archive so that an index of an
+ * archive changed since is not used.
+ *
+ * @returns if the index was written.
+ */
+bool srcml_unit_index_write(const std::string& srcml_filename, const srcml_unit_index& index) {
+
+    int64_t srcml_mtime = fileModificationTime(srcml_filename.c_str());
+    if (srcml_mtime == -1)
+        return false;
+
+    std::ofstream out(srcml_unit_index_filename(srcml_filename), std::ios::binary);
+    if (!out)
+        return false;
+
+    out << INDEX_HEADER << ' ' << index.srcml_size << ' ' << srcml_mtime << ' ' << index.units.size() << '\n';
+
+    for (const auto& unit : index.units) {
+        out << unit.offset << '\t' << unit.length << '\t' << unit.loc << '\t'
+            << escapeField(unit.language) << '\t' << escapeField(unit.hash) << '\t' << escapeField(unit.filename) << '\n';
+    }
+
+    return (bool) out.flush();
+}
+
+/**
+ * srcml_unit_index_read
+ * @param srcml_filename name of a srcML archive
+ *
+ * Read the sidecar index file of an archive.
+ *
+ * @returns the index, or an empty pointer if there is no index or it does not match the archive.
+ */
+std::shared_ptr<srcml_unit_index> srcml_unit_index_read(const char* srcml_filename) {
+
+    if (srcml_filename == nullptr)
+        return nullptr;
+
+    std::ifstream in(srcml_unit_index_filename(srcml_filename), std::ios::binary);
+    if (!in)
+        return nullptr;
+
+    std::ifstream srcml(srcml_filename, std::ios::binary | std::ios::ate);
+    if (!srcml)
+        return nullptr;
+    uint64_t srcml_size = (uint64_t) srcml.tellg();
+
+    // header
+    std::string line;
+    if (!std::getline(in, line) || line.compare(0, strlen(INDEX_HEADER), INDEX_HEADER) != 0)
+        return nullptr;
+
+    auto index = std::make_shared<srcml_unit_index>();
+    size_t num_units = 0;
+    std::istringstream header(line.substr(strlen(INDEX_HEADER)));
+    if (!(header >> index->srcml_size >> index->srcml_mtime >> num_units) || index->srcml_size != srcml_size
+        || index->srcml_mtime != fileModificationTime(srcml_filename))
+        return nullptr;
+
+    // units, in order within the archive
+    uint64_t end = 0;
+    index->units.reserve(std::min(num_units, (size_t) 1 << 20));
+    while (std::getline(in, line)) {
+
+        std::vector<std::string> fields;
+        size_t start = 0;
+        for (size_t pos; (pos = line.find('\t', start)) != std::string::npos; start = pos + 1)
+            fields.push_back(line.substr(start, pos - start));
+        fields.push_back(line.substr(start));
+
+        if (fields.size() != 6)
+            return nullptr;
+
+        srcml_unit_index_entry unit;
+        unit.offset = strtoull(fields[0].c_str(), nullptr, 10);
+        unit.length = strtoull(fields[1].c_str(), nullptr, 10);
+        unit.loc = atoi(fields[2].c_str());
+        unit.language = unescapeField(fields[3]);
+        unit.hash = unescapeField(fields[4]);
+        unit.filename = unescapeField(fields[5]);
+
+        if (unit.offset < end || unit.length == 0 || unit.offset + unit.length > srcml_size)
+            return nullptr;
+        end = unit.offset + unit.length;
+
+        index->units.push_back(std::move(unit));
+    }
+
+    if (index->units.size() != num_units || num_units == 0 || index->units.front().offset == 0)
+        return nullptr;
+
+    // the indexed units start with a start tag
+    for (uint64_t offset : { index->units.front().offset, index->units.back().offset }) {
+
+        srcml.seekg((std::streamoff) offset);
+        if (srcml.get() != '<')
+            return nullptr;
+    }
+
+    return index;
+}
+
+/**
+ * srcml_unit_index_input_create
+ * @param srcml_filename name of an indexed srcML archive
+ * @param index index of the archive
+ * @param position position of the first unit to read
+ * @param encoding the encoding of the archive
+ *
+ * Create an input buffer of the start of the archive, up to the first unit,
+ * followed by the rest of the archive from the unit at position.
+ *
+ * @returns the input buffer, or NULL on failure.
+ */
+xmlParserInputBufferPtr srcml_unit_index_input_create(const char* srcml_filename, const srcml_unit_index& index,
+                                                      size_t position, xmlCharEncoding encoding) {
+
+    if (srcml_filename == nullptr || position >= index.units.size())
+        return nullptr;
+
+    std::unique_ptr<IndexInput> input(new IndexInput);
+    input->in.open(srcml_filename, std::ios::binary);
+    if (!input->in)
+        return nullptr;
+
+    // the start of the archive, with the root start tag
+    input->prefix.resize((size_t) index.units.front().offset);
+    if (!input->in.read(&input->prefix[0], (std::streamsize) input->prefix.size()))
+        return nullptr;
+
+    input->in.seekg((std::streamoff) index.units[position].offset);
+    if (!input->in)
+        return nullptr;
+
+    xmlParserInputBufferPtr buffer_input = xmlParserInputBufferCreateIO(index_input_read, index_input_close, input.get(), encoding);
+    if (buffer_input != nullptr)
+        input.release();
+
+    return buffer_input;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file srcml_unit_index.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SRCML_UNIT_INDEX_HPP
+#define SRCML_UNIT_INDEX_HPP
+
+#include <libxml/xmlIO.h>
+#include <libxml/encoding.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * srcml_unit_index_entry
+ *
+ * Location and metadata of a unit in a srcML archive.
+ */
+struct srcml_unit_index_entry {
+
+    /** byte offset of the unit start tag */
+    uint64_t offset = 0;
+
+    /** size in bytes of the unit, from its start tag to the end of its end tag */
+    uint64_t length = 0;
+
+    /** lines of code of the unit, -1 if not known */
+    int loc = -1;
+
+    /** unit attributes, empty if not present */
+    std::string language;
+    std::string hash;
+    std::string filename;
+};
+
+/**
+ * srcml_unit_index
+ *
+ * Index of the units of a srcML archive, stored in a sidecar file
+ * next to the archive.
+ */
+struct srcml_unit_index {
+
+    /** size of the srcML archive the index is for */
+    uint64_t srcml_size = 0;
+
+    /** modification time of the srcML archive the index is for */
+    int64_t srcml_mtime = 0;
+
+    /** units in archive order */
+    std::vector<srcml_unit_index_entry> units;
+
+    /** bytes written so far to the archive, while writing */
+    uint64_t written = 0;
+
+    /** if every unit written was indexed, while writing */
+    bool complete = true;
+};
+
+/**
+ * srcml_unit_index_filename
+ * @param srcml_filename name of a srcML archive
+ *
+ * @returns the name of the sidecar index file of the archive.
+ */
+std::string srcml_unit_index_filename(const std::string& srcml_filename);
+
+/**
+ * srcml_unit_index_output_create
+ * @param filename name of the srcML archive to write
+ * @param index the index to count the bytes written in
+ *
+ * Create an output buffer to the file that counts the bytes written.
+ *
+ * @returns the output buffer, or NULL on failure.
+ */
+xmlOutputBufferPtr srcml_unit_index_output_create(const char* filename, std::shared_ptr<srcml_unit_index> index);
+
+/**
+ * srcml_unit_index_write
+ * @param srcml_filename name of the srcML archive the index is for
+ * @param index the index of the archive
+ *
+ * Write the sidecar index file of an archive.
+ *
+ * @returns if the index was written.
+ */
+bool srcml_unit_index_write(const std::string& srcml_filename, const srcml_unit_index& index);
+
+/**
+ * srcml_unit_index_read
+ * @param srcml_filename name of a srcML archive
+ *
+ * Read the sidecar index file of an archive.
+ *
+ * @returns the index, or an empty pointer if there is no index or it does not match the archive.
+ */
+std::shared_ptr<srcml_unit_index> srcml_unit_index_read(const char* srcml_filename);
+
+/**
+ * srcml_unit_index_input_create
+ * @param srcml_filename name of an indexed srcML archive
+ * @param index index of the archive
+ * @param position position of the first unit to read
+ * @param encoding the encoding of the archive
+ *
+ * Create an input buffer of the start of the archive, up to the first unit,
+ * followed by the rest of the archive from the unit at position.
+ *
+ * @returns the input buffer, or NULL on failure.
+ */
+xmlParserInputBufferPtr srcml_unit_index_input_create(const char* srcml_filename, const srcml_unit_index& index,
+                                                      size_t position, xmlCharEncoding encoding);
+
+#endif
@@ -27,6 +27,7 @@
 #ifndef INCLUDED_SRCMLNS_HPP
 #define INCLUDED_SRCMLNS_HPP
 
+#include <srcml.h>
 #include <string>
 #include <array>
 #include <boost/multi_index_container.hpp>
@@ -175,4 +176,17 @@ Namespaces& operator +=(Namespaces& ns, const Namespaces& otherns);
 // is a srcdiff archive
 bool issrcdiff(const Namespaces& namespaces);
 
+// value of a srcdiff attribute, e.g., "original|modified", for a revision
+inline std::string attribute_revision(const std::string& attribute, int revision) {
+
+    auto pos = attribute.find('|');
+    if (pos == std::string::npos)
+        return attribute;
+
+    if (revision == SRCDIFF_REVISION_ORIGINAL)
+        return attribute.substr(0, pos);
+
+    return attribute.substr(pos + 1);
+}
+
 #endif
@@ -25,6 +25,12 @@
 #include <libxml/parser.h>
 #include <libxml2_utilities.hpp>
 
+struct sax2_srcsax_handler;
+struct srcml_mapped_input;
+
+/** size of the chunks of input given to the push parser */
+const int SRCSAX_CHUNK_SIZE = 16384;
+
 /**
  * srcsax_context
  *
@@ -52,8 +58,21 @@ public:
     /** xml parser input buffer */
     std::unique_ptr<xmlParserInputBuffer> input;
 
+    /** mapping of the input file, given directly to the parser, or NULL */
+    srcml_mapped_input* mapped = nullptr;
+
     /** internally used libxml2 context */
     xmlParserCtxtPtr libxml2_context = nullptr;
+
+    /** sax handler used while parsing, and the one it replaced */
+    xmlSAXHandler sax;
+    xmlSAXHandlerPtr save_sax = nullptr;
+
+    /** parsing state of the sax handler, created on the first chunk */
+    sax2_srcsax_handler* state = nullptr;
+
+    /** the input has been parsed completely */
+    bool finished = false;
 };
 
 /* srcSAX context creation/open functions */
@@ -65,6 +84,9 @@ void srcsax_free_context(srcsax_context * context);
 /* srcSAX parse function */
 int srcsax_parse(srcsax_context * context);
 
+/* srcSAX incremental parse function */
+int srcsax_parse_chunk(srcsax_context* context, size_t max_size = SRCSAX_CHUNK_SIZE);
+
 /* srcSAX terminate parse function */
 void srcsax_stop_parser(srcsax_context* context);
 
@@ -19,9 +19,11 @@
  */
 #include <srcsax.hpp>
 #include <sax2_srcsax_handler.hpp>
+#include <srcml_mmap_input.hpp>
 
 #include <libxml/parserInternals.h>
 
+#include <algorithm>
 #include <functional>
 #include <cstring>
 
@@ -70,8 +72,9 @@ srcsax_context* srcsax_create_context_parser_input_buffer(std::unique_ptr<xmlPar
     }
 
     context->input = std::move(input);
+    context->mapped = srcml_mmap_input_mapping(context->input.get());
 
-    xmlParserCtxtPtr libxml2_context = srcsax_create_parser_context(context->input.release(), encoding ? xmlParseCharEncoding(encoding) : XML_CHAR_ENCODING_NONE);
+    xmlParserCtxtPtr libxml2_context = srcsax_create_parser_context(context->input.get(), encoding ? xmlParseCharEncoding(encoding) : XML_CHAR_ENCODING_NONE);
     if (libxml2_context == nullptr) {
         delete context;
         return 0;
@@ -94,8 +97,15 @@ void srcsax_free_context(srcsax_context* context) {
     if (context == 0)
         return;
 
-    if (context->libxml2_context)
+    if (context->libxml2_context) {
+
+        if (context->save_sax)
+            context->libxml2_context->sax = context->save_sax;
+
         xmlFreeParserCtxt(context->libxml2_context);
+    }
+
+    delete context->state;
 
     delete context;
 }
@@ -111,41 +121,113 @@ void srcsax_free_context(srcsax_context* context) {
  */
 int srcsax_parse(srcsax_context* context) {
 
+    int status;
+    while ((status = srcsax_parse_chunk(context)) > 0)
+        ;
+
+    return status;
+}
+
+/**
+ * srcsax_parse_chunk
+ * @param context srcSAX context
+ * @param max_size maximum size of the chunk
+ *
+ * Parse the next chunk of the input using the provided sax handlers,
+ * in the calling thread. Every event of the chunk is delivered before
+ * returning, so a handler that wants to pause parsing only has to stop
+ * asking for more chunks.
+ * On error calls the error callback function before returning.
+ *
+ * @returns 1 if there is more to parse, 0 when parsing is complete, and -1 on error.
+ */
+int srcsax_parse_chunk(srcsax_context* context, size_t max_size) {
+
     if (context == 0 || context->handler == 0)
         return -1;
 
-    xmlSAXHandlerPtr save_sax = context->libxml2_context->sax;
+    if (context->finished)
+        return 0;
+
+    xmlParserCtxtPtr ctxt = context->libxml2_context;
+
+    // handlers and state stay with the context between chunks
+    if (!context->state) {
+
+        try {
+            context->state = new sax2_srcsax_handler();
+        } catch (...) {
+            return -1;
+        }
+        context->state->context = context;
+
+        context->sax = srcsax_sax2_factory();
+        context->save_sax = ctxt->sax;
+        ctxt->sax = &context->sax;
+        ctxt->_private = context->state;
+    }
+
+    // the next chunk of a mapped file is given to the parser straight from the mapping,
+    // unless that part was already read into the buffer
+    xmlParserInputBufferPtr input = context->input.get();
+    srcml_mapped_input* mapped = context->mapped;
+    bool terminate = false;
+    if (mapped && xmlBufUse(input->buffer) == 0) {
 
-    xmlSAXHandler sax = srcsax_sax2_factory();
-    context->libxml2_context->sax = &sax;
+        size_t size = std::min(mapped->size - mapped->position, max_size);
+        terminate = size == 0;
 
-    sax2_srcsax_handler state;
-    state.context = context;
-    context->libxml2_context->_private = &state;
+        // counted before the parse, since the handlers use it for their offsets
+        mapped->position += size;
+        mapped->parsed += size;
+        xmlParseChunk(ctxt, mapped->data + mapped->position - size, (int) size, terminate);
 
-    int status = xmlParseDocument(context->libxml2_context);
+    } else {
 
-    context->libxml2_context->sax = save_sax;
+        // the next chunk of the input, already decoded to UTF-8 if the input buffer has an encoder
+        if (xmlBufUse(input->buffer) == 0 && xmlParserInputBufferGrow(input, SRCSAX_CHUNK_SIZE) < 0) {
 
-    if (status != 0 && context->srcsax_error) {
+            context->finished = true;
+            return -1;
+        }
 
-        xmlErrorPtr ep = xmlCtxtGetLastError(context->libxml2_context);
+        int size = (int) std::min(xmlBufUse(input->buffer), max_size);
+        terminate = size == 0;
 
-        auto str_length = strlen(ep->message);
-        ep->message[str_length - 1] = '\0';
+        if (mapped)
+            mapped->parsed += (size_t) size;
 
-        context->srcsax_error((const char *)ep->message, ep->code);
+        xmlParseChunk(ctxt, (const char*) xmlBufContent(input->buffer), size, terminate);
+        xmlBufShrink(input->buffer, (size_t) size);
     }
 
-    return status;
+    if (terminate || !ctxt->wellFormed || ctxt->disableSAX)
+        context->finished = true;
+
+    if (!ctxt->wellFormed) {
+
+        if (context->srcsax_error) {
+
+            xmlErrorPtr ep = xmlCtxtGetLastError(ctxt);
+
+            auto str_length = strlen(ep->message);
+            ep->message[str_length - 1] = '\0';
+
+            context->srcsax_error((const char *)ep->message, ep->code);
+        }
+
+        return -1;
+    }
+
+    return context->finished ? 0 : 1;
 }
 
 /**
  * srcsax_create_parser_context
  * @param buffer_input a parser input buffer
  *
- * Create a ctxt from a parser input buffer.
- * Modeled after function in libxml2.
+ * Create a push parser ctxt for the contents of a parser input buffer.
+ * The buffer is not owned by the ctxt, but read in chunks by srcsax_parse_chunk().
  *
  * @returns xml parser ctxt
  */
@@ -154,19 +236,18 @@ xmlParserCtxtPtr srcsax_create_parser_context(xmlParserInputBufferPtr buffer_inp
     if (buffer_input == 0)
         return 0;
 
-    xmlParserCtxtPtr ctxt = xmlNewParserCtxt();
+    xmlParserCtxtPtr ctxt = xmlCreatePushParserCtxt(0, 0, 0, 0, 0);
     if (ctxt == 0)
         return 0;
 
-    xmlCtxtUseOptions(ctxt, XML_PARSE_COMPACT | XML_PARSE_HUGE | XML_PARSE_NODICT);
-
-    xmlParserInputPtr input = xmlNewIOInputStream(ctxt, buffer_input, enc);
-    if (input == 0) {
-        xmlFreeParserCtxt(ctxt);
-        return 0;
-    }
+    // input decoded by the buffer is UTF-8, whatever the declaration says
+    int options = XML_PARSE_COMPACT | XML_PARSE_HUGE | XML_PARSE_NODICT;
+    if (buffer_input->encoder)
+        options |= XML_PARSE_IGNORE_ENC;
+    xmlCtxtUseOptions(ctxt, options);
 
-    inputPush(ctxt, input);
+    if (enc != XML_CHAR_ENCODING_NONE)
+        xmlSwitchEncoding(ctxt, enc);
 
     return ctxt;
 }
@@ -23,6 +23,9 @@
 #include <unit_utilities.hpp>
 #include <libxml/parserInternals.h>
 #include <stack>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
 
 // Update unit attributes with xml parsed attributes
 void unit_update_attributes(srcml_unit* unit, int num_attributes, const xmlChar** attributes) {
@@ -33,60 +36,73 @@ void unit_update_attributes(srcml_unit* unit, int num_attributes, const xmlChar*
         std::string attribute = (const char*) attributes[pos * 5];
         std::string value((const char *)attributes[pos * 5 + 3], attributes[pos * 5 + 4] - attributes[pos * 5 + 3]);
 
-        if (attribute == "timestamp")
-            srcml_unit_set_timestamp(unit, value.c_str());
-        else if (attribute == "hash")
-            srcml_unit_set_hash(unit, value.c_str());
-        else if (attribute == "language")
-            srcml_unit_set_language(unit, value.c_str());
-        else if (attribute == "revision")
-            unit->revision = value;
-        else if (attribute == "filename")
-            srcml_unit_set_filename(unit, value.c_str());
-        else if (attribute == "url")
-            unit->url = value;
-        else if (attribute == "version")
-            srcml_unit_set_version(unit, value.c_str());
-        else if (attribute == "tabs" || attribute == "options" || attribute == "hash")
-            ;
-        else {
-            // if we already have the attribute, then just update the value
-            // otherwise create a new one
-            bool found = false;
-            for (size_t i = 0; i < unit->attributes.size(); i += 2) {
-                if (unit->attributes[i] == attribute) {
-                    found = true;
-                    unit->attributes[i + 1] = value;
-                    break;
-                }
-            }
-            if (!found) {
-                unit->attributes.push_back(attribute);
-                unit->attributes.push_back(value);
+        unit_update_attribute(unit, attribute, value);
+    }
+}
+
+void unit_update_attribute(srcml_unit* unit, const std::string& attribute, const std::string& value) {
+
+    if (attribute == "timestamp")
+        srcml_unit_set_timestamp(unit, value.c_str());
+    else if (attribute == "hash")
+        srcml_unit_set_hash(unit, value.c_str());
+    else if (attribute == "language")
+        srcml_unit_set_language(unit, value.c_str());
+    else if (attribute == "revision")
+        unit->revision = value;
+    else if (attribute == "filename")
+        srcml_unit_set_filename(unit, value.c_str());
+    else if (attribute == "url")
+        unit->url = value;
+    else if (attribute == "version")
+        srcml_unit_set_version(unit, value.c_str());
+    else if (attribute == "tabs" || attribute == "options" || attribute == "hash")
+        ;
+    else {
+        // if we already have the attribute, then just update the value
+        // otherwise create a new one
+        bool found = false;
+        for (size_t i = 0; i < unit->attributes.size(); i += 2) {
+            if (unit->attributes[i] == attribute) {
+                found = true;
+                unit->attributes[i + 1] = value;
+                break;
             }
         }
+        if (!found) {
+            unit->attributes.push_back(attribute);
+            unit->attributes.push_back(value);
+        }
     }
 }
 
 enum { INSERT, DELETE, COMMON};
 
-std::string extract_revision(const char* srcml, int size, int revision, bool text_only) {
+// Extract both revisions from srcdiff srcml in a single pass
+void extract_revisions(const char* srcml, int size, std::string& original, std::string& modified, bool text_only) {
 
     const char* DIFF_PREFIX = "diff:";
 
     std::stack<int> mode;
     mode.push(COMMON);
 
-    std::string news;
+    original.clear();
+    modified.clear();
+    original.reserve(size);
+    modified.reserve(size);
+
     const char* p = srcml;
     const char* lp = p;
     while ((p = (const char*) memchr(p, '<', size - (p - srcml)))) {
 
-        bool inmode = mode.top() == COMMON || (revision == 0 && mode.top() == DELETE) || (revision == 1 && mode.top() == INSERT);
+        bool inoriginal = mode.top() != INSERT;
+        bool inmodified = mode.top() != DELETE;
 
         // output previous non-tag text
-        if (inmode)
-            news.append(lp, p - lp);
+        if (inoriginal)
+            original.append(lp, p - lp);
+        if (inmodified)
+            modified.append(lp, p - lp);
 
         auto sp = p;
 
@@ -109,100 +125,509 @@ std::string extract_revision(const char* srcml, int size, int revision, bool tex
         else if (*(sp + 1) == '/' && strncmp(sp + 2, DIFF_PREFIX, strlen(DIFF_PREFIX)) == 0) {
             mode.pop();
         }
-        else {
-            if (inmode && !text_only)
-                news.append(sp, p - sp);
+        else if (!text_only) {
+            if (inoriginal)
+                original.append(sp, p - sp);
+            if (inmodified)
+                modified.append(sp, p - sp);
         }
 
         lp = p;
     }
+}
 
-    return news;
+/**
+ * unit_revision
+ * @param revisions cache of the revisions of the srcml
+ * @param srcml srcdiff srcml
+ * @param size size of the srcml
+ * @param revision the revision to get
+ *
+ * Both revisions are extracted in one pass the first time either is needed,
+ * so that the other revision is available without another pass.
+ *
+ * @returns the srcml of the revision
+ */
+const char* unit_revision(std::vector<std::string>& revisions, const char* srcml, int size, size_t revision) {
+
+    if (revisions.empty()) {
+        revisions.resize(2);
+        extract_revisions(srcml, size, revisions[SRCDIFF_REVISION_ORIGINAL], revisions[SRCDIFF_REVISION_MODIFIED]);
+    }
+
+    return revisions[revision].c_str();
 }
 
-struct extract_context {
-    std::string s;
-    boost::optional<int> revision;
-    std::stack<int> mode;
-};
+namespace {
+
+    // append a character reference as UTF-8
+    void append_utf8(std::string& src, unsigned long c, size_t eol) {
+
+        if (c < 0x80) {
+            char ch = (char) c;
+            append_eol(src, &ch, 1, eol);
+        } else if (c < 0x800) {
+            src += (char) (0xC0 | (c >> 6));
+            src += (char) (0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            src += (char) (0xE0 | (c >> 12));
+            src += (char) (0x80 | ((c >> 6) & 0x3F));
+            src += (char) (0x80 | (c & 0x3F));
+        } else if (c < 0x110000) {
+            src += (char) (0xF0 | (c >> 18));
+            src += (char) (0x80 | ((c >> 12) & 0x3F));
+            src += (char) (0x80 | ((c >> 6) & 0x3F));
+            src += (char) (0x80 | (c & 0x3F));
+        }
+    }
+
+    // append text, decoding entity and character references, and normalizing
+    // the line endings CR and CRLF to LF, as an XML parser does
+    void append_text(std::string& src, const char* text, const char* end, size_t eol) {
+
+        while (text < end) {
+
+            const char* p = text;
+            while (p < end && *p != '&' && *p != '\r')
+                ++p;
+
+            append_eol(src, text, p - text, eol);
+            if (p == end)
+                break;
+
+            if (*p == '\r') {
+
+                append_eol(src, "\n", 1, eol);
+                text = p + 1;
+                if (text < end && *text == '\n')
+                    ++text;
+                continue;
+            }
+
+            auto semicolon = (const char*) memchr(p, ';', end - p);
+            if (!semicolon) {
+                append_eol(src, p, end - p, eol);
+                break;
+            }
+
+            std::string name(p + 1, semicolon - p - 1);
+            if (name == "lt")
+                src += '<';
+            else if (name == "gt")
+                src += '>';
+            else if (name == "amp")
+                src += '&';
+            else if (name == "quot")
+                src += '"';
+            else if (name == "apos")
+                src += '\'';
+            else if (name.size() > 1 && name[0] == '#')
+                append_utf8(src, name[1] == 'x' ? strtoul(name.c_str() + 2, NULL, 16) : strtoul(name.c_str() + 1, NULL, 10), eol);
+            else
+                src.append(p, semicolon + 1 - p);
+
+            text = semicolon + 1;
+        }
+    }
+
+    // find the end of the tag starting at p, allowing for a '>' in attribute values
+    const char* tag_end(const char* p, const char* end) {
+
+        auto close = (const char*) memchr(p, '>', end - p);
+        if (!close || (!memchr(p, '"', close - p) && !memchr(p, '\'', close - p)))
+            return close;
+
+        char quote = 0;
+        for (; p < end; ++p) {
+            if (quote) {
+                if (*p == quote)
+                    quote = 0;
+            } else if (*p == '"' || *p == '\'') {
+                quote = *p;
+            } else if (*p == '>') {
+                return p;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // find the string s from p, or nullptr if not found
+    const char* find(const char* p, const char* end, const char* s) {
+
+        const size_t size = strlen(s);
+        while ((p = (const char*) memchr(p, s[0], end - p))) {
+
+            if ((size_t) (end - p) < size)
+                return nullptr;
+
+            if (memcmp(p, s, size) == 0)
+                return p;
+
+            ++p;
+        }
+
+        return nullptr;
+    }
+
+    // qualified name of the escape element from the namespaces on the first start tag
+    std::string escape_name(const char* tag, const char* end) {
+
+        const std::string uri = SRCML_SRC_NS_URI;
+        for (const char* p = tag; (p = find(p, end, uri.c_str())); p += uri.size()) {
+
+            if (p - tag < 3 || (p[-1] != '"' && p[-1] != '\'') || p[-2] != '=' || p[uri.size()] != p[-1])
+                continue;
+
+            const char* name = p - 2;
+            while (name > tag && !isspace(name[-1]))
+                --name;
+
+            std::string attribute(name, p - 2);
+            if (attribute == "xmlns")
+                return "escape";
+            if (attribute.compare(0, 6, "xmlns:") == 0)
+                return attribute.substr(6) + ":escape";
+        }
+
+        return "escape";
+    }
+
+    // character value of the char attribute of an escape element
+    bool escape_char(const char* tag, const char* end, char& value) {
+
+        auto attribute = find(tag, end, "char=");
+        if (!attribute || attribute + 6 >= end)
+            return false;
+
+        value = (char) strtol(std::string(attribute + 6, end).c_str(), NULL, 0);
+
+        return true;
+    }
+}
+
+// Append text to src, converting LF to the eol
+void append_eol(std::string& src, const char* text, size_t size, size_t eol) {
+
+    if (eol == SOURCE_OUTPUT_EOL_AUTO || eol == SOURCE_OUTPUT_EOL_LF) {
+        src.append(text, size);
+        return;
+    }
+
+    const char* end = text + size;
+    const char* p = text;
+    while ((p = (const char*) memchr(text, '\n', end - text))) {
+
+        src.append(text, p - text);
+        if (eol == SOURCE_OUTPUT_EOL_CR)
+            src += '\r';
+        else
+            src.append("\r\n", 2);
+
+        text = p + 1;
+    }
+    src.append(text, end - text);
+}
 
 // Extract source code from srcml
-std::string extract_src(const std::string& srcml, boost::optional<int> revision) {
+// Since the srcML was produced by srcML, the text is collected in a single pass
+// over the srcML, without an XML parser, skipping tags and decoding references
+std::string extract_src(const std::string& srcml, size_t eol) {
+
+    std::string src;
+    src.reserve(srcml.size() / 2);
+
+    const char* p = srcml.c_str();
+    const char* end = p + srcml.size();
+    std::string escape;
+    int depth = 0;
+    while (p < end) {
+
+        // only text inside of the unit is source code
+        auto tag = (const char*) memchr(p, '<', end - p);
+        if (!tag)
+            break;
+
+        if (depth > 0)
+            append_text(src, p, tag, eol);
+
+        if (tag + 1 < end && tag[1] == '!') {
+
+            // comments, CDATA sections, and declarations
+            const char* close = nullptr;
+            if (find(tag, end, "<!--") == tag) {
+                close = find(tag + 4, end, "-->");
+                p = close ? close + 3 : end;
+            } else if (find(tag, end, "<![CDATA[") == tag) {
+                close = find(tag + 9, end, "]]>");
+                if (depth > 0)
+                    append_eol(src, tag + 9, (close ? close : end) - (tag + 9), eol);
+                p = close ? close + 3 : end;
+            } else {
+                close = (const char*) memchr(tag, '>', end - tag);
+                p = close ? close + 1 : end;
+            }
+            continue;
+        }
 
-    extract_context scontext;
-    scontext.revision = revision;
-    scontext.mode.push(COMMON);
+        if (tag + 1 < end && tag[1] == '?') {
 
-    // parse the srcml collecting the (now needed) src
-    xmlSAXHandler charactersax;
-    memset(&charactersax, 0, sizeof(charactersax));
-    charactersax.initialized    = XML_SAX2_MAGIC;
+            // processing instructions and the XML declaration
+            auto close = find(tag + 2, end, "?>");
+            p = close ? close + 2 : end;
+            continue;
+        }
 
-    charactersax.ignorableWhitespace = charactersax.characters = [](void* ctx, const xmlChar* ch, int len) {
+        auto close = tag_end(tag, end);
+        if (!close)
+            break;
 
-        auto ctxt = (xmlParserCtxtPtr) ctx;
-        if (ctxt == nullptr)
-            return;
-        auto scontext = (extract_context*) ctxt->_private;
-        if (scontext == nullptr)
-            return;
+        p = close + 1;
 
-        scontext->s.append((const char*) ch, len);
-    };
+        if (tag[1] == '/') {
+            --depth;
+            continue;
+        }
 
-    charactersax.startElementNs = [](void* ctx, const xmlChar* localname, const xmlChar* /* prefix */, const xmlChar* URI,
-                     int /* nb_namespaces */, const xmlChar** /* namespaces */,
-                     int /* nb_attributes */, int /* nb_defaulted */, const xmlChar** attributes) {
+        if (close[-1] != '/')
+            ++depth;
 
-        auto ctxt = (xmlParserCtxtPtr) ctx;
-        if (ctxt == nullptr)
-            return;
-        auto scontext = (extract_context*) ctxt->_private;
-        if (scontext == nullptr)
-            return;
+        // the first start tag declares the prefix of the escape element
+        if (escape.empty())
+            escape = escape_name(tag, close);
 
-        if (strcmp((const char*) localname, "escape") == 0 && strcmp((const char*) URI, SRCML_SRC_NS_URI) == 0) {
-            std::string svalue((const char *)attributes[0 * 5 + 3], attributes[0 * 5 + 4] - attributes[0 * 5 + 3]);
+        // Special element <escape char="0x0c"/> used to embed non-XML characters
+        // extract the value of the char attribute and add to the src (text)
+        char value = 0;
+        if ((size_t) (close - tag) > escape.size() + 1 && memcmp(tag + 1, escape.c_str(), escape.size()) == 0
+            && (isspace(tag[1 + escape.size()]) || tag[1 + escape.size()] == '/' || tag[1 + escape.size()] == '>')
+            && escape_char(tag, close, value))
+            append_eol(src, &value, 1, eol);
+    }
 
-            char value = (int)strtol(svalue.c_str(), NULL, 0);
+    return src;
+}
 
-            scontext->s.append(1, value);
+// XML whitespace
+static inline bool isxmlspace(char c) {
 
-        } else if (scontext->revision && strcmp((const char*) URI, SRCML_DIFF_NS_URI) == 0) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
 
-            if (std::string((const char*) localname) == "INSERT")
-                scontext->mode.push(INSERT);
-            else if (std::string((const char*) localname) == "DELETE")
-                scontext->mode.push(DELETE);
-            else
-                scontext->mode.push(COMMON);
+// Expand compact position attributes, e.g., pos:span="1:4-12", into pos:start="1:4" pos:end="1:12"
+std::string expand_position(const std::string& srcml, const std::string& prefix) {
+
+    const std::string qualified = prefix + (!prefix.empty() ? ":" : "");
+    const std::string spanName = qualified + "span";
+
+    // no compact positions, e.g., an empty unit
+    if (srcml.find(" " + spanName + "=\"") == std::string::npos)
+        return srcml;
+
+    std::string news;
+    news.reserve(srcml.size() + srcml.size() / 4);
+
+    // single pass over the tags, with attribute values skipped using their quotes, since
+    // text, comments, and other attribute values may contain the attribute or a '>'
+    const auto size = srcml.size();
+    const auto begin = srcml.begin();
+    std::string::size_type lp = 0;
+    std::string::size_type p = 0;
+    while ((p = srcml.find('<', p)) != std::string::npos) {
+
+        // comments, CDATA, and processing instructions are copied as is
+        if (p + 1 < size && (srcml[p + 1] == '!' || srcml[p + 1] == '?')) {
+
+            const char* close = ">";
+            if (srcml.compare(p, 4, "<!--") == 0)
+                close = "-->";
+            else if (srcml.compare(p, 9, "<![CDATA[") == 0)
+                close = "]]>";
+            else if (srcml[p + 1] == '?')
+                close = "?>";
+
+            p = srcml.find(close, p + 2);
+            if (p == std::string::npos)
+                break;
+            p += strlen(close);
+            continue;
+        }
+
+        // element name
+        ++p;
+        while (p < size && !isxmlspace(srcml[p]) && srcml[p] != '>' && srcml[p] != '/')
+            ++p;
+
+        // attributes through the end of the tag
+        while (p < size) {
+
+            while (p < size && isxmlspace(srcml[p]))
+                ++p;
+            if (p >= size || srcml[p] == '>' || srcml[p] == '/')
+                break;
+
+            auto name = p;
+            auto equal = srcml.find('=', p);
+            if (equal == std::string::npos)
+                break;
+            auto endname = equal;
+            while (endname > name && isxmlspace(srcml[endname - 1]))
+                --endname;
+            p = equal + 1;
+            while (p < size && isxmlspace(srcml[p]))
+                ++p;
+            if (p >= size || (srcml[p] != '"' && srcml[p] != '\''))
+                break;
+
+            auto value = p + 1;
+            auto endvalue = srcml.find(srcml[p], value);
+            if (endvalue == std::string::npos)
+                break;
+            p = endvalue + 1;
+
+            if (endname - name != spanName.size() || srcml.compare(name, spanName.size(), spanName) != 0)
+                continue;
+
+            auto dash = (std::string::size_type) (std::find(begin + value, begin + endvalue, '-') - begin);
+            if (dash == endvalue)
+                continue;
+
+            std::string start = srcml.substr(value, dash - value);
+            std::string end = srcml.substr(dash + 1, endvalue - dash - 1);
+
+            // end on the same line only stores the column
+            if (end.find(':') == std::string::npos)
+                end = start.substr(0, start.find(':') + 1) + end;
+
+            news.append(srcml, lp, name - lp);
+            news += qualified;
+            news += "start=\"";
+            news += start;
+            news += "\" ";
+            news += qualified;
+            news += "end=\"";
+            news += end;
+            news += "\"";
+
+            lp = p;
+        }
+    }
+    news.append(srcml, lp, std::string::npos);
+
+    return news;
+}
+
+// Append the qualified name of a tree element or attribute
+static void append_qname(std::string& srcml, xmlNsPtr ns, const xmlChar* name) {
+
+    if (ns && ns->prefix) {
+        srcml += (const char*) ns->prefix;
+        srcml += ':';
+    }
+    srcml += (const char*) name;
+}
+
+// Append text escaped the same as by the parser output, which does not escape a carriage return
+static void append_escaped(std::string& srcml, const xmlChar* text, bool attribute) {
+
+    for (const xmlChar* p = text; p && *p; ++p) {
+        switch (*p) {
+        case '<':  srcml += "&lt;";   break;
+        case '>':  srcml += "&gt;";   break;
+        case '&':  srcml += "&amp;";  break;
+        case '"':  srcml += attribute ? "&quot;" : "\""; break;
+        case '\t': srcml += attribute ? "&#9;"   : "\t"; break;
+        case '\n': srcml += attribute ? "&#10;"  : "\n"; break;
+        case '\r': srcml += attribute ? "&#13;"  : "\r"; break;
+        default:   srcml += (char) *p;
         }
-    };
+    }
+}
 
-    xmlParserCtxtPtr context = xmlCreateMemoryParserCtxt(srcml.c_str(), (int) srcml.size());
-    auto save_private = context->_private;
-    context->_private = &scontext;
-    auto save_sax = context->sax;
-    context->sax = &charactersax;
+// Replace the start tag in the srcML of a unit with the regenerated start tag, when there is one
+void unit_update_start_tag(srcml_unit* unit) {
 
-    xmlParseDocument(context);
+    if (!unit->start_tag)
+        return;
 
-    context->_private = save_private;
-    context->sax = save_sax;
+    // the original start tag is followed by either ">" or, for an empty unit, "/>"
+    int content_begin = unit->content_begin;
+    unit->srcml.replace(0, content_begin - 1, *unit->start_tag);
+    unit->content_begin = (int) unit->start_tag->size() + 1;
 
-    xmlFreeParserCtxt(context);
+    // content end is changed since the start unit tag was rewritten
+    unit->content_end += (unit->content_begin - content_begin);
 
-    return scontext.s;
+    unit->start_tag = boost::none;
 }
 
-std::string attribute_revision(const std::string& attribute, int revision) {
+// Generate the srcML of a unit parsed into a tree, from the start tag in the srcML and the contents of the tree
+void unit_srcml_from_tree(srcml_unit* unit) {
+
+    if (!unit->doc)
+        return;
+
+    xmlNodePtr root = xmlDocGetRootElement(unit->doc.get());
+    std::string& srcml = unit->srcml;
+
+    // same as an empty unit in srcML
+    unit->content_begin = (int) srcml.size() + 1;
+    if (!root->children) {
+        srcml += "/>";
+        unit->content_end = unit->content_begin;
+        unit->doc.reset();
+        return;
+    }
+    srcml += ">";
+
+    // preorder traversal of the contents, with the end tag output when leaving an element
+    xmlNodePtr node = root->children;
+    while (node) {
+
+        if (node->type == XML_TEXT_NODE) {
+
+            append_escaped(srcml, node->content, false);
+
+        } else if (node->type == XML_ELEMENT_NODE) {
+
+            srcml += '<';
+            append_qname(srcml, node->ns, node->name);
+
+            for (xmlAttrPtr attr = node->properties; attr; attr = attr->next) {
+                srcml += ' ';
+                append_qname(srcml, attr->ns, attr->name);
+                srcml += "=\"";
+                if (attr->children)
+                    append_escaped(srcml, attr->children->content, true);
+                srcml += '"';
+            }
+
+            if (node->children) {
+                srcml += '>';
+                node = node->children;
+                continue;
+            }
+
+            srcml += "/>";
+        }
+
+        while (node != root && !node->next) {
+            node = node->parent;
+            if (node != root) {
+                srcml += "</";
+                append_qname(srcml, node->ns, node->name);
+                srcml += '>';
+            }
+        }
+
+        node = node != root ? node->next : nullptr;
+    }
 
-    auto pos = attribute.find('|');
-    if (pos == std::string::npos)
-        return attribute;
+    unit->content_end = (int) srcml.size() + 1;
 
-    if (revision == SRCDIFF_REVISION_ORIGINAL)
-        return attribute.substr(0, pos);
+    srcml += "</";
+    append_qname(srcml, root->ns, BAD_CAST "unit");
+    srcml += ">";
 
-    return attribute.substr(pos + 1);
+    unit->doc.reset();
 }
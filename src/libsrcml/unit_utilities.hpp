@@ -30,9 +30,28 @@
 // Update unit attributes with xml parsed attributes
 void unit_update_attributes(srcml_unit* unit, int num_attributes, const xmlChar** attributes);
 
-// Extract source code from srcml
-std::string extract_src(const std::string& srcml, boost::optional<int> revision = boost::none);
-std::string extract_revision(const char* srcml, int size, int revision, bool text_only = false);
-std::string attribute_revision(const std::string& attribute, int revision);
+// Update a unit attribute by its local name
+void unit_update_attribute(srcml_unit* unit, const std::string& attribute, const std::string& value);
+
+// Extract source code from srcml, with LF converted to the eol
+std::string extract_src(const std::string& srcml, size_t eol = SOURCE_OUTPUT_EOL_AUTO);
+
+// Extract both revisions, original and modified, from srcdiff srcml
+void extract_revisions(const char* srcml, int size, std::string& original, std::string& modified, bool text_only = false);
+
+// The revision of srcdiff srcml, with both revisions extracted into the cache the first time either is needed
+const char* unit_revision(std::vector<std::string>& revisions, const char* srcml, int size, size_t revision);
+
+// Append text to src, converting LF to the eol
+void append_eol(std::string& src, const char* text, size_t size, size_t eol);
+
+// Generate the srcML of a unit parsed into a tree, when it has not been already
+void unit_srcml_from_tree(srcml_unit* unit);
+
+// Replace the start tag in the srcML of a unit with the regenerated start tag, when there is one
+void unit_update_start_tag(srcml_unit* unit);
+
+// Expand compact position attributes into the standard start and end position attributes
+std::string expand_position(const std::string& srcml, const std::string& prefix);
 
 #endif
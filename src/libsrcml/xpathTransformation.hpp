@@ -137,6 +137,15 @@ public :
      */
     virtual TransformationResult apply(xmlDocPtr doc, int position) const;
 
+    /**
+     * modifies
+     *
+     * Elements and attributes are added to the doc.
+     *
+     * @returns if apply changes the doc it is applied to
+     */
+    virtual bool modifies() const { return !element.empty() || !attr_name.empty(); }
+
     void addElementXPathResults(xmlDocPtr doc, xmlXPathObjectPtr result_nodes) const;
 
     // element namespace
@@ -116,16 +116,99 @@ srcMLOutput::~srcMLOutput() {
     close();
 }
 
+/**
+ * startTree
+ * @param node element to add the elements and text to
+ *
+ * Build the elements and text under node instead of generating srcML. Until the namespaces
+ * used are known, the elements use namespaces that are not declared in the tree.
+ */
+void srcMLOutput::startTree(xmlNodePtr node) {
+
+    tree = node;
+    tree_carriage_return = false;
+
+    for (auto prefix : { SRC, CPP, ERR, POS, OMP }) {
+
+        const Namespace& ns = namespaces[prefix];
+        tree_namespaces[prefix] = xmlNewNs(0, BAD_CAST ns.uri.c_str(), ns.prefix.empty() ? 0 : BAD_CAST ns.prefix.c_str());
+    }
+}
+
+/**
+ * endTree
+ * @param root root element with the namespace declarations of the unit
+ *
+ * End building the tree. The elements and attributes under root are changed to use the
+ * namespace declarations of root, as if the tree was parsed from the srcML.
+ */
+void srcMLOutput::endTree(xmlNodePtr root) {
+
+    // namespace declaration of root for each namespace used in the tree, found when first used
+    xmlNsPtr declared[OMP + 1] = { nullptr };
+    auto resolve = [&](xmlNsPtr ns) {
+
+        for (int i = SRC; i <= OMP; ++i) {
+
+            if (ns != tree_namespaces[i])
+                continue;
+
+            if (!declared[i])
+                declared[i] = xmlSearchNsByHref(root->doc, root, ns->href);
+            if (!declared[i])
+                declared[i] = xmlNewNs(root, ns->href, ns->prefix);
+
+            return declared[i];
+        }
+
+        return ns;
+    };
+
+    // preorder traversal of the elements under root
+    xmlNodePtr node = root->children;
+    while (node) {
+
+        if (node->type == XML_ELEMENT_NODE) {
+
+            if (node->ns)
+                node->ns = resolve(node->ns);
+
+            for (xmlAttrPtr attr = node->properties; attr; attr = attr->next) {
+                if (attr->ns)
+                    attr->ns = resolve(attr->ns);
+            }
+
+            if (node->children) {
+                node = node->children;
+                continue;
+            }
+        }
+
+        while (node != root && !node->next)
+            node = node->parent;
+
+        node = node != root ? node->next : nullptr;
+    }
+
+    for (auto& ns : tree_namespaces) {
+        xmlFreeNs(ns);
+        ns = nullptr;
+    }
+
+    tree = nullptr;
+}
+
 /**
  * close
+ * @param end_document end the document, e.g., with a newline, before closing
  *
  * Close/finish the output.
  */
-void srcMLOutput::close() {
+void srcMLOutput::close(bool end_document) {
 
     if (xout) {
 
-        if (didwrite)
+        if (didwrite && end_document)
             xmlTextWriterEndDocument(xout);
         xmlFreeTextWriter(xout);
         xout = 0;
@@ -179,6 +262,16 @@ void srcMLOutput::consume(const char* language, const char* revision, const char
     unit_hash = hash;
     unit_encoding = encoding;
 
+    // position attributes for this unit, as the options and prefix may differ between units
+    isposition = isoption(options, SRCML_OPTION_POSITION);
+    if (isposition) {
+        const std::string& prefix = namespaces[POS].prefix;
+        std::string start = " " + prefix + (!prefix.empty() ? ":" : "");
+        startAttribute = start + "start=\"";
+        endAttribute   = start + "end=\"";
+        spanAttribute  = start + "span=\"";
+    }
+
     while (1) {
         const antlr::RefToken& token = input->nextToken();
         if (token->getType() == antlr::Token::EOF_TYPE)
@@ -258,6 +351,24 @@ void srcMLOutput::outputNamespaces(xmlTextWriterPtr xout, const OPTION_TYPE& opt
     if (isoption(options, SRCML_OPTION_DEBUG))
         view.find(SRCML_ERROR_NS_URI)->flags |= NS_USED;
 
+    // record where the first namespace declaration is for individual units, e.g., for removal from the unit start tag
+    namespace_begin = namespace_end = 0;
+    auto writeNamespace = [&](const Namespace& ns) {
+
+        bool first = namespace_end == 0 && !isoption(options, SRCML_OPTION_ARCHIVE);
+        if (first) {
+            xmlTextWriterFlush(xout);
+            namespace_begin = (int) output_buffer->written + 1;
+        }
+
+        srcMLTextWriterWriteNamespace(xout, ns);
+
+        if (first) {
+            xmlTextWriterFlush(xout);
+            namespace_end = (int) output_buffer->written + 1;
+        }
+    };
+
     for (const auto& ns : namespaces) {
 
         // output standard namespaces for outer unit or non-archive unit
@@ -265,13 +376,13 @@ void srcMLOutput::outputNamespaces(xmlTextWriterPtr xout, const OPTION_TYPE& opt
 
             // must be required, or on the root and used
             if ((ns.flags & NS_STANDARD) && ((ns.flags & NS_REQUIRED) || ((ns.flags & NS_ROOT) && (ns.flags & NS_USED)))) {
-                srcMLTextWriterWriteNamespace(xout, ns);
+                writeNamespace(ns);
                 continue;
             }
 
             // must be user registered
             if (ns.flags & NS_REGISTERED && !(ns.flags & NS_STANDARD)) {
-                srcMLTextWriterWriteNamespace(xout, ns);
+                writeNamespace(ns);
                 continue;
             }
         }
@@ -281,7 +392,7 @@ void srcMLOutput::outputNamespaces(xmlTextWriterPtr xout, const OPTION_TYPE& opt
 
             // must be required, must not be on the root, and must be used
             if ((ns.flags & NS_STANDARD) && !(ns.flags & NS_ROOT) && !(ns.flags & NS_REQUIRED) && (ns.flags & NS_USED)) {
-                srcMLTextWriterWriteNamespace(xout, ns);
+                writeNamespace(ns);
                 continue;
             }
         }
@@ -341,6 +452,7 @@ void srcMLOutput::startUnit(const char* language, const char* revision,
         { SRCML_OPTION_CPP_TEXT_ELSE,  "CPP_TEXT_ELSE" },
         { SRCML_OPTION_CPP_MARKUP_IF0, "CPP_MARKUP_IF0" },
         { SRCML_OPTION_LINE,           "LINE" },
+        { SRCML_OPTION_POSITION_COMPACT, "POSITION_COMPACT" },
     }};
     std::string soptions;
     for (const auto& pair : sep) {
@@ -484,6 +596,35 @@ inline void srcMLOutput::processText(const char* s, int size) {
  */
 inline void srcMLOutput::processText(const antlr::RefToken& token) {
 
+    // parse events receive the unescaped text
+    if (parse_handler) {
+
+        if (parse_handler->characters) {
+            const std::string& text = token->getText();
+            parse_handler->characters(parse_context, text.data(), (int) text.size());
+        }
+
+        return;
+    }
+
+    // text is added to the current element of the tree, in a single text node between elements
+    if (tree) {
+
+        const std::string& text = token->getText();
+        if (text.empty())
+            return;
+
+        if (!tree_carriage_return && text.find('\r') != std::string::npos)
+            tree_carriage_return = true;
+
+        if (tree->last && tree->last->type == XML_TEXT_NODE)
+            xmlNodeAddContentLen(tree->last, BAD_CAST text.data(), (int) text.size());
+        else
+            xmlAddChild(tree, xmlNewDocTextLen(tree->doc, BAD_CAST text.data(), (int) text.size()));
+
+        return;
+    }
+
     processText(token->getText());
 }
 
@@ -501,12 +642,26 @@ void srcMLOutput::addPosition(const antlr::RefToken& token) {
     if (stoken->endline < stoken->getLine() || (stoken->endline == stoken->getLine() && stoken->endcolumn < stoken->getColumn()))
             return;
 
-    thread_local const std::string& prefix = namespaces[POS].prefix;
-    thread_local const std::string startAttribute = " " + prefix + (!prefix.empty() ? ":" : "") + "start=\"";
-    thread_local const std::string endAttribute   = " " + prefix + (!prefix.empty() ? ":" : "") + "end=\"";
-
     // highly optimized as this is output for every start tag
 
+    // compact position span attribute, e.g., pos:span="1:4-12" on a single line, pos:span="1:4-2:1" otherwise
+    if (isoption(options, SRCML_OPTION_POSITION_COMPACT)) {
+
+        xmlOutputBufferWrite(output_buffer, (int) spanAttribute.size(), spanAttribute.c_str());
+        xmlOutputBufferWriteString(output_buffer, positoa(token->getLine()));
+        xmlOutputBufferWrite(output_buffer, 1, ":");
+        xmlOutputBufferWriteString(output_buffer, positoa(token->getColumn()));
+        xmlOutputBufferWrite(output_buffer, 1, "-");
+        if (stoken->endline != token->getLine()) {
+            xmlOutputBufferWriteString(output_buffer, positoa(stoken->endline));
+            xmlOutputBufferWrite(output_buffer, 1, ":");
+        }
+        xmlOutputBufferWriteString(output_buffer, positoa(stoken->endcolumn));
+        xmlOutputBufferWrite(output_buffer, 1, "\"");
+
+        return;
+    }
+
     // position start attribute, e.g. pos:start="1:4"
     xmlOutputBufferWrite(output_buffer, (int) startAttribute.size(), startAttribute.c_str());
     xmlOutputBufferWriteString(output_buffer, positoa(token->getLine()));
@@ -535,8 +690,6 @@ void srcMLOutput::processToken(const antlr::RefToken& token, const char* name, c
     if (name[0] == 0)
         return;
 
-    thread_local bool isposition = isoption(options, SRCML_OPTION_POSITION);
-
     if (isstart(token) || isempty(token)) {
 
         // empty prefixes have to be null for output
@@ -564,6 +717,181 @@ void srcMLOutput::processToken(const antlr::RefToken& token, const char* name, c
     }
 }
 
+/**
+ * processEvent
+ * @param token token to process
+ * @param eparts element description of the token
+ *
+ * Callback to deliver the start and/or end of the token element to the parse handler
+ * without generating any srcML.
+ */
+void srcMLOutput::processEvent(const antlr::RefToken& token, const Element& eparts) {
+
+    // no name, no token
+    if (eparts.name[0] == 0)
+        return;
+
+    // use getPrefix() to record that this prefix was used
+    const char* prefix = namespaces[eparts.prefix].getPrefix().c_str();
+    const char* uri = namespaces[eparts.prefix].uri.c_str();
+
+    if ((isstart(token) || isempty(token)) && parse_handler->start_element) {
+
+        // if attribute name and no value, then take text from token
+        std::string text;
+        if (eparts.attr_name && !eparts.attr_value)
+            text = token->getText();
+
+        const char* attributes[4];
+        int num_attributes = 0;
+        if (eparts.attr_name) {
+            attributes[num_attributes * 2] = eparts.attr_name;
+            attributes[num_attributes * 2 + 1] = eparts.attr_value ? eparts.attr_value : text.c_str();
+            ++num_attributes;
+        }
+        if (eparts.attr2_name) {
+            attributes[num_attributes * 2] = eparts.attr2_name;
+            attributes[num_attributes * 2 + 1] = eparts.attr2_value;
+            ++num_attributes;
+        }
+
+        // empty elements, and those with a wrong position, end where they start
+        const srcMLToken* stoken = static_cast<const srcMLToken*>(&(*token));
+        int end_line = stoken->endline;
+        int end_column = stoken->endcolumn;
+        if (isempty(token) || end_line < token->getLine() || (end_line == token->getLine() && end_column < token->getColumn())) {
+            end_line = token->getLine();
+            end_column = token->getColumn();
+        }
+
+        parse_handler->start_element(parse_context, prefix, eparts.name, uri, num_attributes, attributes,
+                                     token->getLine(), token->getColumn(), end_line, end_column);
+    }
+
+    if ((!isstart(token) || isempty(token)) && parse_handler->end_element)
+        parse_handler->end_element(parse_context, prefix, eparts.name, uri);
+}
+
+/**
+ * processUnitEvent
+ * @param token unit token to process
+ *
+ * Deliver the start of the unit element, with the unit attributes, or the
+ * end, as parse events. The parser also issues an empty unit token at the
+ * start, which is not an element of the unit.
+ */
+void srcMLOutput::processUnitEvent(const antlr::RefToken& token) {
+
+    if (isempty(token))
+        return;
+
+    // use getPrefix() to record that this prefix was used
+    const char* prefix = namespaces[SRC].getPrefix().c_str();
+    const char* uri = namespaces[SRC].uri.c_str();
+
+    if (isstart(token) && parse_handler->start_element) {
+
+        // attributes in the order startUnit() outputs them
+        const char* const attrs[][2] = {
+            { UNIT_ATTRIBUTE_REVISION, unit_revision },
+            { UNIT_ATTRIBUTE_LANGUAGE, unit_language },
+            { UNIT_ATTRIBUTE_URL, unit_url },
+            { UNIT_ATTRIBUTE_FILENAME, unit_filename },
+            { UNIT_ATTRIBUTE_VERSION, unit_version },
+            { UNIT_ATTRIBUTE_TIMESTAMP, unit_timestamp },
+            { UNIT_ATTRIBUTE_HASH, unit_hash },
+        };
+
+        std::vector<const char*> attributes;
+        for (const auto& attr : attrs) {
+            if (!attr[1])
+                continue;
+
+            attributes.push_back(attr[0]);
+            attributes.push_back(attr[1]);
+        }
+        for (const auto& attr : unit_attributes)
+            attributes.push_back(attr.c_str());
+
+        // the end of the unit is not known until the parse is complete, so the unit ends where it starts
+        parse_handler->start_element(parse_context, prefix, "unit", uri, (int) attributes.size() / 2, attributes.data(),
+                                     token->getLine(), token->getColumn(), token->getLine(), token->getColumn());
+    }
+
+    if (!isstart(token) && parse_handler->end_element)
+        parse_handler->end_element(parse_context, prefix, "unit", uri);
+}
+
+/**
+ * processTree
+ * @param token token to process
+ * @param eparts element description of the token
+ *
+ * Add the start of the token element to the tree, and/or end it, as
+ * the element would be output in srcML.
+ */
+void srcMLOutput::processTree(const antlr::RefToken& token, const Element& eparts) {
+
+    // no name, no token
+    if (eparts.name[0] == 0)
+        return;
+
+    if (isstart(token) || isempty(token)) {
+
+        // use getPrefix() to record that this prefix was used
+        namespaces[eparts.prefix].getPrefix();
+
+        xmlNodePtr node = xmlNewDocNode(tree->doc, tree_namespaces[eparts.prefix], BAD_CAST eparts.name, 0);
+        xmlAddChild(tree, node);
+        ++openelementcount;
+
+        // if attribute name and no value, then take text from token
+        if (eparts.attr_name)
+            xmlNewProp(node, BAD_CAST eparts.attr_name, BAD_CAST (eparts.attr_value ? eparts.attr_value : token->getText().c_str()));
+
+        if (eparts.attr2_name)
+            xmlNewProp(node, BAD_CAST eparts.attr2_name, BAD_CAST eparts.attr2_value);
+
+        // if position attributes for non-empty start elements
+        if (isposition && !isempty(token))
+            addTreePosition(node, token);
+
+        tree = node;
+    }
+
+    if (!isstart(token) || isempty(token)) {
+
+        --openelementcount;
+        tree = tree->parent;
+    }
+}
+
+/**
+ * addTreePosition
+ * @param node element of the tree
+ * @param token token of the element
+ *
+ * Add the position start and end attributes to the element, the same as addPosition().
+ */
+void srcMLOutput::addTreePosition(xmlNodePtr node, const antlr::RefToken& token) {
+
+    srcMLToken* stoken = static_cast<srcMLToken*>(&(*token));
+
+    // how we detect empty elements: the position is wrong
+    if (stoken->endline < stoken->getLine() || (stoken->endline == stoken->getLine() && stoken->endcolumn < stoken->getColumn()))
+            return;
+
+    std::string start = positoa(token->getLine());
+    start += ':';
+    start += positoa(token->getColumn());
+    xmlNewNsProp(node, tree_namespaces[POS], BAD_CAST "start", BAD_CAST start.c_str());
+
+    std::string end = positoa(stoken->endline);
+    end += ':';
+    end += positoa(stoken->endcolumn);
+    xmlNewNsProp(node, tree_namespaces[POS], BAD_CAST "end", BAD_CAST end.c_str());
+}
+
 /**
  * outputToken
  * @param token token to output
@@ -572,15 +900,30 @@ void srcMLOutput::processToken(const antlr::RefToken& token, const char* name, c
  */
 inline void srcMLOutput::outputToken(const antlr::RefToken& token) {
 
-    // unit element is handled specially
-    if (SUNIT == token->getType())
+    // unit element is handled specially, with only the events delivered here
+    if (SUNIT == token->getType()) {
+        if (parse_handler)
+            processUnitEvent(token);
         return;
+    }
 
     // find the token in the element map. If found and it has a name, then process the token
     auto search = process.find(token->getType());
     if (search != process.end() && search->second.name) {
         const Element& eparts = search->second;
 
+        // deliver events instead of srcML
+        if (parse_handler) {
+            processEvent(token, eparts);
+            return;
+        }
+
+        // build the tree instead of srcML
+        if (tree) {
+            processTree(token, eparts);
+            return;
+        }
+
         // process the token using the fields in the element
         processToken(token, eparts.name,
                     // use getPrefix() to record that this prefix was used
@@ -50,6 +50,9 @@ enum PREFIXES { SRC,
 
 class srcMLOutput;
 
+/** Forward declaration of the parse event callbacks */
+struct srcml_parse_handler;
+
 struct Element {
     char const * const name;
     const PREFIXES prefix;
@@ -113,7 +116,7 @@ public:
                  const char* unit_version, const char* unit_timestamp, const char* unit_hash, const char* encoding);
 
     // close the output
-    void close();
+    void close(bool end_document = true);
 
     // destructor
     ~srcMLOutput();
@@ -196,12 +199,59 @@ public:
 
     bool didwrite = false;
 
+    /** start of the first namespace declaration in the last unit start tag */
+    int namespace_begin = 0;
+
+    /** end of the first namespace declaration, including the following space, in the last unit start tag */
+    int namespace_end = 0;
+
+    /** parse event callbacks, when set these are called instead of generating srcML */
+    const srcml_parse_handler* parse_handler = nullptr;
+
+    /** context passed to the parse event callbacks */
+    void* parse_context = nullptr;
+
+    // build the elements and text under node, instead of generating srcML
+    void startTree(xmlNodePtr node);
+
+    // end building the tree, with its elements using the namespace declarations of root
+    void endTree(xmlNodePtr root);
+
+    /** when set, the current element of the tree that the elements and text are added to */
+    xmlNodePtr tree = nullptr;
+
+    /** text added to the tree has a carriage return, which parsing the srcML would normalize */
+    bool tree_carriage_return = false;
+
 private:
 
+    /** output position attributes in the current unit */
+    bool isposition = false;
+
+    /** start of the position attributes with the position prefix of the current unit, e.g., ' pos:start="' */
+    std::string startAttribute;
+    std::string endAttribute;
+    std::string spanAttribute;
+
     // token handler
     void processToken(const antlr::RefToken& token, const char* name, const char* prefix, const char* attr_name1, const char* attr_value1,
                                 const char* attr_name2, const char* attr_value2);
 
+    // parse event handler
+    void processEvent(const antlr::RefToken& token, const Element& eparts);
+
+    // delivers the unit element as parse events
+    void processUnitEvent(const antlr::RefToken& token);
+
+    // tree handler
+    void processTree(const antlr::RefToken& token, const Element& eparts);
+
+    // adds the position attributes to an element of the tree
+    void addTreePosition(xmlNodePtr node, const antlr::RefToken& token);
+
+    /** namespaces of the elements of the tree, indexed by prefix position, until resolved to those of the root */
+    xmlNsPtr tree_namespaces[OMP + 1] = { nullptr };
+
     int consume_next();
 
     void outputToken(const antlr::RefToken& token);
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test parsing directly into the output, which for Java is the same as the usual output
+define fsrcml <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION" language="Java" filename="sub/a.java"><expr_stmt><expr><name>a</name></expr>;</expr_stmt></unit>
+	STDOUT
+xmlcheck "$fsrcml"
+
+define nestedfile <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION">
+
+	<unit revision="REVISION" language="Java" filename="sub/a.java" hash="a301d91aac4aa1ab4e69cbc59cde4b4fff32f2b8"><expr_stmt><expr><name>a</name></expr>;</expr_stmt></unit>
+
+	<unit revision="REVISION" language="Java" filename="sub/b.java" hash="9a1e1d3d0e27715d29bcfbf72b891b3ece985b36"><expr_stmt><expr><name>b</name></expr>;</expr_stmt></unit>
+
+	</unit>
+	STDOUT
+xmlcheck "$nestedfile"
+
+createfile sub/a.java "a;"
+createfile sub/b.java "b;"
+
+srcml sub/a.java
+check "$fsrcml"
+
+srcml sub/a.java --parse-on-write
+check "$fsrcml"
+
+srcml sub/a.java sub/b.java
+check "$nestedfile"
+
+srcml sub/a.java sub/b.java --parse-on-write
+check "$nestedfile"
+
+srcml --parse-on-write sub/a.java sub/b.java -o sub/ab.xml
+check sub/ab.xml "$nestedfile"
@@ -0,0 +1,35 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test compact position
+define srcml <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" xmlns:pos="http://www.srcML.org/srcML/position" revision="REVISION" language="C++" pos:tabs="8" options="POSITION_COMPACT"/>
+	STDOUT
+
+define fsrcml <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" xmlns:pos="http://www.srcML.org/srcML/position" revision="REVISION" language="C++" filename="sub/a.cpp" pos:tabs="8" options="POSITION_COMPACT"/>
+	STDOUT
+
+xmlcheck "$srcml"
+xmlcheck "$fsrcml"
+createfile sub/a.cpp ""
+
+srcml -l C++ --position-compact < sub/a.cpp
+check "$srcml"
+
+srcml -l C++ --position-compact -o sub/b.cpp.xml < sub/a.cpp
+check sub/b.cpp.xml "$srcml"
+
+srcml sub/a.cpp --position-compact
+check "$fsrcml"
+
+srcml --position-compact sub/a.cpp
+check "$fsrcml"
+
+# source extraction ignores the compact position
+srcml sub/b.cpp.xml
+check ""
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# test parsing the units of srcML archive files ahead of their use, which gives the same output
+define nestedfile <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" revision="REVISION">
+
+	<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" hash="1a2c5d67e6f651ae10b7673c53e8c502c97316d6" revision="REVISION" language="C++" filename="sub/a.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+	</unit>
+
+	<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" hash="520b48acbdb61e411641fd94359a82686d5591eb" revision="REVISION" language="C++" filename="sub/b.cpp"><expr_stmt><expr><name>b</name></expr>;</expr_stmt>
+	</unit>
+
+	</unit>
+	STDOUT
+
+xmlcheck "$nestedfile"
+createfile sub/ab.xml "$nestedfile"
+
+srcml sub/ab.xml --read-ahead --unit 2
+check "b;\n"
+
+srcml sub/ab.xml --read-ahead --unit 1
+check "a;\n"
+
+srcml --read-ahead --to-dir=out sub/ab.xml
+check out/sub/a.cpp "a;\n"
+check out/sub/b.cpp "b;\n"
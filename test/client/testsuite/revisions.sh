@@ -0,0 +1,51 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# extract both revisions of a srcDiff archive
+define srcdiff <<- 'STDOUT'
+	<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	<unit xmlns="http://www.srcML.org/srcML/src" xmlns:diff="http://www.srcML.org/srcDiff" revision="REVISION">
+
+	<unit revision="REVISION" language="C++" filename="sub/a.cpp|sub/b.cpp"><expr_stmt><expr><name><diff:delete type="replace">a</diff:delete><diff:insert type="replace">b</diff:insert></name></expr>;</expr_stmt>
+	</unit>
+
+	<unit revision="REVISION" language="C++" filename="sub/c.cpp"><expr_stmt><expr><name>c</name></expr>;</expr_stmt><diff:insert type="whitespace">
+	</diff:insert><diff:insert><expr_stmt><expr><name>d</name></expr>;</expr_stmt></diff:insert>
+	</unit>
+
+	</unit>
+	STDOUT
+
+createfile diff.xml "$srcdiff"
+
+srcml --revisions --to-dir=rev diff.xml
+check rev/original/sub/a.cpp "a;\n"
+check rev/modified/sub/b.cpp "b;\n"
+check rev/original/sub/c.cpp "c;\n"
+check rev/modified/sub/c.cpp "c;\nd;\n"
+
+# same as extracting each revision on its own
+rmfile rev/original/sub/c.cpp
+rmfile rev/modified/sub/c.cpp
+
+srcml --revision=0 --to-dir=rev/original diff.xml
+check rev/original/sub/c.cpp "c;\n"
+
+srcml --revision=1 --to-dir=rev/modified diff.xml
+check rev/modified/sub/c.cpp "c;\nd;\n"
+
+# requires --to-dir
+srcml --revisions diff.xml
+check_exit 1
+
+srcml --revisions -o rev.cpp diff.xml
+check_exit 1
+
+# excludes --revision
+srcml --revisions --revision=0 --to-dir=rev diff.xml
+check_exit 1
+
+srcml --revision=1 --revisions --to-dir=rev diff.xml
+check_exit 1
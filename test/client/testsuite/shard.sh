@@ -0,0 +1,66 @@
+#!/bin/bash
+
+# test framework
+source $(dirname "$0")/framework_test.sh
+
+# inputs of the same size, so each shard has the same number of them
+createfile a.cpp "a;"
+createfile dir/b.cpp "b;"
+createfile dir/c.cpp "c;"
+createfile f.cpp "f;"
+createfile list.txt "a.cpp\ndir\nf.cpp\n"
+
+# the directory is expanded with the other inputs, and each shard is a range of them in order
+srcml --shard=1/2 a.cpp dir f.cpp -o shard1.xml
+srcml a.cpp dir/b.cpp
+check shard1.xml
+
+srcml --shard=2/2 a.cpp dir f.cpp -o shard2.xml
+srcml dir/c.cpp f.cpp
+check shard2.xml
+
+srcml --shard=1/4 a.cpp dir f.cpp -o shard1.xml
+srcml a.cpp --archive
+check shard1.xml
+
+srcml --shard=3/4 a.cpp dir f.cpp -o shard3.xml
+srcml dir/c.cpp --archive
+check shard3.xml
+
+# a filelist is expanded the same way
+srcml --shard=1/2 --files-from list.txt -o list1.xml
+srcml --files-from list.txt -o all.xml
+srcml --shard=2/2 --files-from list.txt -o list2.xml
+srcml --merge list1.xml list2.xml
+check all.xml
+
+# merging the shards in order is the same as a single run
+srcml a.cpp dir f.cpp -o all.xml
+
+srcml --shard=1/2 a.cpp dir f.cpp -o shard1.xml
+srcml --shard=2/2 a.cpp dir f.cpp -o shard2.xml
+srcml --merge shard1.xml shard2.xml
+check all.xml
+
+srcml --shard=1/3 a.cpp dir f.cpp -o shard1.xml
+srcml --shard=2/3 a.cpp dir f.cpp -o shard2.xml
+srcml --shard=3/3 a.cpp dir f.cpp -o shard3.xml
+srcml --merge shard1.xml shard2.xml shard3.xml
+check all.xml
+
+# a single directory
+srcml dir -o all.xml
+srcml --shard=1/2 dir -o shard1.xml
+srcml --shard=2/2 dir -o shard2.xml
+srcml --merge shard1.xml shard2.xml
+check all.xml
+
+# i/N with 1 <= i <= N
+srcml --shard=0/2 a.cpp
+check_exit 1
+
+srcml --shard=3/2 a.cpp
+check_exit 1
+
+srcml --shard=1 a.cpp
+check_exit 1
@@ -0,0 +1,91 @@
+/**
+ * @file archive_units.hpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef INCLUDED_ARCHIVE_UNITS_HPP
+#define INCLUDED_ARCHIVE_UNITS_HPP
+
+#include <srcml.h>
+
+#include <string>
+
+// srcML of an archive with the url "project" of the units a0.cpp .. , each with an include
+inline std::string archive_units(int num_units) {
+
+    std::string srcml = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                        "<unit xmlns=\"http://www.srcML.org/srcML/src\" xmlns:cpp=\"http://www.srcML.org/srcML/cpp\" revision=\"" SRCML_VERSION_STRING "\" url=\"project\">\n\n";
+    for (int i = 0; i < num_units; ++i) {
+        std::string name = "a" + std::to_string(i);
+        srcml += "<unit revision=\"" SRCML_VERSION_STRING "\" language=\"C++\" filename=\"" + name + ".cpp\">"
+                 "<cpp:include>#<cpp:directive>include</cpp:directive> <cpp:file>&lt;" + name + "&gt;</cpp:file></cpp:include>\n"
+                 "<expr_stmt><expr><name>" + name + "</name></expr>;</expr_stmt>\n</unit>\n\n";
+    }
+    srcml += "</unit>\n";
+
+    return srcml;
+}
+
+// parse the units a0.cpp .. , with the source of their name, into an archive open for writing, then close and free it
+inline void write_archive_units(srcml_archive* archive, int num_units) {
+
+    for (int i = 0; i < num_units; ++i) {
+        std::string name = "a" + std::to_string(i);
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_filename(unit, (name + ".cpp").c_str());
+        srcml_unit_set_language(unit, "C++");
+        srcml_unit_parse_memory(unit, name.c_str(), name.size());
+        srcml_archive_write_unit(archive, unit);
+        srcml_unit_free(unit);
+    }
+
+    srcml_archive_close(archive);
+    srcml_archive_free(archive);
+}
+
+// filename and srcML, or - if not read, of the units of an archive open for reading, read with the pattern of
+// reads (r) and skips (s), stopping after stop reads and skips if not 0, then close and free it
+inline std::string read_archive_units(srcml_archive* archive, const std::string& pattern, size_t stop = 0) {
+
+    std::string result;
+    for (size_t i = 0; !stop || i < stop; ++i) {
+
+        if (pattern[i % pattern.size()] == 's') {
+
+            if (!srcml_archive_skip_unit(archive))
+                break;
+            continue;
+        }
+
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+        if (!unit)
+            break;
+
+        const char* srcml = srcml_unit_get_srcml(unit);
+        result += srcml_unit_get_filename(unit);
+        result += srcml ? srcml : "-";
+        srcml_unit_free(unit);
+    }
+
+    srcml_archive_close(archive);
+    srcml_archive_free(archive);
+
+    return result;
+}
+
+#endif
@@ -27,6 +27,7 @@
 #include <macros.hpp>
 
 #include <fstream>
+#include <cstring>
 
 #if defined(__GNUC__) && !defined(__MINGW32__)
 #include <unistd.h>
@@ -1705,6 +1706,121 @@ int main(int, char* argv[]) {
         free(s);
     }
 
+    /*
+      units parsed with transformations
+    */
+
+    {
+        // srcML of a unit parsed with the options, with or without a transformation, and the srcML of the results
+        auto parse = [](const char* src, unsigned long long options, const char* xpath, std::string& srcml, int& names, std::string& results) {
+
+            char* s = 0;
+            size_t size = 0;
+            srcml_archive* archive = srcml_archive_create();
+            srcml_archive_enable_option(archive, options);
+            srcml_archive_write_open_memory(archive, &s, &size);
+            if (xpath)
+                srcml_append_transform_xpath(archive, xpath);
+
+            srcml_unit* unit = srcml_unit_create(archive);
+            srcml_unit_set_language(unit, "C++");
+            srcml_unit_parse_memory(unit, src, strlen(src));
+
+            names = 0;
+            results.clear();
+            if (xpath) {
+                srcml_transform_result* result = nullptr;
+                srcml_unit_apply_transforms(archive, unit, &result);
+                names = srcml_transform_get_unit_size(result);
+                for (int i = 0; i < names; ++i)
+                    results += srcml_unit_get_srcml(srcml_transform_get_unit(result, i));
+                srcml_transform_free(result);
+            }
+
+            srcml = srcml_unit_get_srcml(unit);
+
+            srcml_unit_free(unit);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+            srcml_memory_free(s);
+        };
+
+        // srcML of the results of the transformation of the unit read from the srcML
+        auto transform = [](const std::string& srcml, unsigned long long options, const char* xpath) {
+
+            srcml_archive* archive = srcml_archive_create();
+            srcml_archive_enable_option(archive, options);
+            srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+            srcml_append_transform_xpath(archive, xpath);
+
+            std::string results;
+            srcml_unit* unit = srcml_archive_read_unit(archive);
+            srcml_transform_result* result = nullptr;
+            srcml_unit_apply_transforms(archive, unit, &result);
+            for (int i = 0; i < srcml_transform_get_unit_size(result); ++i)
+                results += srcml_unit_get_srcml(srcml_transform_get_unit(result, i));
+            srcml_transform_free(result);
+
+            srcml_unit_free(unit);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+
+            return results;
+        };
+
+        const char* sources[] = { "a;\n", "#include <a.h>\nb < c;\n", "a;\r\nb;\r\n", "",
+            "// a & b < c > d\n/* \"e\" */\nchar s[] = \"a & b < c > d \\\"e\\\" \\n\";\n",
+            "#define A(x) ((x) > 0 && (x) < 10)\n#if A(1)\ntemplate<typename T> std::vector<T> f(const T& t) { return { t }; }\n#endif\n",
+            "namespace n {\n\tclass C : public B<C> {\n\tpublic:\n\t\tC() : a('<'), b(u8\"\xc3\xa9\") {}\n\t};\n}\n" };
+        const int counts[] = { 1, 2, 2, 0 };
+        for (int i = 0; i < 7; ++i) {
+            for (auto options : { 0ULL, (unsigned long long) SRCML_OPTION_POSITION }) {
+                for (const char* xpath : { "//src:name", "//src:function/src:name", "//src:comment | //src:literal" }) {
+
+                    std::string expected;
+                    std::string results;
+                    int names = 0;
+                    parse(sources[i], options, 0, expected, names, results);
+
+                    std::string srcml;
+                    parse(sources[i], options, xpath, srcml, names, results);
+                    dassert(srcml, expected);
+                    if (i < 4 && strcmp(xpath, "//src:name") == 0) {
+                        dassert(names, counts[i]);
+                    }
+
+                    // the same as transforming the srcML
+                    dassert(results, transform(expected, options, xpath));
+                }
+            }
+        }
+    }
+
+    {
+        char* s = 0;
+        size_t size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+        srcml_append_transform_xpath_attribute(archive, "//src:name", "foo", "http://www.foo.com", "bar", "baz");
+
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C++");
+        srcml_unit_parse_memory(unit, "a;", 2);
+
+        srcml_transform_result* result = nullptr;
+        srcml_unit_apply_transforms(archive, unit, &result);
+        dassert(srcml_transform_get_unit_size(result), 1);
+        dassert(std::string(srcml_unit_get_srcml_inner(srcml_transform_get_unit(result, 0))), "<expr_stmt><expr><name foo:bar=\"baz\">a</name></expr>;</expr_stmt>");
+        srcml_transform_free(result);
+
+        dassert(std::string(srcml_unit_get_srcml_inner(unit)), "<expr_stmt><expr><name>a</name></expr>;</expr_stmt>");
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_memory_free(s);
+    }
+
     srcml_cleanup_globals();
 
     return 0;
@@ -0,0 +1,225 @@
+/**
+ * @file test_srcml_archive_header_scan.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for srcml_archive_set_header_scan and srcml_archive_read_unit_header
+*/
+
+#include <srcml.h>
+
+#include <macros.hpp>
+
+#include <string>
+#include <fstream>
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include <dassert.hpp>
+
+int main(int, char* argv[]) {
+
+    const std::string srcml_archive_units = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(" url="project">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp" hash="aa"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<!-- comment -->
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C" filename="b &lt;1&gt;.c" hash="bb"><comment type="block">/* b
+ */</comment>
+<expr_stmt><expr><name>b</name></expr>;</expr_stmt><escape char="0xc"/></unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="Java" filename="c.java"><expr_stmt><expr><literal type="string">"&gt;
+"</literal></expr>;</expr_stmt>
+</unit>
+
+</unit>
+)";
+
+    const std::string srcml_solitary = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+<expr_stmt><expr><name>b</name></expr>;</expr_stmt>
+</unit>
+)";
+
+    /*
+      srcml_archive_set_header_scan
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_get_header_scan(archive), 0);
+        dassert(srcml_archive_set_header_scan(archive, 1), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_header_scan(archive), 1);
+        dassert(srcml_archive_set_header_scan(archive, 0), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_header_scan(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_set_header_scan(0, 1), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_header_scan(0), 0);
+    }
+
+    /*
+      srcml_archive_read_unit_header
+    */
+
+    {
+        // headers read with and without a header scan
+        std::string headers[2];
+        for (int header_scan = 0; header_scan < 2; ++header_scan) {
+
+            srcml_archive* archive = srcml_archive_create();
+            srcml_archive_set_header_scan(archive, header_scan);
+            srcml_archive_read_open_memory(archive, srcml_archive_units.c_str(), srcml_archive_units.size());
+
+            while (srcml_unit* unit = (header_scan ? srcml_archive_read_unit_header(archive) : srcml_archive_read_unit(archive))) {
+                headers[header_scan] += srcml_unit_get_filename(unit) ? srcml_unit_get_filename(unit) : "-";
+                headers[header_scan] += " ";
+                headers[header_scan] += srcml_unit_get_language(unit) ? srcml_unit_get_language(unit) : "-";
+                headers[header_scan] += " ";
+                headers[header_scan] += srcml_unit_get_hash(unit) ? srcml_unit_get_hash(unit) : "-";
+                headers[header_scan] += " " + std::to_string(srcml_unit_get_loc(unit)) + "\n";
+                srcml_unit_free(unit);
+            }
+
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+        }
+
+        dassert(headers[1], headers[0]);
+        dassert(headers[1], std::string("a.cpp C++ aa 1\nb <1>.c C bb 3\nc.java Java - 2\n"));
+    }
+
+    {
+        // headers read with and without a header scan
+        std::string headers[2];
+        for (int header_scan = 0; header_scan < 2; ++header_scan) {
+
+            srcml_archive* archive = srcml_archive_create();
+            srcml_archive_set_header_scan(archive, header_scan);
+            srcml_archive_read_open_memory(archive, srcml_solitary.c_str(), srcml_solitary.size());
+
+            while (srcml_unit* unit = (header_scan ? srcml_archive_read_unit_header(archive) : srcml_archive_read_unit(archive))) {
+                headers[header_scan] += srcml_unit_get_filename(unit) ? srcml_unit_get_filename(unit) : "-";
+                headers[header_scan] += " ";
+                headers[header_scan] += srcml_unit_get_language(unit) ? srcml_unit_get_language(unit) : "-";
+                headers[header_scan] += " ";
+                headers[header_scan] += srcml_unit_get_hash(unit) ? srcml_unit_get_hash(unit) : "-";
+                headers[header_scan] += " " + std::to_string(srcml_unit_get_loc(unit)) + "\n";
+                srcml_unit_free(unit);
+            }
+
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+        }
+
+        dassert(headers[1], headers[0]);
+        dassert(headers[1], std::string("a.cpp C++ - 2\n"));
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_archive_units.c_str(), srcml_archive_units.size());
+
+        srcml_unit* unit = srcml_archive_read_unit_header(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a.cpp"));
+        srcml_unit_free(unit);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_read_unit_header(0), 0);
+    }
+
+    /*
+      skip and count with a header scan
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_header_scan(archive, 1);
+        srcml_archive_read_open_memory(archive, srcml_archive_units.c_str(), srcml_archive_units.size());
+
+        dassert(srcml_archive_get_url(archive), std::string("project"));
+        dassert(srcml_archive_skip_unit(archive), 1);
+
+        // only headers are read
+        dassert(srcml_archive_read_unit(archive), 0);
+
+        srcml_unit* unit = srcml_archive_read_unit_header(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("c.java"));
+        srcml_unit_free(unit);
+
+        dassert(srcml_archive_skip_unit(archive), 0);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      large archive file
+    */
+
+    {
+        std::ofstream out("project_header_scan.xml", std::ios::binary);
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+               "<unit xmlns=\"http://www.srcML.org/srcML/src\" revision=\"" SRCML_VERSION_STRING "\">\n\n";
+        for (int i = 0; i < 10000; ++i)
+            out << "<unit revision=\"" SRCML_VERSION_STRING "\" language=\"C++\" filename=\"a" << i << ".cpp\">"
+                << "<expr_stmt><expr><name>a</name></expr>;</expr_stmt>\n<expr_stmt><expr><name>b</name></expr>;</expr_stmt>\n</unit>\n\n";
+        out << "</unit>\n";
+        out.close();
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_header_scan(archive, 1);
+        srcml_archive_read_open_filename(archive, "project_header_scan.xml");
+
+        int count = 0;
+        long loc = 0;
+        std::string last;
+        while (srcml_unit* unit = srcml_archive_read_unit_header(archive)) {
+            ++count;
+            loc += srcml_unit_get_loc(unit);
+            last = srcml_unit_get_filename(unit);
+            srcml_unit_free(unit);
+        }
+        dassert(count, 10000);
+        dassert(loc, 20000);
+        dassert(last, std::string("a9999.cpp"));
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        UNLINK("project_header_scan.xml");
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * @file test_srcml_archive_index.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for unit indexes and srcml_archive_read_unit_at
+*/
+
+#include <srcml.h>
+
+#include <macros.hpp>
+
+#include <string>
+#include <fstream>
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include <dassert.hpp>
+#include <archive_units.hpp>
+
+int main(int, char* argv[]) {
+
+    /*
+      srcml_archive_enable_index
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_has_index(archive), 0);
+        dassert(srcml_archive_enable_index(archive), SRCML_STATUS_OK);
+        dassert(srcml_archive_has_index(archive), 1);
+        dassert(srcml_archive_disable_index(archive), SRCML_STATUS_OK);
+        dassert(srcml_archive_has_index(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_enable_index(0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_disable_index(0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_has_index(0), 0);
+    }
+
+    /*
+      srcml_archive_read_unit_at with an index
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_enable_index(archive);
+        srcml_archive_write_open_filename(archive, "project_index.xml");
+        write_archive_units(archive, 7);
+        dassert(std::ifstream("project_index.xml.idx").good(), true);
+
+        archive = srcml_archive_create();
+        dassert(srcml_archive_read_open_filename(archive, "project_index.xml"), SRCML_STATUS_OK);
+        dassert(srcml_archive_has_index(archive), 1);
+
+        srcml_unit* unit = srcml_archive_read_unit_at(archive, 5);
+        dassert(srcml_unit_get_filename(unit), std::string("a5.cpp"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a6.cpp"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit_at(archive, 0);
+        dassert(srcml_unit_get_filename(unit), std::string("a0.cpp"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a1.cpp"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit_at(archive, 6);
+        dassert(srcml_unit_get_filename(unit), std::string("a6.cpp"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit(archive);
+        dassert(unit, 0);
+        unit = srcml_archive_read_unit_at(archive, 3);
+        dassert(srcml_unit_get_filename(unit), std::string("a3.cpp"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a4.cpp"));
+        srcml_unit_free(unit);
+        dassert(srcml_archive_read_unit_at(archive, 7), 0);
+
+        unit = srcml_archive_read_unit_at(archive, 2);
+        dassert(srcml_unit_get_filename(unit), std::string("a2.cpp"));
+        dassert(!srcml_unit_get_srcml(unit), false);
+        srcml_unit_free(unit);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        // skips with an index
+        archive = srcml_archive_create();
+        srcml_archive_read_open_filename(archive, "project_index.xml");
+        dassert(srcml_archive_skip_units(archive, 4), 1);
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a4.cpp"));
+        srcml_unit_free(unit);
+        dassert(srcml_archive_skip_units(archive, 2), 1);
+        dassert(srcml_archive_read_unit(archive), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        archive = srcml_archive_create();
+        srcml_archive_read_open_filename(archive, "project_index.xml");
+        dassert(srcml_archive_skip_units(archive, 8), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        // writing the archive again without an index removes the index
+        archive = srcml_archive_create();
+        srcml_archive_write_open_filename(archive, "project_index.xml");
+        write_archive_units(archive, 3);
+        dassert(std::ifstream("project_index.xml.idx").good(), false);
+
+        archive = srcml_archive_create();
+        srcml_archive_read_open_filename(archive, "project_index.xml");
+        dassert(srcml_archive_has_index(archive), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        UNLINK("project_index.xml");
+        UNLINK("project_index.xml.idx");
+    }
+
+    /*
+      srcml_archive_read_unit_at without an index
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_filename(archive, "project_index.xml");
+        write_archive_units(archive, 7);
+
+        archive = srcml_archive_create();
+        srcml_archive_read_open_filename(archive, "project_index.xml");
+        dassert(srcml_archive_has_index(archive), 0);
+        srcml_unit* unit = srcml_archive_read_unit_at(archive, 2);
+        dassert(srcml_unit_get_filename(unit), std::string("a2.cpp"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a3.cpp"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit_at(archive, 4);
+        dassert(srcml_unit_get_filename(unit), std::string("a4.cpp"));
+        srcml_unit_free(unit);
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a5.cpp"));
+        srcml_unit_free(unit);
+        dassert(srcml_archive_read_unit_at(archive, 1), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        UNLINK("project_index.xml");
+    }
+
+    {
+        dassert(srcml_archive_read_unit_at(0, 0), 0);
+
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_read_unit_at(archive, 0), 0);
+        srcml_archive_free(archive);
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file test_srcml_archive_read_ahead.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for srcml_archive_set_read_ahead
+*/
+
+#include <srcml.h>
+
+#include <string>
+
+#include <dassert.hpp>
+#include <archive_units.hpp>
+
+int main(int, char* argv[]) {
+
+    /*
+      srcml_archive_set_read_ahead
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_get_read_ahead_units(archive), 0);
+        dassert(srcml_archive_get_read_ahead_bytes(archive), 0);
+        dassert(srcml_archive_set_read_ahead(archive, 16, 4096), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_read_ahead_units(archive), 16);
+        dassert(srcml_archive_get_read_ahead_bytes(archive), 4096);
+        dassert(srcml_archive_set_read_ahead(archive, 0, 0), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_read_ahead_units(archive), 0);
+        dassert(srcml_archive_get_read_ahead_bytes(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_set_read_ahead(0, 16, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_read_ahead_units(0), 0);
+        dassert(srcml_archive_get_read_ahead_bytes(0), 0);
+    }
+
+    /*
+      reading ahead
+    */
+
+    {
+        const std::string srcml = archive_units(200);
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        std::string expected = read_archive_units(archive, "r");
+
+        archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        std::string expected_skips = read_archive_units(archive, "rss");
+
+        // limited by units, by bytes, and by both
+        archive = srcml_archive_create();
+        srcml_archive_set_read_ahead(archive, 1, 0);
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        dassert(read_archive_units(archive, "r"), expected);
+
+        archive = srcml_archive_create();
+        srcml_archive_set_read_ahead(archive, 16, 0);
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        dassert(read_archive_units(archive, "r"), expected);
+
+        archive = srcml_archive_create();
+        srcml_archive_set_read_ahead(archive, 0, 1);
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        dassert(read_archive_units(archive, "r"), expected);
+
+        archive = srcml_archive_create();
+        srcml_archive_set_read_ahead(archive, 0, 1000);
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        dassert(read_archive_units(archive, "r"), expected);
+
+        archive = srcml_archive_create();
+        srcml_archive_set_read_ahead(archive, 8, 1000);
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        dassert(read_archive_units(archive, "r"), expected);
+
+        // skips
+        archive = srcml_archive_create();
+        srcml_archive_set_read_ahead(archive, 16, 0);
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        dassert(read_archive_units(archive, "rss"), expected_skips);
+
+        archive = srcml_archive_create();
+        srcml_archive_set_read_ahead(archive, 0, 1000);
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        dassert(read_archive_units(archive, "rss"), expected_skips);
+
+        // close before the end of the input
+        archive = srcml_archive_create();
+        srcml_archive_set_read_ahead(archive, 4, 0);
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        dassert(read_archive_units(archive, "r", 10), expected.substr(0, expected.find("a10.cpp<")));
+
+        archive = srcml_archive_create();
+        srcml_archive_set_read_ahead(archive, 4, 0);
+        srcml_archive_read_open_memory(archive, srcml.c_str(), srcml.size());
+        dassert(read_archive_units(archive, "r", 1), expected.substr(0, expected.find("a1.cpp<")));
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
@@ -129,6 +129,36 @@ int main(int, char* argv[]) {
         srcml_archive_free(archive);
     }
 
+    {
+        // a regular file mapped when enabled, and its units are the same as from memory
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_enable_mmap(archive), SRCML_STATUS_OK);
+        dassert(srcml_archive_read_open_filename(archive, "project.xml"), SRCML_STATUS_OK);
+        srcml_archive* marchive = srcml_archive_create();
+        dassert(srcml_archive_read_open_memory(marchive, srcml.c_str(), srcml.size()), SRCML_STATUS_OK);
+
+        for (int i = 0; i < 2; ++i) {
+            srcml_unit* unit = srcml_archive_read_unit(archive);
+            srcml_unit* munit = srcml_archive_read_unit(marchive);
+            dassert(std::string(srcml_unit_get_srcml(unit)), std::string(srcml_unit_get_srcml(munit)));
+            dassert(std::string(srcml_unit_get_srcml_outer(unit)), std::string(srcml_unit_get_srcml_outer(munit)));
+            dassert(std::string(srcml_unit_get_srcml_inner(unit)), std::string(srcml_unit_get_srcml_inner(munit)));
+            srcml_unit_free(unit);
+            srcml_unit_free(munit);
+        }
+        dassert(srcml_archive_read_unit(archive), 0);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_archive_close(marchive);
+        srcml_archive_free(marchive);
+    }
+
+    {
+        dassert(srcml_archive_enable_mmap(0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_disable_mmap(0), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
     {
         srcml_archive* archive = srcml_archive_create();
         dassert(srcml_archive_read_open_filename(archive, "foobar.xml"), SRCML_STATUS_IO_ERROR);
@@ -0,0 +1,170 @@
+/**
+ * @file test_srcml_archive_read_threads.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for srcml_archive_set_read_threads
+*/
+
+#include <srcml.h>
+
+#include <macros.hpp>
+
+#include <string>
+#include <fstream>
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include <dassert.hpp>
+#include <archive_units.hpp>
+
+int main(int, char* argv[]) {
+
+    /*
+      srcml_archive_set_read_threads
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_get_read_threads(archive), 0);
+        dassert(srcml_archive_set_read_threads(archive, 4), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_read_threads(archive), 4);
+        dassert(srcml_archive_set_read_threads(archive, -1), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_read_threads(archive), 4);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_set_read_threads(0, 4), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_read_threads(0), 0);
+    }
+
+    /*
+      reading in parallel
+    */
+
+    {
+        std::ofstream("project_read_threads.xml", std::ios::binary) << archive_units(8000);
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        std::string expected = read_archive_units(archive, "r");
+
+        archive = srcml_archive_create();
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        std::string expected_skips = read_archive_units(archive, "rss");
+
+        dassert((expected.find("a7999.cpp") != std::string::npos), true);
+
+        archive = srcml_archive_create();
+        srcml_archive_set_read_threads(archive, 2);
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        dassert(read_archive_units(archive, "r"), expected);
+
+        archive = srcml_archive_create();
+        srcml_archive_set_read_threads(archive, 4);
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        dassert(srcml_archive_get_url(archive), std::string("project"));
+        dassert(read_archive_units(archive, "r"), expected);
+
+        // skips
+        archive = srcml_archive_create();
+        srcml_archive_set_read_threads(archive, 4);
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        dassert(read_archive_units(archive, "rss"), expected_skips);
+
+        // close before the end of the input
+        archive = srcml_archive_create();
+        srcml_archive_set_read_threads(archive, 4);
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        dassert(read_archive_units(archive, "r", 5000), expected.substr(0, expected.find("a5000.cpp<")));
+
+        // direct access to a unit
+        archive = srcml_archive_create();
+        srcml_archive_set_read_threads(archive, 4);
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        srcml_unit* unit = srcml_archive_read_unit_at(archive, 6000);
+        dassert(srcml_unit_get_filename(unit), std::string("a6000.cpp"));
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        UNLINK("project_read_threads.xml");
+    }
+
+    /*
+      unit start tags in comments and processing instructions
+    */
+
+    {
+        std::string srcml = archive_units(8000);
+        std::string bogus;
+        for (int i = 0; i < 100; ++i)
+            bogus += "<unit filename=\"bogus.cpp\">";
+        for (size_t pos = 0, i = 0; (pos = srcml.find("\n\n<unit ", pos)) != std::string::npos; pos += 2, ++i) {
+            if (i % 10 == 0)
+                srcml.insert(pos + 2, "<!-- " + bogus + " -->\n");
+            else if (i % 10 == 5)
+                srcml.insert(pos + 2, "<?bogus " + bogus + " ?>\n");
+        }
+        std::ofstream("project_read_threads.xml", std::ios::binary) << srcml;
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        std::string expected = read_archive_units(archive, "r");
+
+        dassert((expected.find("a7999.cpp") != std::string::npos), true);
+        dassert((expected.find("bogus.cpp") == std::string::npos), true);
+
+        archive = srcml_archive_create();
+        srcml_archive_set_read_threads(archive, 4);
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        dassert(read_archive_units(archive, "r"), expected);
+
+        UNLINK("project_read_threads.xml");
+    }
+
+    /*
+      small archives are read in a single thread
+    */
+
+    {
+        std::ofstream("project_read_threads.xml", std::ios::binary) << archive_units(10);
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        std::string expected = read_archive_units(archive, "r");
+
+        archive = srcml_archive_create();
+        srcml_archive_set_read_threads(archive, 4);
+        srcml_archive_read_open_filename(archive, "project_read_threads.xml");
+        dassert(read_archive_units(archive, "r"), expected);
+
+        UNLINK("project_read_threads.xml");
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
@@ -238,6 +238,36 @@ int main(int, char* argv[]) {
         dassert(srcml_archive_set_tabstop(0, 4), SRCML_STATUS_INVALID_ARGUMENT);
     }
 
+    /*
+      srcml_archive_set_gzip_threads
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+
+        dassert(srcml_archive_set_gzip_threads(archive, 0), SRCML_STATUS_OK);
+        dassert(srcml_archive_get_gzip_threads(archive), 0);
+        if (srcml_archive_set_gzip_threads(archive, 4) == SRCML_STATUS_OK) {
+            dassert(srcml_archive_get_gzip_threads(archive), 4);
+        } else {
+            dassert(srcml_archive_get_gzip_threads(archive), 0);
+        }
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+
+        dassert(srcml_archive_set_gzip_threads(archive, -1), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_gzip_threads(archive), 0);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_set_gzip_threads(0, 4), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_gzip_threads(0), 0);
+    }
+
     /*
       srcml_archive_register_file_extension
     */
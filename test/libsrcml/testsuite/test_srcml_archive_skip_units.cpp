@@ -0,0 +1,156 @@
+/**
+ * @file test_srcml_archive_skip_units.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for srcml_archive_skip_units and seekable gzip archives
+*/
+
+#include <srcml.h>
+
+#include <macros.hpp>
+
+#include <string>
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include <dassert.hpp>
+#include <archive_units.hpp>
+
+int main(int, char* argv[]) {
+
+    /*
+      srcml_archive_set_gzip_frame_units
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_get_gzip_frame_units(archive), 0);
+        if (srcml_archive_set_gzip_frame_units(archive, 2) == SRCML_STATUS_OK) {
+            dassert(srcml_archive_get_gzip_frame_units(archive), 2);
+        }
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_archive_set_gzip_frame_units(0, 2), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_get_gzip_frame_units(0), 0);
+    }
+
+    /*
+      srcml_archive_skip_units
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_filename(archive, "project_skip.xml");
+        write_archive_units(archive, 7);
+
+        for (int num_skip : { 0, 3, 6, 7 }) {
+            archive = srcml_archive_create();
+            srcml_archive_read_open_filename(archive, "project_skip.xml");
+            srcml_unit* unit = srcml_archive_skip_units(archive, num_skip) ? srcml_archive_read_unit(archive) : 0;
+            std::string filename = unit ? srcml_unit_get_filename(unit) : "";
+            dassert(filename, (num_skip < 7 ? "a" + std::to_string(num_skip) + ".cpp" : ""));
+            srcml_unit_free(unit);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+        }
+
+        UNLINK("project_skip.xml");
+    }
+
+    {
+        dassert(srcml_archive_skip_units(0, 1), 0);
+
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_skip_units(archive, 1), 0);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      seekable gzip archives
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        bool supported = srcml_archive_set_gzip_frame_units(archive, 2) == SRCML_STATUS_OK;
+        srcml_archive_free(archive);
+
+        if (supported) {
+
+            archive = srcml_archive_create();
+            srcml_archive_set_gzip_frame_units(archive, 2);
+            srcml_archive_write_open_filename(archive, "project_skip.xml.gz");
+            write_archive_units(archive, 7);
+
+            // every unit in order
+            archive = srcml_archive_create();
+            dassert(srcml_archive_read_open_filename(archive, "project_skip.xml.gz"), SRCML_STATUS_OK);
+            for (int i = 0; i < 7; ++i) {
+                srcml_unit* unit = srcml_archive_read_unit(archive);
+                dassert(!unit, false);
+                dassert(srcml_unit_get_filename(unit), "a" + std::to_string(i) + ".cpp");
+                dassert(!srcml_unit_get_srcml_outer(unit), false);
+                srcml_unit_free(unit);
+            }
+            dassert(srcml_archive_read_unit(archive), 0);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+
+            // skips within and across frames
+            for (int num_skip : { 0, 1, 2, 3, 4, 5, 6, 7, 100 }) {
+                archive = srcml_archive_create();
+                srcml_archive_read_open_filename(archive, "project_skip.xml.gz");
+                srcml_unit* unit = srcml_archive_skip_units(archive, num_skip) ? srcml_archive_read_unit(archive) : 0;
+                std::string filename = unit ? srcml_unit_get_filename(unit) : "";
+                dassert(filename, (num_skip < 7 ? "a" + std::to_string(num_skip) + ".cpp" : ""));
+                srcml_unit_free(unit);
+                srcml_archive_close(archive);
+                srcml_archive_free(archive);
+            }
+
+            // repeated skips from a position
+            archive = srcml_archive_create();
+            srcml_archive_read_open_filename(archive, "project_skip.xml.gz");
+            dassert(srcml_archive_skip_units(archive, 1), 1);
+            dassert(srcml_archive_skip_units(archive, 3), 1);
+            srcml_unit* unit = srcml_archive_read_unit(archive);
+            dassert(srcml_unit_get_filename(unit), std::string("a4.cpp"));
+            srcml_unit_free(unit);
+            dassert(srcml_archive_skip_units(archive, 1), 1);
+            unit = srcml_archive_read_unit(archive);
+            dassert(srcml_unit_get_filename(unit), std::string("a6.cpp"));
+            srcml_unit_free(unit);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+
+            UNLINK("project_skip.xml.gz");
+        }
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file test_srcml_archive_srcdiff_revision.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for reading both revisions of a srcDiff archive
+*/
+
+#include <srcml.h>
+
+#include <macros.hpp>
+
+#include <string>
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include <dassert.hpp>
+
+int main(int, char* argv[]) {
+
+    const std::string srcdiff = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" xmlns:diff="http://www.srcML.org/srcDiff" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp|b.cpp"><expr_stmt><expr><name><diff:delete type="replace">a</diff:delete><diff:insert type="replace">b</diff:insert></name></expr>;</expr_stmt>
+<diff:insert type="replace"><expr_stmt><expr><name>c</name></expr>;</expr_stmt>
+</diff:insert></unit>
+
+</unit>
+)";
+
+    const std::string original_inner = R"(<expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+)";
+
+    const std::string modified_inner = R"(<expr_stmt><expr><name>b</name></expr>;</expr_stmt>
+<expr_stmt><expr><name>c</name></expr>;</expr_stmt>
+)";
+
+    /*
+      both revisions of a unit from a single read
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcdiff.c_str(), srcdiff.size());
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+
+        for (int i = 0; i < 2; ++i) {
+
+            srcml_archive_set_srcdiff_revision(archive, SRCDIFF_REVISION_ORIGINAL);
+            dassert(srcml_unit_get_srcml_inner(unit), original_inner);
+
+            char* s;
+            size_t size;
+            srcml_unit_set_src_encoding(unit, "UTF-8");
+            dassert(srcml_unit_unparse_memory(unit, &s, &size), SRCML_STATUS_OK);
+            dassert(std::string(s, size), std::string("a;\n"));
+            srcml_memory_free(s);
+
+            srcml_archive_set_srcdiff_revision(archive, SRCDIFF_REVISION_MODIFIED);
+            dassert(srcml_unit_get_srcml_inner(unit), modified_inner);
+
+            dassert(srcml_unit_unparse_memory(unit, &s, &size), SRCML_STATUS_OK);
+            dassert(std::string(s, size), std::string("b;\nc;\n"));
+            srcml_memory_free(s);
+        }
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      both revisions written to separate archives
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcdiff.c_str(), srcdiff.size());
+
+        char* outputs[2];
+        size_t sizes[2];
+        srcml_archive* revisions[2];
+        for (int i = 0; i < 2; ++i) {
+            revisions[i] = srcml_archive_create();
+            srcml_archive_write_open_memory(revisions[i], &outputs[i], &sizes[i]);
+        }
+
+        while (srcml_unit* unit = srcml_archive_read_unit(archive)) {
+
+            for (int i = 0; i < 2; ++i) {
+                srcml_archive_set_srcdiff_revision(archive, i);
+                dassert(srcml_archive_write_unit(revisions[i], unit), SRCML_STATUS_OK);
+            }
+            srcml_unit_free(unit);
+        }
+
+        for (int i = 0; i < 2; ++i) {
+            srcml_archive_close(revisions[i]);
+            srcml_archive_free(revisions[i]);
+        }
+
+        std::string original(outputs[0], sizes[0]);
+        std::string modified(outputs[1], sizes[1]);
+        dassert((original.find("filename=\"a.cpp\">" + original_inner + "</unit>") != std::string::npos), true);
+        dassert((modified.find("filename=\"b.cpp\">" + modified_inner + "</unit>") != std::string::npos), true);
+        dassert((original.find("diff:") == std::string::npos), true);
+        dassert((modified.find("diff:") == std::string::npos), true);
+
+        srcml_memory_free(outputs[0]);
+        srcml_memory_free(outputs[1]);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
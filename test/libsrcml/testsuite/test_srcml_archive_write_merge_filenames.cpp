@@ -0,0 +1,310 @@
+/**
+ * @file test_srcml_archive_write_merge_filenames.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for srcml_archive_write_merge_filenames
+*/
+
+#include <srcml.h>
+
+#include <macros.hpp>
+
+#include <string>
+#include <fstream>
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include <dassert.hpp>
+
+int main(int, char* argv[]) {
+
+    const std::string srcml_a = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(" url="project">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp" hash="aa"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="b.cpp" hash="bb"/>
+
+</unit>
+)";
+
+    const std::string srcml_b = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(" url="project">
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="c.cpp" hash="cc"><cpp:empty>#</cpp:empty>
+</unit>
+
+</unit>
+)";
+
+    const std::string srcml_other = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(" url="other">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C" filename="d.c" hash="dd"><name>d</name></unit>
+
+</unit>
+)";
+
+    const std::string srcml_options = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(" url="project" options="LINE">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C" filename="e.c" hash="ee"><name>e</name></unit>
+
+</unit>
+)";
+
+    const std::string srcml_position = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" xmlns:pos="http://www.srcML.org/srcML/position" revision=")" SRCML_VERSION_STRING R"(" pos:tabs="4"><macro-list token="MACRO" type="src:macro"/>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C" filename="f.c" pos:tabs="4"><name pos:start="1:1" pos:end="1:1">f</name></unit>
+
+</unit>
+)";
+
+    const std::string srcml_single = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="s.cpp"><cpp:empty>#</cpp:empty>
+</unit>
+)";
+
+    std::ofstream("merge_a.xml", std::ios::binary) << srcml_a;
+    std::ofstream("merge_b.xml", std::ios::binary) << srcml_b;
+    std::ofstream("merge_other.xml", std::ios::binary) << srcml_other;
+    std::ofstream("merge_options.xml", std::ios::binary) << srcml_options;
+    std::ofstream("merge_position.xml", std::ios::binary) << srcml_position;
+    std::ofstream("merge_single.xml", std::ios::binary) << srcml_single;
+    std::ofstream("merge_invalid.xml", std::ios::binary) << "<unit xmlns=\"http://www.srcML.org/srcML/src\">\n\n<unit language=\"C\"><name>";
+
+    /*
+      srcml_archive_write_merge_filenames
+    */
+
+    // units copied as is, after the root of the inputs
+    {
+        char* s = 0;
+        size_t size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        const char* filenames[] = { "merge_a.xml", "merge_b.xml" };
+        dassert(srcml_archive_write_merge_filenames(archive, 2, filenames), SRCML_STATUS_OK);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(" url="project">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp" hash="aa"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="b.cpp" hash="bb"/>
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="c.cpp" hash="cc"><cpp:empty>#</cpp:empty>
+</unit>
+
+</unit>
+)");
+        srcml_memory_free(s);
+    }
+
+    // a single input is the same archive
+    {
+        char* s = 0;
+        size_t size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        const char* filenames[] = { "merge_a.xml" };
+        dassert(srcml_archive_write_merge_filenames(archive, 1, filenames), SRCML_STATUS_OK);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), srcml_a);
+        srcml_memory_free(s);
+    }
+
+    // an attribute that differs between the roots is dropped
+    {
+        char* s = 0;
+        size_t size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        const char* filenames[] = { "merge_a.xml", "merge_other.xml" };
+        dassert(srcml_archive_write_merge_filenames(archive, 2, filenames), SRCML_STATUS_OK);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp" hash="aa"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="b.cpp" hash="bb"/>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C" filename="d.c" hash="dd"><name>d</name></unit>
+
+</unit>
+)");
+        srcml_memory_free(s);
+    }
+
+    // namespaces, tabs, and macro lists of the root
+    {
+        char* s = 0;
+        size_t size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        const char* filenames[] = { "merge_position.xml" };
+        dassert(srcml_archive_write_merge_filenames(archive, 1, filenames), SRCML_STATUS_OK);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), srcml_position);
+        srcml_memory_free(s);
+    }
+
+    // single units are nested, with the namespaces of the root removed
+    {
+        char* s = 0;
+        size_t size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        const char* filenames[] = { "merge_single.xml", "merge_single.xml" };
+        dassert(srcml_archive_write_merge_filenames(archive, 2, filenames), SRCML_STATUS_OK);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="s.cpp"><cpp:empty>#</cpp:empty>
+</unit>
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="s.cpp"><cpp:empty>#</cpp:empty>
+</unit>
+
+</unit>
+)");
+        srcml_memory_free(s);
+    }
+
+    // options must be the same
+    {
+        char* s = 0;
+        size_t size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        const char* filenames[] = { "merge_a.xml", "merge_options.xml" };
+        dassert(srcml_archive_write_merge_filenames(archive, 2, filenames), SRCML_STATUS_INVALID_INPUT);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_memory_free(s);
+    }
+
+    {
+        char* s = 0;
+        size_t size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        const char* filenames[] = { "merge_a.xml", "merge_invalid.xml" };
+        dassert(srcml_archive_write_merge_filenames(archive, 2, filenames), SRCML_STATUS_INVALID_INPUT);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_memory_free(s);
+    }
+
+    {
+        char* s = 0;
+        size_t size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        const char* filenames[] = { "merge_a.xml", "merge_missing.xml" };
+        dassert(srcml_archive_write_merge_filenames(archive, 2, filenames), SRCML_STATUS_IO_ERROR);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_memory_free(s);
+    }
+
+    // nothing can be written before a merge
+    {
+        char* s = 0;
+        size_t size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C++");
+        srcml_unit_parse_memory(unit, "a;", 2);
+        srcml_archive_write_unit(archive, unit);
+
+        const char* filenames[] = { "merge_a.xml" };
+        dassert(srcml_archive_write_merge_filenames(archive, 1, filenames), SRCML_STATUS_INVALID_IO_OPERATION);
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        srcml_memory_free(s);
+    }
+
+    {
+        const char* filenames[] = { "merge_a.xml" };
+        srcml_archive* archive = srcml_archive_create();
+        dassert(srcml_archive_write_merge_filenames(archive, 1, filenames), SRCML_STATUS_INVALID_IO_OPERATION);
+        dassert(srcml_archive_write_merge_filenames(archive, 1, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_merge_filenames(archive, -1, filenames), SRCML_STATUS_INVALID_ARGUMENT);
+        srcml_archive_free(archive);
+    }
+
+    {
+        const char* filenames[] = { "merge_a.xml" };
+        dassert(srcml_archive_write_merge_filenames(0, 1, filenames), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
+    UNLINK("merge_a.xml");
+    UNLINK("merge_b.xml");
+    UNLINK("merge_other.xml");
+    UNLINK("merge_options.xml");
+    UNLINK("merge_position.xml");
+    UNLINK("merge_single.xml");
+    UNLINK("merge_invalid.xml");
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
@@ -115,6 +115,36 @@ int main(int, char* argv[]) {
         dassert(size, -1);
     }
 
+    // gzip output, when supported, is a gzip stream of the uncompressed output
+    {
+        char* plain = 0;
+        size_t plain_size = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &plain, &plain_size);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        char* s = 0;
+        size_t size = 0;
+        archive = srcml_archive_create();
+        if (srcml_archive_set_gzip_threads(archive, 2) == SRCML_STATUS_OK) {
+            dassert(srcml_archive_write_open_memory(archive, &s, &size), SRCML_STATUS_OK);
+            srcml_archive_close(archive);
+
+            const unsigned char* gz = (const unsigned char*) s;
+            dassert((size > 18), true);
+            dassert(gz[0], 0x1f);
+            dassert(gz[1], 0x8b);
+
+            // trailer ends with the uncompressed size
+            size_t isize = gz[size - 4] | (gz[size - 3] << 8) | (gz[size - 2] << 16) | ((size_t) gz[size - 1] << 24);
+            dassert(isize, plain_size);
+        }
+        srcml_archive_free(archive);
+        srcml_memory_free(s);
+        srcml_memory_free(plain);
+    }
+
     /*
       srcml_archive_write_open_FILE
     */
@@ -0,0 +1,416 @@
+/**
+ * @file test_srcml_archive_write_parse.cpp
+ *
+ * @copyright Copyright (C) 2013-2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for srcml_archive_write_parse_filename, srcml_archive_write_parse_memory,
+  and srcml_archive_write_submit*
+*/
+
+#include <srcml.h>
+
+#include <dassert.hpp>
+
+#include <fstream>
+#include <vector>
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+int main(int, char* argv[]) {
+
+    const std::string srcml_a_java = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="Java" filename="a.java"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+</unit>
+)";
+
+    const std::string srcml_a_cpp = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" xmlns:omp="http://www.srcML.org/srcML/openmp" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+</unit>
+)";
+
+    {
+        std::ofstream file("a.cpp");
+        file << "a;\n";
+    }
+
+    /*
+      srcml_archive_write_parse_memory
+    */
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_filename(unit, "a.java");
+        srcml_unit_set_language(unit, "Java");
+
+        dassert(srcml_archive_write_parse_memory(archive, unit, "a;\n", 3), SRCML_STATUS_OK);
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), srcml_a_java);
+
+        free(s);
+    }
+
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_filename(unit, "a.cpp");
+        srcml_unit_set_language(unit, "C++");
+
+        dassert(srcml_archive_write_parse_memory(archive, unit, "a;\n", 3), SRCML_STATUS_OK);
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), srcml_a_cpp);
+
+        free(s);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C++");
+
+        dassert(srcml_archive_write_parse_memory(archive, unit, "a;\n", 3), SRCML_STATUS_INVALID_IO_OPERATION);
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+
+        dassert(srcml_archive_write_parse_memory(0, unit, "a;\n", 3), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_parse_memory(archive, 0, "a;\n", 3), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_parse_memory(archive, unit, 0, 3), SRCML_STATUS_INVALID_ARGUMENT);
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      srcml_archive_write_parse_filename
+    */
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_filename(unit, "a.cpp");
+
+        dassert(srcml_archive_write_parse_filename(archive, unit, "a.cpp"), SRCML_STATUS_OK);
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), srcml_a_cpp);
+
+        free(s);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+
+        dassert(srcml_archive_write_parse_filename(0, unit, "a.cpp"), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_parse_filename(archive, 0, "a.cpp"), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_parse_filename(archive, unit, 0), SRCML_STATUS_INVALID_ARGUMENT);
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      srcml_archive_write_submit_filename and srcml_archive_write_submit_memory
+    */
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        srcml_executor* executor = srcml_executor_create(3, 0);
+
+        const int num_units = 8;
+        srcml_unit* units[num_units];
+        for (int i = 0; i < num_units - 1; ++i) {
+            units[i] = srcml_unit_create(archive);
+            srcml_unit_set_filename(units[i], "a.java");
+            srcml_unit_set_language(units[i], "Java");
+            dassert(srcml_archive_write_submit_memory(archive, executor, units[i], "a;\n", 3, 0, 0, 0), SRCML_STATUS_OK);
+        }
+        units[num_units - 1] = srcml_unit_create(archive);
+        srcml_unit_set_filename(units[num_units - 1], "a.cpp");
+        dassert(srcml_archive_write_submit_filename(archive, executor, units[num_units - 1], "a.cpp", 0, 0, 0), SRCML_STATUS_OK);
+
+        dassert(srcml_archive_write_submit_wait(archive), SRCML_STATUS_OK);
+
+        srcml_executor_free(executor);
+        for (int i = 0; i < num_units; ++i)
+            srcml_unit_free(units[i]);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        std::string java_unit = R"(<unit revision=")" SRCML_VERSION_STRING R"(" language="Java" filename="a.java"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+)";
+        std::string cpp_unit = R"(<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+)";
+        std::string submitted = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(">
+
+)";
+        for (int i = 0; i < num_units - 1; ++i)
+            submitted += java_unit;
+        submitted += cpp_unit;
+        submitted += "</unit>\n";
+
+        dassert(std::string(s, size), submitted);
+
+        free(s);
+    }
+
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        srcml_executor* executor = srcml_executor_create(0, 0);
+
+        srcml_unit* units[2] = { srcml_unit_create(archive), srcml_unit_create(archive) };
+        srcml_unit_set_filename(units[0], "a.java");
+        srcml_unit_set_language(units[0], "Java");
+        dassert(srcml_archive_write_submit_memory(archive, executor, units[0], "a;\n", 3, 0, 0, 0), SRCML_STATUS_OK);
+        dassert(srcml_archive_write_submit_memory(archive, executor, units[1], "a;\n", 3, 0, 0, 0), SRCML_STATUS_OK);
+
+        dassert(srcml_archive_write_submit_wait(archive), SRCML_STATUS_UNSET_LANGUAGE);
+        dassert(srcml_archive_write_submit_wait(archive), SRCML_STATUS_OK);
+
+        srcml_executor_free(executor);
+        srcml_unit_free(units[0]);
+        srcml_unit_free(units[1]);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), srcml_a_java);
+
+        free(s);
+    }
+
+    // callbacks, with the write callback called in the order submitted
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        srcml_executor* executor = srcml_executor_create(4, 0);
+
+        struct submitted {
+            srcml_archive* archive;
+            int position;
+            bool parsed = false;
+            std::vector<int>* written;
+        };
+
+        auto parsed = [](srcml_unit*, int, void* context) { static_cast<submitted*>(context)->parsed = true; };
+        auto write = [](srcml_unit* unit, int status, void* context) {
+
+            submitted* submission = static_cast<submitted*>(context);
+            submission->written->push_back(submission->position);
+            if (unit && status == SRCML_STATUS_OK)
+                srcml_archive_write_unit(submission->archive, unit);
+            srcml_unit_free(unit);
+        };
+
+        const int num_units = 32;
+        std::vector<int> written;
+        std::vector<submitted> submissions(num_units);
+        for (int i = 0; i < num_units; ++i) {
+
+            submissions[i].archive = archive;
+            submissions[i].position = i;
+            submissions[i].written = &written;
+
+            // a unit without a parse, and without a unit
+            if (i % 8 == 7) {
+                dassert(srcml_archive_write_submit(archive, executor, 0, parsed, write, &submissions[i]), SRCML_STATUS_OK);
+                continue;
+            }
+
+            srcml_unit* unit = srcml_unit_create(archive);
+            srcml_unit_set_language(unit, "C++");
+            dassert(srcml_archive_write_submit_memory(archive, executor, unit, "a;\n", 3, parsed, write, &submissions[i]), SRCML_STATUS_OK);
+        }
+
+        dassert(srcml_archive_write_submit_wait(archive), SRCML_STATUS_OK);
+
+        dassert(written.size(), (size_t) num_units);
+        for (int i = 0; i < num_units; ++i) {
+            dassert(written[i], i);
+            dassert(submissions[i].parsed, true);
+        }
+
+        srcml_executor_free(executor);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        std::string output(s, size);
+        int count = 0;
+        for (auto pos = output.find("</unit>\n\n"); pos != std::string::npos; pos = output.find("</unit>\n\n", pos + 1))
+            ++count;
+        dassert(count, num_units - num_units / 8);
+
+        free(s);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_executor* executor = srcml_executor_create(1, 0);
+        srcml_unit* unit = srcml_unit_create(archive);
+
+        dassert(srcml_archive_write_submit_memory(archive, executor, unit, "a;\n", 3, 0, 0, 0), SRCML_STATUS_INVALID_IO_OPERATION);
+        dassert(srcml_archive_write_submit_memory(0, executor, unit, "a;\n", 3, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_submit_memory(archive, 0, unit, "a;\n", 3, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_submit_memory(archive, executor, 0, "a;\n", 3, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_submit_memory(archive, executor, unit, 0, 3, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_submit_filename(archive, executor, unit, 0, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_submit(archive, executor, 0, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_submit_wait(0), SRCML_STATUS_INVALID_ARGUMENT);
+
+        srcml_unit_free(unit);
+        srcml_executor_free(executor);
+        srcml_archive_free(archive);
+    }
+
+    // with a write callback, an archive that is not opened only holds the order
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_executor* executor = srcml_executor_create(2, 0);
+
+        struct submitted {
+            int position;
+            std::vector<int>* written;
+        };
+
+        auto write = [](srcml_unit* unit, int status, void* context) {
+
+            submitted* submission = static_cast<submitted*>(context);
+            if (status == SRCML_STATUS_OK)
+                submission->written->push_back(submission->position);
+            srcml_unit_free(unit);
+        };
+
+        const int num_units = 6;
+        std::vector<int> written;
+        std::vector<submitted> submissions(num_units);
+        for (int i = 0; i < num_units; ++i) {
+
+            submissions[i].position = i;
+            submissions[i].written = &written;
+
+            srcml_unit* unit = srcml_unit_create(archive);
+            srcml_unit_set_language(unit, "C++");
+            dassert(srcml_archive_write_submit_memory(archive, executor, unit, "a;\n", 3, 0, write, &submissions[i]), SRCML_STATUS_OK);
+        }
+
+        dassert(srcml_archive_write_submit_wait(archive), SRCML_STATUS_OK);
+
+        dassert(written.size(), (size_t) num_units);
+        for (int i = 0; i < num_units; ++i)
+            dassert(written[i], i);
+
+        srcml_executor_free(executor);
+        srcml_archive_free(archive);
+    }
+
+    // a unit that can not be queued does not take a place in the order
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+        srcml_archive* other_archive = srcml_archive_create();
+        srcml_executor* executor = srcml_executor_create(1, 0);
+
+        srcml_unit* other_unit = srcml_unit_create(other_archive);
+        srcml_unit_set_language(other_unit, "C++");
+        dassert(srcml_archive_write_submit_memory(archive, executor, other_unit, "a;\n", 3, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_filename(unit, "a.java");
+        srcml_unit_set_language(unit, "Java");
+        dassert(srcml_archive_write_submit_memory(archive, executor, unit, "a;\n", 3, 0, 0, 0), SRCML_STATUS_OK);
+        dassert(srcml_archive_write_submit_wait(archive), SRCML_STATUS_OK);
+
+        srcml_executor_free(executor);
+        srcml_unit_free(unit);
+        srcml_unit_free(other_unit);
+        srcml_archive_free(other_archive);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), srcml_a_java);
+
+        free(s);
+    }
+
+    unlink("a.cpp");
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
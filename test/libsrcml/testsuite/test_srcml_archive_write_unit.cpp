@@ -28,6 +28,10 @@
 #include <dassert.hpp>
 
 #include <string.h>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 int main(int, char* argv[]) {
 
@@ -473,6 +477,119 @@ int main(int, char* argv[]) {
         free(s);
     }
 
+    // units copied between archives, as is or with a new start tag
+    {
+        const std::string srcml_copy = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp" item="1"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="b.cpp"/>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="c.cpp"></unit>
+
+<unit filename="d.cpp" revision=")" SRCML_VERSION_STRING R"(" language="C++"><name>d</name></unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="e.cpp"><name>e</name></unit>
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="f.cpp"><cpp:empty>#</cpp:empty>
+</unit>
+
+</unit>
+)";
+
+        const std::string expected = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp" item="1"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="b.cpp"/>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="c.cpp"/>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="d.cpp"><name>d</name></unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="g.cpp"><name>e</name></unit>
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="f.cpp"><cpp:empty>#</cpp:empty>
+</unit>
+
+</unit>
+)";
+
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_write_open_memory(archive, &s, &size);
+        srcml_archive* iarchive = srcml_archive_create();
+        srcml_archive_read_open_memory(iarchive, srcml_copy.c_str(), srcml_copy.size());
+
+        while (srcml_unit* unit = srcml_archive_read_unit(iarchive)) {
+
+            if (srcml_unit_get_filename(unit) == std::string("e.cpp"))
+                srcml_unit_set_filename(unit, "g.cpp");
+
+            dassert(srcml_archive_write_unit(archive, unit), SRCML_STATUS_OK);
+            srcml_unit_free(unit);
+        }
+
+        srcml_archive_close(iarchive);
+        srcml_archive_free(iarchive);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), expected);
+
+        free(s);
+    }
+
+    // units with namespace declarations written to an archive that does not declare namespaces on units
+    {
+        const std::string srcml_copy = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="f.cpp"><cpp:empty>#</cpp:empty>
+</unit>
+
+</unit>
+)";
+
+        const std::string expected = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit revision=")" SRCML_VERSION_STRING R"(">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="f.cpp"><cpp:empty>#</cpp:empty>
+</unit>
+
+</unit>
+)";
+
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_set_options(archive, 0);
+        srcml_archive_disable_solitary_unit(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+        srcml_archive* iarchive = srcml_archive_create();
+        srcml_archive_read_open_memory(iarchive, srcml_copy.c_str(), srcml_copy.size());
+
+        while (srcml_unit* unit = srcml_archive_read_unit(iarchive)) {
+
+            dassert(srcml_archive_write_unit(archive, unit), SRCML_STATUS_OK);
+            srcml_unit_free(unit);
+        }
+
+        srcml_archive_close(iarchive);
+        srcml_archive_free(iarchive);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(std::string(s, size), expected);
+
+        free(s);
+    }
+
     {
         char* s = 0;
         size_t size;
@@ -631,6 +748,197 @@ int main(int, char* argv[]) {
         srcml_archive_free(archive);
     }
 
+    /*
+      srcml_archive_write_unit from multiple threads
+    */
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        const int num_threads = 16;
+        std::vector<srcml_unit*> units;
+        for (int i = 0; i < num_threads; ++i) {
+            srcml_unit* unit = srcml_unit_create(archive);
+            srcml_unit_set_language(unit, "C++");
+            srcml_unit_set_filename(unit, (std::to_string(i) + ".cpp").c_str());
+            dassert(srcml_unit_parse_memory(unit, "a;\n", 3), SRCML_STATUS_OK);
+            units.push_back(unit);
+        }
+
+        std::vector<int> status(num_threads);
+        std::vector<std::thread> writers;
+        for (int i = 0; i < num_threads; ++i)
+            writers.emplace_back([&, i]{ status[i] = srcml_archive_write_unit(archive, units[i]); });
+        for (auto& writer : writers)
+            writer.join();
+
+        for (auto unit : units)
+            srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        for (int i = 0; i < num_threads; ++i)
+            dassert(status[i], SRCML_STATUS_OK);
+
+        std::string output(s, size);
+        int count = 0;
+        for (auto pos = output.find("</unit>\n\n"); pos != std::string::npos; pos = output.find("</unit>\n\n", pos + 1))
+            ++count;
+        dassert(count, num_threads);
+
+        free(s);
+    }
+
+    /*
+      srcml_archive_write_unit_sequence
+    */
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        const int num_threads = 16;
+        std::vector<srcml_unit*> units;
+        for (int i = 0; i < num_threads; ++i) {
+            srcml_unit* unit = srcml_unit_create(archive);
+            srcml_unit_set_language(unit, "C++");
+            srcml_unit_set_filename(unit, (std::to_string(i) + ".cpp").c_str());
+            dassert(srcml_unit_parse_memory(unit, "a;\n", 3), SRCML_STATUS_OK);
+            units.push_back(unit);
+        }
+
+        // started in reverse order
+        std::vector<int> status(num_threads);
+        std::vector<std::thread> writers;
+        for (int i = num_threads - 1; i >= 0; --i)
+            writers.emplace_back([&, i]{ status[i] = srcml_archive_write_unit_sequence(archive, units[i], i); });
+        for (auto& writer : writers)
+            writer.join();
+
+        dassert(srcml_archive_write_unit_sequence(archive, units[0], 0), SRCML_STATUS_INVALID_ARGUMENT);
+
+        for (auto unit : units)
+            srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        for (int i = 0; i < num_threads; ++i)
+            dassert(status[i], SRCML_STATUS_OK);
+
+        std::string expected = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(">
+
+)";
+        for (int i = 0; i < num_threads; ++i) {
+            expected += R"(<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename=")" + std::to_string(i) + R"(.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+)";
+        }
+        expected += "</unit>\n";
+
+        dassert(std::string(s, size), expected);
+
+        free(s);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+
+        dassert(srcml_archive_write_unit_sequence(0, unit, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_archive_write_unit_sequence(archive, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    // a sequence number taken by a waiting write
+    {
+        char* s = 0;
+        size_t size;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_archive_write_open_memory(archive, &s, &size);
+
+        std::vector<srcml_unit*> units;
+        for (int i = 0; i < 3; ++i) {
+            srcml_unit* unit = srcml_unit_create(archive);
+            srcml_unit_set_language(unit, "C++");
+            dassert(srcml_unit_parse_memory(unit, "a;\n", 3), SRCML_STATUS_OK);
+            units.push_back(unit);
+        }
+
+        // both want sequence 1, so one waits for sequence 0 and the other is rejected
+        std::atomic<int> status[2];
+        std::vector<std::thread> writers;
+        for (int i = 0; i < 2; ++i) {
+            status[i] = SRCML_STATUS_OK;
+            writers.emplace_back([&, i]{ status[i] = srcml_archive_write_unit_sequence(archive, units[i + 1], 1); });
+        }
+
+        while (status[0] != SRCML_STATUS_INVALID_ARGUMENT && status[1] != SRCML_STATUS_INVALID_ARGUMENT)
+            std::this_thread::yield();
+
+        dassert(srcml_archive_write_unit_sequence(archive, units[0], 0), SRCML_STATUS_OK);
+        for (auto& writer : writers)
+            writer.join();
+
+        dassert(status[0] + status[1], SRCML_STATUS_OK + SRCML_STATUS_INVALID_ARGUMENT);
+
+        for (auto unit : units)
+            srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+        free(s);
+    }
+
+    // a unit rendered apart from the output is the same as one written by srcml_archive_write_unit()
+    {
+        std::string outputs[2];
+        for (int sequenced = 0; sequenced < 2; ++sequenced) {
+
+            char* s = 0;
+            size_t size;
+            srcml_archive* archive = srcml_archive_create();
+            srcml_archive_disable_hash(archive);
+            srcml_archive_write_open_memory(archive, &s, &size);
+
+            srcml_unit* unit = srcml_unit_create(archive);
+            srcml_unit_set_language(unit, "C++");
+            srcml_unit_set_filename(unit, "a&b.cpp");
+            srcml_unit_set_version(unit, "\"1\"");
+            dassert(srcml_unit_parse_memory(unit, "#define A\na;\n", 13), SRCML_STATUS_OK);
+
+            srcml_unit* empty = srcml_unit_create(archive);
+            srcml_unit_set_language(empty, "C");
+            dassert(srcml_unit_parse_memory(empty, "", 0), SRCML_STATUS_OK);
+
+            if (sequenced) {
+                dassert(srcml_archive_write_unit_sequence(archive, unit, 0), SRCML_STATUS_OK);
+                dassert(srcml_archive_write_unit_sequence(archive, empty, 1), SRCML_STATUS_OK);
+            } else {
+                dassert(srcml_archive_write_unit(archive, unit), SRCML_STATUS_OK);
+                dassert(srcml_archive_write_unit(archive, empty), SRCML_STATUS_OK);
+            }
+
+            srcml_unit_free(unit);
+            srcml_unit_free(empty);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+
+            outputs[sequenced].assign(s, size);
+            free(s);
+        }
+
+        dassert(outputs[1], outputs[0]);
+    }
+
     srcml_cleanup_globals();
 
     return 0;
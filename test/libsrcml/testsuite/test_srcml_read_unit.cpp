@@ -116,6 +116,22 @@ int main(int, char* argv[]) {
     const std::string srcml_hash_single = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
 <unit xmlns="http://www.srcML.org/srcML/src" xmlns:cpp="http://www.srcML.org/srcML/cpp" hash="aa2a72b26cf958d8718a2e9bc6b84679a81d54cb" language="C" filename="project.c"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
 </unit>
+)";
+
+    const std::string srcml_position_compact = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" xmlns:pos="http://www.srcML.org/srcML/position" pos:tabs="8" options="POSITION_COMPACT">
+
+<unit xmlns:cpp="http://www.srcML.org/srcML/cpp" language="C" filename="project.c"><expr_stmt pos:span="1:1-2"><expr pos:span="1:1-1"><name type="a>b" pos:span="1:1-1">a</name></expr>;</expr_stmt><!-- <name pos:span="1:1-1"> -->
+<block pos:span="2:1-3:1">{
+}</block>
+</unit>
+
+</unit>
+)";
+
+    const std::string srcml_position_expanded_inner = R"(<expr_stmt pos:start="1:1" pos:end="1:2"><expr pos:start="1:1" pos:end="1:1"><name type="a>b" pos:start="1:1" pos:end="1:1">a</name></expr>;</expr_stmt><!-- <name pos:span="1:1-1"> -->
+<block pos:start="2:1" pos:end="3:1">{
+}</block>
 )";
 
     /*
@@ -226,6 +242,58 @@ int main(int, char* argv[]) {
 
     }
 
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_position_compact.c_str(), srcml_position_compact.size());
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+        dassert((srcml_archive_get_options(archive) & SRCML_OPTION_POSITION_COMPACT), SRCML_OPTION_POSITION_COMPACT);
+        dassert(srcml_unit_get_srcml_inner(unit), srcml_position_expanded_inner);
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    // empty elements, including an empty unit, directly inside the root and the units
+    {
+        const std::string srcml_empty = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src">
+
+<unit language="C" filename="a.c"/>
+
+<unit language="C" filename="b.c"><escape char="0xc"/><expr_stmt><expr><name>b</name></expr>;</expr_stmt>
+</unit>
+
+<unit language="C" filename="c.c"><escape char="0xc"/></unit>
+
+<unit language="C" filename="d.c"/>
+
+</unit>
+)";
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_empty.c_str(), srcml_empty.size());
+
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("a.c"));
+        dassert(srcml_unit_get_srcml_inner(unit), std::string(""));
+        srcml_unit_free(unit);
+
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("b.c"));
+        dassert(srcml_unit_get_srcml_inner(unit), std::string("<escape char=\"0xc\"/><expr_stmt><expr><name>b</name></expr>;</expr_stmt>\n"));
+        srcml_unit_free(unit);
+
+        dassert(srcml_archive_skip_unit(archive), 1);
+
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("d.c"));
+        srcml_unit_free(unit);
+
+        dassert(srcml_archive_read_unit(archive), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
     {
         srcml_archive* archive = srcml_archive_create();
         dassert(srcml_archive_read_unit(archive), 0);
@@ -307,6 +375,32 @@ int main(int, char* argv[]) {
         srcml_archive_free(archive);
     }
 
+    // archive much larger than the parser chunks, with units read and skipped
+    {
+        std::string srcml_large = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n<unit xmlns=\"http://www.srcML.org/srcML/src\">\n\n";
+        for (int i = 0; i < 2000; ++i)
+            srcml_large += "<unit language=\"C\" filename=\"f" + std::to_string(i) + ".c\"><expr_stmt><expr><name>a" + std::to_string(i) + "</name></expr>;</expr_stmt>\n</unit>\n\n";
+        srcml_large += "</unit>\n";
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_large.c_str(), srcml_large.size());
+        for (int i = 0; i < 2000; ++i) {
+
+            if (i % 3 == 1) {
+                dassert(srcml_archive_skip_unit(archive), 1);
+                continue;
+            }
+
+            srcml_unit* unit = srcml_archive_read_unit(archive);
+            dassert(srcml_unit_get_filename(unit), "f" + std::to_string(i) + ".c");
+            dassert(srcml_unit_get_srcml_inner(unit), "<expr_stmt><expr><name>a" + std::to_string(i) + "</name></expr>;</expr_stmt>\n");
+            srcml_unit_free(unit);
+        }
+        dassert(srcml_archive_read_unit(archive), 0);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
     {
         srcml_archive* archive = srcml_archive_create();
         dassert(srcml_archive_read_unit(archive), 0);
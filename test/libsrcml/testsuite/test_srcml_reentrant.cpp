@@ -0,0 +1,109 @@
+/**
+ * @file test_srcml_reentrant.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for archives with different options interleaved on the same threads
+*/
+
+#include <srcml.h>
+
+#include <dassert.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int, char* argv[]) {
+
+    const std::string srcml_plain = R"(<expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+)";
+
+    const std::string srcml_position = R"(<expr_stmt pos:start="1:1" pos:end="1:2"><expr pos:start="1:1" pos:end="1:1"><name pos:start="1:1" pos:end="1:1">a</name></expr>;</expr_stmt>
+)";
+
+    const std::string srcml_position_prefix = R"(<expr_stmt p:start="1:1" p:end="1:2"><expr p:start="1:1" p:end="1:1"><name p:start="1:1" p:end="1:1">a</name></expr>;</expr_stmt>
+)";
+
+    // each kind of archive and the expected srcML of its unit
+    enum { PLAIN, POSITION, POSITION_PREFIX, KINDS };
+    const std::string* expected[KINDS] = { &srcml_plain, &srcml_position, &srcml_position_prefix };
+
+    auto parse = [](int kind) -> std::string {
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        if (kind != PLAIN)
+            srcml_archive_enable_option(archive, SRCML_OPTION_POSITION);
+        if (kind == POSITION_PREFIX)
+            srcml_archive_register_namespace(archive, "p", "http://www.srcML.org/srcML/position");
+
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C");
+        srcml_unit_parse_memory(unit, "a;\n", 3);
+
+        const char* inner = srcml_unit_get_srcml_inner(unit);
+        std::string result = inner ? inner : "";
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+
+        return result;
+    };
+
+    /*
+      interleaved on one thread, with each kind of archive first
+    */
+    for (int first = 0; first < KINDS; ++first) {
+        for (int i = 0; i < KINDS; ++i) {
+            int kind = (first + i) % KINDS;
+            dassert(parse(kind), *expected[kind]);
+        }
+    }
+
+    /*
+      interleaved on multiple threads at once
+    */
+    {
+        const int num_threads = 8;
+        const int iterations = 100;
+        std::atomic<int> failures(0);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]{
+                for (int i = 0; i < iterations; ++i) {
+                    int kind = (t + i) % KINDS;
+                    if (parse(kind) != *expected[kind])
+                        ++failures;
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        dassert(failures, 0);
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
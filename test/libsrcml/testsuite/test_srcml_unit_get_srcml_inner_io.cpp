@@ -0,0 +1,288 @@
+/**
+ * @file test_srcml_unit_get_srcml_inner_io.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for srcml_unit_get_srcml_inner_io, and for streaming the
+  body of a unit read by its header
+*/
+
+#include <srcml.h>
+
+#include <string>
+#include <map>
+
+#include <dassert.hpp>
+
+int append(void* context, const char* buffer, int len) {
+    ((std::string*) context)->append(buffer, len);
+    return len;
+}
+
+int fail(void*, const char*, int) {
+    return -1;
+}
+
+int main(int, char* argv[]) {
+
+    const std::string srcml_a = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+)";
+
+    // an archive with a unit much larger than a chunk of the parser between small units
+    std::string large;
+    for (int i = 0; i < 5000; ++i)
+        large += "<expr_stmt><expr><name>a" + std::to_string(i) + "</name> <operator>&lt;</operator> <literal type=\"number\">1</literal></expr>;</expr_stmt>\n";
+
+    const std::string srcml_large = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" revision=")" SRCML_VERSION_STRING R"(">
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="a.cpp"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="b.cpp">)" + large + R"(<expr_stmt><expr><name>b</name></expr>;</expr_stmt></unit>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="c.cpp"/>
+
+<unit revision=")" SRCML_VERSION_STRING R"(" language="C++" filename="d.cpp"><expr_stmt><expr><name>d</name></expr>;</expr_stmt>
+</unit>
+
+</unit>
+)";
+
+    /*
+      srcml_unit_get_srcml_inner_io
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_a.c_str(), srcml_a.size());
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+
+        std::string inner;
+        dassert(srcml_unit_get_srcml_inner_io(unit, &inner, append), SRCML_STATUS_OK);
+        dassert(inner, "<expr_stmt><expr><name>a</name></expr>;</expr_stmt>\n");
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_a.c_str(), srcml_a.size());
+        srcml_unit* unit = srcml_archive_read_unit_header(archive);
+
+        std::string inner;
+        dassert(srcml_unit_get_srcml_inner_io(unit, &inner, append), SRCML_STATUS_OK);
+        dassert(inner, "<expr_stmt><expr><name>a</name></expr>;</expr_stmt>\n");
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_a.c_str(), srcml_a.size());
+        srcml_unit* unit = srcml_archive_read_unit(archive);
+
+        dassert(srcml_unit_get_srcml_inner_io(unit, 0, fail), SRCML_STATUS_IO_ERROR);
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_a.c_str(), srcml_a.size());
+        srcml_unit* unit = srcml_unit_create(archive);
+
+        std::string inner;
+        dassert(srcml_unit_get_srcml_inner_io(unit, &inner, append), SRCML_STATUS_UNINITIALIZED_UNIT);
+        dassert(srcml_unit_get_srcml_inner_io(unit, &inner, 0), SRCML_STATUS_INVALID_ARGUMENT);
+
+        srcml_unit_free(unit);
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        std::string inner;
+        dassert(srcml_unit_get_srcml_inner_io(0, &inner, append), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
+    /*
+      streaming the body of a unit read by its header
+    */
+
+    {
+        // inner srcML, source, and lines of code of each unit from full reads
+        std::map<std::string, std::string> inners;
+        std::map<std::string, std::string> sources;
+        std::map<std::string, int> locs;
+
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_large.c_str(), srcml_large.size());
+        while (srcml_unit* unit = srcml_archive_read_unit(archive)) {
+
+            std::string unit_srcml = srcml_unit_get_srcml(unit);
+            std::string inner = unit_srcml.substr(unit_srcml.find('>') + 1);
+            inners[srcml_unit_get_filename(unit)] = inner.substr(0, inner.rfind("</unit>"));
+
+            char* buffer = 0;
+            size_t size = 0;
+            srcml_unit_unparse_memory(unit, &buffer, &size);
+            sources[srcml_unit_get_filename(unit)].assign(buffer, size);
+            srcml_memory_free(buffer);
+
+            locs[srcml_unit_get_filename(unit)] = srcml_unit_get_loc(unit);
+            srcml_unit_free(unit);
+        }
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+
+        dassert(inners.size(), 4);
+        dassert(inners["c.cpp"], "");
+        dassert((inners["b.cpp"].size() > large.size()), true);
+
+        // with the pattern of full reads (r), inner srcML of a header read (i), source of a header read (s),
+        // and srcML of a header read (h), without and with a unit larger than the read ahead handed over to be streamed
+        for (const std::string pattern : { "r", "i", "s", "h", "is", "si", "ih", "hs", "ri", "sr" }) {
+            for (size_t num_bytes : { 0, 1000 }) {
+
+                archive = srcml_archive_create();
+                if (num_bytes)
+                    srcml_archive_set_read_ahead(archive, 0, num_bytes);
+                srcml_archive_read_open_memory(archive, srcml_large.c_str(), srcml_large.size());
+
+                int count = 0;
+                for (size_t i = 0; ; ++i) {
+
+                    char c = pattern[i % pattern.size()];
+                    srcml_unit* unit = c == 'r' ? srcml_archive_read_unit(archive) : srcml_archive_read_unit_header(archive);
+                    if (!unit)
+                        break;
+
+                    std::string filename = srcml_unit_get_filename(unit);
+                    if (c == 'r' || c == 'i') {
+
+                        std::string inner;
+                        dassert(srcml_unit_get_srcml_inner_io(unit, &inner, append), SRCML_STATUS_OK);
+                        dassert(inner, inners[filename]);
+
+                    } else if (c == 'h') {
+
+                        std::string unit_srcml = srcml_unit_get_srcml(unit);
+                        std::string inner = unit_srcml.substr(unit_srcml.find('>') + 1);
+                        dassert(inner.substr(0, inner.rfind("</unit>")), inners[filename]);
+                    }
+
+                    if (c == 'r' || c == 's') {
+
+                        char* buffer = 0;
+                        size_t size = 0;
+                        dassert(srcml_unit_unparse_memory(unit, &buffer, &size), SRCML_STATUS_OK);
+                        dassert(std::string(buffer, size), sources[filename]);
+                        srcml_memory_free(buffer);
+                    }
+
+                    dassert(srcml_unit_get_loc(unit), locs[filename]);
+                    dassert(filename, std::string(1, 'a' + count) + ".cpp");
+                    ++count;
+                    srcml_unit_free(unit);
+                }
+                dassert(count, 4);
+
+                srcml_archive_close(archive);
+                srcml_archive_free(archive);
+            }
+        }
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_large.c_str(), srcml_large.size());
+        srcml_archive_skip_unit(archive);
+
+        // output failure of the large unit
+        srcml_unit* unit = srcml_archive_read_unit_header(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("b.cpp"));
+        dassert(srcml_unit_get_srcml_inner_io(unit, 0, fail), SRCML_STATUS_IO_ERROR);
+        srcml_unit_free(unit);
+
+        // the next unit is still read
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("c.cpp"));
+        srcml_unit_free(unit);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_large.c_str(), srcml_large.size());
+        srcml_archive_skip_unit(archive);
+
+        // the body of the large unit is only streamed by the unit it was read with
+        srcml_unit* unit = srcml_archive_read_unit_header(archive);
+        srcml_unit* clone = srcml_unit_clone(unit);
+        std::string inner;
+        dassert((srcml_unit_get_srcml_inner_io(clone, &inner, append) != SRCML_STATUS_OK), true);
+        dassert(srcml_unit_get_srcml_inner_io(unit, &inner, append), SRCML_STATUS_OK);
+        dassert((inner.size() > large.size()), true);
+        srcml_unit_free(clone);
+        srcml_unit_free(unit);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_read_open_memory(archive, srcml_large.c_str(), srcml_large.size());
+        srcml_archive_skip_unit(archive);
+
+        // a unit freed before its body is streamed does not pass its body to the next unit
+        srcml_unit* unit = srcml_archive_read_unit_header(archive);
+        srcml_unit_free(unit);
+
+        unit = srcml_archive_read_unit_header(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("c.cpp"));
+        std::string inner;
+        dassert(srcml_unit_get_srcml_inner_io(unit, &inner, append), SRCML_STATUS_OK);
+        dassert(inner, "");
+        srcml_unit_free(unit);
+
+        unit = srcml_archive_read_unit(archive);
+        dassert(srcml_unit_get_filename(unit), std::string("d.cpp"));
+        srcml_unit_free(unit);
+
+        srcml_archive_close(archive);
+        srcml_archive_free(archive);
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
@@ -0,0 +1,263 @@
+/**
+ * @file test_srcml_unit_parse_async.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for srcml_executor and srcml_unit_parse_*_async
+*/
+
+#include <srcml.h>
+
+#include <dassert.hpp>
+
+#include <atomic>
+#include <thread>
+
+std::atomic<int> completed(0);
+std::atomic<int> canceled(0);
+std::atomic<bool> started(false);
+std::atomic<bool> release(false);
+
+void count_callback(srcml_unit*, int status, void*) {
+
+    if (status == SRCML_STATUS_CANCELED)
+        ++canceled;
+    else
+        ++completed;
+}
+
+// holds its executor thread until released
+void blocking_callback(srcml_unit* unit, int status, void* context) {
+
+    started = true;
+    while (!release)
+        std::this_thread::yield();
+
+    count_callback(unit, status, context);
+}
+
+int main(int, char* argv[]) {
+
+    const std::string srcml_a = R"(<unit revision=")" SRCML_VERSION_STRING R"(" language="C++"><expr_stmt><expr><name>a</name></expr>;</expr_stmt>
+</unit>)";
+
+    /*
+      srcml_executor_create
+    */
+    {
+        srcml_executor* executor = srcml_executor_create(2, 0);
+        dassert(!executor, false);
+        srcml_executor_free(executor);
+    }
+
+    {
+        dassert(srcml_executor_create(-1, 0), 0);
+        dassert(srcml_executor_create(1, -1), 0);
+    }
+
+    /*
+      srcml_unit_parse_memory_async
+    */
+    {
+        completed = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_archive_disable_hash(archive);
+        srcml_executor* executor = srcml_executor_create(4, 0);
+
+        const int num_units = 16;
+        srcml_unit* units[num_units];
+        srcml_parse_request* requests[num_units];
+        for (int i = 0; i < num_units; ++i) {
+            units[i] = srcml_unit_create(archive);
+            srcml_unit_set_language(units[i], "C++");
+            dassert(srcml_unit_parse_memory_async(executor, units[i], "a;\n", 3, count_callback, 0, &requests[i]), SRCML_STATUS_OK);
+        }
+
+        for (int i = 0; i < num_units; ++i) {
+            dassert(srcml_parse_request_wait(requests[i]), SRCML_STATUS_OK);
+            dassert(srcml_parse_request_is_done(requests[i]), 1);
+            dassert(srcml_unit_get_srcml_outer(units[i]), srcml_a);
+            srcml_parse_request_free(requests[i]);
+            srcml_unit_free(units[i]);
+        }
+        dassert(completed, num_units);
+
+        srcml_executor_free(executor);
+        srcml_archive_free(archive);
+    }
+
+    {
+        completed = 0;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_executor* executor = srcml_executor_create(1, 0);
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_parse_request* request = 0;
+
+        dassert(srcml_unit_parse_memory_async(executor, unit, "a;\n", 3, count_callback, 0, &request), SRCML_STATUS_OK);
+        dassert(srcml_parse_request_wait(request), SRCML_STATUS_UNSET_LANGUAGE);
+        dassert(completed, 1);
+
+        srcml_parse_request_free(request);
+        srcml_unit_free(unit);
+        srcml_executor_free(executor);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_executor* executor = srcml_executor_create(1, 0);
+        srcml_unit* unit = srcml_unit_create(archive);
+
+        dassert(srcml_unit_parse_memory_async(0, unit, "a;\n", 3, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_unit_parse_memory_async(executor, 0, "a;\n", 3, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_unit_parse_memory_async(executor, unit, 0, 3, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+        dassert(srcml_unit_parse_filename_async(executor, unit, 0, 0, 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+
+        srcml_unit_free(unit);
+        srcml_executor_free(executor);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      bounded queue and srcml_parse_request_cancel
+    */
+    {
+        completed = 0;
+        canceled = 0;
+        started = false;
+        release = false;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_executor* executor = srcml_executor_create(1, 1);
+        srcml_unit* units[3] = { srcml_unit_create(archive), srcml_unit_create(archive), srcml_unit_create(archive) };
+        for (auto unit : units)
+            srcml_unit_set_language(unit, "C++");
+        srcml_parse_request* requests[3] = { 0, 0, 0 };
+
+        // the only thread is held in the callback of the first request
+        dassert(srcml_unit_parse_memory_async(executor, units[0], "a;\n", 3, blocking_callback, 0, &requests[0]), SRCML_STATUS_OK);
+        while (!started)
+            std::this_thread::yield();
+
+        // queue of size one
+        dassert(srcml_unit_parse_memory_async(executor, units[1], "a;\n", 3, count_callback, 0, &requests[1]), SRCML_STATUS_OK);
+        dassert(srcml_unit_parse_memory_async(executor, units[2], "a;\n", 3, count_callback, 0, &requests[2]), SRCML_STATUS_BUSY);
+        dassert(requests[2], 0);
+
+        dassert(srcml_parse_request_cancel(requests[1]), SRCML_STATUS_OK);
+        dassert(srcml_parse_request_is_done(requests[1]), 1);
+        dassert(srcml_parse_request_wait(requests[1]), SRCML_STATUS_CANCELED);
+        dassert(canceled, 1);
+
+        dassert(srcml_parse_request_cancel(requests[0]), SRCML_STATUS_ERROR);
+        dassert(srcml_parse_request_is_done(requests[0]), 0);
+
+        release = true;
+        dassert(srcml_parse_request_wait(requests[0]), SRCML_STATUS_OK);
+        dassert(completed, 1);
+
+        srcml_parse_request_free(requests[0]);
+        srcml_parse_request_free(requests[1]);
+        for (auto unit : units)
+            srcml_unit_free(unit);
+        srcml_executor_free(executor);
+        srcml_archive_free(archive);
+    }
+
+    /*
+      srcml_executor_free cancels queued requests
+    */
+    {
+        completed = 0;
+        canceled = 0;
+        started = false;
+        release = false;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_executor* executor = srcml_executor_create(1, 0);
+        srcml_unit* units[2] = { srcml_unit_create(archive), srcml_unit_create(archive) };
+        for (auto unit : units)
+            srcml_unit_set_language(unit, "C++");
+
+        dassert(srcml_unit_parse_memory_async(executor, units[0], "a;\n", 3, blocking_callback, 0, 0), SRCML_STATUS_OK);
+        while (!started)
+            std::this_thread::yield();
+        dassert(srcml_unit_parse_memory_async(executor, units[1], "a;\n", 3, count_callback, 0, 0), SRCML_STATUS_OK);
+
+        std::thread releaser([]{
+            while (canceled == 0)
+                std::this_thread::yield();
+            release = true;
+        });
+
+        srcml_executor_free(executor);
+        releaser.join();
+
+        dassert(canceled, 1);
+        dassert(completed, 1);
+
+        for (auto unit : units)
+            srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+
+    /*
+      srcml_parse_request_cancel after srcml_executor_free
+    */
+    {
+        completed = 0;
+        canceled = 0;
+        started = false;
+        release = false;
+        srcml_archive* archive = srcml_archive_create();
+        srcml_executor* executor = srcml_executor_create(1, 0);
+        srcml_unit* units[2] = { srcml_unit_create(archive), srcml_unit_create(archive) };
+        for (auto unit : units)
+            srcml_unit_set_language(unit, "C++");
+
+        dassert(srcml_unit_parse_memory_async(executor, units[0], "a;\n", 3, blocking_callback, 0, 0), SRCML_STATUS_OK);
+        while (!started)
+            std::this_thread::yield();
+        srcml_parse_request* request = 0;
+        dassert(srcml_unit_parse_memory_async(executor, units[1], "a;\n", 3, count_callback, 0, &request), SRCML_STATUS_OK);
+
+        std::thread releaser([]{
+            while (canceled == 0)
+                std::this_thread::yield();
+            release = true;
+        });
+
+        srcml_executor_free(executor);
+        releaser.join();
+
+        // the request outlives the executor
+        dassert(srcml_parse_request_cancel(request), SRCML_STATUS_ERROR);
+        dassert(srcml_parse_request_wait(request), SRCML_STATUS_CANCELED);
+        dassert(canceled, 1);
+        srcml_parse_request_free(request);
+
+        for (auto unit : units)
+            srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file test_srcml_unit_parse_events.cpp
+ *
+ * @copyright Copyright (C) 2019 srcML, LLC. (www.srcML.org)
+ *
+ * The srcML Toolkit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The srcML Toolkit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the srcML Toolkit; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+
+  Test cases for srcml_unit_parse_*_events
+*/
+
+#include <srcml.h>
+
+#include <macros.hpp>
+
+#include <fstream>
+#include <string>
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include <dassert.hpp>
+
+// record the events as a string similar to srcML with positions
+void start_element(void* context, const char* prefix, const char* localname, const char* /* uri */,
+                   int num_attributes, const char** attributes,
+                   int start_line, int start_column, int end_line, int end_column) {
+
+    std::string& s = *(std::string*) context;
+
+    s += "<";
+    if (prefix[0] != '\0') {
+        s += prefix;
+        s += ":";
+    }
+    s += localname;
+    for (int i = 0; i < num_attributes; ++i) {
+        s += " ";
+        s += attributes[i * 2];
+        s += "=\"";
+        s += attributes[i * 2 + 1];
+        s += "\"";
+    }
+    s += " " + std::to_string(start_line) + ":" + std::to_string(start_column);
+    s += "-" + std::to_string(end_line) + ":" + std::to_string(end_column);
+    s += ">";
+}
+
+void end_element(void* context, const char* prefix, const char* localname, const char* /* uri */) {
+
+    std::string& s = *(std::string*) context;
+
+    s += "</";
+    if (prefix[0] != '\0') {
+        s += prefix;
+        s += ":";
+    }
+    s += localname;
+    s += ">";
+}
+
+void characters(void* context, const char* ch, int len) {
+
+    std::string& s = *(std::string*) context;
+
+    s.append(ch, len);
+}
+
+int main(int, char* argv[]) {
+
+    const std::string src = "a;\n";
+    const std::string events = std::string("<unit revision=\"") + srcml_version_string() + "\" language=\"C\" 1:1-1:1>"
+        "<expr_stmt 1:1-1:2><expr 1:1-1:1><name 1:1-1:1>a</name></expr>;</expr_stmt>\n</unit>";
+
+    const srcml_parse_handler handler = { start_element, end_element, characters };
+    const srcml_parse_handler text_handler = { 0, 0, characters };
+
+    {
+        std::ofstream project("project.c");
+        project << src;
+    }
+
+    /*
+      srcml_unit_parse_memory_events
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C");
+        std::string s;
+        dassert(srcml_unit_parse_memory_events(unit, src.c_str(), src.size(), &handler, &s), SRCML_STATUS_OK);
+        dassert(s, events);
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C");
+        std::string s;
+        dassert(srcml_unit_parse_memory_events(unit, src.c_str(), src.size(), &text_handler, &s), SRCML_STATUS_OK);
+        dassert(s, src);
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+        std::string s;
+        dassert(srcml_unit_parse_memory_events(unit, src.c_str(), src.size(), &handler, &s), SRCML_STATUS_UNSET_LANGUAGE);
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+        srcml_unit_set_language(unit, "C");
+        dassert(srcml_unit_parse_memory_events(unit, src.c_str(), src.size(), 0, 0), SRCML_STATUS_INVALID_ARGUMENT);
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    {
+        dassert(srcml_unit_parse_memory_events(0, src.c_str(), src.size(), &handler, 0), SRCML_STATUS_INVALID_ARGUMENT);
+    }
+
+    /*
+      srcml_unit_parse_filename_events
+    */
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+        std::string s;
+        dassert(srcml_unit_parse_filename_events(unit, "project.c", &handler, &s), SRCML_STATUS_OK);
+        dassert(s, events);
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    {
+        srcml_archive* archive = srcml_archive_create();
+        srcml_unit* unit = srcml_unit_create(archive);
+        dassert(srcml_unit_parse_filename_events(unit, 0, &handler, 0), SRCML_STATUS_INVALID_ARGUMENT);
+
+        srcml_unit_free(unit);
+        srcml_archive_free(archive);
+    }
+
+    UNLINK("project.c");
+
+    srcml_cleanup_globals();
+
+    return 0;
+}
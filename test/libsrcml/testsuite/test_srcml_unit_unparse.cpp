@@ -284,6 +284,34 @@ int main(int, char* argv[]) {
         srcml_memory_free(s);
     }
 
+    {
+        const std::string eol_srcml = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<unit xmlns="http://www.srcML.org/srcML/src" language="C"><expr_stmt><expr><name>a</name> <operator>&lt;</operator> <name>b</name> <operator>&amp;&amp;</operator> <literal type="char">'&#10;'</literal></expr>;</expr_stmt>
+<escape char="0xc"/><expr_stmt><expr><name>c</name></expr>;</expr_stmt>
+</unit>
+)";
+
+        const char* eols[] = { "\n", "\n", "\r", "\r\n" };
+        for (size_t eol = SOURCE_OUTPUT_EOL_AUTO; eol <= SOURCE_OUTPUT_EOL_CRLF; ++eol) {
+
+            char* s;
+            size_t size;
+            srcml_archive* archive = srcml_archive_create();
+            srcml_archive_read_open_memory(archive, eol_srcml.c_str(), eol_srcml.size());
+            srcml_unit* unit = srcml_archive_read_unit(archive);
+            srcml_unit_set_src_encoding(unit, "UTF-8");
+            srcml_unit_set_eol(unit, eol);
+
+            dassert(srcml_unit_unparse_memory(unit, &s, &size), SRCML_STATUS_OK);
+            dassert(std::string(s, size), std::string("a < b && '") + eols[eol] + "';" + eols[eol] + "\fc;" + eols[eol]);
+
+            srcml_unit_free(unit);
+            srcml_archive_close(archive);
+            srcml_archive_free(archive);
+            srcml_memory_free(s);
+        }
+    }
+
     {
         char* s;
         size_t size;